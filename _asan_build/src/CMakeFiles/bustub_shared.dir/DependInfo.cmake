@@ -0,0 +1,80 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/buffer/buffer_pool_manager_instance.cpp" "src/CMakeFiles/bustub_shared.dir/buffer/buffer_pool_manager_instance.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/buffer/buffer_pool_manager_instance.cpp.o.d"
+  "/root/repo/src/buffer/clock_replacer.cpp" "src/CMakeFiles/bustub_shared.dir/buffer/clock_replacer.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/buffer/clock_replacer.cpp.o.d"
+  "/root/repo/src/buffer/lru_replacer.cpp" "src/CMakeFiles/bustub_shared.dir/buffer/lru_replacer.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/buffer/lru_replacer.cpp.o.d"
+  "/root/repo/src/buffer/parallel_buffer_pool_manager.cpp" "src/CMakeFiles/bustub_shared.dir/buffer/parallel_buffer_pool_manager.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/buffer/parallel_buffer_pool_manager.cpp.o.d"
+  "/root/repo/src/catalog/column.cpp" "src/CMakeFiles/bustub_shared.dir/catalog/column.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/catalog/column.cpp.o.d"
+  "/root/repo/src/catalog/schema.cpp" "src/CMakeFiles/bustub_shared.dir/catalog/schema.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/catalog/schema.cpp.o.d"
+  "/root/repo/src/catalog/table_generator.cpp" "src/CMakeFiles/bustub_shared.dir/catalog/table_generator.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/catalog/table_generator.cpp.o.d"
+  "/root/repo/src/common/config.cpp" "src/CMakeFiles/bustub_shared.dir/common/config.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/common/config.cpp.o.d"
+  "/root/repo/src/common/util/string_util.cpp" "src/CMakeFiles/bustub_shared.dir/common/util/string_util.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/common/util/string_util.cpp.o.d"
+  "/root/repo/src/concurrency/key_range_lock.cpp" "src/CMakeFiles/bustub_shared.dir/concurrency/key_range_lock.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/concurrency/key_range_lock.cpp.o.d"
+  "/root/repo/src/concurrency/lock_manager.cpp" "src/CMakeFiles/bustub_shared.dir/concurrency/lock_manager.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/concurrency/lock_manager.cpp.o.d"
+  "/root/repo/src/concurrency/partition_executor.cpp" "src/CMakeFiles/bustub_shared.dir/concurrency/partition_executor.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/concurrency/partition_executor.cpp.o.d"
+  "/root/repo/src/concurrency/transaction_manager.cpp" "src/CMakeFiles/bustub_shared.dir/concurrency/transaction_manager.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/concurrency/transaction_manager.cpp.o.d"
+  "/root/repo/src/concurrency/version_store.cpp" "src/CMakeFiles/bustub_shared.dir/concurrency/version_store.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/concurrency/version_store.cpp.o.d"
+  "/root/repo/src/container/hash/extendible_hash_table.cpp" "src/CMakeFiles/bustub_shared.dir/container/hash/extendible_hash_table.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/container/hash/extendible_hash_table.cpp.o.d"
+  "/root/repo/src/container/hash/linear_probe_hash_table.cpp" "src/CMakeFiles/bustub_shared.dir/container/hash/linear_probe_hash_table.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/container/hash/linear_probe_hash_table.cpp.o.d"
+  "/root/repo/src/execution/aggregation_executor.cpp" "src/CMakeFiles/bustub_shared.dir/execution/aggregation_executor.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/execution/aggregation_executor.cpp.o.d"
+  "/root/repo/src/execution/delete_executor.cpp" "src/CMakeFiles/bustub_shared.dir/execution/delete_executor.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/execution/delete_executor.cpp.o.d"
+  "/root/repo/src/execution/distinct_executor.cpp" "src/CMakeFiles/bustub_shared.dir/execution/distinct_executor.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/execution/distinct_executor.cpp.o.d"
+  "/root/repo/src/execution/executor_factory.cpp" "src/CMakeFiles/bustub_shared.dir/execution/executor_factory.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/execution/executor_factory.cpp.o.d"
+  "/root/repo/src/execution/hash_join_executor.cpp" "src/CMakeFiles/bustub_shared.dir/execution/hash_join_executor.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/execution/hash_join_executor.cpp.o.d"
+  "/root/repo/src/execution/index_scan_executor.cpp" "src/CMakeFiles/bustub_shared.dir/execution/index_scan_executor.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/execution/index_scan_executor.cpp.o.d"
+  "/root/repo/src/execution/insert_executor.cpp" "src/CMakeFiles/bustub_shared.dir/execution/insert_executor.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/execution/insert_executor.cpp.o.d"
+  "/root/repo/src/execution/limit_executor.cpp" "src/CMakeFiles/bustub_shared.dir/execution/limit_executor.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/execution/limit_executor.cpp.o.d"
+  "/root/repo/src/execution/nested_index_join_executor.cpp" "src/CMakeFiles/bustub_shared.dir/execution/nested_index_join_executor.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/execution/nested_index_join_executor.cpp.o.d"
+  "/root/repo/src/execution/nested_loop_join_executor.cpp" "src/CMakeFiles/bustub_shared.dir/execution/nested_loop_join_executor.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/execution/nested_loop_join_executor.cpp.o.d"
+  "/root/repo/src/execution/seq_scan_executor.cpp" "src/CMakeFiles/bustub_shared.dir/execution/seq_scan_executor.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/execution/seq_scan_executor.cpp.o.d"
+  "/root/repo/src/execution/update_executor.cpp" "src/CMakeFiles/bustub_shared.dir/execution/update_executor.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/execution/update_executor.cpp.o.d"
+  "/root/repo/src/recovery/checkpoint_manager.cpp" "src/CMakeFiles/bustub_shared.dir/recovery/checkpoint_manager.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/recovery/checkpoint_manager.cpp.o.d"
+  "/root/repo/src/recovery/log_manager.cpp" "src/CMakeFiles/bustub_shared.dir/recovery/log_manager.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/recovery/log_manager.cpp.o.d"
+  "/root/repo/src/recovery/log_recovery.cpp" "src/CMakeFiles/bustub_shared.dir/recovery/log_recovery.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/recovery/log_recovery.cpp.o.d"
+  "/root/repo/src/storage/disk/disk_manager.cpp" "src/CMakeFiles/bustub_shared.dir/storage/disk/disk_manager.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/disk/disk_manager.cpp.o.d"
+  "/root/repo/src/storage/index/b_plus_tree.cpp" "src/CMakeFiles/bustub_shared.dir/storage/index/b_plus_tree.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/index/b_plus_tree.cpp.o.d"
+  "/root/repo/src/storage/index/b_plus_tree_index.cpp" "src/CMakeFiles/bustub_shared.dir/storage/index/b_plus_tree_index.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/index/b_plus_tree_index.cpp.o.d"
+  "/root/repo/src/storage/index/extendible_hash_table_index.cpp" "src/CMakeFiles/bustub_shared.dir/storage/index/extendible_hash_table_index.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/index/extendible_hash_table_index.cpp.o.d"
+  "/root/repo/src/storage/index/generic_key.cpp" "src/CMakeFiles/bustub_shared.dir/storage/index/generic_key.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/index/generic_key.cpp.o.d"
+  "/root/repo/src/storage/index/index_iterator.cpp" "src/CMakeFiles/bustub_shared.dir/storage/index/index_iterator.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/index/index_iterator.cpp.o.d"
+  "/root/repo/src/storage/index/linear_probe_hash_table_index.cpp" "src/CMakeFiles/bustub_shared.dir/storage/index/linear_probe_hash_table_index.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/index/linear_probe_hash_table_index.cpp.o.d"
+  "/root/repo/src/storage/page/b_plus_tree_internal_page.cpp" "src/CMakeFiles/bustub_shared.dir/storage/page/b_plus_tree_internal_page.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/page/b_plus_tree_internal_page.cpp.o.d"
+  "/root/repo/src/storage/page/b_plus_tree_leaf_page.cpp" "src/CMakeFiles/bustub_shared.dir/storage/page/b_plus_tree_leaf_page.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/page/b_plus_tree_leaf_page.cpp.o.d"
+  "/root/repo/src/storage/page/b_plus_tree_page.cpp" "src/CMakeFiles/bustub_shared.dir/storage/page/b_plus_tree_page.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/page/b_plus_tree_page.cpp.o.d"
+  "/root/repo/src/storage/page/hash_table_block_page.cpp" "src/CMakeFiles/bustub_shared.dir/storage/page/hash_table_block_page.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/page/hash_table_block_page.cpp.o.d"
+  "/root/repo/src/storage/page/hash_table_bucket_page.cpp" "src/CMakeFiles/bustub_shared.dir/storage/page/hash_table_bucket_page.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/page/hash_table_bucket_page.cpp.o.d"
+  "/root/repo/src/storage/page/hash_table_directory_page.cpp" "src/CMakeFiles/bustub_shared.dir/storage/page/hash_table_directory_page.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/page/hash_table_directory_page.cpp.o.d"
+  "/root/repo/src/storage/page/hash_table_header_page.cpp" "src/CMakeFiles/bustub_shared.dir/storage/page/hash_table_header_page.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/page/hash_table_header_page.cpp.o.d"
+  "/root/repo/src/storage/page/header_page.cpp" "src/CMakeFiles/bustub_shared.dir/storage/page/header_page.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/page/header_page.cpp.o.d"
+  "/root/repo/src/storage/page/table_page.cpp" "src/CMakeFiles/bustub_shared.dir/storage/page/table_page.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/page/table_page.cpp.o.d"
+  "/root/repo/src/storage/table/table_heap.cpp" "src/CMakeFiles/bustub_shared.dir/storage/table/table_heap.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/table/table_heap.cpp.o.d"
+  "/root/repo/src/storage/table/table_iterator.cpp" "src/CMakeFiles/bustub_shared.dir/storage/table/table_iterator.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/table/table_iterator.cpp.o.d"
+  "/root/repo/src/storage/table/tuple.cpp" "src/CMakeFiles/bustub_shared.dir/storage/table/tuple.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/storage/table/tuple.cpp.o.d"
+  "/root/repo/src/type/bigint_type.cpp" "src/CMakeFiles/bustub_shared.dir/type/bigint_type.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/type/bigint_type.cpp.o.d"
+  "/root/repo/src/type/boolean_type.cpp" "src/CMakeFiles/bustub_shared.dir/type/boolean_type.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/type/boolean_type.cpp.o.d"
+  "/root/repo/src/type/decimal_type.cpp" "src/CMakeFiles/bustub_shared.dir/type/decimal_type.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/type/decimal_type.cpp.o.d"
+  "/root/repo/src/type/integer_parent_type.cpp" "src/CMakeFiles/bustub_shared.dir/type/integer_parent_type.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/type/integer_parent_type.cpp.o.d"
+  "/root/repo/src/type/integer_type.cpp" "src/CMakeFiles/bustub_shared.dir/type/integer_type.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/type/integer_type.cpp.o.d"
+  "/root/repo/src/type/smallint_type.cpp" "src/CMakeFiles/bustub_shared.dir/type/smallint_type.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/type/smallint_type.cpp.o.d"
+  "/root/repo/src/type/timestamp_type.cpp" "src/CMakeFiles/bustub_shared.dir/type/timestamp_type.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/type/timestamp_type.cpp.o.d"
+  "/root/repo/src/type/tinyint_type.cpp" "src/CMakeFiles/bustub_shared.dir/type/tinyint_type.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/type/tinyint_type.cpp.o.d"
+  "/root/repo/src/type/type.cpp" "src/CMakeFiles/bustub_shared.dir/type/type.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/type/type.cpp.o.d"
+  "/root/repo/src/type/value.cpp" "src/CMakeFiles/bustub_shared.dir/type/value.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/type/value.cpp.o.d"
+  "/root/repo/src/type/varlen_type.cpp" "src/CMakeFiles/bustub_shared.dir/type/varlen_type.cpp.o" "gcc" "src/CMakeFiles/bustub_shared.dir/type/varlen_type.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_asan_build/src/CMakeFiles/thirdparty_murmur3.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
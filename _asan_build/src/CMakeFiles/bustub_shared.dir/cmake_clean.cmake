@@ -0,0 +1,131 @@
+file(REMOVE_RECURSE
+  "../lib/libbustub_shared.pdb"
+  "../lib/libbustub_shared.so"
+  "CMakeFiles/bustub_shared.dir/buffer/buffer_pool_manager_instance.cpp.o"
+  "CMakeFiles/bustub_shared.dir/buffer/buffer_pool_manager_instance.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/buffer/clock_replacer.cpp.o"
+  "CMakeFiles/bustub_shared.dir/buffer/clock_replacer.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/buffer/lru_replacer.cpp.o"
+  "CMakeFiles/bustub_shared.dir/buffer/lru_replacer.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/buffer/parallel_buffer_pool_manager.cpp.o"
+  "CMakeFiles/bustub_shared.dir/buffer/parallel_buffer_pool_manager.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/catalog/column.cpp.o"
+  "CMakeFiles/bustub_shared.dir/catalog/column.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/catalog/schema.cpp.o"
+  "CMakeFiles/bustub_shared.dir/catalog/schema.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/catalog/table_generator.cpp.o"
+  "CMakeFiles/bustub_shared.dir/catalog/table_generator.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/common/config.cpp.o"
+  "CMakeFiles/bustub_shared.dir/common/config.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/common/util/string_util.cpp.o"
+  "CMakeFiles/bustub_shared.dir/common/util/string_util.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/concurrency/key_range_lock.cpp.o"
+  "CMakeFiles/bustub_shared.dir/concurrency/key_range_lock.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/concurrency/lock_manager.cpp.o"
+  "CMakeFiles/bustub_shared.dir/concurrency/lock_manager.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/concurrency/partition_executor.cpp.o"
+  "CMakeFiles/bustub_shared.dir/concurrency/partition_executor.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/concurrency/transaction_manager.cpp.o"
+  "CMakeFiles/bustub_shared.dir/concurrency/transaction_manager.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/concurrency/version_store.cpp.o"
+  "CMakeFiles/bustub_shared.dir/concurrency/version_store.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/container/hash/extendible_hash_table.cpp.o"
+  "CMakeFiles/bustub_shared.dir/container/hash/extendible_hash_table.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/container/hash/linear_probe_hash_table.cpp.o"
+  "CMakeFiles/bustub_shared.dir/container/hash/linear_probe_hash_table.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/execution/aggregation_executor.cpp.o"
+  "CMakeFiles/bustub_shared.dir/execution/aggregation_executor.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/execution/delete_executor.cpp.o"
+  "CMakeFiles/bustub_shared.dir/execution/delete_executor.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/execution/distinct_executor.cpp.o"
+  "CMakeFiles/bustub_shared.dir/execution/distinct_executor.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/execution/executor_factory.cpp.o"
+  "CMakeFiles/bustub_shared.dir/execution/executor_factory.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/execution/hash_join_executor.cpp.o"
+  "CMakeFiles/bustub_shared.dir/execution/hash_join_executor.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/execution/index_scan_executor.cpp.o"
+  "CMakeFiles/bustub_shared.dir/execution/index_scan_executor.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/execution/insert_executor.cpp.o"
+  "CMakeFiles/bustub_shared.dir/execution/insert_executor.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/execution/limit_executor.cpp.o"
+  "CMakeFiles/bustub_shared.dir/execution/limit_executor.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/execution/nested_index_join_executor.cpp.o"
+  "CMakeFiles/bustub_shared.dir/execution/nested_index_join_executor.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/execution/nested_loop_join_executor.cpp.o"
+  "CMakeFiles/bustub_shared.dir/execution/nested_loop_join_executor.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/execution/seq_scan_executor.cpp.o"
+  "CMakeFiles/bustub_shared.dir/execution/seq_scan_executor.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/execution/update_executor.cpp.o"
+  "CMakeFiles/bustub_shared.dir/execution/update_executor.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/recovery/checkpoint_manager.cpp.o"
+  "CMakeFiles/bustub_shared.dir/recovery/checkpoint_manager.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/recovery/log_manager.cpp.o"
+  "CMakeFiles/bustub_shared.dir/recovery/log_manager.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/recovery/log_recovery.cpp.o"
+  "CMakeFiles/bustub_shared.dir/recovery/log_recovery.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/disk/disk_manager.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/disk/disk_manager.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/index/b_plus_tree.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/index/b_plus_tree.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/index/b_plus_tree_index.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/index/b_plus_tree_index.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/index/extendible_hash_table_index.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/index/extendible_hash_table_index.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/index/generic_key.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/index/generic_key.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/index/index_iterator.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/index/index_iterator.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/index/linear_probe_hash_table_index.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/index/linear_probe_hash_table_index.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/page/b_plus_tree_internal_page.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/page/b_plus_tree_internal_page.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/page/b_plus_tree_leaf_page.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/page/b_plus_tree_leaf_page.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/page/b_plus_tree_page.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/page/b_plus_tree_page.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/page/hash_table_block_page.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/page/hash_table_block_page.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/page/hash_table_bucket_page.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/page/hash_table_bucket_page.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/page/hash_table_directory_page.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/page/hash_table_directory_page.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/page/hash_table_header_page.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/page/hash_table_header_page.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/page/header_page.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/page/header_page.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/page/table_page.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/page/table_page.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/table/table_heap.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/table/table_heap.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/table/table_iterator.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/table/table_iterator.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/storage/table/tuple.cpp.o"
+  "CMakeFiles/bustub_shared.dir/storage/table/tuple.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/type/bigint_type.cpp.o"
+  "CMakeFiles/bustub_shared.dir/type/bigint_type.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/type/boolean_type.cpp.o"
+  "CMakeFiles/bustub_shared.dir/type/boolean_type.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/type/decimal_type.cpp.o"
+  "CMakeFiles/bustub_shared.dir/type/decimal_type.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/type/integer_parent_type.cpp.o"
+  "CMakeFiles/bustub_shared.dir/type/integer_parent_type.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/type/integer_type.cpp.o"
+  "CMakeFiles/bustub_shared.dir/type/integer_type.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/type/smallint_type.cpp.o"
+  "CMakeFiles/bustub_shared.dir/type/smallint_type.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/type/timestamp_type.cpp.o"
+  "CMakeFiles/bustub_shared.dir/type/timestamp_type.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/type/tinyint_type.cpp.o"
+  "CMakeFiles/bustub_shared.dir/type/tinyint_type.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/type/type.cpp.o"
+  "CMakeFiles/bustub_shared.dir/type/type.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/type/value.cpp.o"
+  "CMakeFiles/bustub_shared.dir/type/value.cpp.o.d"
+  "CMakeFiles/bustub_shared.dir/type/varlen_type.cpp.o"
+  "CMakeFiles/bustub_shared.dir/type/varlen_type.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/bustub_shared.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
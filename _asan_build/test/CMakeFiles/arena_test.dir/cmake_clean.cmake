@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/arena_test.dir/common/arena_test.cpp.o"
+  "CMakeFiles/arena_test.dir/common/arena_test.cpp.o.d"
+  "arena_test"
+  "arena_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/arena_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/b_plus_tree_delete_test.dir/storage/b_plus_tree_delete_test.cpp.o"
+  "CMakeFiles/b_plus_tree_delete_test.dir/storage/b_plus_tree_delete_test.cpp.o.d"
+  "b_plus_tree_delete_test"
+  "b_plus_tree_delete_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/b_plus_tree_delete_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
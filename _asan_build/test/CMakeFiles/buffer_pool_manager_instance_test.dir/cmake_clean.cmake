@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/buffer_pool_manager_instance_test.dir/buffer/buffer_pool_manager_instance_test.cpp.o"
+  "CMakeFiles/buffer_pool_manager_instance_test.dir/buffer/buffer_pool_manager_instance_test.cpp.o.d"
+  "buffer_pool_manager_instance_test"
+  "buffer_pool_manager_instance_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/buffer_pool_manager_instance_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
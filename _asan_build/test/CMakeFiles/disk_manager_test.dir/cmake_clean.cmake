@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/disk_manager_test.dir/storage/disk_manager_test.cpp.o"
+  "CMakeFiles/disk_manager_test.dir/storage/disk_manager_test.cpp.o.d"
+  "disk_manager_test"
+  "disk_manager_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/disk_manager_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/external_sorter_test.dir/storage/external_sorter_test.cpp.o"
+  "CMakeFiles/external_sorter_test.dir/storage/external_sorter_test.cpp.o.d"
+  "external_sorter_test"
+  "external_sorter_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/external_sorter_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/hash_table_page_test.dir/container/hash_table_page_test.cpp.o"
+  "CMakeFiles/hash_table_page_test.dir/container/hash_table_page_test.cpp.o.d"
+  "hash_table_page_test"
+  "hash_table_page_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/hash_table_page_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/hash_util_test.dir/common/hash_util_test.cpp.o"
+  "CMakeFiles/hash_util_test.dir/common/hash_util_test.cpp.o.d"
+  "hash_util_test"
+  "hash_util_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/hash_util_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
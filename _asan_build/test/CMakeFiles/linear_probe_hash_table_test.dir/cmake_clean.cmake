@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/linear_probe_hash_table_test.dir/container/linear_probe_hash_table_test.cpp.o"
+  "CMakeFiles/linear_probe_hash_table_test.dir/container/linear_probe_hash_table_test.cpp.o.d"
+  "linear_probe_hash_table_test"
+  "linear_probe_hash_table_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/linear_probe_hash_table_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/parallel_buffer_pool_manager_test.dir/buffer/parallel_buffer_pool_manager_test.cpp.o"
+  "CMakeFiles/parallel_buffer_pool_manager_test.dir/buffer/parallel_buffer_pool_manager_test.cpp.o.d"
+  "parallel_buffer_pool_manager_test"
+  "parallel_buffer_pool_manager_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/parallel_buffer_pool_manager_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/recovery_test.dir/recovery/recovery_test.cpp.o"
+  "CMakeFiles/recovery_test.dir/recovery/recovery_test.cpp.o.d"
+  "recovery_test"
+  "recovery_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/recovery_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
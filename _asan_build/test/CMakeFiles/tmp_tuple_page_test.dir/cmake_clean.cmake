@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/tmp_tuple_page_test.dir/storage/tmp_tuple_page_test.cpp.o"
+  "CMakeFiles/tmp_tuple_page_test.dir/storage/tmp_tuple_page_test.cpp.o.d"
+  "tmp_tuple_page_test"
+  "tmp_tuple_page_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/tmp_tuple_page_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,58 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/test
+# Build directory: /root/repo/_asan_build/test
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(buffer_pool_manager_instance_test "/root/repo/_asan_build/test/buffer_pool_manager_instance_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/buffer_pool_manager_instance_test.xml")
+set_tests_properties(buffer_pool_manager_instance_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(clock_replacer_test "/root/repo/_asan_build/test/clock_replacer_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/clock_replacer_test.xml")
+set_tests_properties(clock_replacer_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(lru_replacer_test "/root/repo/_asan_build/test/lru_replacer_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/lru_replacer_test.xml")
+set_tests_properties(lru_replacer_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(parallel_buffer_pool_manager_test "/root/repo/_asan_build/test/parallel_buffer_pool_manager_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/parallel_buffer_pool_manager_test.xml")
+set_tests_properties(parallel_buffer_pool_manager_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(catalog_test "/root/repo/_asan_build/test/catalog_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/catalog_test.xml")
+set_tests_properties(catalog_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(arena_test "/root/repo/_asan_build/test/arena_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/arena_test.xml")
+set_tests_properties(arena_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(hash_util_test "/root/repo/_asan_build/test/hash_util_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/hash_util_test.xml")
+set_tests_properties(hash_util_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(rwlatch_test "/root/repo/_asan_build/test/rwlatch_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/rwlatch_test.xml")
+set_tests_properties(rwlatch_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(lock_manager_test "/root/repo/_asan_build/test/lock_manager_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/lock_manager_test.xml")
+set_tests_properties(lock_manager_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(transaction_test "/root/repo/_asan_build/test/transaction_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/transaction_test.xml")
+set_tests_properties(transaction_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(hash_table_page_test "/root/repo/_asan_build/test/hash_table_page_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/hash_table_page_test.xml")
+set_tests_properties(hash_table_page_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(hash_table_test "/root/repo/_asan_build/test/hash_table_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/hash_table_test.xml")
+set_tests_properties(hash_table_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(linear_probe_hash_table_test "/root/repo/_asan_build/test/linear_probe_hash_table_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/linear_probe_hash_table_test.xml")
+set_tests_properties(linear_probe_hash_table_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(executor_test "/root/repo/_asan_build/test/executor_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/executor_test.xml")
+set_tests_properties(executor_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(starter_test "/root/repo/_asan_build/test/starter_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/starter_test.xml")
+set_tests_properties(starter_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(recovery_test "/root/repo/_asan_build/test/recovery_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/recovery_test.xml")
+set_tests_properties(recovery_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(b_plus_tree_concurrent_test "/root/repo/_asan_build/test/b_plus_tree_concurrent_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/b_plus_tree_concurrent_test.xml")
+set_tests_properties(b_plus_tree_concurrent_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(b_plus_tree_delete_test "/root/repo/_asan_build/test/b_plus_tree_delete_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/b_plus_tree_delete_test.xml")
+set_tests_properties(b_plus_tree_delete_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(b_plus_tree_insert_test "/root/repo/_asan_build/test/b_plus_tree_insert_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/b_plus_tree_insert_test.xml")
+set_tests_properties(b_plus_tree_insert_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(b_plus_tree_print_test "/root/repo/_asan_build/test/b_plus_tree_print_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/b_plus_tree_print_test.xml")
+set_tests_properties(b_plus_tree_print_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(disk_manager_test "/root/repo/_asan_build/test/disk_manager_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/disk_manager_test.xml")
+set_tests_properties(disk_manager_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(external_sorter_test "/root/repo/_asan_build/test/external_sorter_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/external_sorter_test.xml")
+set_tests_properties(external_sorter_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(generic_key_test "/root/repo/_asan_build/test/generic_key_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/generic_key_test.xml")
+set_tests_properties(generic_key_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(tmp_tuple_page_test "/root/repo/_asan_build/test/tmp_tuple_page_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/tmp_tuple_page_test.xml")
+set_tests_properties(tmp_tuple_page_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(tuple_test "/root/repo/_asan_build/test/tuple_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/tuple_test.xml")
+set_tests_properties(tuple_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(type_test "/root/repo/_asan_build/test/type_test" "--gtest_color=yes" "--gtest_output=xml:/root/repo/_asan_build/test/type_test.xml")
+set_tests_properties(type_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;58;add_test;/root/repo/test/CMakeLists.txt;0;")
@@ -12,7 +12,10 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 
+#include <algorithm>
+
 #include "common/macros.h"
+#include "recovery/log_recovery.h"
 
 namespace bustub {
 
@@ -49,26 +52,90 @@ BufferPoolManagerInstance::~BufferPoolManagerInstance() {
 
 bool BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) {
   // Make sure you call DiskManager::WritePage!
-  latch_.lock();
   if (page_id == INVALID_PAGE_ID) {
-    latch_.unlock();
     return false;
   }
+  latch_.lock();
+  while (true) {
+    auto kv = page_table_.find(page_id);
+    if (kv == page_table_.end()) {
+      latch_.unlock();
+      return false;
+    }
+    Page *cur_frame = &pages_[kv->second];
+    if (!cur_frame->IsDirty()) {
+      break;
+    }
+    lsn_t page_lsn = cur_frame->GetLSN();
+    if (!NeedsLogForce(page_lsn)) {
+      disk_manager_->WritePage(page_id, cur_frame->data_);
+      cur_frame->is_dirty_ = false;
+      cur_frame->rec_lsn_ = INVALID_LSN;
+      break;
+    }
+    // Wait for the log without the latch, then look at the page again, which may have changed meanwhile.
+    latch_.unlock();
+    ForceLogBeforeWrite(page_lsn);
+    latch_.lock();
+  }
+
+  latch_.unlock();
+  return true;
+}
+
+bool BufferPoolManagerInstance::FlushPageFuzzy(page_id_t page_id) {
+  // Pin the page so that it cannot be evicted while we copy it out.
+  latch_.lock();
   auto kv = page_table_.find(page_id);
   if (kv == page_table_.end()) {
     latch_.unlock();
     return false;
   }
-  frame_id_t frame_id = kv->second;
-  Page *cur_frame = &pages_[frame_id];
-  if (cur_frame->IsDirty()) {
-    disk_manager_->WritePage(page_id, cur_frame->data_);
-  }
+  Page *page = &pages_[kv->second];
+  page->pin_count_++;
+  replacer_->Pin(kv->second);
+  latch_.unlock();
 
+  // Take a consistent copy under the page latch. Changes made after the copy re-dirty the page and set a new
+  // recovery LSN, so they are picked up by a later flush.
+  char page_copy[PAGE_SIZE];
+  page->RLatch();
+  memcpy(page_copy, page->GetData(), PAGE_SIZE);
+  lsn_t page_lsn = page->GetLSN();
+  latch_.lock();
+  page->is_dirty_ = false;
+  page->rec_lsn_ = INVALID_LSN;
   latch_.unlock();
+  page->RUnlatch();
+
+  ForceLogBeforeWrite(page_lsn);
+  disk_manager_->WritePage(page_id, page_copy);
+  UnpinPgImp(page_id, false);
   return true;
 }
 
+void BufferPoolManagerInstance::GetDirtyPageTable(std::unordered_map<page_id_t, lsn_t> *dirty_pages) {
+  std::scoped_lock lock(latch_);
+  for (size_t i = 0; i < pool_size_; i++) {
+    lsn_t rec_lsn = pages_[i].rec_lsn_;
+    if (pages_[i].page_id_ != INVALID_PAGE_ID && rec_lsn != INVALID_LSN) {
+      (*dirty_pages)[pages_[i].page_id_] = rec_lsn;
+    }
+  }
+}
+
+void BufferPoolManagerInstance::ForceLogBeforeWrite(lsn_t page_lsn) {
+  if (NeedsLogForce(page_lsn)) {
+    log_manager_->ForceFlush(page_lsn);
+  }
+}
+
+bool BufferPoolManagerInstance::NeedsLogForce(lsn_t page_lsn) const {
+  // As in ForceFlush, nothing beyond the last appended record can ever become persistent, so it is not waited for.
+  return enable_logging && log_manager_ != nullptr &&
+         std::min<lsn_t>(page_lsn, log_manager_->GetNextLSN() - 1) > log_manager_->GetPersistentLSN();
+}
+
 void BufferPoolManagerInstance::FlushAllPgsImp() {
   // You can do it!
   for (const auto &kv : page_table_) {
@@ -83,22 +150,31 @@ Page *BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) {
   // 3.   Update P's metadata, zero out memory and add P to the page table.
   // 4.   Set the page ID output parameter. Return a pointer to P.
   latch_.lock();
-  bool all_pinned = true;
-  for (size_t i = 0; i < pool_size_; i++) {
-    if (pages_[i].GetPinCount() == 0) {
-      all_pinned = false;
+  frame_id_t frame_id;
+  while (true) {
+    bool all_pinned = true;
+    for (size_t i = 0; i < pool_size_; i++) {
+      if (pages_[i].GetPinCount() == 0) {
+        all_pinned = false;
+      }
+    }
+    if (all_pinned) {
+      latch_.unlock();
+      return nullptr;
+    }
+    lsn_t force_lsn = INVALID_LSN;
+    if (FindReplaceFrameL(&frame_id, &force_lsn)) {
+      break;
+    }
+    if (force_lsn == INVALID_LSN) {
+      latch_.unlock();
+      return nullptr;
     }
-  }
-  if (all_pinned) {
     latch_.unlock();
-    return nullptr;
+    ForceLogBeforeWrite(force_lsn);
+    latch_.lock();
   }
   *page_id = AllocatePage();
-  frame_id_t frame_id;
-  if (!FindReplaceFrameL(&frame_id)) {
-    latch_.unlock();
-    return nullptr;
-  }
 
   Page *page = &pages_[frame_id];
   page_table_[*page_id] = frame_id;
@@ -121,20 +197,30 @@ Page *BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) {
   // 3.     Delete R from the page table and insert P.
   // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
   latch_.lock();
-  auto kv = page_table_.find(page_id);
   Page *page;
   frame_id_t frame_id;
-  if (kv != page_table_.end()) {
-    frame_id = kv->second;
-    page = &pages_[frame_id];
-    page->pin_count_++;
-    replacer_->Pin(frame_id);
-    latch_.unlock();
-    return page;
-  }
-  if (!FindReplaceFrameL(&frame_id)) {
+  while (true) {
+    auto kv = page_table_.find(page_id);
+    if (kv != page_table_.end()) {
+      frame_id = kv->second;
+      page = &pages_[frame_id];
+      page->pin_count_++;
+      replacer_->Pin(frame_id);
+      latch_.unlock();
+      return page;
+    }
+    lsn_t force_lsn = INVALID_LSN;
+    if (FindReplaceFrameL(&frame_id, &force_lsn)) {
+      break;
+    }
+    if (force_lsn == INVALID_LSN) {
+      latch_.unlock();
+      return nullptr;
+    }
+    // Another thread may read the page in while the latch is dropped, so it is looked up again.
     latch_.unlock();
-    return nullptr;
+    ForceLogBeforeWrite(force_lsn);
+    latch_.lock();
   }
   page_table_[page_id] = frame_id;
   page = &pages_[frame_id];
@@ -143,11 +229,24 @@ Page *BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) {
   page->pin_count_ = 1;
   page->ResetMemory();
   disk_manager_->ReadPage(page_id, page->data_);
+  LogRecovery *log_recovery = log_recovery_;
+  if (log_recovery == nullptr) {
+    latch_.unlock();
+    return page;
+  }
+  // Instant restart: replay the pending log records of the page before anyone else can latch it. The frame was just
+  // taken from the free list or the replacer, so nobody holds its latch and taking it here cannot block.
+  page->WLatch();
   latch_.unlock();
+  if (log_recovery->RedoPage(page)) {
+    std::scoped_lock lock(latch_);
+    page->is_dirty_ = true;
+  }
+  page->WUnlatch();
   return page;
 }
 
-bool BufferPoolManagerInstance::FindReplaceFrameL(frame_id_t *frame_id) {
+bool BufferPoolManagerInstance::FindReplaceFrameL(frame_id_t *frame_id, lsn_t *force_lsn) {
   if (!free_list_.empty()) {
     *frame_id = *free_list_.begin();
     free_list_.erase(free_list_.begin());
@@ -155,10 +254,17 @@ bool BufferPoolManagerInstance::FindReplaceFrameL(frame_id_t *frame_id) {
     if (!replacer_->Victim(frame_id)) {
       return false;
     }
-    page_table_.erase(pages_[*frame_id].page_id_);
-    if (pages_[*frame_id].IsDirty()) {
-      disk_manager_->WritePage(pages_[*frame_id].GetPageId(), pages_[*frame_id].data_);
+    Page *victim = &pages_[*frame_id];
+    if (victim->IsDirty() && NeedsLogForce(victim->GetLSN())) {
+      replacer_->Unpin(*frame_id);
+      *force_lsn = victim->GetLSN();
+      return false;
+    }
+    page_table_.erase(victim->page_id_);
+    if (victim->IsDirty()) {
+      disk_manager_->WritePage(victim->GetPageId(), victim->data_);
     }
+    pages_[*frame_id].rec_lsn_ = INVALID_LSN;
   }
   return true;
 }
@@ -170,27 +276,40 @@ bool BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) {
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
   latch_.lock();
-  auto kv = page_table_.find(page_id);
-  if (kv == page_table_.end()) {
-    latch_.unlock();
-    return true;
-  }
-  frame_id_t frame_id = kv->second;
-  Page *page = &pages_[frame_id];
-  if (page->GetPinCount() > 0) {
+  frame_id_t frame_id;
+  Page *page;
+  while (true) {
+    auto kv = page_table_.find(page_id);
+    if (kv == page_table_.end()) {
+      latch_.unlock();
+      return true;
+    }
+    frame_id = kv->second;
+    page = &pages_[frame_id];
+    if (page->GetPinCount() > 0) {
+      latch_.unlock();
+      return false;
+    }
+    if (!page->IsDirty() || !NeedsLogForce(page->GetLSN())) {
+      break;
+    }
+    lsn_t page_lsn = page->GetLSN();
     latch_.unlock();
-    return false;
+    ForceLogBeforeWrite(page_lsn);
+    latch_.lock();
   }
   if (page->IsDirty()) {
     disk_manager_->WritePage(page->GetPageId(), page->GetData());
   }
   page->is_dirty_ = false;
+  page->rec_lsn_ = INVALID_LSN;
   page->pin_count_ = 0;
   page->page_id_ = INVALID_PAGE_ID;
   page->ResetMemory();
 
+  // Frames on the free list are handed out without the replacer, which must not pick them as victims meanwhile.
   free_list_.emplace_back(frame_id);
-  replacer_->Unpin(frame_id);
+  replacer_->Pin(frame_id);
   page_table_.erase(page_id);
   DeallocatePage(page_id);
   latch_.unlock();
@@ -215,6 +334,18 @@ bool BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) {
   return true;
 }
 
+void BufferPoolManagerInstance::ReservePageIds(page_id_t page_id) {
+  std::scoped_lock lock(latch_);
+  // The first id above page_id that maps back to this instance.
+  auto num_instances = static_cast<page_id_t>(num_instances_);
+  page_id_t next_page_id = page_id + 1;
+  next_page_id += (static_cast<page_id_t>(instance_index_) - next_page_id % num_instances + num_instances) %
+                  num_instances;
+  if (next_page_id > next_page_id_) {
+    next_page_id_ = next_page_id;
+  }
+}
+
 page_id_t BufferPoolManagerInstance::AllocatePage() {
   const page_id_t next_page_id = next_page_id_;
   next_page_id_ += num_instances_;
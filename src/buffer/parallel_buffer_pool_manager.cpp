@@ -38,6 +38,28 @@ size_t ParallelBufferPoolManager::GetPoolSize() {
   return num_instances_ * pool_size_;
 }
 
+void ParallelBufferPoolManager::GetDirtyPageTable(std::unordered_map<page_id_t, lsn_t> *dirty_pages) {
+  for (size_t i = 0; i < num_instances_; i++) {
+    manager_instances_[i]->GetDirtyPageTable(dirty_pages);
+  }
+}
+
+bool ParallelBufferPoolManager::FlushPageFuzzy(page_id_t page_id) {
+  return GetBufferPoolManager(page_id)->FlushPageFuzzy(page_id);
+}
+
+void ParallelBufferPoolManager::SetLogRecovery(LogRecovery *log_recovery) {
+  for (size_t i = 0; i < num_instances_; i++) {
+    manager_instances_[i]->SetLogRecovery(log_recovery);
+  }
+}
+
+void ParallelBufferPoolManager::ReservePageIds(page_id_t page_id) {
+  for (size_t i = 0; i < num_instances_; i++) {
+    manager_instances_[i]->ReservePageIds(page_id);
+  }
+}
+
 BufferPoolManager *ParallelBufferPoolManager::GetBufferPoolManager(page_id_t page_id) {
   // Get BufferPoolManager responsible for handling given page id. You can use this method in your other methods.
   return manager_instances_[page_id % num_instances_];
@@ -18,6 +18,12 @@ std::atomic<bool> enable_logging(false);
 
 std::chrono::duration<int64_t> log_timeout = std::chrono::seconds(1);
 
+std::chrono::milliseconds checkpoint_flush_interval = std::chrono::milliseconds(10);
+
+size_t checkpoint_flush_batch = 16;
+
 std::chrono::milliseconds cycle_detection_interval = std::chrono::milliseconds(50);
 
+size_t lock_escalation_threshold = 1000;
+
 }  // namespace bustub
@@ -0,0 +1,201 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// key_range_lock.cpp
+//
+// Identification: src/concurrency/key_range_lock.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "concurrency/key_range_lock.h"
+
+#include "storage/index/generic_key.h"
+
+namespace bustub {
+
+template <typename KeyType, typename KeyComparator>
+bool KeyRangeLockTable<KeyType, KeyComparator>::LockRange(Transaction *txn, LockMode lock_mode, const KeyType &low,
+                                                          const KeyType &high) {
+  BUSTUB_ASSERT(lock_mode == LockMode::SHARED || lock_mode == LockMode::EXCLUSIVE, "Key ranges are locked S or X.");
+  std::unique_lock latch(latch_);
+  if (IsCovered(txn, lock_mode, low, high)) {
+    return true;
+  }
+  while (true) {
+    if (txn->GetState() == TransactionState::ABORTED) {
+      return false;
+    }
+    bool conflict = false;
+    std::vector<txn_id_t> wounded;
+    VisitOverlaps(root_.get(), low, high, [&](const RangeLock &lock) {
+      if (lock.txn_id_ == txn->GetTransactionId() ||
+          (lock.lock_mode_ == LockMode::SHARED && lock_mode == LockMode::SHARED)) {
+        return true;
+      }
+      conflict = true;
+      // A committed transaction only has to release its locks, and an aborted one is already on its way.
+      TransactionState state = lock.txn_->GetState();
+      if (lock.txn_id_ > txn->GetTransactionId() && state != TransactionState::COMMITTED &&
+          state != TransactionState::ABORTED) {
+        lock.txn_->SetState(TransactionState::ABORTED);
+        wounded.push_back(lock.txn_id_);
+      }
+      return true;
+    });
+    if (!conflict) {
+      break;
+    }
+    if (!wounded.empty()) {
+      // Wounded transactions waiting for another range here notice it right away.
+      cv_.notify_all();
+      if (lock_manager_ != nullptr) {
+        latch.unlock();
+        lock_manager_->WakeAborted(wounded);
+        latch.lock();
+      }
+    }
+    cv_.wait_for(latch, WOUND_CHECK_INTERVAL);
+  }
+  uint64_t seq = next_seq_++;
+  auto node = std::make_unique<Node>(Node{{txn, txn->GetTransactionId(), lock_mode, low, high}, seq,
+                                          static_cast<uint32_t>(random_()), high, nullptr, nullptr});
+  auto [before, after] = Split(std::move(root_), low, seq);
+  root_ = Merge(Merge(std::move(before), std::move(node)), std::move(after));
+  txn_locks_[txn->GetTransactionId()].emplace_back(low, seq);
+  lock_count_++;
+  txn->GetIndexRangeLockSet()->emplace(this);
+  return true;
+}
+
+template <typename KeyType, typename KeyComparator>
+void KeyRangeLockTable<KeyType, KeyComparator>::UnlockAll(Transaction *txn) {
+  {
+    std::scoped_lock latch(latch_);
+    auto txn_locks = txn_locks_.find(txn->GetTransactionId());
+    if (txn_locks != txn_locks_.end()) {
+      for (const auto &[low, seq] : txn_locks->second) {
+        Erase(&root_, low, seq);
+      }
+      lock_count_ -= txn_locks->second.size();
+      txn_locks_.erase(txn_locks);
+    }
+  }
+  cv_.notify_all();
+}
+
+template <typename KeyType, typename KeyComparator>
+size_t KeyRangeLockTable<KeyType, KeyComparator>::GetLockCount() {
+  std::scoped_lock latch(latch_);
+  return lock_count_;
+}
+
+template <typename KeyType, typename KeyComparator>
+bool KeyRangeLockTable<KeyType, KeyComparator>::Before(const KeyType &low, uint64_t seq, const Node &node) const {
+  int cmp = comparator_(low, node.lock_.low_);
+  return cmp < 0 || (cmp == 0 && seq < node.seq_);
+}
+
+template <typename KeyType, typename KeyComparator>
+void KeyRangeLockTable<KeyType, KeyComparator>::Update(Node *node) const {
+  node->max_high_ = node->lock_.high_;
+  for (Node *child : {node->left_.get(), node->right_.get()}) {
+    if (child != nullptr && comparator_(child->max_high_, node->max_high_) > 0) {
+      node->max_high_ = child->max_high_;
+    }
+  }
+}
+
+template <typename KeyType, typename KeyComparator>
+std::pair<typename KeyRangeLockTable<KeyType, KeyComparator>::NodePtr,
+          typename KeyRangeLockTable<KeyType, KeyComparator>::NodePtr>
+KeyRangeLockTable<KeyType, KeyComparator>::Split(NodePtr node, const KeyType &low, uint64_t seq) const {
+  if (node == nullptr) {
+    return {nullptr, nullptr};
+  }
+  if (Before(low, seq, *node)) {
+    auto [before, after] = Split(std::move(node->left_), low, seq);
+    node->left_ = std::move(after);
+    Update(node.get());
+    return {std::move(before), std::move(node)};
+  }
+  auto [before, after] = Split(std::move(node->right_), low, seq);
+  node->right_ = std::move(before);
+  Update(node.get());
+  return {std::move(node), std::move(after)};
+}
+
+template <typename KeyType, typename KeyComparator>
+typename KeyRangeLockTable<KeyType, KeyComparator>::NodePtr KeyRangeLockTable<KeyType, KeyComparator>::Merge(
+    NodePtr left, NodePtr right) const {
+  if (left == nullptr) {
+    return right;
+  }
+  if (right == nullptr) {
+    return left;
+  }
+  if (left->priority_ > right->priority_) {
+    left->right_ = Merge(std::move(left->right_), std::move(right));
+    Update(left.get());
+    return left;
+  }
+  right->left_ = Merge(std::move(left), std::move(right->left_));
+  Update(right.get());
+  return right;
+}
+
+template <typename KeyType, typename KeyComparator>
+void KeyRangeLockTable<KeyType, KeyComparator>::Erase(NodePtr *node, const KeyType &low, uint64_t seq) const {
+  Node *current = node->get();
+  BUSTUB_ASSERT(current != nullptr, "Unlocked a range that is not locked.");
+  if (current->seq_ == seq) {
+    *node = Merge(std::move(current->left_), std::move(current->right_));
+    return;
+  }
+  Erase(Before(low, seq, *current) ? &current->left_ : &current->right_, low, seq);
+  Update(current);
+}
+
+template <typename KeyType, typename KeyComparator>
+bool KeyRangeLockTable<KeyType, KeyComparator>::VisitOverlaps(
+    Node *node, const KeyType &low, const KeyType &high, const std::function<bool(const RangeLock &)> &visitor) const {
+  // No range in the subtree reaches the searched one.
+  if (node == nullptr || comparator_(node->max_high_, low) < 0) {
+    return true;
+  }
+  if (!VisitOverlaps(node->left_.get(), low, high, visitor)) {
+    return false;
+  }
+  // This range and the ones to its right start after the searched one.
+  if (comparator_(node->lock_.low_, high) > 0) {
+    return true;
+  }
+  if (comparator_(low, node->lock_.high_) <= 0 && !visitor(node->lock_)) {
+    return false;
+  }
+  return VisitOverlaps(node->right_.get(), low, high, visitor);
+}
+
+template <typename KeyType, typename KeyComparator>
+bool KeyRangeLockTable<KeyType, KeyComparator>::IsCovered(Transaction *txn, LockMode lock_mode, const KeyType &low,
+                                                          const KeyType &high) const {
+  // A covering range contains the low end.
+  bool covered = false;
+  VisitOverlaps(root_.get(), low, low, [&](const RangeLock &lock) {
+    covered = lock.txn_id_ == txn->GetTransactionId() &&
+              (lock.lock_mode_ == LockMode::EXCLUSIVE || lock_mode == LockMode::SHARED) &&
+              comparator_(high, lock.high_) <= 0;
+    return !covered;
+  });
+  return covered;
+}
+
+template class KeyRangeLockTable<GenericKey<4>, GenericComparator<4>>;
+template class KeyRangeLockTable<GenericKey<8>, GenericComparator<8>>;
+template class KeyRangeLockTable<GenericKey<16>, GenericComparator<16>>;
+template class KeyRangeLockTable<GenericKey<32>, GenericComparator<32>>;
+template class KeyRangeLockTable<GenericKey<64>, GenericComparator<64>>;
+
+}  // namespace bustub
@@ -12,23 +12,73 @@
 
 #include "concurrency/lock_manager.h"
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 
 namespace bustub {
 
+LockManager::LockManager(DeadlockMode deadlock_mode) : deadlock_mode_(deadlock_mode) {
+  if (deadlock_mode_ == DeadlockMode::DETECTION) {
+    enable_cycle_detection_ = true;
+    cycle_detection_thread_ = std::thread(&LockManager::RunCycleDetection, this);
+  }
+}
+
+LockManager::~LockManager() {
+  enable_cycle_detection_ = false;
+  if (cycle_detection_thread_.joinable()) {
+    cycle_detection_thread_.join();
+  }
+}
+
 bool LockManager::LockShared(Transaction *txn, const RID &rid) {
+  if (!CheckLockable(txn, LockMode::SHARED)) {
+    return false;
+  }
+  if (txn->IsSharedLocked(rid) || txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  if (!AcquireLock(txn, rid, LockMode::SHARED)) {
+    return false;
+  }
   txn->GetSharedLockSet()->emplace(rid);
   return true;
 }
 
 bool LockManager::LockExclusive(Transaction *txn, const RID &rid) {
+  if (!CheckLockable(txn, LockMode::EXCLUSIVE)) {
+    return false;
+  }
+  if (txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  if (txn->IsSharedLocked(rid)) {
+    return LockUpgrade(txn, rid);
+  }
+  if (!AcquireLock(txn, rid, LockMode::EXCLUSIVE)) {
+    return false;
+  }
   txn->GetExclusiveLockSet()->emplace(rid);
   return true;
 }
 
 bool LockManager::LockUpgrade(Transaction *txn, const RID &rid) {
+  if (!CheckLockable(txn, LockMode::EXCLUSIVE)) {
+    return false;
+  }
+  if (txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  bool upgraded = UpgradeLock(txn, rid, LockMode::EXCLUSIVE);
   txn->GetSharedLockSet()->erase(rid);
+  if (!upgraded) {
+    // The shared lock is gone with the failed upgrade, its table must not count it anymore.
+    for (auto &[oid, rows] : *txn->GetTableRowLockSet()) {
+      rows.erase(rid);
+    }
+    return false;
+  }
   txn->GetExclusiveLockSet()->emplace(rid);
   return true;
 }
@@ -36,7 +86,576 @@ bool LockManager::LockUpgrade(Transaction *txn, const RID &rid) {
 bool LockManager::Unlock(Transaction *txn, const RID &rid) {
   txn->GetSharedLockSet()->erase(rid);
   txn->GetExclusiveLockSet()->erase(rid);
+  for (auto &[oid, rows] : *txn->GetTableRowLockSet()) {
+    rows.erase(rid);
+  }
+  LockMode lock_mode;
+  if (!ReleaseLock(txn, rid, &lock_mode)) {
+    return false;
+  }
+  Shrink(txn, lock_mode);
+  return true;
+}
+
+bool LockManager::LockTable(Transaction *txn, LockMode lock_mode, table_oid_t oid) {
+  if (!CheckLockable(txn, lock_mode)) {
+    return false;
+  }
+  auto table_locks = txn->GetTableLockSet();
+  auto held = table_locks->find(oid);
+  if (held == table_locks->end()) {
+    if (!AcquireLock(txn, TableResource(oid), lock_mode)) {
+      return false;
+    }
+    table_locks->emplace(oid, lock_mode);
+    return true;
+  }
+  LockMode target = Join(held->second, lock_mode);
+  if (target == held->second) {
+    return true;
+  }
+  if (!UpgradeLock(txn, TableResource(oid), target)) {
+    table_locks->erase(oid);
+    return false;
+  }
+  (*table_locks)[oid] = target;
+  return true;
+}
+
+bool LockManager::UnlockTable(Transaction *txn, table_oid_t oid) {
+  auto table_locks = txn->GetTableLockSet();
+  auto held = table_locks->find(oid);
+  if (held == table_locks->end()) {
+    return false;
+  }
+  auto rows = txn->GetTableRowLockSet()->find(oid);
+  if (rows != txn->GetTableRowLockSet()->end() && !rows->second.empty()) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::TABLE_UNLOCKED_BEFORE_UNLOCKING_ROWS);
+  }
+  table_locks->erase(held);
+  txn->GetTableRowLockSet()->erase(oid);
+  LockMode lock_mode;
+  if (!ReleaseLock(txn, TableResource(oid), &lock_mode)) {
+    return false;
+  }
+  Shrink(txn, lock_mode);
+  return true;
+}
+
+bool LockManager::LockRow(Transaction *txn, LockMode lock_mode, table_oid_t oid, const RID &rid) {
+  BUSTUB_ASSERT(lock_mode == LockMode::SHARED || lock_mode == LockMode::EXCLUSIVE, "Rows are locked S or X.");
+  auto held = txn->GetTableLockSet()->find(oid);
+  if (held != txn->GetTableLockSet()->end() && Covers(held->second, lock_mode)) {
+    return true;
+  }
+  // An aborted transaction rolls back its writes under the locks it holds.
+  if (txn->IsExclusiveLocked(rid) || (lock_mode == LockMode::SHARED && txn->IsSharedLocked(rid))) {
+    return true;
+  }
+  LockMode intention = lock_mode == LockMode::SHARED ? LockMode::INTENTION_SHARED : LockMode::INTENTION_EXCLUSIVE;
+  if (!LockTable(txn, intention, oid)) {
+    return false;
+  }
+  bool locked = lock_mode == LockMode::SHARED ? LockShared(txn, rid) : LockExclusive(txn, rid);
+  if (!locked) {
+    return false;
+  }
+  auto &rows = (*txn->GetTableRowLockSet())[oid];
+  rows.emplace(rid);
+  if (rows.size() > lock_escalation_threshold) {
+    return EscalateTableLock(txn, oid);
+  }
+  return true;
+}
+
+bool LockManager::EscalateTableLock(Transaction *txn, table_oid_t oid) {
+  auto &rows = (*txn->GetTableRowLockSet())[oid];
+  // Writers need the whole table exclusively, readers that announced writes keep the intention.
+  LockMode target = LockMode::SHARED;
+  if (std::any_of(rows.begin(), rows.end(), [txn](const RID &rid) { return txn->IsExclusiveLocked(rid); })) {
+    target = LockMode::EXCLUSIVE;
+  } else if (!txn->IsTableLocked(oid, LockMode::INTENTION_SHARED)) {
+    target = LockMode::SHARED_INTENTION_EXCLUSIVE;
+  }
+  if (!LockTable(txn, target, oid)) {
+    return false;
+  }
+  // Dropping the covered row locks does not end the growing phase.
+  for (const RID &rid : rows) {
+    txn->GetSharedLockSet()->erase(rid);
+    txn->GetExclusiveLockSet()->erase(rid);
+    LockMode lock_mode;
+    ReleaseLock(txn, rid, &lock_mode);
+  }
+  rows.clear();
+  return true;
+}
+
+bool LockManager::AreCompatible(LockMode held, LockMode requested) {
+  // Indexed by SHARED, EXCLUSIVE, INTENTION_SHARED, INTENTION_EXCLUSIVE, SHARED_INTENTION_EXCLUSIVE.
+  static constexpr bool COMPATIBLE[LOCK_MODE_COUNT][LOCK_MODE_COUNT] = {{true, false, true, false, false},
+                                           {false, false, false, false, false},
+                                           {true, false, true, true, true},
+                                           {false, false, true, true, false},
+                                           {false, false, true, false, false}};
+  return COMPATIBLE[static_cast<int>(held)][static_cast<int>(requested)];
+}
+
+bool LockManager::Covers(LockMode held, LockMode requested) {
+  switch (held) {
+    case LockMode::EXCLUSIVE:
+      return true;
+    case LockMode::SHARED_INTENTION_EXCLUSIVE:
+      return requested != LockMode::EXCLUSIVE;
+    case LockMode::SHARED:
+      return requested == LockMode::SHARED || requested == LockMode::INTENTION_SHARED;
+    case LockMode::INTENTION_EXCLUSIVE:
+      return requested == LockMode::INTENTION_EXCLUSIVE || requested == LockMode::INTENTION_SHARED;
+    case LockMode::INTENTION_SHARED:
+      return requested == LockMode::INTENTION_SHARED;
+  }
+  return false;
+}
+
+LockMode LockManager::Join(LockMode held, LockMode requested) {
+  if (Covers(held, requested)) {
+    return held;
+  }
+  if (Covers(requested, held)) {
+    return requested;
+  }
+  // Only SHARED and INTENTION_EXCLUSIVE are incomparable.
+  return LockMode::SHARED_INTENTION_EXCLUSIVE;
+}
+
+LockManager::LockTablePartition &LockManager::GetPartition(const RID &rid) {
+  // Scramble the RID so that the page id and the slot number both pick the partition.
+  uint64_t hash = static_cast<uint64_t>(rid.Get()) * 0x9E3779B97F4A7C15ULL;
+  return partitions_[(hash >> 32) % LOCK_TABLE_PARTITIONS];
+}
+
+bool LockManager::CheckLockable(Transaction *txn, LockMode lock_mode) {
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  if (txn->GetState() == TransactionState::SHRINKING) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
+  }
+  if (txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED && lock_mode != LockMode::EXCLUSIVE &&
+      lock_mode != LockMode::INTENTION_EXCLUSIVE) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED);
+  }
+  return true;
+}
+
+void LockManager::Shrink(Transaction *txn, LockMode lock_mode) {
+  // Intention locks are released with the row locks below them. Read committed gives up shared locks right after
+  // reading without ending the growing phase.
+  if (txn->GetState() != TransactionState::GROWING || lock_mode == LockMode::INTENTION_SHARED ||
+      lock_mode == LockMode::INTENTION_EXCLUSIVE ||
+      (lock_mode == LockMode::SHARED && txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED)) {
+    return;
+  }
+  txn->SetState(TransactionState::SHRINKING);
+}
+
+bool LockManager::UpgradeLock(Transaction *txn, const RID &rid, LockMode lock_mode) {
+  LockTablePartition &partition = GetPartition(rid);
+  std::unique_lock lock(partition.latch_);
+  auto entry = partition.lock_table_.find(rid);
+  if (entry == partition.lock_table_.end()) {
+    return false;
+  }
+  LockRequestQueue &queue = entry->second;
+  auto &requests = queue.request_queue_;
+  txn_id_t txn_id = txn->GetTransactionId();
+  auto request = std::find_if(requests.begin(), requests.end(),
+                              [txn_id](const LockRequest &other) { return other.txn_id_ == txn_id; });
+  if (request == requests.end() || !request->granted_) {
+    return false;
+  }
+  // Two upgrading transactions would wait for each other's lock.
+  if (queue.upgrading_ != INVALID_TXN_ID) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn_id, AbortReason::UPGRADE_CONFLICT);
+  }
+  queue.upgrading_ = txn_id;
+
+  // Wait right behind the last granted request, ahead of the other waiters. Requests behind a waiter are granted
+  // when the waiter is aborted, so the granted requests are not always in front.
+  request->granted_ = false;
+  request->lock_mode_ = lock_mode;
+  auto position = requests.begin();
+  for (auto other = requests.begin(); other != requests.end(); ++other) {
+    if (other->granted_) {
+      position = std::next(other);
+    }
+  }
+  requests.splice(position, requests, request);
+
+  std::vector<txn_id_t> wounded;
+  Wound(&queue, request, &wounded);
+  GrantWaiters(rid, &queue);
+  if (!wounded.empty()) {
+    lock.unlock();
+    WakeAborted(wounded);
+    lock.lock();
+  }
+  if (!WaitForGrant(&partition, &lock, rid, request)) {
+    return false;
+  }
+  queue.upgrading_ = INVALID_TXN_ID;
+  return true;
+}
+
+bool LockManager::ReleaseLock(Transaction *txn, const RID &rid, LockMode *lock_mode) {
+  LockTablePartition &partition = GetPartition(rid);
+  std::scoped_lock lock(partition.latch_);
+  auto entry = partition.lock_table_.find(rid);
+  if (entry == partition.lock_table_.end()) {
+    return false;
+  }
+  auto &requests = entry->second.request_queue_;
+  txn_id_t txn_id = txn->GetTransactionId();
+  auto request = std::find_if(requests.begin(), requests.end(),
+                              [txn_id](const LockRequest &other) { return other.txn_id_ == txn_id; });
+  if (request == requests.end()) {
+    return false;
+  }
+  *lock_mode = request->lock_mode_;
+  ReleaseRequest(&partition, rid, &entry->second, request);
+  return true;
+}
+
+bool LockManager::AcquireLock(Transaction *txn, const RID &rid, LockMode lock_mode) {
+  LockTablePartition &partition = GetPartition(rid);
+  std::unique_lock lock(partition.latch_);
+  LockRequestQueue &queue = partition.lock_table_[rid];
+  RequestIterator request = AppendRequest(&partition, &queue, txn, lock_mode);
+
+  std::vector<txn_id_t> wounded;
+  Wound(&queue, request, &wounded);
+  GrantWaiters(rid, &queue);
+  if (!wounded.empty()) {
+    // The queue stays in the table while our request is in it.
+    lock.unlock();
+    WakeAborted(wounded);
+    lock.lock();
+  }
+  return WaitForGrant(&partition, &lock, rid, request);
+}
+
+LockManager::RequestIterator LockManager::AppendRequest(LockTablePartition *partition, LockRequestQueue *queue,
+                                                        Transaction *txn, LockMode lock_mode) {
+  auto &requests = queue->request_queue_;
+  auto &free_requests = partition->free_requests_;
+  if (free_requests.empty()) {
+    requests.emplace_back(txn, lock_mode);
+  } else {
+    requests.splice(requests.end(), free_requests, free_requests.begin());
+    LockRequest &request = requests.back();
+    request.txn_ = txn;
+    request.txn_id_ = txn->GetTransactionId();
+    request.lock_mode_ = lock_mode;
+    request.granted_ = false;
+    request.waiting_ = false;
+  }
+  return std::prev(requests.end());
+}
+
+void LockManager::Wound(LockRequestQueue *queue, RequestIterator request, std::vector<txn_id_t> *wounded) {
+  if (deadlock_mode_ != DeadlockMode::PREVENTION) {
+    return;
+  }
+  for (auto other = queue->request_queue_.begin(); other != request; ++other) {
+    if (other->txn_id_ < request->txn_id_ || AreCompatible(other->lock_mode_, request->lock_mode_)) {
+      continue;
+    }
+    // A committed transaction only has to release its locks, and an aborted one is already on its way.
+    TransactionState state = other->txn_->GetState();
+    if (state == TransactionState::COMMITTED || state == TransactionState::ABORTED) {
+      continue;
+    }
+    other->txn_->SetState(TransactionState::ABORTED);
+    deadlock_aborts_++;
+    if (other->granted_) {
+      wounded->push_back(other->txn_id_);
+    } else {
+      other->cv_.notify_one();
+    }
+  }
+}
+
+void LockManager::WakeAborted(const std::vector<txn_id_t> &aborted) {
+  for (txn_id_t txn_id : aborted) {
+    RID rid;
+    {
+      std::scoped_lock waits_for_lock(waits_for_latch_);
+      auto waiting = waiting_.find(txn_id);
+      if (waiting == waiting_.end()) {
+        continue;
+      }
+      rid = waiting->second.rid_;
+    }
+    // A waiter is registered and checks its state under the partition latch, so it cannot miss this.
+    LockTablePartition &partition = GetPartition(rid);
+    std::scoped_lock lock(partition.latch_);
+    auto entry = partition.lock_table_.find(rid);
+    if (entry == partition.lock_table_.end()) {
+      continue;
+    }
+    for (auto &request : entry->second.request_queue_) {
+      if (request.txn_id_ == txn_id && !request.granted_) {
+        request.cv_.notify_one();
+      }
+    }
+  }
+}
+
+void LockManager::GrantWaiters(const RID &rid, LockRequestQueue *queue) {
+  // Bit i is set once a request in the i-th lock mode is ahead.
+  uint32_t modes_ahead = 0;
+  bool blocked = false;
+  bool unblocked = false;
+  for (auto &request : queue->request_queue_) {
+    if (!request.granted_) {
+      // Aborted waiters are about to leave the queue.
+      if (request.txn_->GetState() == TransactionState::ABORTED) {
+        continue;
+      }
+      bool compatible = true;
+      for (uint32_t mode = 0; mode < LOCK_MODE_COUNT && compatible; mode++) {
+        compatible =
+            (modes_ahead & (1U << mode)) == 0 || AreCompatible(static_cast<LockMode>(mode), request.lock_mode_);
+      }
+      if (!compatible) {
+        blocked = true;
+        break;
+      }
+      request.granted_ = true;
+      request.cv_.notify_one();
+      unblocked = unblocked || request.waiting_;
+    }
+    modes_ahead |= 1U << static_cast<uint32_t>(request.lock_mode_);
+  }
+  // Requests that never had to wait stay out of the graph, so uncontended locks never take its latch.
+  if (blocked || unblocked) {
+    UpdateWaitsFor(rid, queue);
+  }
+}
+
+void LockManager::UpdateWaitsFor(const RID &rid, LockRequestQueue *queue) {
+  auto now = std::chrono::steady_clock::now();
+  std::scoped_lock waits_for_lock(waits_for_latch_);
+  for (auto request = queue->request_queue_.begin(); request != queue->request_queue_.end(); ++request) {
+    if (request->granted_) {
+      if (request->waiting_) {
+        ForgetWaiter(request->txn_id_);
+        request->waiting_ = false;
+      }
+      continue;
+    }
+    if (request->txn_->GetState() == TransactionState::ABORTED) {
+      continue;
+    }
+    if (!request->waiting_) {
+      waiting_[request->txn_id_] = WaitInfo{request->txn_, rid, now};
+      request->waiting_ = true;
+    }
+    if (deadlock_mode_ != DeadlockMode::DETECTION) {
+      continue;
+    }
+    // A blocked request waits for every conflicting request ahead of it.
+    std::vector<txn_id_t> &edges = waits_for_[request->txn_id_];
+    edges.clear();
+    for (auto other = queue->request_queue_.begin(); other != request; ++other) {
+      if ((other->granted_ || other->txn_->GetState() != TransactionState::ABORTED) &&
+          !AreCompatible(other->lock_mode_, request->lock_mode_)) {
+        edges.push_back(other->txn_id_);
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  }
+}
+
+void LockManager::ForgetWaiter(txn_id_t txn_id) {
+  waiting_.erase(txn_id);
+  waits_for_.erase(txn_id);
+}
+
+bool LockManager::WaitForGrant(LockTablePartition *partition, std::unique_lock<std::mutex> *lock, const RID &rid,
+                               RequestIterator request) {
+  Transaction *txn = request->txn_;
+  request->cv_.wait(*lock, [&] { return request->granted_ || txn->GetState() == TransactionState::ABORTED; });
+  if (request->waiting_) {
+    std::scoped_lock waits_for_lock(waits_for_latch_);
+    ForgetWaiter(request->txn_id_);
+    request->waiting_ = false;
+  }
+  if (txn->GetState() == TransactionState::ABORTED) {
+    ReleaseRequest(partition, rid, &partition->lock_table_[rid], request);
+    return false;
+  }
+  return true;
+}
+
+void LockManager::ReleaseRequest(LockTablePartition *partition, const RID &rid, LockRequestQueue *queue,
+                                 RequestIterator request) {
+  if (queue->upgrading_ == request->txn_id_) {
+    queue->upgrading_ = INVALID_TXN_ID;
+  }
+  partition->free_requests_.splice(partition->free_requests_.end(), queue->request_queue_, request);
+  if (queue->request_queue_.empty()) {
+    partition->lock_table_.erase(rid);
+    return;
+  }
+  GrantWaiters(rid, queue);
+}
+
+void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) {
+  std::scoped_lock waits_for_lock(waits_for_latch_);
+  std::vector<txn_id_t> &edges = waits_for_[t1];
+  auto position = std::lower_bound(edges.begin(), edges.end(), t2);
+  if (position == edges.end() || *position != t2) {
+    edges.insert(position, t2);
+  }
+}
+
+void LockManager::RemoveEdge(txn_id_t t1, txn_id_t t2) {
+  std::scoped_lock waits_for_lock(waits_for_latch_);
+  auto entry = waits_for_.find(t1);
+  if (entry == waits_for_.end()) {
+    return;
+  }
+  std::vector<txn_id_t> &edges = entry->second;
+  edges.erase(std::remove(edges.begin(), edges.end(), t2), edges.end());
+  if (edges.empty()) {
+    waits_for_.erase(entry);
+  }
+}
+
+bool LockManager::HasCycle(txn_id_t *txn_id) {
+  std::scoped_lock waits_for_lock(waits_for_latch_);
+  std::vector<txn_id_t> cycle;
+  if (!FindCycle(&cycle)) {
+    return false;
+  }
+  *txn_id = *std::max_element(cycle.begin(), cycle.end());
   return true;
 }
 
+std::vector<std::pair<txn_id_t, txn_id_t>> LockManager::GetEdgeList() {
+  std::scoped_lock waits_for_lock(waits_for_latch_);
+  std::vector<std::pair<txn_id_t, txn_id_t>> edge_list;
+  for (const auto &[t1, edges] : waits_for_) {
+    for (txn_id_t t2 : edges) {
+      edge_list.emplace_back(t1, t2);
+    }
+  }
+  return edge_list;
+}
+
+bool LockManager::FindCycle(std::vector<txn_id_t> *cycle) {
+  std::vector<txn_id_t> sources;
+  sources.reserve(waits_for_.size());
+  for (const auto &entry : waits_for_) {
+    sources.push_back(entry.first);
+  }
+  std::sort(sources.begin(), sources.end());
+
+  // Transactions on the current path are visiting, the ones whose every path has been searched are finished.
+  enum class Visit { VISITING, FINISHED };
+  std::unordered_map<txn_id_t, Visit> visited;
+  // The current path with the index of the next neighbour to visit of every transaction on it.
+  std::vector<std::pair<txn_id_t, size_t>> path;
+  for (txn_id_t source : sources) {
+    if (visited.count(source) != 0) {
+      continue;
+    }
+    visited[source] = Visit::VISITING;
+    path.emplace_back(source, 0);
+    while (!path.empty()) {
+      auto &[txn_id, next] = path.back();
+      auto edges = waits_for_.find(txn_id);
+      if (edges == waits_for_.end() || next == edges->second.size()) {
+        visited[txn_id] = Visit::FINISHED;
+        path.pop_back();
+        continue;
+      }
+      txn_id_t neighbour = edges->second[next++];
+      auto state = visited.find(neighbour);
+      if (state == visited.end()) {
+        visited[neighbour] = Visit::VISITING;
+        path.emplace_back(neighbour, 0);
+      } else if (state->second == Visit::VISITING) {
+        cycle->clear();
+        for (auto entry = path.rbegin(); entry != path.rend(); ++entry) {
+          cycle->push_back(entry->first);
+          if (entry->first == neighbour) {
+            break;
+          }
+        }
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void LockManager::RunCycleDetection() {
+  while (enable_cycle_detection_) {
+    std::this_thread::sleep_for(cycle_detection_interval);
+    std::vector<txn_id_t> victims;
+    {
+      std::scoped_lock waits_for_lock(waits_for_latch_);
+      auto now = std::chrono::steady_clock::now();
+      std::vector<txn_id_t> cycle;
+      while (FindCycle(&cycle)) {
+        txn_id_t victim = *std::max_element(cycle.begin(), cycle.end());
+        // The victim stops waiting, which breaks the cycle. It is woken below and leaves its queue.
+        waits_for_.erase(victim);
+        auto waiting = waiting_.find(victim);
+        if (waiting == waiting_.end()) {
+          // Only an edge added through AddEdge, there is no transaction to abort.
+          continue;
+        }
+        waiting->second.txn_->SetState(TransactionState::ABORTED);
+        deadlock_aborts_++;
+        victims.push_back(victim);
+
+        // The deadlock formed when the last transaction of the cycle started waiting.
+        auto formed = std::chrono::steady_clock::time_point::min();
+        for (txn_id_t txn_id : cycle) {
+          auto member = waiting_.find(txn_id);
+          if (member != waiting_.end()) {
+            formed = std::max(formed, member->second.since_);
+          }
+        }
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - formed);
+        detected_deadlocks_++;
+        total_detection_latency_ += latency;
+        max_detection_latency_ = std::max(max_detection_latency_, latency);
+      }
+    }
+    WakeAborted(victims);
+  }
+}
+
+std::chrono::microseconds LockManager::GetMaxDetectionLatency() {
+  std::scoped_lock waits_for_lock(waits_for_latch_);
+  return max_detection_latency_;
+}
+
+std::chrono::microseconds LockManager::GetAverageDetectionLatency() {
+  std::scoped_lock waits_for_lock(waits_for_latch_);
+  if (detected_deadlocks_ == 0) {
+    return std::chrono::microseconds(0);
+  }
+  return total_detection_latency_ / detected_deadlocks_;
+}
+
 }  // namespace bustub
@@ -0,0 +1,123 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// partition_executor.cpp
+//
+// Identification: src/concurrency/partition_executor.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "concurrency/partition_executor.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace bustub {
+
+PartitionExecutor::PartitionExecutor(TransactionManager *txn_mgr, size_t num_partitions) : txn_mgr_(txn_mgr) {
+  BUSTUB_ASSERT(num_partitions > 0, "There must be a partition.");
+  for (size_t i = 0; i < num_partitions; i++) {
+    auto &partition = partitions_.emplace_back(std::make_unique<Partition>());
+    partition->worker_ = std::thread(RunWorker, partition.get());
+  }
+}
+
+PartitionExecutor::~PartitionExecutor() {
+  for (auto &partition : partitions_) {
+    {
+      std::scoped_lock latch(partition->latch_);
+      partition->stopped_ = true;
+    }
+    partition->cv_.notify_one();
+  }
+  for (auto &partition : partitions_) {
+    partition->worker_.join();
+  }
+}
+
+std::future<bool> PartitionExecutor::Submit(size_t partition, Procedure procedure) {
+  // Tasks are copyable functions, the promise is not.
+  auto committed = std::make_shared<std::promise<bool>>();
+  auto res = committed->get_future();
+  Enqueue(partition, [this, committed, procedure = std::move(procedure)] { committed->set_value(Execute(procedure)); });
+  return res;
+}
+
+bool PartitionExecutor::ExecuteMultiPartition(std::vector<size_t> partitions, const Procedure &procedure) {
+  // A worker stopped twice would wait for itself.
+  std::sort(partitions.begin(), partitions.end());
+  partitions.erase(std::unique(partitions.begin(), partitions.end()), partitions.end());
+
+  std::promise<void> done;
+  std::shared_future<void> released(done.get_future());
+  std::vector<std::future<void>> stopped;
+  {
+    std::scoped_lock latch(multi_partition_latch_);
+    for (auto partition : partitions) {
+      auto reached = std::make_shared<std::promise<void>>();
+      stopped.push_back(reached->get_future());
+      Enqueue(partition, [reached, released] {
+        reached->set_value();
+        released.wait();
+      });
+    }
+  }
+  for (auto &worker : stopped) {
+    worker.wait();
+  }
+  bool committed = Execute(procedure);
+  done.set_value();
+  return committed;
+}
+
+void PartitionExecutor::Enqueue(size_t partition, std::function<void()> task) {
+  BUSTUB_ASSERT(partition < partitions_.size(), "Invalid partition.");
+  auto &owner = *partitions_[partition];
+  {
+    std::scoped_lock latch(owner.latch_);
+    owner.tasks_.push_back(std::move(task));
+  }
+  owner.cv_.notify_one();
+}
+
+void PartitionExecutor::RunWorker(Partition *partition) {
+  std::deque<std::function<void()>> batch;
+  std::unique_lock latch(partition->latch_);
+  while (true) {
+    partition->cv_.wait(latch, [partition] { return partition->stopped_ || !partition->tasks_.empty(); });
+    if (partition->tasks_.empty()) {
+      return;
+    }
+    // Everything queued so far runs without taking the latch again.
+    batch.swap(partition->tasks_);
+    latch.unlock();
+    for (auto &task : batch) {
+      task();
+    }
+    batch.clear();
+    latch.lock();
+  }
+}
+
+bool PartitionExecutor::Execute(const Procedure &procedure) {
+  Transaction *txn = txn_mgr_->BeginSerial();
+  bool ok;
+  try {
+    ok = procedure(txn);
+  } catch (TransactionAbortException &e) {
+    ok = false;
+  }
+  bool committed = false;
+  if (ok && txn->GetState() != TransactionState::ABORTED) {
+    committed = txn_mgr_->Commit(txn);
+  } else {
+    txn_mgr_->Abort(txn);
+  }
+  delete txn;
+  return committed;
+}
+
+}  // namespace bustub
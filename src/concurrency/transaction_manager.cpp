@@ -12,6 +12,8 @@
 
 #include "concurrency/transaction_manager.h"
 
+#include <algorithm>
+#include <thread>  // NOLINT
 #include <unordered_map>
 #include <unordered_set>
 
@@ -20,26 +22,98 @@
 
 namespace bustub {
 
-std::unordered_map<txn_id_t, Transaction *> TransactionManager::txn_map = {};
-std::shared_mutex TransactionManager::txn_map_mutex = {};
+namespace {
 
-Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level) {
-  // Acquire the global transaction latch in shared mode.
-  global_txn_latch_.RLock();
+/** Threads are spread over the quiescence slots in the order they first begin a transaction. */
+std::atomic<size_t> next_quiescence_slot{0};
+
+size_t GetThreadQuiescenceSlot() {
+  thread_local size_t slot = next_quiescence_slot++ % TXN_QUIESCENCE_SLOTS;
+  return slot;
+}
+
+}  // namespace
+
+void TransactionRegistry::Insert(Transaction *txn, const std::atomic<timestamp_t> *last_commit_ts) {
+  auto &shard = GetShard(txn->GetTransactionId());
+  std::unique_lock<std::shared_mutex> latch(shard.latch_);
+  if (last_commit_ts != nullptr) {
+    txn->SetReadTimestamp(*last_commit_ts);
+  }
+  shard.txns_[txn->GetTransactionId()] = txn;
+}
+
+void TransactionRegistry::Erase(txn_id_t txn_id) {
+  auto &shard = GetShard(txn_id);
+  std::unique_lock<std::shared_mutex> latch(shard.latch_);
+  shard.txns_.erase(txn_id);
+}
 
+Transaction *TransactionRegistry::Find(txn_id_t txn_id) {
+  auto &shard = GetShard(txn_id);
+  std::shared_lock<std::shared_mutex> latch(shard.latch_);
+  auto it = shard.txns_.find(txn_id);
+  return it == shard.txns_.end() ? nullptr : it->second;
+}
+
+void TransactionRegistry::ForEach(const std::function<void(Transaction *)> &visitor) {
+  for (auto &shard : shards_) {
+    std::shared_lock<std::shared_mutex> latch(shard.latch_);
+    for (const auto &entry : shard.txns_) {
+      visitor(entry.second);
+    }
+  }
+}
+
+Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level) {
   if (txn == nullptr) {
     txn = new Transaction(next_txn_id_++, isolation_level);
   }
-  txn_map_mutex.lock();
-  txn_map[txn->GetTransactionId()] = txn;
-  txn_map_mutex.unlock();
+  EnterQuiescenceSlot(txn);
+  txn->SetOptimistic(concurrency_mode_ == ConcurrencyMode::OPTIMISTIC);
+  if (enable_logging) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::BEGIN);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+    txn->SetFirstLSN(txn->GetPrevLSN());
+    txn->AddLogBytes(log_record.GetSize());
+  }
+
+  // The read timestamp is taken under the shard latch, so that no running snapshot is older than the oldest one found
+  // by the garbage collection.
+  txn_registry_.Insert(txn, &last_commit_ts_);
+  return txn;
+}
+
+Transaction *TransactionManager::BeginReadOnly(Transaction *txn) {
+  if (txn == nullptr) {
+    txn = new Transaction(next_txn_id_++, IsolationLevel::SNAPSHOT, true);
+  }
+  BUSTUB_ASSERT(txn->IsReadOnly() && txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT,
+                "Read-only transactions read a snapshot.");
+  txn_registry_.Insert(txn, &last_commit_ts_);
+  return txn;
+}
+
+Transaction *TransactionManager::BeginSerial(Transaction *txn) {
+  txn = Begin(txn);
+  txn->SetOptimistic(false);
+  txn->SetSerial(true);
   return txn;
 }
 
-void TransactionManager::Commit(Transaction *txn) {
+bool TransactionManager::Commit(Transaction *txn) {
   txn->SetState(TransactionState::COMMITTED);
+  if (txn->IsReadOnly()) {
+    txn_registry_.Erase(txn->GetTransactionId());
+    committed_txns_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  if (!CommitVersions(txn)) {
+    Abort(txn);
+    return false;
+  }
 
-  // Perform all deletes before we commit.
+  // Perform all deletes before we commit. Snapshots read the deleted versions from the version store from then on.
   auto write_set = txn->GetWriteSet();
   while (!write_set->empty()) {
     auto &item = write_set->back();
@@ -52,18 +126,38 @@ void TransactionManager::Commit(Transaction *txn) {
   }
   write_set->clear();
 
+  if (enable_logging) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
+    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+    txn->SetPrevLSN(lsn);
+    txn->AddLogBytes(log_record.GetSize());
+    // The transaction has only committed once its commit record is durable.
+    log_manager_->ForceFlush(lsn);
+  }
+  committed_log_bytes_.fetch_add(txn->GetLogBytes(), std::memory_order_relaxed);
+  committed_txns_.fetch_add(1, std::memory_order_relaxed);
+  // The transaction is no longer running.
+  txn_registry_.Erase(txn->GetTransactionId());
+
   // Release all the locks.
   ReleaseLocks(txn);
-  // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  // The write records are gone, so are the tuples they referred to.
+  txn->GetArena()->Reset();
+  ExitQuiescenceSlot(txn);
+  return true;
 }
 
 void TransactionManager::Abort(Transaction *txn) {
   txn->SetState(TransactionState::ABORTED);
+  if (txn->IsReadOnly()) {
+    txn_registry_.Erase(txn->GetTransactionId());
+    return;
+  }
   // Rollback before releasing the lock.
   auto table_write_set = txn->GetWriteSet();
-  while (!table_write_set->empty()) {
-    auto &item = table_write_set->back();
+  // Rolling back an update appends to the write set, those records are skipped.
+  for (size_t i = table_write_set->size(); i-- > 0;) {
+    auto &item = (*table_write_set)[i];
     auto table = item.table_;
     if (item.wtype_ == WType::DELETE) {
       table->RollbackDelete(item.rid_, txn);
@@ -73,9 +167,15 @@ void TransactionManager::Abort(Transaction *txn) {
     } else if (item.wtype_ == WType::UPDATE) {
       table->UpdateTuple(item.tuple_, item.rid_, txn);
     }
-    table_write_set->pop_back();
+  }
+  // The saved versions are only dropped once every write is rolled back, a tuple written twice would otherwise show
+  // its intermediate version as committed.
+  for (auto &item : *table_write_set) {
+    item.table_->GetVersionStore()->Abort(item.rid_, txn);
   }
   table_write_set->clear();
+  txn->GetBufferedWriteSet()->clear();
+  txn->GetReadSet()->clear();
   // Rollback index updates
   auto index_write_set = txn->GetIndexWriteSet();
   while (!index_write_set->empty()) {
@@ -102,14 +202,139 @@ void TransactionManager::Abort(Transaction *txn) {
   table_write_set->clear();
   index_write_set->clear();
 
+  if (enable_logging) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+    txn->AddLogBytes(log_record.GetSize());
+  }
+  // The transaction is no longer running.
+  txn_registry_.Erase(txn->GetTransactionId());
+
   // Release all the locks.
   ReleaseLocks(txn);
-  // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  // The write records are gone, so are the tuples they referred to.
+  txn->GetArena()->Reset();
+  ExitQuiescenceSlot(txn);
 }
 
-void TransactionManager::BlockAllTransactions() { global_txn_latch_.WLock(); }
+void TransactionManager::GetActiveTransactionTable(std::vector<std::pair<txn_id_t, lsn_t>> *active_txns) {
+  txn_registry_.ForEach([active_txns](Transaction *txn) {
+    lsn_t last_lsn = txn->GetPrevLSN();
+    if (last_lsn != INVALID_LSN) {
+      active_txns->emplace_back(txn->GetTransactionId(), last_lsn);
+    }
+  });
+}
+
+lsn_t TransactionManager::GetOldestActiveLSN() {
+  lsn_t oldest_lsn = INVALID_LSN;
+  txn_registry_.ForEach([&oldest_lsn](Transaction *txn) {
+    lsn_t first_lsn = txn->GetFirstLSN();
+    if (first_lsn != INVALID_LSN && (oldest_lsn == INVALID_LSN || first_lsn < oldest_lsn)) {
+      oldest_lsn = first_lsn;
+    }
+  });
+  return oldest_lsn;
+}
+
+timestamp_t TransactionManager::GetOldestSnapshot() {
+  // Read before the scan: a transaction the scan misses registers later and reads this timestamp or a newer one.
+  timestamp_t oldest_ts = last_commit_ts_;
+  txn_registry_.ForEach([&oldest_ts](Transaction *txn) {
+    if (txn->IsOptimistic() || txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT) {
+      oldest_ts = std::min(oldest_ts, txn->GetReadTimestamp());
+    }
+  });
+  return oldest_ts;
+}
+
+bool TransactionManager::CommitVersions(Transaction *txn) {
+  auto write_set = txn->GetWriteSet();
+  if (write_set->empty() && !txn->IsOptimistic()) {
+    return true;
+  }
+  {
+    std::scoped_lock latch(commit_latch_);
+    if (txn->IsOptimistic() && !ValidateAndInstall(txn)) {
+      return false;
+    }
+    if (write_set->empty()) {
+      return true;
+    }
+    timestamp_t commit_ts = last_commit_ts_ + 1;
+    for (auto &item : *write_set) {
+      item.table_->GetVersionStore()->Commit(item.rid_, txn, commit_ts);
+    }
+    txn->SetCommitTimestamp(commit_ts);
+    last_commit_ts_ = commit_ts;
+  }
+  timestamp_t watermark = GetOldestSnapshot();
+  for (auto &item : *write_set) {
+    item.table_->GetVersionStore()->GarbageCollect(item.rid_, watermark);
+  }
+  return true;
+}
 
-void TransactionManager::ResumeTransactions() { global_txn_latch_.WUnlock(); }
+bool TransactionManager::ValidateAndInstall(Transaction *txn) {
+  // Other optimistic transactions only change committed versions under the commit latch, so the reads stay valid
+  // until the writes are installed.
+  auto read_set = txn->GetReadSet();
+  for (const auto &item : *read_set) {
+    if (item.table_->GetVersionStore()->GetCommittedTimestamp(item.rid_, txn) != item.version_) {
+      return false;
+    }
+  }
+  read_set->clear();
+  // The transaction is no longer growing, so the table heaps write in place now.
+  auto buffered_write_set = txn->GetBufferedWriteSet();
+  for (const auto &item : *buffered_write_set) {
+    bool installed = item.wtype_ == WType::DELETE ? item.table_->MarkDelete(item.rid_, txn)
+                                                  : item.table_->UpdateTuple(item.tuple_, item.rid_, txn);
+    if (!installed) {
+      return false;
+    }
+  }
+  buffered_write_set->clear();
+  return true;
+}
+
+void TransactionManager::BlockAllTransactions() {
+  block_latch_.lock();
+  blocked_ = true;
+  // A transaction counted before the flag was raised is waited for, one counted after it backs off again.
+  for (auto &slot : quiescence_slots_) {
+    while (slot.running_ != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void TransactionManager::ResumeTransactions() {
+  {
+    std::scoped_lock latch(resume_latch_);
+    blocked_ = false;
+  }
+  resume_cv_.notify_all();
+  block_latch_.unlock();
+}
+
+void TransactionManager::EnterQuiescenceSlot(Transaction *txn) {
+  size_t slot = GetThreadQuiescenceSlot();
+  txn->SetQuiescenceSlot(slot);
+  auto &running = quiescence_slots_[slot].running_;
+  running++;
+  while (blocked_) {
+    running--;
+    std::unique_lock<std::mutex> latch(resume_latch_);
+    resume_cv_.wait(latch, [this] { return !blocked_; });
+    latch.unlock();
+    running++;
+  }
+}
+
+void TransactionManager::ExitQuiescenceSlot(Transaction *txn) {
+  // The transaction may end on another thread than the one it began on.
+  quiescence_slots_[txn->GetQuiescenceSlot()].running_--;
+}
 
 }  // namespace bustub
@@ -0,0 +1,166 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.cpp
+//
+// Identification: src/concurrency/version_store.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "concurrency/version_store.h"
+
+#include <mutex>  // NOLINT
+
+namespace bustub {
+
+void VersionStore::RecordWrite(const RID &rid, Transaction *txn, const Tuple *old_tuple) {
+  std::unique_lock<std::shared_mutex> latch(latch_);
+  auto &chain = chains_[rid];
+  // Without locks a second writer may overwrite an uncommitted version, it then takes over the saved one.
+  if (chain.writer_ == INVALID_TXN_ID) {
+    // The old tuple may live in the writer's arena, the store keeps a copy of its own.
+    chain.undo_.push_front(
+        {chain.ts_, old_tuple == nullptr ? std::nullopt : std::optional<Tuple>(old_tuple->DeepCopy())});
+  }
+  chain.writer_ = txn->GetTransactionId();
+}
+
+bool VersionStore::IsWriteConflict(const RID &rid, Transaction *txn) {
+  std::shared_lock<std::shared_mutex> latch(latch_);
+  auto chain = chains_.find(rid);
+  if (chain == chains_.end() || chain->second.writer_ == txn->GetTransactionId()) {
+    return false;
+  }
+  return chain->second.writer_ != INVALID_TXN_ID || chain->second.ts_ > txn->GetReadTimestamp();
+}
+
+VisibleVersion VersionStore::GetVisibleVersion(const RID &rid, Transaction *txn, Tuple *tuple) {
+  std::shared_lock<std::shared_mutex> latch(latch_);
+  auto it = chains_.find(rid);
+  if (it == chains_.end()) {
+    return VisibleVersion::IN_PAGE;
+  }
+  const auto &chain = it->second;
+  timestamp_t read_ts = txn->GetReadTimestamp();
+  if (chain.writer_ == txn->GetTransactionId() || (chain.writer_ == INVALID_TXN_ID && chain.ts_ <= read_ts)) {
+    return VisibleVersion::IN_PAGE;
+  }
+  for (const auto &version : chain.undo_) {
+    if (version.ts_ <= read_ts) {
+      if (!version.tuple_.has_value()) {
+        return VisibleVersion::NONE;
+      }
+      *tuple = *version.tuple_;
+      return VisibleVersion::IN_STORE;
+    }
+  }
+  return VisibleVersion::NONE;
+}
+
+VisibleVersion VersionStore::GetCommittedVersion(const RID &rid, Transaction *txn, Tuple *tuple,
+                                                timestamp_t *version) {
+  std::shared_lock<std::shared_mutex> latch(latch_);
+  auto it = chains_.find(rid);
+  if (it == chains_.end()) {
+    *version = 0;
+    return VisibleVersion::IN_PAGE;
+  }
+  const auto &chain = it->second;
+  *version = CommittedTimestamp(chain, txn);
+  if (chain.writer_ == INVALID_TXN_ID || chain.writer_ == txn->GetTransactionId()) {
+    return VisibleVersion::IN_PAGE;
+  }
+  const auto &committed = chain.undo_.front();
+  if (!committed.tuple_.has_value()) {
+    return VisibleVersion::NONE;
+  }
+  *tuple = *committed.tuple_;
+  return VisibleVersion::IN_STORE;
+}
+
+timestamp_t VersionStore::GetCommittedTimestamp(const RID &rid, Transaction *txn) {
+  std::shared_lock<std::shared_mutex> latch(latch_);
+  auto chain = chains_.find(rid);
+  return chain == chains_.end() ? 0 : CommittedTimestamp(chain->second, txn);
+}
+
+void VersionStore::Commit(const RID &rid, Transaction *txn, timestamp_t commit_ts) {
+  std::unique_lock<std::shared_mutex> latch(latch_);
+  auto chain = chains_.find(rid);
+  if (chain != chains_.end() && chain->second.writer_ == txn->GetTransactionId()) {
+    chain->second.writer_ = INVALID_TXN_ID;
+    chain->second.ts_ = commit_ts;
+  }
+}
+
+void VersionStore::Abort(const RID &rid, Transaction *txn) {
+  std::unique_lock<std::shared_mutex> latch(latch_);
+  auto it = chains_.find(rid);
+  if (it == chains_.end() || it->second.writer_ != txn->GetTransactionId()) {
+    return;
+  }
+  // The page holds the saved version again.
+  auto &chain = it->second;
+  chain.writer_ = INVALID_TXN_ID;
+  chain.ts_ = chain.undo_.front().ts_;
+  chain.undo_.pop_front();
+  if (chain.undo_.empty()) {
+    chains_.erase(it);
+  }
+}
+
+void VersionStore::GarbageCollect(const RID &rid, timestamp_t watermark) {
+  std::unique_lock<std::shared_mutex> latch(latch_);
+  Prune(rid, watermark);
+  auto chain = chains_.find(rid);
+  if (chain != chains_.end() && chain->second.writer_ == INVALID_TXN_ID) {
+    gc_queue_.emplace_back(chain->second.ts_, rid);
+  }
+  // Chains are queued in about commit order, a late one only waits for the ones in front of it.
+  while (!gc_queue_.empty() && gc_queue_.front().first <= watermark) {
+    Prune(gc_queue_.front().second, watermark);
+    gc_queue_.pop_front();
+  }
+}
+
+size_t VersionStore::GetVersionCount() {
+  std::shared_lock<std::shared_mutex> latch(latch_);
+  size_t count = 0;
+  for (const auto &[rid, chain] : chains_) {
+    count += chain.undo_.size();
+  }
+  return count;
+}
+
+timestamp_t VersionStore::CommittedTimestamp(const VersionChain &chain, Transaction *txn) {
+  if (chain.writer_ == txn->GetTransactionId()) {
+    return 0;
+  }
+  // Chains are kept while the transaction runs if they were committed after it began.
+  timestamp_t ts = chain.writer_ == INVALID_TXN_ID ? chain.ts_ : chain.undo_.front().ts_;
+  return ts <= txn->GetReadTimestamp() ? 0 : ts;
+}
+
+void VersionStore::Prune(const RID &rid, timestamp_t watermark) {
+  auto it = chains_.find(rid);
+  if (it == chains_.end()) {
+    return;
+  }
+  auto &chain = it->second;
+  if (chain.writer_ == INVALID_TXN_ID && chain.ts_ <= watermark) {
+    chains_.erase(it);
+    return;
+  }
+  // The oldest snapshot reads the first version committed at or before it, nobody reads past that one.
+  for (auto version = chain.undo_.begin(); version != chain.undo_.end(); ++version) {
+    if (version->ts_ <= watermark) {
+      chain.undo_.erase(version + 1, chain.undo_.end());
+      break;
+    }
+  }
+}
+
+}  // namespace bustub
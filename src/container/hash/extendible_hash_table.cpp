@@ -10,8 +10,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -24,12 +28,21 @@ namespace bustub {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn)
-    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
+                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                                     LogManager *log_manager)
+    : buffer_pool_manager_(buffer_pool_manager),
+      log_manager_(log_manager),
+      comparator_(comparator),
+      hash_fn_(std::move(hash_fn)) {
   //  implement me!
+  page_id_t directory_page_id;
   page_id_t first_bucket_page_id;
+  auto *header_page = reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->NewPage(&header_page_id_));
+  header_page->SetPageId(header_page_id_);
+  header_page->InitTable();
   HashTableDirectoryPage *d_page =
-      reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->NewPage(&directory_page_id_));
+      reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->NewPage(&directory_page_id));
+  d_page->SetPageId(directory_page_id);
   d_page->InitTable();
   d_page->IncrGlobalDepth();
   buffer_pool_manager_->NewPage(&first_bucket_page_id);
@@ -37,11 +50,30 @@ HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager
   d_page->SetBucketPageId(1, first_bucket_page_id);
   d_page->SetLocalDepth(0, 0);
   d_page->SetLocalDepth(1, 0);
+  header_page->SetBucketPageId(0, directory_page_id);
+  header_page->SetLocalDepth(0, 0);
 
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true, nullptr);
+  buffer_pool_manager_->UnpinPage(header_page_id_, true, nullptr);
+  buffer_pool_manager_->UnpinPage(directory_page_id, true, nullptr);
   buffer_pool_manager_->UnpinPage(first_bucket_page_id, false, nullptr);
+  // Creating the table is not logged, every later change is logged against these pages.
+  if (enable_logging && log_manager_ != nullptr) {
+    buffer_pool_manager_->FlushPage(header_page_id_, nullptr);
+    buffer_pool_manager_->FlushPage(directory_page_id, nullptr);
+    buffer_pool_manager_->FlushPage(first_bucket_page_id, nullptr);
+  }
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
+                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                                     LogManager *log_manager, page_id_t header_page_id)
+    : header_page_id_(header_page_id),
+      buffer_pool_manager_(buffer_pool_manager),
+      log_manager_(log_manager),
+      comparator_(comparator),
+      hash_fn_(std::move(hash_fn)) {}
+
 /*****************************************************************************
  * HELPERS
  *****************************************************************************/
@@ -71,9 +103,18 @@ inline uint32_t HASH_TABLE_TYPE::KeyToPageId(KeyType key, HashTableDirectoryPage
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-HashTableDirectoryPage *HASH_TABLE_TYPE::FetchDirectoryPage() {
+HashTableDirectoryPage *HASH_TABLE_TYPE::FetchHeaderPage() {
+  return reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(header_page_id_));
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HashTableDirectoryPage *HASH_TABLE_TYPE::FetchDirectoryPage(const KeyType &key) {
+  // The header only changes under the exclusive table latch, the directory page stays valid after unpinning it.
+  HashTableDirectoryPage *header_page = FetchHeaderPage();
+  page_id_t directory_page_id = header_page->GetBucketPageId(header_page->HashToHeaderIndex(Hash(key)));
+  buffer_pool_manager_->UnpinPage(header_page_id_, false, nullptr);
   HashTableDirectoryPage *d_page =
-      reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(directory_page_id_));
+      reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(directory_page_id));
   return d_page;
 }
 
@@ -84,147 +125,667 @@ HASH_TABLE_BUCKET_TYPE *HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_i
   return bucket_page;
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+std::vector<std::pair<page_id_t, size_t>> HASH_TABLE_TYPE::GroupByBucket(const KeyType *keys, size_t batch_size,
+                                                                         size_t stride) {
+  // Group the keys by directory first, so that every directory is fetched once and only one is pinned at a time.
+  std::vector<std::pair<page_id_t, size_t>> grouped(batch_size);
+  std::vector<uint64_t> full_hashes(batch_size);
+  hash_fn_.GetHashes(keys, batch_size, full_hashes.data(), stride);
+  std::vector<uint32_t> hashes(full_hashes.begin(), full_hashes.end());
+  HashTableDirectoryPage *header_page = FetchHeaderPage();
+  for (size_t pos = 0; pos < batch_size; pos++) {
+    grouped[pos] = {header_page->GetBucketPageId(header_page->HashToHeaderIndex(hashes[pos])), pos};
+  }
+  buffer_pool_manager_->UnpinPage(header_page_id_, false, nullptr);
+  std::sort(grouped.begin(), grouped.end());
+
+  HashTableDirectoryPage *directory_page = nullptr;
+  for (auto &[page_id, pos] : grouped) {
+    if (directory_page == nullptr || directory_page->GetPageId() != page_id) {
+      if (directory_page != nullptr) {
+        buffer_pool_manager_->UnpinPage(directory_page->GetPageId(), false, nullptr);
+      }
+      directory_page = reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(page_id));
+    }
+    page_id = directory_page->GetBucketPageId(hashes[pos] & directory_page->GetGlobalDepthMask());
+  }
+  if (directory_page != nullptr) {
+    buffer_pool_manager_->UnpinPage(directory_page->GetPageId(), false, nullptr);
+  }
+  std::sort(grouped.begin(), grouped.end());
+  return grouped;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename Visitor>
+void HASH_TABLE_TYPE::ForEachBucket(const std::vector<std::pair<page_id_t, size_t>> &grouped, Visitor visit) {
+  // The bitmaps and fingerprints a bucket is searched by come before its entries.
+  static const uint32_t search_bytes = HASH_TABLE_BUCKET_TYPE::GetLayout().array_offset_;
+  HASH_TABLE_BUCKET_TYPE *next_page = grouped.empty() ? nullptr : FetchBucketPage(grouped[0].first);
+  size_t first = 0;
+  while (first < grouped.size()) {
+    page_id_t bucket_page_id = grouped[first].first;
+    size_t last = first;
+    while (last < grouped.size() && grouped[last].first == bucket_page_id) {
+      last++;
+    }
+    HASH_TABLE_BUCKET_TYPE *bucket_page = next_page;
+    if (last < grouped.size()) {
+      next_page = FetchBucketPage(grouped[last].first);
+      for (uint32_t offset = 0; offset < search_bytes; offset += 64) {
+        __builtin_prefetch(reinterpret_cast<char *>(next_page) + offset);
+      }
+    }
+    bool dirty = visit(bucket_page_id, bucket_page, first, last);
+    buffer_pool_manager_->UnpinPage(bucket_page_id, dirty, nullptr);
+    first = last;
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename Visitor>
+bool HASH_TABLE_TYPE::ForEachOverflowPage(HASH_TABLE_BUCKET_TYPE *bucket_page, const KeyType &key, Visitor visit) {
+  uint32_t split_hash = SplitHash(key);
+  bool agrees = false;
+  page_id_t page_id = bucket_page->GetOverflowPageId();
+  while (page_id != INVALID_PAGE_ID) {
+    HASH_TABLE_BUCKET_TYPE *overflow_page = FetchBucketPage(page_id);
+    // Removes may have emptied the first pages of the chain.
+    for (uint32_t bucket_idx = 0; !agrees && bucket_idx < BUCKET_ARRAY_SIZE; bucket_idx++) {
+      if (!overflow_page->IsReadable(bucket_idx)) {
+        continue;
+      }
+      if (SplitHash(overflow_page->KeyAt(bucket_idx)) != split_hash) {
+        buffer_pool_manager_->UnpinPage(page_id, false, nullptr);
+        return false;
+      }
+      agrees = true;
+    }
+    bool done = visit(page_id, overflow_page);
+    page_id_t next_page_id = overflow_page->GetOverflowPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false, nullptr);
+    if (done) {
+      break;
+    }
+    page_id = next_page_id;
+  }
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::GetOverflowSplitHash(HASH_TABLE_BUCKET_TYPE *bucket_page, uint32_t *split_hash) {
+  bool found = false;
+  page_id_t page_id = bucket_page->GetOverflowPageId();
+  while (page_id != INVALID_PAGE_ID && !found) {
+    HASH_TABLE_BUCKET_TYPE *overflow_page = FetchBucketPage(page_id);
+    for (uint32_t bucket_idx = 0; bucket_idx < BUCKET_ARRAY_SIZE; bucket_idx++) {
+      if (overflow_page->IsReadable(bucket_idx)) {
+        *split_hash = SplitHash(overflow_page->KeyAt(bucket_idx));
+        found = true;
+        break;
+      }
+    }
+    page_id_t next_page_id = overflow_page->GetOverflowPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false, nullptr);
+    page_id = next_page_id;
+  }
+  return found;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::GetBucketValue(HASH_TABLE_BUCKET_TYPE *bucket_page, const KeyType &key,
+                                     std::vector<ValueType> *result) {
+  bool found = bucket_page->GetValue(key, comparator_, result);
+  if (bucket_page->GetOverflowPageId() != INVALID_PAGE_ID) {
+    ForEachOverflowPage(bucket_page, key, [&](page_id_t /*page_id*/, HASH_TABLE_BUCKET_TYPE *overflow_page) {
+      found = overflow_page->GetValue(key, comparator_, result) || found;
+      return false;
+    });
+  }
+  return found;
+}
+
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) {
   table_latch_.RLock();
-  HashTableDirectoryPage *directory_page = FetchDirectoryPage();
+  HashTableDirectoryPage *directory_page = FetchDirectoryPage(key);
   uint32_t index = KeyToDirectoryIndex(key, directory_page);
 
   page_id_t bucket_page_id = directory_page->GetBucketPageId(index);
   HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
   reinterpret_cast<Page *>(bucket_page)->RLatch();
-  bool ret = bucket_page->GetValue(key, comparator_, result);
+  bool ret = GetBucketValue(bucket_page, key, result);
 
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr);
+  buffer_pool_manager_->UnpinPage(directory_page->GetPageId(), false, nullptr);
   buffer_pool_manager_->UnpinPage(bucket_page_id, false, nullptr);
   reinterpret_cast<Page *>(bucket_page)->RUnlatch();
   table_latch_.RUnlock();
   return ret;
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+size_t HASH_TABLE_TYPE::GetValues(Transaction *transaction, const std::vector<KeyType> &keys,
+                                  std::vector<std::vector<ValueType>> *results) {
+  results->assign(keys.size(), std::vector<ValueType>());
+  size_t found = 0;
+  table_latch_.RLock();
+  auto grouped = GroupByBucket(keys.data(), keys.size(), sizeof(KeyType));
+  ForEachBucket(grouped, [&](page_id_t /*bucket_page_id*/, HASH_TABLE_BUCKET_TYPE *bucket_page, size_t first,
+                             size_t last) {
+    reinterpret_cast<Page *>(bucket_page)->RLatch();
+    for (size_t i = first; i < last; i++) {
+      size_t pos = grouped[i].second;
+      if (GetBucketValue(bucket_page, keys[pos], &(*results)[pos])) {
+        found++;
+      }
+    }
+    reinterpret_cast<Page *>(bucket_page)->RUnlatch();
+    return false;
+  });
+  table_latch_.RUnlock();
+  return found;
+}
+
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) {
+  // Most inserts fit into their bucket, they only latch the bucket and share the table latch.
+  table_latch_.RLock();
+  bool needs_split;
+  bool inserted = InsertIntoBucket(transaction, key, value, &needs_split);
+  table_latch_.RUnlock();
+  if (!needs_split) {
+    return inserted;
+  }
+  // Another insert may have split the bucket between the latches, so the key's slot is looked up again.
   table_latch_.WLock();
-  HashTableDirectoryPage *directory_page = FetchDirectoryPage();
-  uint32_t index = KeyToDirectoryIndex(key, directory_page);
-  page_id_t bucket_page_id = directory_page->GetBucketPageId(index);
-  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
-  reinterpret_cast<Page *>(bucket_page)->WLatch();
-  if (bucket_page->Insert(key, value, comparator_)) {
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, true, nullptr);
-    reinterpret_cast<Page *>(bucket_page)->WUnlatch();
-    table_latch_.WUnlock();
-    return true;
+  while (true) {
+    inserted = InsertIntoBucket(transaction, key, value, &needs_split);
+    // The directory cannot grow any further if the split fails.
+    if (!needs_split || !SplitInsert(transaction, key, value)) {
+      break;
+    }
   }
-  if (bucket_page->IsFull() && !bucket_page->CheckKeyValueExist(key, value, comparator_)) {
-    // full and does not have the kv pair, try split insert
-    bool ret = SplitInsert(transaction, key, value);
-    buffer_pool_manager_->UnpinPage(directory_page_id_, true, nullptr);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, true, nullptr);
+  table_latch_.WUnlock();
+  return inserted;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+size_t HASH_TABLE_TYPE::InsertBatch(Transaction *transaction, const std::vector<std::pair<KeyType, ValueType>> &batch) {
+  size_t inserted = 0;
+  std::vector<size_t> needs_split;
+  table_latch_.RLock();
+  auto grouped = GroupByBucket(batch.empty() ? nullptr : &batch[0].first, batch.size(), sizeof(batch[0]));
+  ForEachBucket(grouped, [&](page_id_t bucket_page_id, HASH_TABLE_BUCKET_TYPE *bucket_page, size_t first,
+                             size_t last) {
+    reinterpret_cast<Page *>(bucket_page)->WLatch();
+    bool dirty = false;
+    for (size_t i = first; i < last; i++) {
+      size_t pos = grouped[i].second;
+      const auto &[key, value] = batch[pos];
+      bool is_full;
+      if (InsertIntoChain(transaction, bucket_page_id, bucket_page, key, value, &is_full)) {
+        inserted++;
+        dirty = true;
+      } else if (is_full) {
+        needs_split.push_back(pos);
+      }
+    }
     reinterpret_cast<Page *>(bucket_page)->WUnlatch();
-    table_latch_.WUnlock();
-    return ret;
+    return dirty;
+  });
+  table_latch_.RUnlock();
+  for (size_t pos : needs_split) {
+    if (Insert(transaction, batch[pos].first, batch[pos].second)) {
+      inserted++;
+    }
   }
-  // existed same kv pair, return false
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr);
-  buffer_pool_manager_->UnpinPage(bucket_page_id, false, nullptr);
+  return inserted;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::InsertIntoBucket(Transaction *transaction, const KeyType &key, const ValueType &value,
+                                       bool *needs_split) {
+  HashTableDirectoryPage *directory_page = FetchDirectoryPage(key);
+  page_id_t bucket_page_id = KeyToPageId(key, directory_page);
+  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
+  reinterpret_cast<Page *>(bucket_page)->WLatch();
+  bool inserted = InsertIntoChain(transaction, bucket_page_id, bucket_page, key, value, needs_split);
+  buffer_pool_manager_->UnpinPage(directory_page->GetPageId(), false, nullptr);
+  buffer_pool_manager_->UnpinPage(bucket_page_id, inserted, nullptr);
   reinterpret_cast<Page *>(bucket_page)->WUnlatch();
-  table_latch_.WUnlock();
-  return false;
+  return inserted;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::InsertIntoChain(Transaction *transaction, page_id_t bucket_page_id,
+                                      HASH_TABLE_BUCKET_TYPE *bucket_page, const KeyType &key, const ValueType &value,
+                                      bool *is_full) {
+  uint32_t bucket_idx;
+  if (bucket_page->GetOverflowPageId() == INVALID_PAGE_ID) {
+    bool inserted = bucket_page->Insert(key, value, comparator_, &bucket_idx);
+    if (inserted) {
+      LogBucketEntry(transaction, LogRecordType::HASH_INSERT, bucket_page_id, bucket_page, bucket_idx, key, value);
+    }
+    // full and does not have the kv pair
+    *is_full = !inserted && bucket_page->IsFull() && !bucket_page->CheckKeyValueExist(key, value, comparator_);
+    return inserted;
+  }
+
+  // The pair may be on any page of the chain, so all of them are searched before it is inserted.
+  *is_full = false;
+  if (bucket_page->CheckKeyValueExist(key, value, comparator_)) {
+    return false;
+  }
+  bool exists = false;
+  page_id_t free_page_id = INVALID_PAGE_ID;
+  bool agrees = ForEachOverflowPage(bucket_page, key, [&](page_id_t page_id, HASH_TABLE_BUCKET_TYPE *overflow_page) {
+    exists = overflow_page->CheckKeyValueExist(key, value, comparator_);
+    if (free_page_id == INVALID_PAGE_ID && !overflow_page->IsFull()) {
+      free_page_id = page_id;
+    }
+    return exists;
+  });
+  if (agrees && exists) {
+    return false;
+  }
+  // Keys that agree with the overflow pages go there, the bucket page is left to the keys a split can tell apart.
+  if (!agrees) {
+    free_page_id = bucket_page->IsFull() ? INVALID_PAGE_ID : bucket_page_id;
+  }
+  if (free_page_id == INVALID_PAGE_ID) {
+    *is_full = true;
+    return false;
+  }
+  HASH_TABLE_BUCKET_TYPE *free_page = free_page_id == bucket_page_id ? bucket_page : FetchBucketPage(free_page_id);
+  free_page->Insert(key, value, comparator_, &bucket_idx);
+  LogBucketEntry(transaction, LogRecordType::HASH_INSERT, free_page_id, free_page, bucket_idx, key, value);
+  if (free_page != bucket_page) {
+    buffer_pool_manager_->UnpinPage(free_page_id, true, nullptr);
+  }
+  return true;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  HashTableDirectoryPage *directory_page = FetchDirectoryPage();
+  HashTableDirectoryPage *directory_page = FetchDirectoryPage(key);
+  page_id_t directory_page_id = directory_page->GetPageId();
   uint32_t index = KeyToDirectoryIndex(key, directory_page);
   page_id_t old_page_id = directory_page->GetBucketPageId(index);
-  HASH_TABLE_BUCKET_TYPE *old_page = FetchBucketPage(old_page_id);
   uint32_t local_depth = directory_page->GetLocalDepth(index);
-
-  uint32_t new_idx = index;
-  page_id_t new_page_id = INVALID_PAGE_ID;
-  if (local_depth < directory_page->GetGlobalDepth()) {
-    // no need for increasing global depth
-    directory_page->IncrLocalDepth(index);
-    uint32_t local_depth = directory_page->GetLocalDepth(index);
-    new_idx = index ^ (1 << (local_depth - 1));
-    // get new index ***1*** , index is ***0***, new index ***0***, index is ***1**
-  } else if (local_depth == directory_page->GetGlobalDepth()) {
-    directory_page->IncrLocalDepth(
-        index);  // increase local depth and the global depth. two bucket point to same page now
-    uint32_t global_depth = directory_page->GetGlobalDepth();
-    new_idx = index | (1 << (global_depth - 1));  // index 0****, new_idx 1****.
-    if (new_idx >= DIRECTORY_ARRAY_SIZE) {        // if out of bound
-      directory_page->DecrLocalDepth(index);      // decrease local and global depth
-      buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr);
-      buffer_pool_manager_->UnpinPage(old_page_id, false, nullptr);
-      return false;
+  HASH_TABLE_BUCKET_TYPE *old_page = FetchBucketPage(old_page_id);
+  // A split only helps if the bucket has an entry it can tell apart from the key. The bucket page only holds other
+  // keys than the overflow pages.
+  bool splits;
+  if (old_page->GetOverflowPageId() != INVALID_PAGE_ID) {
+    splits = !ForEachOverflowPage(old_page, key, [](page_id_t /*page_id*/, HASH_TABLE_BUCKET_TYPE *overflow_page) {
+      return !overflow_page->IsEmpty();
+    });
+  } else {
+    uint32_t split_hash = SplitHash(key);
+    splits = false;
+    for (uint32_t bucket_idx = 0; bucket_idx < BUCKET_ARRAY_SIZE && !splits; bucket_idx++) {
+      splits = old_page->IsReadable(bucket_idx) && SplitHash(old_page->KeyAt(bucket_idx)) != split_hash;
     }
   }
-  HASH_TABLE_BUCKET_TYPE *new_page =
-      reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(buffer_pool_manager_->NewPage(&new_page_id));
+  if (!splits) {
+    buffer_pool_manager_->UnpinPage(old_page_id, false, nullptr);
+    bool appended = AppendOverflowPage(transaction, directory_page, old_page_id);
+    buffer_pool_manager_->UnpinPage(directory_page_id, appended, nullptr);
+    return appended;
+  }
+  // Splitting a bucket at the global depth doubles the directory, a directory that cannot double is split instead.
+  if (local_depth == directory_page->GetGlobalDepth() && (2U << local_depth) > DIRECTORY_ARRAY_SIZE) {
+    buffer_pool_manager_->UnpinPage(directory_page_id, false, nullptr);
+    buffer_pool_manager_->UnpinPage(old_page_id, false, nullptr);
+    return SplitDirectory(transaction, key);
+  }
+  page_id_t new_page_id = INVALID_PAGE_ID;
+  auto *new_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(buffer_pool_manager_->NewPage(&new_page_id));
+  if (new_page == nullptr) {
+    buffer_pool_manager_->UnpinPage(directory_page_id, false, nullptr);
+    buffer_pool_manager_->UnpinPage(old_page_id, false, nullptr);
+    return false;
+  }
+  bool logging = IsLogging(transaction);
+  std::vector<char> old_directory;
+  if (logging) {
+    auto *directory_data = reinterpret_cast<char *>(directory_page);
+    old_directory.assign(directory_data, directory_data + sizeof(HashTableDirectoryPage));
+  }
+
+  // increase local depth (and the global depth if needed), get new index ***1*** , index is ***0***, new index ***0***,
+  // index is ***1**
+  directory_page->IncrLocalDepth(index);
+  uint32_t new_idx = index ^ (1 << (directory_page->GetLocalDepth(index) - 1));
   // redirect the bucket page ids, half of them point to new page id
   reinterpret_cast<Page *>(new_page)->WLatch();
   directory_page->SeperatePageId(index, new_idx, new_page_id);
-  std::vector<KeyType> keys;
-  std::vector<ValueType> values;
-  old_page->EmptyArray(&keys, &values);
-  keys.push_back(key);
-  values.push_back(value);
-  for (size_t i = 0; i < keys.size(); i++) {
-    uint32_t tmp_index = KeyToDirectoryIndex(keys[i], directory_page);
-    page_id_t tmp_page_id = directory_page->GetBucketPageId(tmp_index);
-    if (tmp_page_id == new_page_id) {
-      new_page->Insert(keys[i], values[i], comparator_);
-    } else {
-      old_page->Insert(keys[i], values[i], comparator_);
+  // The overflow pages move along with their entries, the new page points to them before the split is logged.
+  uint32_t overflow_split_hash;
+  bool moves_overflow =
+      GetOverflowSplitHash(old_page, &overflow_split_hash) &&
+      directory_page->GetBucketPageId(overflow_split_hash & directory_page->GetGlobalDepthMask()) == new_page_id;
+  if (moves_overflow) {
+    SetOverflowPageId(transaction, new_page, old_page->GetOverflowPageId());
+  }
+  LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::HASH_SPLIT, directory_page_id, old_page_id,
+                       new_page_id, HASH_TABLE_BUCKET_TYPE::GetLayout(), 0);
+  // move the pairs that now map to the new page, they fill the new page from its first slot
+  for (uint32_t bucket_idx = 0; bucket_idx < BUCKET_ARRAY_SIZE; bucket_idx++) {
+    if (!old_page->IsReadable(bucket_idx)) {
+      continue;
     }
+    MappingType entry(old_page->KeyAt(bucket_idx), old_page->ValueAt(bucket_idx));
+    if (directory_page->GetBucketPageId(KeyToDirectoryIndex(entry.first, directory_page)) != new_page_id) {
+      continue;
+    }
+    new_page->Insert(entry.first, entry.second, comparator_);
+    old_page->RemoveAt(bucket_idx);
+    if (logging) {
+      log_record.AddBucketEntry(bucket_idx, reinterpret_cast<const char *>(&entry));
+    }
+  }
+  if (logging) {
+    log_record.AddDirectoryDelta(old_directory.data(), reinterpret_cast<char *>(directory_page),
+                                 sizeof(HashTableDirectoryPage));
+    AppendLogRecord(transaction, &log_record,
+                    {reinterpret_cast<Page *>(directory_page), reinterpret_cast<Page *>(old_page),
+                     reinterpret_cast<Page *>(new_page)});
   }
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true, nullptr);
+  if (moves_overflow) {
+    SetOverflowPageId(transaction, old_page, INVALID_PAGE_ID);
+  }
+  buffer_pool_manager_->UnpinPage(directory_page_id, true, nullptr);
   buffer_pool_manager_->UnpinPage(old_page_id, true, nullptr);
   buffer_pool_manager_->UnpinPage(new_page_id, true, nullptr);
   reinterpret_cast<Page *>(new_page)->WUnlatch();
   return true;
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::SplitDirectory(Transaction *transaction, const KeyType &key) {
+  HashTableDirectoryPage *header_page = FetchHeaderPage();
+  uint32_t header_idx = header_page->HashToHeaderIndex(Hash(key));
+  uint32_t local_depth = header_page->GetLocalDepth(header_idx);
+  page_id_t new_directory_page_id = INVALID_PAGE_ID;
+  HashTableDirectoryPage *new_directory_page = nullptr;
+  if (local_depth < header_page->GetGlobalDepth() || (2U << local_depth) <= DIRECTORY_ARRAY_SIZE) {
+    new_directory_page =
+        reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->NewPage(&new_directory_page_id));
+  }
+  if (new_directory_page == nullptr) {
+    buffer_pool_manager_->UnpinPage(header_page_id_, false, nullptr);
+    return false;
+  }
+  page_id_t directory_page_id = header_page->GetBucketPageId(header_idx);
+  auto *directory_page = reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(directory_page_id));
+  memcpy(reinterpret_cast<char *>(new_directory_page), reinterpret_cast<char *>(directory_page),
+         sizeof(HashTableDirectoryPage));
+  new_directory_page->SetPageId(new_directory_page_id);
+  bool logging = IsLogging(transaction);
+  HashTableBucketLayout layout = HASH_TABLE_BUCKET_TYPE::GetLayout();
+
+  // Copy the entries that move to the new directory into new buckets. Nothing reaches them yet.
+  uint32_t split_bit = 1U << (DIRECTORY_MAX_DEPTH + local_depth);
+  std::unordered_map<page_id_t, page_id_t> new_bucket_page_ids;
+  std::vector<std::pair<page_id_t, std::vector<uint32_t>>> moved;
+  std::vector<page_id_t> moved_overflow;
+  bool copied = true;
+  for (uint32_t idx = 0; idx <= directory_page->GetGlobalDepthMask() && copied; idx++) {
+    page_id_t bucket_page_id = directory_page->GetBucketPageId(idx);
+    auto it = new_bucket_page_ids.find(bucket_page_id);
+    if (it != new_bucket_page_ids.end()) {
+      new_directory_page->SetBucketPageId(idx, it->second);
+      continue;
+    }
+    page_id_t new_bucket_page_id = INVALID_PAGE_ID;
+    auto *new_bucket_page =
+        reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(buffer_pool_manager_->NewPage(&new_bucket_page_id));
+    if (new_bucket_page == nullptr) {
+      copied = false;
+      break;
+    }
+    new_bucket_page_ids.emplace(bucket_page_id, new_bucket_page_id);
+    new_directory_page->SetBucketPageId(idx, new_bucket_page_id);
+    HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
+    auto &moved_idxs = moved.emplace_back(bucket_page_id, std::vector<uint32_t>()).second;
+    LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::HASH_SPLIT, INVALID_PAGE_ID, INVALID_PAGE_ID,
+                         new_bucket_page_id, layout, 0);
+    for (uint32_t bucket_idx = 0; bucket_idx < BUCKET_ARRAY_SIZE; bucket_idx++) {
+      if (!bucket_page->IsReadable(bucket_idx) || (Hash(bucket_page->KeyAt(bucket_idx)) & split_bit) == 0) {
+        continue;
+      }
+      MappingType entry(bucket_page->KeyAt(bucket_idx), bucket_page->ValueAt(bucket_idx));
+      new_bucket_page->Insert(entry.first, entry.second, comparator_);
+      moved_idxs.push_back(bucket_idx);
+      if (logging) {
+        log_record.AddBucketEntry(bucket_idx, reinterpret_cast<const char *>(&entry));
+      }
+    }
+    if (logging) {
+      AppendLogRecord(transaction, &log_record, {reinterpret_cast<Page *>(new_bucket_page)});
+    }
+    // Overflow pages are not copied, both buckets point to them until the old one lets go below.
+    uint32_t overflow_split_hash;
+    if (GetOverflowSplitHash(bucket_page, &overflow_split_hash) && (overflow_split_hash & split_bit) != 0) {
+      SetOverflowPageId(transaction, new_bucket_page, bucket_page->GetOverflowPageId());
+      moved_overflow.push_back(bucket_page_id);
+    }
+    buffer_pool_manager_->UnpinPage(bucket_page_id, false, nullptr);
+    buffer_pool_manager_->UnpinPage(new_bucket_page_id, true, nullptr);
+  }
+  if (!copied) {
+    // The pages allocated so far are left unused.
+    buffer_pool_manager_->UnpinPage(header_page_id_, false, nullptr);
+    buffer_pool_manager_->UnpinPage(directory_page_id, false, nullptr);
+    buffer_pool_manager_->UnpinPage(new_directory_page_id, false, nullptr);
+    return false;
+  }
+
+  // Directory-only changes are logged as merges, the new directory against the zeroed page it starts out as.
+  if (logging) {
+    std::vector<char> old_directory(sizeof(HashTableDirectoryPage), 0);
+    LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::HASH_MERGE, new_directory_page_id,
+                         INVALID_PAGE_ID, INVALID_PAGE_ID, layout, 0);
+    log_record.AddDirectoryDelta(old_directory.data(), reinterpret_cast<char *>(new_directory_page),
+                                 sizeof(HashTableDirectoryPage));
+    AppendLogRecord(transaction, &log_record, {reinterpret_cast<Page *>(new_directory_page)});
+  }
+  std::vector<char> old_header;
+  if (logging) {
+    auto *header_data = reinterpret_cast<char *>(header_page);
+    old_header.assign(header_data, header_data + sizeof(HashTableDirectoryPage));
+  }
+  header_page->IncrLocalDepth(header_idx);
+  header_page->SeperatePageId(header_idx, header_idx | (1U << local_depth), new_directory_page_id);
+  if (logging) {
+    LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::HASH_MERGE, header_page_id_, INVALID_PAGE_ID,
+                         INVALID_PAGE_ID, layout, 0);
+    log_record.AddDirectoryDelta(old_header.data(), reinterpret_cast<char *>(header_page),
+                                 sizeof(HashTableDirectoryPage));
+    AppendLogRecord(transaction, &log_record, {reinterpret_cast<Page *>(header_page)});
+  }
+  buffer_pool_manager_->UnpinPage(header_page_id_, true, nullptr);
+  buffer_pool_manager_->UnpinPage(directory_page_id, false, nullptr);
+  buffer_pool_manager_->UnpinPage(new_directory_page_id, true, nullptr);
+
+  // Only now that the header points to the new directory are the moved entries removed from the old buckets.
+  for (auto &[bucket_page_id, bucket_idxs] : moved) {
+    if (bucket_idxs.empty()) {
+      continue;
+    }
+    HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
+    LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::HASH_SPLIT, INVALID_PAGE_ID, bucket_page_id,
+                         INVALID_PAGE_ID, layout, 0);
+    for (uint32_t bucket_idx : bucket_idxs) {
+      if (logging) {
+        MappingType entry(bucket_page->KeyAt(bucket_idx), bucket_page->ValueAt(bucket_idx));
+        log_record.AddBucketEntry(bucket_idx, reinterpret_cast<const char *>(&entry));
+      }
+      bucket_page->RemoveAt(bucket_idx);
+    }
+    if (logging) {
+      AppendLogRecord(transaction, &log_record, {reinterpret_cast<Page *>(bucket_page)});
+    }
+    buffer_pool_manager_->UnpinPage(bucket_page_id, true, nullptr);
+  }
+  for (page_id_t bucket_page_id : moved_overflow) {
+    HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
+    SetOverflowPageId(transaction, bucket_page, INVALID_PAGE_ID);
+    buffer_pool_manager_->UnpinPage(bucket_page_id, true, nullptr);
+  }
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::AppendOverflowPage(Transaction *transaction, HashTableDirectoryPage *directory_page,
+                                         page_id_t bucket_page_id) {
+  page_id_t new_page_id = INVALID_PAGE_ID;
+  auto *new_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(buffer_pool_manager_->NewPage(&new_page_id));
+  if (new_page == nullptr) {
+    return false;
+  }
+  // The new page is logged empty, so that redo starts it out empty whatever its page held before.
+  if (IsLogging(transaction)) {
+    LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::HASH_SPLIT, INVALID_PAGE_ID, INVALID_PAGE_ID,
+                         new_page_id, HASH_TABLE_BUCKET_TYPE::GetLayout(), 0);
+    AppendLogRecord(transaction, &log_record, {reinterpret_cast<Page *>(new_page)});
+  }
+
+  HASH_TABLE_BUCKET_TYPE *last_page = FetchBucketPage(bucket_page_id);
+  if (last_page->GetOverflowPageId() == INVALID_PAGE_ID) {
+    // The full bucket page becomes the first overflow page, the new page takes its place in the directory.
+    SetOverflowPageId(transaction, new_page, bucket_page_id);
+    std::vector<char> old_directory;
+    if (IsLogging(transaction)) {
+      auto *directory_data = reinterpret_cast<char *>(directory_page);
+      old_directory.assign(directory_data, directory_data + sizeof(HashTableDirectoryPage));
+    }
+    for (uint32_t idx = 0; idx <= directory_page->GetGlobalDepthMask(); idx++) {
+      if (directory_page->GetBucketPageId(idx) == bucket_page_id) {
+        directory_page->SetBucketPageId(idx, new_page_id);
+      }
+    }
+    if (IsLogging(transaction)) {
+      LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::HASH_MERGE, directory_page->GetPageId(),
+                           INVALID_PAGE_ID, INVALID_PAGE_ID, HASH_TABLE_BUCKET_TYPE::GetLayout(), 0);
+      log_record.AddDirectoryDelta(old_directory.data(), reinterpret_cast<char *>(directory_page),
+                                   sizeof(HashTableDirectoryPage));
+      AppendLogRecord(transaction, &log_record, {reinterpret_cast<Page *>(directory_page)});
+    }
+    buffer_pool_manager_->UnpinPage(bucket_page_id, false, nullptr);
+    buffer_pool_manager_->UnpinPage(new_page_id, true, nullptr);
+    return true;
+  }
+  buffer_pool_manager_->UnpinPage(new_page_id, true, nullptr);
+
+  page_id_t last_page_id = bucket_page_id;
+  while (last_page->GetOverflowPageId() != INVALID_PAGE_ID) {
+    page_id_t next_page_id = last_page->GetOverflowPageId();
+    buffer_pool_manager_->UnpinPage(last_page_id, false, nullptr);
+    last_page_id = next_page_id;
+    last_page = FetchBucketPage(last_page_id);
+  }
+  SetOverflowPageId(transaction, last_page, new_page_id);
+  buffer_pool_manager_->UnpinPage(last_page_id, true, nullptr);
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::PruneOverflowPages(Transaction *transaction, page_id_t bucket_page_id) {
+  page_id_t prev_page_id = bucket_page_id;
+  HASH_TABLE_BUCKET_TYPE *prev_page = FetchBucketPage(prev_page_id);
+  bool prev_dirty = false;
+  while (prev_page->GetOverflowPageId() != INVALID_PAGE_ID) {
+    page_id_t page_id = prev_page->GetOverflowPageId();
+    HASH_TABLE_BUCKET_TYPE *overflow_page = FetchBucketPage(page_id);
+    if (overflow_page->IsEmpty()) {
+      SetOverflowPageId(transaction, prev_page, overflow_page->GetOverflowPageId());
+      prev_dirty = true;
+      buffer_pool_manager_->UnpinPage(page_id, false, nullptr);
+      buffer_pool_manager_->DeletePage(page_id, nullptr);
+      continue;
+    }
+    buffer_pool_manager_->UnpinPage(prev_page_id, prev_dirty, nullptr);
+    prev_page_id = page_id;
+    prev_page = overflow_page;
+    prev_dirty = false;
+  }
+  buffer_pool_manager_->UnpinPage(prev_page_id, prev_dirty, nullptr);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::SetOverflowPageId(Transaction *transaction, HASH_TABLE_BUCKET_TYPE *bucket_page,
+                                        page_id_t overflow_page_id) {
+  // Redo applies the delta at its offset in the page.
+  auto *header = reinterpret_cast<char *>(bucket_page);
+  char old_header[HashTableBucketLayout::OFFSET_OVERFLOW + sizeof(page_id_t)];
+  memcpy(old_header, header, sizeof(old_header));
+  bucket_page->SetOverflowPageId(overflow_page_id);
+  if (IsLogging(transaction)) {
+    auto *page = reinterpret_cast<Page *>(bucket_page);
+    LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::HASH_MERGE, page->GetPageId(), INVALID_PAGE_ID,
+                         INVALID_PAGE_ID, HASH_TABLE_BUCKET_TYPE::GetLayout(), 0);
+    log_record.AddDirectoryDelta(old_header, header, sizeof(old_header));
+    AppendLogRecord(transaction, &log_record, {page});
+  }
+}
+
 /*****************************************************************************
  * REMOVE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  table_latch_.WLock();
-  HashTableDirectoryPage *directory_page = FetchDirectoryPage();
+  // Like inserts, removes share the table latch unless they empty a bucket that may be merged.
+  table_latch_.RLock();
+  HashTableDirectoryPage *directory_page = FetchDirectoryPage(key);
   uint32_t index = KeyToDirectoryIndex(key, directory_page);
   page_id_t page_id = directory_page->GetBucketPageId(index);
   HASH_TABLE_BUCKET_TYPE *cur_page = FetchBucketPage(page_id);
   reinterpret_cast<Page *>(cur_page)->WLatch();
-  if (!cur_page->Remove(key, value, comparator_)) {
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr);
-    buffer_pool_manager_->UnpinPage(page_id, false, nullptr);
-    reinterpret_cast<Page *>(cur_page)->WUnlatch();
-    table_latch_.WUnlock();
-    return false;
+  uint32_t bucket_idx;
+  bool removed = cur_page->Remove(key, value, comparator_, &bucket_idx);
+  bool needs_merge = false;
+  if (removed) {
+    LogBucketEntry(transaction, LogRecordType::HASH_DELETE, page_id, cur_page, bucket_idx, key, value);
+    needs_merge = cur_page->IsEmpty() && directory_page->GetLocalDepth(index) > 0;
+  } else if (cur_page->GetOverflowPageId() != INVALID_PAGE_ID) {
+    page_id_t overflow_page_id = INVALID_PAGE_ID;
+    ForEachOverflowPage(cur_page, key, [&](page_id_t chain_page_id, HASH_TABLE_BUCKET_TYPE *overflow_page) {
+      if (overflow_page->CheckKeyValueExist(key, value, comparator_)) {
+        overflow_page_id = chain_page_id;
+      }
+      return overflow_page_id != INVALID_PAGE_ID;
+    });
+    if (overflow_page_id != INVALID_PAGE_ID) {
+      HASH_TABLE_BUCKET_TYPE *overflow_page = FetchBucketPage(overflow_page_id);
+      overflow_page->Remove(key, value, comparator_, &bucket_idx);
+      LogBucketEntry(transaction, LogRecordType::HASH_DELETE, overflow_page_id, overflow_page, bucket_idx, key, value);
+      // An emptied overflow page is unlinked by the merge.
+      needs_merge = overflow_page->IsEmpty();
+      buffer_pool_manager_->UnpinPage(overflow_page_id, true, nullptr);
+      removed = true;
+    }
   }
+  buffer_pool_manager_->UnpinPage(directory_page->GetPageId(), false, nullptr);
+  buffer_pool_manager_->UnpinPage(page_id, removed, nullptr);
+  reinterpret_cast<Page *>(cur_page)->WUnlatch();
+  table_latch_.RUnlock();
 
-  if (cur_page->IsEmpty() && directory_page->GetLocalDepth(index) > 0) {
-    reinterpret_cast<Page *>(cur_page)->WUnlatch();
+  // Merge checks again whether the bucket is still empty and can be merged.
+  if (needs_merge) {
+    table_latch_.WLock();
     Merge(transaction, key, value);
-    buffer_pool_manager_->UnpinPage(directory_page_id_, true, nullptr);
-    buffer_pool_manager_->UnpinPage(page_id, true, nullptr);
-  } else {
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr);
-    buffer_pool_manager_->UnpinPage(page_id, true, nullptr);
-    reinterpret_cast<Page *>(cur_page)->WUnlatch();
+    table_latch_.WUnlock();
   }
-  table_latch_.WUnlock();
-  return true;
+  return removed;
 }
 
 /*****************************************************************************
@@ -232,23 +793,26 @@ bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  HashTableDirectoryPage *directory_page = FetchDirectoryPage();
+  HashTableDirectoryPage *directory_page = FetchDirectoryPage(key);
+  page_id_t directory_page_id = directory_page->GetPageId();
   uint32_t index = KeyToDirectoryIndex(key, directory_page);
   // std::cout<< "Before Merge\n";
   // directory_page->PrintDirectory();
+  PruneOverflowPages(transaction, directory_page->GetBucketPageId(index));
 
   uint32_t local_depth = directory_page->GetLocalDepth(index);
-  uint32_t merge_page_index = index ^ (1 << (local_depth - 1));
+  // Emptied overflow pages get here with local depth 0 too.
+  uint32_t merge_page_index = local_depth == 0 ? index : index ^ (1 << (local_depth - 1));
   if (local_depth == 0 || local_depth != directory_page->GetLocalDepth(merge_page_index)) {
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr);
+    buffer_pool_manager_->UnpinPage(directory_page_id, false, nullptr);
     return;
   }
 
   page_id_t page_id = directory_page->GetBucketPageId(index);
   HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(page_id);
   reinterpret_cast<Page *>(bucket_page)->RLatch();
-  if (!bucket_page->IsEmpty()) {
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr);
+  if (!bucket_page->IsEmpty() || bucket_page->GetOverflowPageId() != INVALID_PAGE_ID) {
+    buffer_pool_manager_->UnpinPage(directory_page_id, false, nullptr);
     buffer_pool_manager_->UnpinPage(page_id, false, nullptr);
     reinterpret_cast<Page *>(bucket_page)->RUnlatch();
     return;
@@ -256,21 +820,32 @@ void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const
   buffer_pool_manager_->UnpinPage(page_id, false, nullptr);
   reinterpret_cast<Page *>(bucket_page)->RUnlatch();
 
+  std::vector<char> old_directory;
+  if (IsLogging(transaction)) {
+    auto *directory_data = reinterpret_cast<char *>(directory_page);
+    old_directory.assign(directory_data, directory_data + sizeof(HashTableDirectoryPage));
+  }
+  page_id_t merge_page_id = directory_page->GetBucketPageId(merge_page_index);
   if (directory_page->GetLocalDepth(index) == directory_page->GetGlobalDepth()) {
-    page_id_t merge_page_id = directory_page->GetBucketPageId(merge_page_index);
     directory_page->SetBucketPageId(index, merge_page_id);
     directory_page->SetBucketPageId(merge_page_index, merge_page_id);
     directory_page->DecrLocalDepth(index);
   } else {
     uint32_t next_local_mask =
         ((1 << local_depth) - 1) >> 1;  // create mask for local depth (after decreased, thats what the >>1 for)
-    page_id_t merge_page_id = directory_page->GetBucketPageId(merge_page_index);
     directory_page->MergePageId(index, next_local_mask, merge_page_id);
     directory_page->DecrLocalDepth(index);
   }
+  if (IsLogging(transaction)) {
+    LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::HASH_MERGE, directory_page_id, page_id,
+                         merge_page_id, HASH_TABLE_BUCKET_TYPE::GetLayout(), 0);
+    log_record.AddDirectoryDelta(old_directory.data(), reinterpret_cast<char *>(directory_page),
+                                 sizeof(HashTableDirectoryPage));
+    AppendLogRecord(transaction, &log_record, {reinterpret_cast<Page *>(directory_page)});
+  }
   uint32_t new_index = KeyToDirectoryIndex(key, directory_page);
   page_id_t new_page_id = directory_page->GetBucketPageId(new_index);
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true, nullptr);
+  buffer_pool_manager_->UnpinPage(directory_page_id, true, nullptr);
 
   HASH_TABLE_BUCKET_TYPE *new_page = FetchBucketPage(new_page_id);
   reinterpret_cast<Page *>(new_page)->WLatch();
@@ -287,27 +862,76 @@ void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const
 }
 
 /*****************************************************************************
- * GETGLOBALDEPTH - DO NOT TOUCH
+ * LOGGING
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::LogBucketEntry(Transaction *transaction, LogRecordType log_record_type,
+                                     page_id_t bucket_page_id, HASH_TABLE_BUCKET_TYPE *bucket_page,
+                                     uint32_t bucket_idx, const KeyType &key, const ValueType &value) {
+  if (!IsLogging(transaction)) {
+    return;
+  }
+  // The hash finds the entry's bucket through the header again when undo runs after the bucket was split or merged.
+  LogRecord log_record(transaction->GetTransactionId(), transaction->GetPrevLSN(), log_record_type, header_page_id_,
+                       bucket_page_id, INVALID_PAGE_ID, HASH_TABLE_BUCKET_TYPE::GetLayout(), Hash(key));
+  MappingType entry(key, value);
+  log_record.AddBucketEntry(bucket_idx, reinterpret_cast<const char *>(&entry));
+  AppendLogRecord(transaction, &log_record, {reinterpret_cast<Page *>(bucket_page)});
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::AppendLogRecord(Transaction *transaction, LogRecord *log_record,
+                                      std::initializer_list<Page *> pages) {
+  lsn_t lsn = log_manager_->AppendLogRecord(log_record);
+  for (Page *page : pages) {
+    page->SetLSN(lsn);
+  }
+  // Splits and merges are not undone with the transaction.
+  if (log_record->GetTxnId() != INVALID_TXN_ID) {
+    transaction->SetPrevLSN(lsn);
+  }
+  transaction->AddLogBytes(log_record->GetSize());
+}
+
+/*****************************************************************************
+ * GETGLOBALDEPTH
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 uint32_t HASH_TABLE_TYPE::GetGlobalDepth() {
   table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t global_depth = dir_page->GetGlobalDepth();
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr));
+  HashTableDirectoryPage *header_page = FetchHeaderPage();
+  uint32_t directory_depth = 0;
+  for (uint32_t idx = 0; idx <= header_page->GetGlobalDepthMask(); idx++) {
+    page_id_t directory_page_id = header_page->GetBucketPageId(idx);
+    auto *dir_page = reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(directory_page_id));
+    directory_depth = std::max(directory_depth, dir_page->GetGlobalDepth());
+    buffer_pool_manager_->UnpinPage(directory_page_id, false, nullptr);
+  }
+  uint32_t global_depth = header_page->GetGlobalDepth() + directory_depth;
+  buffer_pool_manager_->UnpinPage(header_page_id_, false, nullptr);
   table_latch_.RUnlock();
   return global_depth;
 }
 
 /*****************************************************************************
- * VERIFY INTEGRITY - DO NOT TOUCH
+ * VERIFY INTEGRITY
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_TYPE::VerifyIntegrity() {
   table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  dir_page->VerifyIntegrity();
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr));
+  HashTableDirectoryPage *header_page = FetchHeaderPage();
+  header_page->VerifyIntegrity();
+  std::unordered_set<page_id_t> verified;
+  for (uint32_t idx = 0; idx <= header_page->GetGlobalDepthMask(); idx++) {
+    page_id_t directory_page_id = header_page->GetBucketPageId(idx);
+    if (!verified.insert(directory_page_id).second) {
+      continue;
+    }
+    auto *dir_page = reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(directory_page_id));
+    dir_page->VerifyIntegrity();
+    buffer_pool_manager_->UnpinPage(directory_page_id, false, nullptr);
+  }
+  buffer_pool_manager_->UnpinPage(header_page_id_, false, nullptr);
   table_latch_.RUnlock();
 }
 
@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <utility>
@@ -23,46 +24,329 @@
 namespace bustub {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-HASH_TABLE_TYPE::LinearProbeHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                                      const KeyComparator &comparator, size_t num_buckets,
-                                      HashFunction<KeyType> hash_fn)
-    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {}
+LINEAR_PROBE_HASH_TABLE_TYPE::LinearProbeHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
+                                                   const KeyComparator &comparator, size_t num_buckets,
+                                                   HashFunction<KeyType> hash_fn)
+    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
+  size_t num_blocks = (num_buckets + BLOCK_ARRAY_SIZE - 1) / BLOCK_ARRAY_SIZE;
+  table_ = NewTable(std::clamp<size_t>(num_blocks, 1, HashTableHeaderPage::MaxNumBlocks()));
+}
+
+/*****************************************************************************
+ * HELPERS
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+std::unique_ptr<typename LINEAR_PROBE_HASH_TABLE_TYPE::Table> LINEAR_PROBE_HASH_TABLE_TYPE::NewTable(
+    size_t num_blocks) {
+  auto table = std::make_unique<Table>();
+  auto *header_page =
+      reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->NewPage(&table->header_page_id_));
+  header_page->SetPageId(table->header_page_id_);
+  header_page->SetSize(num_blocks * BLOCK_ARRAY_SIZE);
+  for (size_t i = 0; i < num_blocks; i++) {
+    page_id_t block_page_id;
+    buffer_pool_manager_->NewPage(&block_page_id);
+    header_page->AddBlockPageId(block_page_id);
+    table->block_page_ids_.push_back(block_page_id);
+    buffer_pool_manager_->UnpinPage(block_page_id, true, nullptr);
+  }
+  buffer_pool_manager_->UnpinPage(table->header_page_id_, true, nullptr);
+  return table;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void LINEAR_PROBE_HASH_TABLE_TYPE::DeleteTable(const Table &table) {
+  for (page_id_t block_page_id : table.block_page_ids_) {
+    buffer_pool_manager_->DeletePage(block_page_id, nullptr);
+  }
+  buffer_pool_manager_->DeletePage(table.header_page_id_, nullptr);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+typename LINEAR_PROBE_HASH_TABLE_TYPE::Probe LINEAR_PROBE_HASH_TABLE_TYPE::ProbeKey(Table *table, const KeyType &key,
+                                                                                    bool exclusive) {
+  size_t num_slots = table->block_page_ids_.size() * BLOCK_ARRAY_SIZE;
+  size_t home_slot = hash_fn_.GetHash(key) % num_slots;
+  // The blocks to latch, in the order they are latched in.
+  std::vector<size_t> blocks{home_slot / BLOCK_ARRAY_SIZE};
+  while (true) {
+    Probe probe;
+    for (size_t block : blocks) {
+      Page *page = buffer_pool_manager_->FetchPage(table->block_page_ids_[block]);
+      if (exclusive) {
+        page->WLatch();
+      } else {
+        page->RLatch();
+      }
+      probe.latched_.push_back(page);
+    }
+
+    size_t slot = home_slot;
+    size_t current_block = num_slots;
+    HASH_TABLE_BLOCK_TYPE *block_page = nullptr;
+    for (size_t i = 0; i < num_slots; i++, slot = slot + 1 == num_slots ? 0 : slot + 1) {
+      size_t block = slot / BLOCK_ARRAY_SIZE;
+      slot_offset_t offset = slot % BLOCK_ARRAY_SIZE;
+      if (block != current_block) {
+        auto it = std::lower_bound(blocks.begin(), blocks.end(), block);
+        if (it == blocks.end() || *it != block) {
+          break;
+        }
+        block_page = reinterpret_cast<HASH_TABLE_BLOCK_TYPE *>(probe.latched_[it - blocks.begin()]);
+        current_block = block;
+      }
+      if (!block_page->IsOccupied(offset)) {
+        probe.free_block_ = block_page;
+        probe.free_slot_ = offset;
+        return probe;
+      }
+      if (block_page->IsReadable(offset) && comparator_(key, block_page->KeyAt(offset)) == 0) {
+        probe.matches_.emplace_back(block_page, offset);
+      }
+    }
+    if (blocks.size() == table->block_page_ids_.size()) {
+      // Every slot is occupied.
+      return probe;
+    }
+    // The probe ran into a block it did not latch, which comes before the blocks latched if it wrapped around.
+    size_t missing = slot / BLOCK_ARRAY_SIZE;
+    Release(probe, exclusive);
+    blocks.insert(std::lower_bound(blocks.begin(), blocks.end(), missing), missing);
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void LINEAR_PROBE_HASH_TABLE_TYPE::Release(const Probe &probe, bool exclusive,
+                                           const HASH_TABLE_BLOCK_TYPE *dirty_block) {
+  for (Page *page : probe.latched_) {
+    if (exclusive) {
+      page->WUnlatch();
+    } else {
+      page->RUnlatch();
+    }
+    bool dirty = reinterpret_cast<HASH_TABLE_BLOCK_TYPE *>(page) == dirty_block;
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), dirty, nullptr);
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool LINEAR_PROBE_HASH_TABLE_TYPE::InsertEntry(Table *table, const KeyType &key, const ValueType &value) {
+  Probe probe = ProbeKey(table, key, true);
+  bool inserted = probe.free_block_ != nullptr && probe.free_block_->Insert(probe.free_slot_, key, value);
+  if (inserted) {
+    table->num_occupied_++;
+    table->num_readable_++;
+  }
+  Release(probe, true, inserted ? probe.free_block_ : nullptr);
+  return inserted;
+}
 
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) {
-  return false;
+bool LINEAR_PROBE_HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key,
+                                            std::vector<ValueType> *result) {
+  size_t num_found = result->size();
+  table_latch_.RLock();
+  // The old table is probed first and stays latched, so no entry of the key is migrated meanwhile.
+  Probe old_probe;
+  if (old_table_ != nullptr) {
+    old_probe = ProbeKey(old_table_.get(), key, false);
+    for (auto &[block_page, slot] : old_probe.matches_) {
+      result->push_back(block_page->ValueAt(slot));
+    }
+  }
+  Probe probe = ProbeKey(table_.get(), key, false);
+  for (auto &[block_page, slot] : probe.matches_) {
+    result->push_back(block_page->ValueAt(slot));
+  }
+  Release(probe, false);
+  Release(old_probe, false);
+  table_latch_.RUnlock();
+  return result->size() > num_found;
 }
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  return false;
+bool LINEAR_PROBE_HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) {
+  auto holds_value = [&value](const Probe &probe) {
+    return std::any_of(probe.matches_.begin(), probe.matches_.end(),
+                       [&value](const auto &match) { return match.first->ValueAt(match.second) == value; });
+  };
+  while (true) {
+    table_latch_.RLock();
+    bool migrated_last = MigrateBlock();
+    Probe old_probe;
+    bool duplicate = false;
+    if (old_table_ != nullptr) {
+      old_probe = ProbeKey(old_table_.get(), key, false);
+      duplicate = holds_value(old_probe);
+    }
+    Table *table = table_.get();
+    Probe probe = ProbeKey(table, key, true);
+    duplicate = duplicate || holds_value(probe);
+    bool full = !duplicate && probe.free_block_ == nullptr;
+    bool inserted = !duplicate && !full && probe.free_block_->Insert(probe.free_slot_, key, value);
+    if (inserted) {
+      table->num_occupied_++;
+      table->num_readable_++;
+    }
+    page_id_t header_page_id = table->header_page_id_;
+    size_t num_slots = table->block_page_ids_.size() * BLOCK_ARRAY_SIZE;
+    bool overloaded = old_table_ == nullptr && table->num_occupied_ > MAX_LOAD_FACTOR * num_slots;
+    Release(probe, true, inserted ? probe.free_block_ : nullptr);
+    Release(old_probe, false);
+    table_latch_.RUnlock();
+
+    if (migrated_last) {
+      FinishResize();
+    }
+    if (!overloaded && !full) {
+      return inserted;
+    }
+    table_latch_.WLock();
+    // Another insert may have resized the table meanwhile.
+    bool resized = table_->header_page_id_ != header_page_id;
+    if (!resized && (full || old_table_ == nullptr)) {
+      // A table mostly holding tombstones is rebuilt at the same size.
+      resized = StartResize(std::max(table_->num_readable_.load(), num_slots / 2));
+    }
+    table_latch_.WUnlock();
+    if (!full) {
+      return inserted;
+    }
+    if (!resized) {
+      return false;
+    }
+  }
 }
 
 /*****************************************************************************
  * REMOVE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  return false;
+bool LINEAR_PROBE_HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
+  auto remove_value = [&value](Table *table, const Probe &probe) -> HASH_TABLE_BLOCK_TYPE * {
+    for (auto &[block_page, slot] : probe.matches_) {
+      if (block_page->ValueAt(slot) == value) {
+        block_page->Remove(slot);
+        table->num_readable_--;
+        return block_page;
+      }
+    }
+    return nullptr;
+  };
+  table_latch_.RLock();
+  bool migrated_last = MigrateBlock();
+  Probe old_probe;
+  HASH_TABLE_BLOCK_TYPE *old_removed = nullptr;
+  if (old_table_ != nullptr) {
+    old_probe = ProbeKey(old_table_.get(), key, true);
+    old_removed = remove_value(old_table_.get(), old_probe);
+  }
+  Probe probe;
+  HASH_TABLE_BLOCK_TYPE *removed = nullptr;
+  if (old_removed == nullptr) {
+    probe = ProbeKey(table_.get(), key, true);
+    removed = remove_value(table_.get(), probe);
+  }
+  Release(probe, true, removed);
+  Release(old_probe, true, old_removed);
+  table_latch_.RUnlock();
+
+  if (migrated_last) {
+    FinishResize();
+  }
+  return removed != nullptr || old_removed != nullptr;
 }
 
 /*****************************************************************************
  * RESIZE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-void HASH_TABLE_TYPE::Resize(size_t initial_size) {}
+void LINEAR_PROBE_HASH_TABLE_TYPE::Resize(size_t initial_size) {
+  table_latch_.WLock();
+  StartResize(initial_size);
+  table_latch_.WUnlock();
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool LINEAR_PROBE_HASH_TABLE_TYPE::StartResize(size_t initial_size) {
+  if (old_table_ != nullptr) {
+    // Nothing else runs under the exclusive table latch, every block claimed is migrated already.
+    while (old_table_->next_migrated_block_ < old_table_->block_page_ids_.size()) {
+      MigrateBlock();
+    }
+    DeleteTable(*old_table_);
+    old_table_.reset();
+  }
+  // Inserts into the new table before the old one is migrated migrate a block each, so there are no more entries in
+  // the new table by then than this.
+  size_t max_entries = table_->num_readable_ + table_->block_page_ids_.size();
+  size_t num_slots = 2 * std::max(initial_size, max_entries);
+  size_t num_blocks =
+      std::min((num_slots + BLOCK_ARRAY_SIZE - 1) / BLOCK_ARRAY_SIZE, HashTableHeaderPage::MaxNumBlocks());
+  if (num_blocks * BLOCK_ARRAY_SIZE * MAX_LOAD_FACTOR < max_entries) {
+    return false;
+  }
+  old_table_ = std::move(table_);
+  table_ = NewTable(num_blocks);
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool LINEAR_PROBE_HASH_TABLE_TYPE::MigrateBlock() {
+  Table *old_table = old_table_.get();
+  if (old_table == nullptr) {
+    return false;
+  }
+  size_t num_blocks = old_table->block_page_ids_.size();
+  size_t block = old_table->next_migrated_block_++;
+  if (block >= num_blocks) {
+    return false;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(old_table->block_page_ids_[block]);
+  page->WLatch();
+  auto *block_page = reinterpret_cast<HASH_TABLE_BLOCK_TYPE *>(page);
+  bool dirty = false;
+  for (slot_offset_t slot = 0; slot < BLOCK_ARRAY_SIZE; slot++) {
+    if (!block_page->IsReadable(slot)) {
+      continue;
+    }
+    if (!InsertEntry(table_.get(), block_page->KeyAt(slot), block_page->ValueAt(slot))) {
+      UNREACHABLE("The new table has room for every entry of the old one.");
+    }
+    // Left as a tombstone, the entry is neither found twice nor cuts short the probes of later blocks.
+    block_page->Remove(slot);
+    old_table->num_readable_--;
+    dirty = true;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), dirty, nullptr);
+  return ++old_table->num_migrated_blocks_ == num_blocks;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void LINEAR_PROBE_HASH_TABLE_TYPE::FinishResize() {
+  table_latch_.WLock();
+  if (old_table_ != nullptr && old_table_->num_migrated_blocks_ == old_table_->block_page_ids_.size()) {
+    DeleteTable(*old_table_);
+    old_table_.reset();
+  }
+  table_latch_.WUnlock();
+}
 
 /*****************************************************************************
  * GETSIZE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-size_t HASH_TABLE_TYPE::GetSize() {
-  return 0;
+size_t LINEAR_PROBE_HASH_TABLE_TYPE::GetSize() {
+  table_latch_.RLock();
+  size_t size = table_->block_page_ids_.size() * BLOCK_ARRAY_SIZE;
+  table_latch_.RUnlock();
+  return size;
 }
 
 template class LinearProbeHashTable<int, int, IntComparator>;
@@ -24,6 +24,7 @@ void DeleteExecutor::Init() {
   catalog_ = exec_ctx_->GetCatalog();
   table_info_ = catalog_->GetTable(plan_->TableOid());
   txn_ = exec_ctx_->GetTransaction();
+  table_info_->table_->LockTable(txn_, LockMode::INTENTION_EXCLUSIVE);
   child_executor_->Init();
 }
 
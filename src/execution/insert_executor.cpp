@@ -25,6 +25,7 @@ void InsertExecutor::Init() {
   catalog_ = exec_ctx_->GetCatalog();
   table_info_ = catalog_->GetTable(plan_->TableOid());
   txn_ = exec_ctx_->GetTransaction();
+  table_info_->table_->LockTable(txn_, LockMode::INTENTION_EXCLUSIVE);
   if (!is_raw_) {
     child_executor_->Init();
   }
@@ -22,6 +22,10 @@ void SeqScanExecutor::Init() {
   txn_ = exec_ctx_->GetTransaction();
   catalog_ = exec_ctx_->GetCatalog();
   table_info_ = catalog_->GetTable(plan_->GetTableOid());
+  // Repeatable read keeps every scanned tuple locked, a single table lock does the same.
+  if (txn_->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ) {
+    table_info_->table_->LockTable(txn_, LockMode::SHARED);
+  }
   iterator_ = TableIterator(table_info_->table_->Begin(txn_));
 }
 
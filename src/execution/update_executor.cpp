@@ -23,6 +23,7 @@ void UpdateExecutor::Init() {
   catalog_ = exec_ctx_->GetCatalog();
   txn_ = exec_ctx_->GetTransaction();
   table_info_ = catalog_->GetTable(plan_->TableOid());
+  table_info_->table_->LockTable(txn_, LockMode::INTENTION_EXCLUSIVE);
   child_executor_->Init();
 }
 
@@ -23,6 +23,8 @@
 
 namespace bustub {
 
+class LogRecovery;
+
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
  */
@@ -87,6 +89,34 @@ class BufferPoolManager {
   /** @return size of the buffer pool */
   virtual size_t GetPoolSize() = 0;
 
+  /**
+   * Collects the dirty page table, i.e. the recovery LSN of every buffered page with logged changes not yet on disk.
+   * @param[out] dirty_pages maps page id to recovery LSN
+   */
+  virtual void GetDirtyPageTable(std::unordered_map<page_id_t, lsn_t> *dirty_pages) = 0;
+
+  /**
+   * Writes a buffered page to disk without holding the buffer pool latch during the I/O. The page is copied out
+   * under its read latch, so concurrent transactions are only blocked for the copy. Used by fuzzy checkpoints.
+   * @param page_id id of page to be flushed
+   * @return false if the page is not in the buffer pool, true otherwise
+   */
+  virtual bool FlushPageFuzzy(page_id_t page_id) = 0;
+
+  /**
+   * Enables lazy redo for instant restart: every page read from disk is brought up to date by the log recovery
+   * before it is handed out.
+   * @param log_recovery the recovery replaying pending log records, or nullptr once redo has finished
+   */
+  virtual void SetLogRecovery(LogRecovery *log_recovery) = 0;
+
+  /**
+   * Makes sure that pages allocated from now on get larger ids than the pages already in use. Page ids restart from
+   * the beginning after a restart, so recovery reserves the ids of the pages it finds in the log and on disk.
+   * @param page_id the largest page id in use
+   */
+  virtual void ReservePageIds(page_id_t page_id) = 0;
+
  protected:
   /**
    * Grading function. Do not modify!
@@ -58,6 +58,31 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** @return pointer to all the pages in the buffer pool */
   Page *GetPages() { return pages_; }
 
+  /**
+   * Collects the dirty page table, i.e. the recovery LSN of every buffered page with logged changes not yet on disk.
+   * @param[out] dirty_pages maps page id to recovery LSN
+   */
+  void GetDirtyPageTable(std::unordered_map<page_id_t, lsn_t> *dirty_pages) override;
+
+  /**
+   * Writes a buffered page to disk without holding the buffer pool latch during the I/O.
+   * @param page_id id of page to be flushed
+   * @return false if the page is not in the buffer pool, true otherwise
+   */
+  bool FlushPageFuzzy(page_id_t page_id) override;
+
+  /**
+   * Enables lazy redo of pages read from disk.
+   * @param log_recovery the recovery replaying pending log records, or nullptr once redo has finished
+   */
+  void SetLogRecovery(LogRecovery *log_recovery) override { log_recovery_ = log_recovery; }
+
+  /**
+   * Makes sure that pages allocated from now on get larger ids than the pages already in use.
+   * @param page_id the largest page id in use
+   */
+  void ReservePageIds(page_id_t page_id) override;
+
  protected:
   /**
    * Fetch the requested page from the buffer pool.
@@ -88,7 +113,25 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   Page *NewPgImp(page_id_t *page_id) override;
 
-  bool FindReplaceFrameL(frame_id_t *frame_id);
+  /**
+   * Takes a frame from the free list or the replacer, writing back its page if dirty. Requires the latch.
+   * A victim whose log records are not durable yet is left in the replacer, because forcing the log under the latch
+   * would stall every other thread on log I/O. The caller forces the log without the latch and retries.
+   * @param[out] frame_id the frame taken
+   * @param[out] force_lsn set to the LSN the log must be forced to if the victim could not be written yet
+   * @return true if a frame was taken
+   */
+  bool FindReplaceFrameL(frame_id_t *frame_id, lsn_t *force_lsn);
+
+  /**
+   * Write-ahead logging: blocks until the log is persistent up to the given page LSN, so that the page may be written.
+   * Must not be called with the latch held.
+   * @param page_lsn the LSN of the page about to be written to disk
+   */
+  void ForceLogBeforeWrite(lsn_t page_lsn);
+
+  /** @return true if the page with the given page LSN may only be written after forcing the log */
+  bool NeedsLogForce(lsn_t page_lsn) const;
 
   /**
    * Deletes a page from the buffer pool.
@@ -135,9 +178,11 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** Array of buffer pool pages. */
   Page *pages_;
   /** Pointer to the disk manager. */
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
   /** Pointer to the log manager. */
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
+  /** Recovery that replays pending log records of pages read from disk during instant restart. */
+  std::atomic<LogRecovery *> log_recovery_{nullptr};
   /** Page table for keeping track of buffer pool pages. */
   std::unordered_map<page_id_t, frame_id_t> page_table_;
   /** Replacer to find unpinned pages for replacement. */
@@ -41,6 +41,31 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /** @return size of the buffer pool */
   size_t GetPoolSize() override;
 
+  /**
+   * Collects the dirty page table of every BufferPoolManagerInstance.
+   * @param[out] dirty_pages maps page id to recovery LSN
+   */
+  void GetDirtyPageTable(std::unordered_map<page_id_t, lsn_t> *dirty_pages) override;
+
+  /**
+   * Writes a buffered page to disk through the responsible BufferPoolManagerInstance.
+   * @param page_id id of page to be flushed
+   * @return false if the page is not in the buffer pool, true otherwise
+   */
+  bool FlushPageFuzzy(page_id_t page_id) override;
+
+  /**
+   * Enables lazy redo of pages read from disk in every BufferPoolManagerInstance.
+   * @param log_recovery the recovery replaying pending log records, or nullptr once redo has finished
+   */
+  void SetLogRecovery(LogRecovery *log_recovery) override;
+
+  /**
+   * Makes sure that every BufferPoolManagerInstance allocates larger ids than the pages already in use.
+   * @param page_id the largest page id in use
+   */
+  void ReservePageIds(page_id_t page_id) override;
+
  protected:
   /**
    * @param page_id id of page
@@ -0,0 +1,81 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// arena.h
+//
+// Identification: src/include/common/arena.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * Arena is a bump allocator for memory that is freed all at once. Allocations are carved out of blocks of BLOCK_SIZE
+ * bytes, larger ones get a block of their own. Reset frees everything but keeps the first block for reuse.
+ */
+class Arena {
+  static constexpr size_t BLOCK_SIZE = 4096;
+  static constexpr size_t ALIGNMENT = alignof(std::max_align_t);
+
+ public:
+  Arena() = default;
+  ~Arena() = default;
+
+  DISALLOW_COPY_AND_MOVE(Arena);
+
+  /**
+   * Allocates memory that stays valid until the arena is reset or destroyed.
+   * @param size the number of bytes
+   * @return the memory, aligned for any type
+   */
+  char *Allocate(size_t size) {
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    allocated_bytes_ += size;
+    if (size > BLOCK_SIZE) {
+      // The current block keeps serving the small allocations.
+      return blocks_.emplace_back(new char[size]).get();
+    }
+    if (size > remaining_) {
+      next_ = blocks_.emplace_back(new char[BLOCK_SIZE]).get();
+      remaining_ = BLOCK_SIZE;
+    }
+    char *res = next_;
+    next_ += size;
+    remaining_ -= size;
+    return res;
+  }
+
+  /** Frees all allocations at once. Every block is at least BLOCK_SIZE bytes, so the first one serves again. */
+  void Reset() {
+    if (blocks_.empty()) {
+      return;
+    }
+    blocks_.resize(1);
+    next_ = blocks_.front().get();
+    remaining_ = BLOCK_SIZE;
+    allocated_bytes_ = 0;
+  }
+
+  /** @return the number of bytes allocated since the last reset */
+  size_t GetAllocatedBytes() const { return allocated_bytes_; }
+
+ private:
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  char *next_{nullptr};
+  size_t remaining_{0};
+  size_t allocated_bytes_{0};
+};
+
+}  // namespace bustub
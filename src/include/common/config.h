@@ -14,6 +14,7 @@
 
 #include <atomic>
 #include <chrono>  // NOLINT
+#include <cstddef>
 #include <cstdint>
 
 namespace bustub {
@@ -21,12 +22,19 @@ namespace bustub {
 /** Cycle detection is performed every CYCLE_DETECTION_INTERVAL milliseconds. */
 extern std::chrono::milliseconds cycle_detection_interval;
 
+/** A transaction's row locks on a table are escalated to a table lock once it holds more than this many. */
+extern size_t lock_escalation_threshold;
+
 /** True if logging should be enabled, false otherwise. */
 extern std::atomic<bool> enable_logging;
 
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/** A fuzzy checkpoint writes at most CHECKPOINT_FLUSH_BATCH dirty pages every CHECKPOINT_FLUSH_INTERVAL. */
+extern std::chrono::milliseconds checkpoint_flush_interval;
+extern size_t checkpoint_flush_batch;
+
 static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
@@ -34,12 +42,22 @@ static constexpr int HEADER_PAGE_ID = 0;                                      //
 static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
+static constexpr int LOG_SEGMENT_SIZE = 16 * LOG_BUFFER_SIZE;                 // size of a log segment file in byte
+static constexpr int LOG_SEGMENT_SPARES = 2;                                  // recycled log segments kept for reuse
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr int LOCK_TABLE_PARTITIONS = 64;                              // independently latched lock table parts
+static constexpr int TXN_REGISTRY_SHARDS = 16;                                // independently latched txn map parts
+static constexpr int TXN_QUIESCENCE_SLOTS = 64;                               // per-thread running txn counters
+static constexpr int INDEX_BATCH_SIZE = 1024;                                 // entries inserted at once on index build
+static constexpr int SORT_MEMORY_PAGES = 64;                                  // pages an external sort holds in memory
+static constexpr double BULK_LOAD_FILL_FACTOR = 0.9;                          // fill of bulk loaded B+ tree pages
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
 using txn_id_t = int32_t;      // transaction id type
 using lsn_t = int32_t;         // log sequence number type
+using log_offset_t = int64_t;  // logical log offset type
+using timestamp_t = uint64_t;  // commit timestamp type
 using slot_offset_t = size_t;  // slot offset type
 using oid_t = uint16_t;
 
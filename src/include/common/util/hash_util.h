@@ -13,9 +13,16 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
 
 #include "common/macros.h"
 #include "type/value.h"
@@ -28,16 +35,86 @@ class HashUtil {
  private:
   static const hash_t PRIME_FACTOR = 10000019;
 
- public:
-  static inline hash_t HashBytes(const char *bytes, size_t length) {
-    // https://github.com/greenplum-db/gpos/blob/b53c1acd6285de94044ff91fbee91589543feba1/libgpos/src/utils.cpp#L126
-    hash_t hash = length;
-    for (size_t i = 0; i < length; ++i) {
-      hash = ((hash << 5) ^ (hash >> 27)) ^ bytes[i];
+  static inline uint64_t LoadWord(const char *bytes) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+  }
+
+  /** Folds a word into the running hash, with the CRC32C instruction where the CPU has it, which keeps 32 bits. */
+  static inline uint64_t HashWord(uint64_t hash, uint64_t word) {
+#ifdef __SSE4_2__
+    return _mm_crc32_u64(hash, word);
+#else
+    hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+    return (hash << 29) | (hash >> 35);
+#endif
+  }
+
+  /** Folds bytes [offset, length) into the running hash and mixes it, so that every bit depends on every byte. */
+  static inline hash_t FinishHash(const char *bytes, size_t length, size_t offset, uint64_t hash) {
+    for (; offset + sizeof(uint64_t) <= length; offset += sizeof(uint64_t)) {
+      hash = HashWord(hash, LoadWord(bytes + offset));
     }
+    if (offset < length) {
+      uint64_t tail = 0;
+      if (length >= sizeof(uint64_t)) {
+        // The last word of the bytes, shifting out the bytes already hashed.
+        tail = LoadWord(bytes + length - sizeof(uint64_t)) >> (8 * (sizeof(uint64_t) - (length - offset)));
+      } else {
+        for (size_t i = length; i > offset; i--) {
+          tail = (tail << 8) | static_cast<uint8_t>(bytes[i - 1]);
+        }
+      }
+      hash = HashWord(hash, tail);
+    }
+    // The finalizer of MurmurHash3.
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
     return hash;
   }
 
+ public:
+  /** Hashes bytes a word at a time. */
+  static inline hash_t HashBytes(const char *bytes, size_t length) { return FinishHash(bytes, length, 0, length); }
+
+  /**
+   * @return the length of bytes without the zero words at its end. Fixed size keys are zero padded, and two keys
+   * of the same size that are equal without their padding are equal, so hashing them without it is enough.
+   */
+  static inline size_t TrimZeroPadding(const char *bytes, size_t length) {
+    while (length >= sizeof(uint64_t)) {
+      size_t num_words = std::min<size_t>(length / sizeof(uint64_t), 64);
+      // The words are tested all at once rather than one after the other, so that their loads overlap.
+      uint64_t nonzero = 0;
+      for (size_t i = 0; i < num_words; i++) {
+        nonzero |= static_cast<uint64_t>(LoadWord(bytes + length - (i + 1) * sizeof(uint64_t)) != 0) << i;
+      }
+      if (nonzero != 0) {
+        return length - __builtin_ctzll(nonzero) * sizeof(uint64_t);
+      }
+      length -= num_words * sizeof(uint64_t);
+    }
+    return length;
+  }
+
+  /**
+   * Hashes count strings of length bytes each, which start stride bytes apart, e.g. the keys of an array. Each hash
+   * equals HashBytes of its string, or of the string without its zero padding if trim_padding is set. The strings are
+   * independent of each other, so the CPU overlaps the latency of their CRCs; with length known at compile time the
+   * padding is tested with vector instructions.
+   */
+  static inline void HashBytesBatch(const char *bytes, size_t length, size_t stride, size_t count, hash_t *hashes,
+                                    bool trim_padding) {
+    for (size_t i = 0; i < count; i++) {
+      const char *key = bytes + i * stride;
+      hashes[i] = HashBytes(key, trim_padding ? TrimZeroPadding(key, length) : length);
+    }
+  }
+
   static inline hash_t CombineHashes(hash_t l, hash_t r) {
     hash_t both[2] = {};
     both[0] = l;
@@ -98,6 +175,50 @@ class HashUtil {
       }
     }
   }
+
+  /**
+   * Hashes a column of values, each the same as HashValue of it. Integers, decimals and timestamps are hashed as
+   * 8 byte words, a batch at a time.
+   */
+  static inline void HashColumn(const std::vector<Value> &column, hash_t *hashes) {
+    std::vector<uint64_t> words(column.size());
+    for (size_t i = 0; i < column.size(); i++) {
+      const Value &val = column[i];
+      switch (val.GetTypeId()) {
+        case TypeId::TINYINT:
+          words[i] = static_cast<int64_t>(val.GetAs<int8_t>());
+          break;
+        case TypeId::SMALLINT:
+          words[i] = static_cast<int64_t>(val.GetAs<int16_t>());
+          break;
+        case TypeId::INTEGER:
+          words[i] = static_cast<int64_t>(val.GetAs<int32_t>());
+          break;
+        case TypeId::BIGINT:
+          words[i] = val.GetAs<int64_t>();
+          break;
+        case TypeId::DECIMAL: {
+          auto raw = val.GetAs<double>();
+          memcpy(&words[i], &raw, sizeof(raw));
+          break;
+        }
+        case TypeId::TIMESTAMP:
+          words[i] = val.GetAs<uint64_t>();
+          break;
+        default:
+          // Hashed on their own below.
+          break;
+      }
+    }
+    HashBytesBatch(reinterpret_cast<const char *>(words.data()), sizeof(uint64_t), sizeof(uint64_t), words.size(),
+                   hashes, false);
+    for (size_t i = 0; i < column.size(); i++) {
+      TypeId type_id = column[i].GetTypeId();
+      if (type_id == TypeId::BOOLEAN || type_id == TypeId::VARCHAR) {
+        hashes[i] = HashValue(&column[i]);
+      }
+    }
+  }
 };
 
 }  // namespace bustub
@@ -0,0 +1,159 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// key_range_lock.h
+//
+// Identification: src/include/concurrency/key_range_lock.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction.h"
+
+namespace bustub {
+
+/**
+ * IndexRangeLocks is what a transaction sees of the key range locks of an index: it releases all of them when it
+ * ends.
+ */
+class IndexRangeLocks {
+ public:
+  virtual ~IndexRangeLocks() = default;
+
+  /** Releases all the key ranges locked by txn. */
+  virtual void UnlockAll(Transaction *txn) = 0;
+};
+
+/**
+ * KeyRangeLockTable locks ranges of the keys of one ordered index, so that transactions reading a key range under
+ * REPEATABLE_READ see no phantoms without locking the whole table.
+ *
+ * A range scan locks the closed range of keys it scans in SHARED mode, which covers the scanned keys and the gaps
+ * between and after them up to the end of the range. A point lookup locks the single key, also if it is missing.
+ * Inserts and deletes lock their key in EXCLUSIVE mode, so they wait for the scans whose range contains the key while
+ * inserts and scans elsewhere in the index go ahead. Locks are held until the transaction ends.
+ *
+ * The locked ranges are kept in an interval tree, so that finding the ranges that overlap a requested one takes time
+ * logarithmic in the number of locks plus the number of overlapping ones, however many keys large transactions lock.
+ *
+ * Deadlocks are prevented by wound-wait whatever the deadlock mode of the lock manager: an older transaction aborts
+ * the younger holders of a conflicting range, a younger one waits. Transactions wounded here are woken up if they
+ * wait in the lock manager.
+ */
+template <typename KeyType, typename KeyComparator>
+class KeyRangeLockTable : public IndexRangeLocks {
+ public:
+  /**
+   * @param comparator the comparator of the index keys
+   * @param lock_manager the lock manager that wounded transactions may be waiting in, or nullptr
+   */
+  KeyRangeLockTable(const KeyComparator &comparator, LockManager *lock_manager)
+      : comparator_(comparator), lock_manager_(lock_manager) {}
+
+  ~KeyRangeLockTable() override = default;
+
+  /**
+   * Locks the keys from low to high, both included. Returns right away if txn already holds a lock that covers them.
+   * An aborted transaction may only rely on the locks it holds, to roll back its index changes.
+   * @param txn the transaction requesting the lock
+   * @param lock_mode SHARED or EXCLUSIVE
+   * @param low the smallest key of the range
+   * @param high the largest key of the range
+   * @return true if the lock is granted, false if txn is or was aborted while waiting
+   */
+  bool LockRange(Transaction *txn, LockMode lock_mode, const KeyType &low, const KeyType &high);
+
+  /** Locks a single key, see LockRange. */
+  bool LockKey(Transaction *txn, LockMode lock_mode, const KeyType &key) { return LockRange(txn, lock_mode, key, key); }
+
+  void UnlockAll(Transaction *txn) override;
+
+  /** @return the number of key ranges locked, used for testing */
+  size_t GetLockCount();
+
+ private:
+  /** Waiters check this often whether the lock manager wounded them. */
+  static constexpr std::chrono::milliseconds WOUND_CHECK_INTERVAL{10};
+
+  /** A locked range of keys, both ends included. */
+  struct RangeLock {
+    Transaction *txn_;
+    txn_id_t txn_id_;
+    LockMode lock_mode_;
+    KeyType low_;
+    KeyType high_;
+  };
+
+  /**
+   * A node of the interval tree of the locked ranges, a treap ordered by the low ends of the ranges and then by the
+   * order they were locked in. Every node knows the largest high end in its subtree, so that searches skip the
+   * subtrees that hold no overlapping range.
+   */
+  struct Node {
+    RangeLock lock_;
+    uint64_t seq_;
+    uint32_t priority_;
+    KeyType max_high_;
+    std::unique_ptr<Node> left_;
+    std::unique_ptr<Node> right_;
+  };
+  using NodePtr = std::unique_ptr<Node>;
+
+  /** @return true if the range starting at low that was locked as seq sorts before the one of node */
+  bool Before(const KeyType &low, uint64_t seq, const Node &node) const;
+
+  /** Recomputes the largest high end in the subtree of node from its children. */
+  void Update(Node *node) const;
+
+  /** Splits a subtree into the ranges that sort before the range starting at low locked as seq, and the others. */
+  std::pair<NodePtr, NodePtr> Split(NodePtr node, const KeyType &low, uint64_t seq) const;
+
+  /** Merges two subtrees, where all the ranges of left sort before the ones of right. */
+  NodePtr Merge(NodePtr left, NodePtr right) const;
+
+  /** Removes the range starting at low locked as seq from a subtree. */
+  void Erase(NodePtr *node, const KeyType &low, uint64_t seq) const;
+
+  /**
+   * Visits the locked ranges that share a key with the range from low to high.
+   * @param node the root of the subtree to search
+   * @param visitor called with every overlapping range, returns false to stop the search
+   * @return false if the visitor stopped the search
+   */
+  bool VisitOverlaps(Node *node, const KeyType &low, const KeyType &high,
+                     const std::function<bool(const RangeLock &)> &visitor) const;
+
+  /** @return true if txn holds a lock covering the range in a mode that implies lock_mode. Caller holds the latch. */
+  bool IsCovered(Transaction *txn, LockMode lock_mode, const KeyType &low, const KeyType &high) const;
+
+  KeyComparator comparator_;
+  LockManager *lock_manager_;
+  std::mutex latch_;
+  /** Waiters are woken whenever ranges are unlocked. */
+  std::condition_variable cv_;
+  /** The root of the interval tree of all locked ranges. */
+  NodePtr root_;
+  /** The low end and sequence number of every range locked by each transaction, to unlock them. */
+  std::unordered_map<txn_id_t, std::vector<std::pair<KeyType, uint64_t>>> txn_locks_;
+  size_t lock_count_{0};
+  uint64_t next_seq_{0};
+  /** Draws the priorities of the treap nodes, which keep it balanced whatever order ranges are locked in. */
+  std::mt19937 random_;
+};
+
+}  // namespace bustub
@@ -13,10 +13,14 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <condition_variable>  // NOLINT
 #include <list>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -29,43 +33,91 @@ namespace bustub {
 
 class TransactionManager;
 
+/** How deadlocks are handled: PREVENTION uses wound-wait, DETECTION aborts transactions on a waits-for cycle. */
+enum class DeadlockMode { PREVENTION, DETECTION };
+
 /**
  * LockManager handles transactions asking for locks on records.
+ *
+ * Locks follow two-phase locking. Deadlocks are prevented with wound-wait by default: a transaction that has to wait
+ * for a younger one aborts it instead, and only waits for older transactions. Alternatively, transactions always wait
+ * and a background thread looks for cycles in the waits-for graph, aborting the youngest transaction of each cycle.
+ * The graph is kept up to date as requests block and get granted, only the queue that changed is looked at.
+ *
+ * Tables can be locked in every LockMode. Rows locked through LockRow take the matching intention lock on their
+ * table first, and once a transaction holds more than lock_escalation_threshold row locks on a table, they are
+ * replaced by a single shared or exclusive lock on the table. Table locks are queued in the same lock table, under
+ * a RID with an invalid page id and the table oid as slot.
+ *
+ * The lock table is split into LOCK_TABLE_PARTITIONS parts by the hash of the RID, each with its own latch, so that
+ * requests on different records rarely contend. Every waiting request has its own condition variable and is only
+ * woken once it has been granted or its transaction has been aborted. Request nodes are recycled through a free list
+ * of their partition instead of being allocated for every request.
  */
 class LockManager {
-  enum class LockMode { SHARED, EXCLUSIVE };
-
   class LockRequest {
    public:
-    LockRequest(txn_id_t txn_id, LockMode lock_mode) : txn_id_(txn_id), lock_mode_(lock_mode), granted_(false) {}
+    LockRequest(Transaction *txn, LockMode lock_mode)
+        : txn_(txn), txn_id_(txn->GetTransactionId()), lock_mode_(lock_mode), granted_(false) {}
 
+    Transaction *txn_;
     txn_id_t txn_id_;
     LockMode lock_mode_;
     bool granted_;
+    // whether the request is registered as blocked in the waits-for graph
+    bool waiting_{false};
+    // for notifying this request alone once it is granted or its transaction is wounded
+    std::condition_variable cv_;
   };
 
   class LockRequestQueue {
    public:
     std::list<LockRequest> request_queue_;
-    // for notifying blocked transactions on this rid
-    std::condition_variable cv_;
     // txn_id of an upgrading transaction (if any)
     txn_id_t upgrading_ = INVALID_TXN_ID;
   };
 
+  /** A part of the lock table with its own latch, padded to a cache line to keep the latches apart. */
+  struct alignas(64) LockTablePartition {
+    std::mutex latch_;
+    /** Lock table for lock requests. */
+    std::unordered_map<RID, LockRequestQueue> lock_table_;
+    /** Request nodes that are not in any queue, spliced in and out of the queues. */
+    std::list<LockRequest> free_requests_;
+  };
+
+  using RequestIterator = std::list<LockRequest>::iterator;
+
+  static constexpr uint32_t LOCK_MODE_COUNT = 5;
+
+  /** A blocked transaction and since when it waits. */
+  struct WaitInfo {
+    Transaction *txn_;
+    RID rid_;
+    std::chrono::steady_clock::time_point since_;
+  };
+
  public:
   /**
    * Creates a new lock manager configured for the deadlock prevention policy.
    */
-  LockManager() = default;
+  LockManager() : LockManager(DeadlockMode::PREVENTION) {}
 
-  ~LockManager() = default;
+  /**
+   * Creates a new lock manager for the given deadlock policy. For DETECTION, a background thread checks the waits-for
+   * graph for cycles every cycle_detection_interval.
+   */
+  explicit LockManager(DeadlockMode deadlock_mode);
+
+  ~LockManager();
 
   /*
    * [LOCK_NOTE]: For all locking functions, we:
-   * 1. return false if the transaction is aborted; and
+   * 1. return false if the transaction is aborted, also when it gets wounded while waiting; and
    * 2. block on wait, return true when the lock request is granted; and
-   * 3. it is undefined behavior to try locking an already locked RID in the
+   * 3. set the transaction to ABORTED and throw a TransactionAbortException if the request breaks two-phase locking
+   * or the isolation level; and
+   * 4. it is undefined behavior to try locking an already locked RID in the
    * same transaction, i.e. the transaction is responsible for keeping track of
    * its current locks.
    */
@@ -104,11 +156,181 @@ class LockManager {
    */
   bool Unlock(Transaction *txn, const RID &rid);
 
+  /**
+   * Acquire a lock on a table, or upgrade the table lock held by the transaction to cover the given mode as well.
+   * See [LOCK_NOTE] in header file.
+   * @param txn the transaction requesting the lock
+   * @param lock_mode the mode to lock the table in
+   * @param oid the table to be locked
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockTable(Transaction *txn, LockMode lock_mode, table_oid_t oid);
+
+  /**
+   * Release the table lock held by the transaction. The transaction must have released its row locks on the table.
+   * @param txn the transaction releasing the lock
+   * @param oid the table that is locked by the transaction
+   * @return true if the unlock is successful, false otherwise
+   */
+  bool UnlockTable(Transaction *txn, table_oid_t oid);
+
+  /**
+   * Acquire a lock on a row of a table, taking an intention lock on the table first. Nothing is locked if the table
+   * lock already covers the row, and the table's row locks are escalated once there are too many of them. See
+   * [LOCK_NOTE] in header file.
+   * @param txn the transaction requesting the lock
+   * @param lock_mode SHARED or EXCLUSIVE
+   * @param oid the table the row belongs to
+   * @param rid the RID to be locked
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockRow(Transaction *txn, LockMode lock_mode, table_oid_t oid, const RID &rid);
+
+  /**
+   * Wakes the aborted transactions if they are waiting for a lock, also used by the key range locks of indexes that
+   * wound transactions. Must be called without any partition latch.
+   */
+  void WakeAborted(const std::vector<txn_id_t> &aborted);
+
+  /*** Graph API ***/
+  /**
+   * Adds an edge from t1 -> t2.
+   */
+  void AddEdge(txn_id_t t1, txn_id_t t2);
+
+  /**
+   * Removes an edge from t1 -> t2.
+   */
+  void RemoveEdge(txn_id_t t1, txn_id_t t2);
+
+  /**
+   * Checks if the graph has a cycle, returning the newest transaction ID in the cycle if so.
+   * @param[out] txn_id if the graph has a cycle, will contain the newest transaction ID
+   * @return false if the graph has no cycle, otherwise stores the newest transaction ID in the cycle to txn_id
+   */
+  bool HasCycle(txn_id_t *txn_id);
+
+  /**
+   * @return the set of all edges in the graph, used for testing only!
+   */
+  std::vector<std::pair<txn_id_t, txn_id_t>> GetEdgeList();
+
+  /**
+   * Runs cycle detection in the background.
+   */
+  void RunCycleDetection();
+
+  /** @return the number of transactions wounded or chosen as deadlock victims */
+  size_t GetDeadlockAbortCount() { return deadlock_aborts_; }
+
+  /** @return the longest time a deadlock existed before the detector broke it */
+  std::chrono::microseconds GetMaxDetectionLatency();
+
+  /** @return the average time a deadlock existed before the detector broke it */
+  std::chrono::microseconds GetAverageDetectionLatency();
+
  private:
-  std::mutex latch_;
+  /** @return true if a lock in mode held lets other transactions acquire a lock in mode requested */
+  static bool AreCompatible(LockMode held, LockMode requested);
+
+  /** @return true if holding a lock in mode held implies a lock in mode requested */
+  static bool Covers(LockMode held, LockMode requested);
+
+  /** @return the weakest mode that covers both held and requested */
+  static LockMode Join(LockMode held, LockMode requested);
+
+  /** @return the RID the table lock of oid is queued under */
+  static RID TableResource(table_oid_t oid) { return RID(INVALID_PAGE_ID, oid); }
+
+  /** @return the partition of the lock table that holds the queue of rid */
+  LockTablePartition &GetPartition(const RID &rid);
+
+  /**
+   * Checks that txn may still acquire a lock in the given mode, aborting it if not.
+   * @return false if the transaction is already aborted
+   */
+  bool CheckLockable(Transaction *txn, LockMode lock_mode);
+
+  /** Queues a new request of txn in the given mode and blocks until it is granted. */
+  bool AcquireLock(Transaction *txn, const RID &rid, LockMode lock_mode);
+
+  /**
+   * Changes the mode of the lock the transaction holds on rid, waiting ahead of every other waiter.
+   * @return true if the lock was converted, false if it is not held any more
+   */
+  bool UpgradeLock(Transaction *txn, const RID &rid, LockMode lock_mode);
+
+  /**
+   * Releases the lock of the transaction on rid without touching its lock sets or state.
+   * @param[out] lock_mode the mode the lock was held in
+   * @return false if the transaction holds no lock on rid
+   */
+  bool ReleaseLock(Transaction *txn, const RID &rid, LockMode *lock_mode);
+
+  /** Moves to the shrinking phase after releasing a lock in the given mode if the isolation level asks for it. */
+  static void Shrink(Transaction *txn, LockMode lock_mode);
+
+  /** Replaces the row locks of the transaction on the table by a shared or exclusive table lock. */
+  bool EscalateTableLock(Transaction *txn, table_oid_t oid);
+
+  /** Appends a request to the queue, reusing a free node of the partition if there is one. */
+  RequestIterator AppendRequest(LockTablePartition *partition, LockRequestQueue *queue, Transaction *txn,
+                                LockMode lock_mode);
+
+  /**
+   * Wounds the younger transactions whose requests ahead of the given one conflict with it. Wounded waiters of this
+   * queue are woken right away.
+   * @param[out] wounded lock holders that were wounded and may be waiting on another record
+   */
+  void Wound(LockRequestQueue *queue, RequestIterator request, std::vector<txn_id_t> *wounded);
+
+  /**
+   * Grants the waiting requests at the front of the queue that are compatible with everything ahead of them, then
+   * updates the waits-for graph of the queue if it has blocked requests or unblocked any.
+   */
+  void GrantWaiters(const RID &rid, LockRequestQueue *queue);
+
+  /** Registers the blocked requests of the queue with the transactions they wait for, and forgets granted ones. */
+  void UpdateWaitsFor(const RID &rid, LockRequestQueue *queue);
+
+  /** Removes a transaction that stopped waiting from the waits-for graph. Requires waits_for_latch_. */
+  void ForgetWaiter(txn_id_t txn_id);
+
+  /**
+   * Searches the waits-for graph depth-first, from the lowest transaction id and visiting the neighbours in order.
+   * Every transaction is visited at most once. Requires waits_for_latch_.
+   * @param[out] cycle the transactions of the first cycle found
+   * @return true if there is a cycle
+   */
+  bool FindCycle(std::vector<txn_id_t> *cycle);
+
+  /**
+   * Blocks until the request is granted or its transaction is aborted, in which case the request is removed.
+   * @return true if the lock was granted
+   */
+  bool WaitForGrant(LockTablePartition *partition, std::unique_lock<std::mutex> *lock, const RID &rid,
+                    RequestIterator request);
+
+  /** Removes a request from the queue of rid, returns its node to the free list and grants the next waiters. */
+  void ReleaseRequest(LockTablePartition *partition, const RID &rid, LockRequestQueue *queue, RequestIterator request);
+
+  std::array<LockTablePartition, LOCK_TABLE_PARTITIONS> partitions_;
+
+  DeadlockMode deadlock_mode_;
+  std::atomic<bool> enable_cycle_detection_{false};
+  std::thread cycle_detection_thread_;
+
+  /** Latch for the waits-for graph and the blocked transactions, taken after a partition latch. */
+  std::mutex waits_for_latch_;
+  /** Waits-for graph, sorted edges from every blocked transaction to the transactions it waits for. */
+  std::unordered_map<txn_id_t, std::vector<txn_id_t>> waits_for_;
+  /** The record every blocked transaction waits for, used to wake transactions that are aborted. */
+  std::unordered_map<txn_id_t, WaitInfo> waiting_;
 
-  /** Lock table for lock requests. */
-  std::unordered_map<RID, LockRequestQueue> lock_table_;
+  std::atomic<size_t> deadlock_aborts_{0};
+  size_t detected_deadlocks_{0};
+  std::chrono::microseconds total_detection_latency_{0};
+  std::chrono::microseconds max_detection_latency_{0};
 };
 
 }  // namespace bustub
@@ -0,0 +1,108 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// partition_executor.h
+//
+// Identification: src/include/concurrency/partition_executor.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <future>  // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/macros.h"
+#include "concurrency/transaction_manager.h"
+
+namespace bustub {
+
+/**
+ * A stored procedure: the work of one transaction, which it gets begun for it. It returns false to abort the
+ * transaction, so does throwing a TransactionAbortException.
+ */
+using Procedure = std::function<bool(Transaction *)>;
+
+/**
+ * PartitionExecutor runs transactions on data partitioned by key, H-Store style. Every partition is owned by one
+ * worker thread that runs the transactions submitted to it one after the other. Since nothing else runs on a
+ * partition meanwhile, the transactions are serial: they take no locks, only the page latches that keep the pages
+ * themselves consistent, and never wait for or abort each other.
+ *
+ * A transaction touching several partitions takes the slow path: it is queued behind the transactions already
+ * submitted to each of its partitions, and once all their workers have reached it and stopped, it runs serially on
+ * the calling thread. Multi-partition transactions are queued under a latch, so that they stop the workers in the
+ * same order and cannot wait for each other.
+ *
+ * Which partition a key belongs to is up to the caller, as is only touching the partitions a transaction was run on.
+ * Partitioned data must only be accessed through the executor, other transactions would not see its writes locked.
+ */
+class PartitionExecutor {
+ public:
+  /**
+   * Starts a worker for every partition.
+   * @param txn_mgr the transaction manager to begin the transactions with
+   * @param num_partitions the number of partitions
+   */
+  PartitionExecutor(TransactionManager *txn_mgr, size_t num_partitions);
+
+  /** Runs the transactions submitted so far, then stops the workers. */
+  ~PartitionExecutor();
+
+  DISALLOW_COPY_AND_MOVE(PartitionExecutor);
+
+  /** @return the number of partitions */
+  size_t GetPartitionCount() const { return partitions_.size(); }
+
+  /**
+   * Queues a transaction touching a single partition on the worker owning it.
+   * @param partition the partition the transaction touches
+   * @param procedure the work of the transaction
+   * @return whether the transaction committed, once it ran
+   */
+  std::future<bool> Submit(size_t partition, Procedure procedure);
+
+  /**
+   * Runs a transaction touching several partitions on the calling thread, which must not be a worker. Waits until
+   * the transactions submitted to the partitions before have run and holds the partitions up until it ends.
+   * @param partitions the partitions the transaction touches
+   * @param procedure the work of the transaction
+   * @return true if the transaction committed
+   */
+  bool ExecuteMultiPartition(std::vector<size_t> partitions, const Procedure &procedure);
+
+ private:
+  /** A partition and the work queued for its worker. */
+  struct Partition {
+    std::mutex latch_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopped_{false};
+    std::thread worker_;
+  };
+
+  /** Queues a task on the worker of a partition. */
+  void Enqueue(size_t partition, std::function<void()> task);
+
+  /** Runs the tasks of a partition until it is stopped and its queue is empty. */
+  static void RunWorker(Partition *partition);
+
+  /** Runs a serial transaction. @return true if it committed */
+  bool Execute(const Procedure &procedure);
+
+  TransactionManager *txn_mgr_;
+  std::vector<std::unique_ptr<Partition>> partitions_;
+  /** Multi-partition transactions stop the workers one at a time. */
+  std::mutex multi_partition_latch_;
+};
+
+}  // namespace bustub
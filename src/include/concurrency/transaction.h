@@ -17,8 +17,10 @@
 #include <memory>
 #include <string>
 #include <thread>  // NOLINT
+#include <unordered_map>
 #include <unordered_set>
 
+#include "common/arena.h"
 #include "common/config.h"
 #include "common/logger.h"
 #include "storage/page/page.h"
@@ -26,6 +28,8 @@
 
 namespace bustub {
 
+class IndexRangeLocks;
+
 /**
  * Transaction states for 2PL:
  *
@@ -44,44 +48,77 @@ namespace bustub {
 enum class TransactionState { GROWING, SHRINKING, COMMITTED, ABORTED };
 
 /**
- * Transaction isolation level.
+ * Transaction isolation level. SNAPSHOT reads the versions committed before the transaction began without locking
+ * them, and aborts when it writes a tuple that someone else changed since.
  */
-enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED };
+enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED, SNAPSHOT };
 
 /**
  * Type of write operation.
  */
 enum class WType { INSERT = 0, DELETE, UPDATE };
 
+/**
+ * Lock modes. Rows are only locked in SHARED or EXCLUSIVE mode, tables in any mode. The intention modes announce
+ * row locks in shared or exclusive mode below a table, SHARED_INTENTION_EXCLUSIVE reads the whole table and
+ * announces exclusive row locks.
+ */
+enum class LockMode { SHARED, EXCLUSIVE, INTENTION_SHARED, INTENTION_EXCLUSIVE, SHARED_INTENTION_EXCLUSIVE };
+
 class TableHeap;
 class Catalog;
 using table_oid_t = uint32_t;
 using index_oid_t = uint32_t;
 
 /**
- * WriteRecord tracks information related to a write.
+ * WriteRecord tracks information related to a write. Its tuples live in the transaction's arena, so records are
+ * copied without copying the tuple data and are all freed at once when the transaction ends.
  */
 class TableWriteRecord {
  public:
-  TableWriteRecord(RID rid, WType wtype, const Tuple &tuple, TableHeap *table)
-      : rid_(rid), wtype_(wtype), tuple_(tuple), table_(table) {}
+  /**
+   * @param tuple the tuple of the write, copied into the arena if it owns its data, otherwise it must already live
+   * there
+   */
+  TableWriteRecord(RID rid, WType wtype, const Tuple &tuple, TableHeap *table, Arena *arena)
+      : rid_(rid), wtype_(wtype), tuple_(tuple.IsAllocated() ? tuple.CopyTo(arena) : tuple), table_(table) {}
 
   RID rid_;
   WType wtype_;
-  /** The tuple is only used for the update operation. */
+  /** The tuple is only used for the update operation, the old version when rolling back. */
   Tuple tuple_;
   /** The table heap specifies which table this write record is for. */
   TableHeap *table_;
 };
 
 /**
- * WriteRecord tracks information related to a write.
+ * ReadRecord tracks a tuple read by an optimistic transaction, validated when it commits.
+ */
+class TableReadRecord {
+ public:
+  TableReadRecord(RID rid, timestamp_t version, TableHeap *table) : rid_(rid), version_(version), table_(table) {}
+
+  RID rid_;
+  /** The commit timestamp of the version read, see VersionStore::GetCommittedVersion. */
+  timestamp_t version_;
+  /** The table heap specifies which table this read record is for. */
+  TableHeap *table_;
+};
+
+/**
+ * WriteRecord tracks information related to a write. Its tuples live in the transaction's arena like those of
+ * TableWriteRecord.
  */
 class IndexWriteRecord {
  public:
   IndexWriteRecord(RID rid, table_oid_t table_oid, WType wtype, const Tuple &tuple, index_oid_t index_oid,
-                   Catalog *catalog)
-      : rid_(rid), table_oid_(table_oid), wtype_(wtype), tuple_(tuple), index_oid_(index_oid), catalog_(catalog) {}
+                   Catalog *catalog, Arena *arena)
+      : rid_(rid),
+        table_oid_(table_oid),
+        wtype_(wtype),
+        tuple_(tuple.IsAllocated() ? tuple.CopyTo(arena) : tuple),
+        index_oid_(index_oid),
+        catalog_(catalog) {}
 
   /** The rid is the value stored in the index. */
   RID rid_;
@@ -107,7 +144,9 @@ enum class AbortReason {
   UNLOCK_ON_SHRINKING,
   UPGRADE_CONFLICT,
   DEADLOCK,
-  LOCKSHARED_ON_READ_UNCOMMITTED
+  LOCKSHARED_ON_READ_UNCOMMITTED,
+  TABLE_UNLOCKED_BEFORE_UNLOCKING_ROWS,
+  WRITE_ON_READ_ONLY
 };
 
 /**
@@ -137,6 +176,10 @@ class TransactionAbortException : public std::exception {
         return "Transaction " + std::to_string(txn_id_) + " aborted on deadlock\n";
       case AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED:
         return "Transaction " + std::to_string(txn_id_) + " aborted on lockshared on READ_UNCOMMITTED\n";
+      case AbortReason::TABLE_UNLOCKED_BEFORE_UNLOCKING_ROWS:
+        return "Transaction " + std::to_string(txn_id_) + " aborted on unlocking a table before its rows\n";
+      case AbortReason::WRITE_ON_READ_ONLY:
+        return "Transaction " + std::to_string(txn_id_) + " aborted on writing in a read-only transaction\n";
     }
     // Todo: Should fail with unreachable.
     return "";
@@ -148,16 +191,29 @@ class TransactionAbortException : public std::exception {
  */
 class Transaction {
  public:
-  explicit Transaction(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ)
+  /**
+   * Creates a transaction. A read-only transaction does not get write sets, see BeginReadOnly.
+   */
+  explicit Transaction(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ,
+                       bool read_only = false)
       : state_(TransactionState::GROWING),
         isolation_level_(isolation_level),
+        read_only_(read_only),
         thread_id_(std::this_thread::get_id()),
         txn_id_(txn_id),
         prev_lsn_(INVALID_LSN),
         shared_lock_set_{new std::unordered_set<RID>},
-        exclusive_lock_set_{new std::unordered_set<RID>} {
+        exclusive_lock_set_{new std::unordered_set<RID>},
+        table_lock_set_{new std::unordered_map<table_oid_t, LockMode>},
+        table_row_lock_set_{new std::unordered_map<table_oid_t, std::unordered_set<RID>>},
+        index_range_lock_set_{new std::unordered_set<IndexRangeLocks *>} {
+    if (read_only) {
+      return;
+    }
     // Initialize the sets that will be tracked.
     table_write_set_ = std::make_shared<std::deque<TableWriteRecord>>();
+    table_read_set_ = std::make_shared<std::deque<TableReadRecord>>();
+    buffered_write_set_ = std::make_shared<std::deque<TableWriteRecord>>();
     index_write_set_ = std::make_shared<std::deque<IndexWriteRecord>>();
     page_set_ = std::make_shared<std::deque<bustub::Page *>>();
     deleted_page_set_ = std::make_shared<std::unordered_set<page_id_t>>();
@@ -176,13 +232,46 @@ class Transaction {
   /** @return the isolation level of this transaction */
   inline IsolationLevel GetIsolationLevel() const { return isolation_level_; }
 
-  /** @return the list of table write records of this transaction */
+  /** @return true if the transaction was begun read-only, it then must not write */
+  inline bool IsReadOnly() const { return read_only_; }
+
+  /** @return the list of table write records of this transaction, nullptr if it is read-only */
   inline std::shared_ptr<std::deque<TableWriteRecord>> GetWriteSet() { return table_write_set_; }
 
-  /** @return the list of index write records of this transaction */
+  /** @return the tuples read by this transaction if it is optimistic, nullptr if it is read-only */
+  inline std::shared_ptr<std::deque<TableReadRecord>> GetReadSet() { return table_read_set_; }
+
+  /** @return the writes an optimistic transaction installs once it is validated, nullptr if it is read-only */
+  inline std::shared_ptr<std::deque<TableWriteRecord>> GetBufferedWriteSet() { return buffered_write_set_; }
+
+  /** @return true if the transaction runs under optimistic concurrency control instead of locking */
+  inline bool IsOptimistic() const { return optimistic_; }
+
+  /**
+   * Set whether the transaction is optimistic.
+   * @param optimistic true if the transaction validates its reads at commit instead of locking
+   */
+  inline void SetOptimistic(bool optimistic) { optimistic_ = optimistic; }
+
+  /** @return true if the transaction runs alone on the partitions it touches, see PartitionExecutor */
+  inline bool IsSerial() const { return serial_; }
+
+  /**
+   * Set whether the transaction is serial.
+   * @param serial true if nothing runs concurrently with the transaction on the data it touches
+   */
+  inline void SetSerial(bool serial) { serial_ = serial; }
+
+  /** @return true if the transaction locks what it reads and writes, optimistic and serial transactions do not */
+  inline bool TakesLocks() const { return !optimistic_ && !serial_; }
+
+  /** @return the arena holding the tuples of the write records, reset when the transaction ends */
+  inline Arena *GetArena() { return &arena_; }
+
+  /** @return the list of index write records of this transaction, nullptr if it is read-only */
   inline std::shared_ptr<std::deque<IndexWriteRecord>> GetIndexWriteSet() { return index_write_set_; }
 
-  /** @return the page set */
+  /** @return the page set, nullptr if the transaction is read-only */
   inline std::shared_ptr<std::deque<Page *>> GetPageSet() { return page_set_; }
 
   /**
@@ -207,7 +296,7 @@ class Transaction {
    */
   inline void AddIntoPageSet(Page *page) { page_set_->push_back(page); }
 
-  /** @return the deleted page set */
+  /** @return the deleted page set, nullptr if the transaction is read-only */
   inline std::shared_ptr<std::unordered_set<page_id_t>> GetDeletedPageSet() { return deleted_page_set_; }
 
   /**
@@ -228,6 +317,23 @@ class Transaction {
   /** @return true if rid is exclusively locked by this transaction */
   bool IsExclusiveLocked(const RID &rid) { return exclusive_lock_set_->find(rid) != exclusive_lock_set_->end(); }
 
+  /** @return the tables locked by this transaction with their lock mode */
+  inline std::shared_ptr<std::unordered_map<table_oid_t, LockMode>> GetTableLockSet() { return table_lock_set_; }
+
+  /** @return the rows locked through their table by this transaction, by table */
+  inline std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<RID>>> GetTableRowLockSet() {
+    return table_row_lock_set_;
+  }
+
+  /** @return the indexes this transaction locked key ranges in */
+  inline std::shared_ptr<std::unordered_set<IndexRangeLocks *>> GetIndexRangeLockSet() { return index_range_lock_set_; }
+
+  /** @return true if the table is locked by this transaction in exactly the given mode */
+  bool IsTableLocked(table_oid_t oid, LockMode lock_mode) {
+    auto lock = table_lock_set_->find(oid);
+    return lock != table_lock_set_->end() && lock->second == lock_mode;
+  }
+
   /** @return the current state of the transaction */
   inline TransactionState GetState() { return state_; }
 
@@ -246,11 +352,58 @@ class Transaction {
    */
   inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+  /** @return the LSN of the first record written by the transaction */
+  inline lsn_t GetFirstLSN() { return first_lsn_; }
+
+  /**
+   * Set the first LSN.
+   * @param first_lsn the LSN of the first record written by the transaction
+   */
+  inline void SetFirstLSN(lsn_t first_lsn) { first_lsn_ = first_lsn; }
+
+  /** @return the number of log bytes written on behalf of this transaction */
+  inline uint64_t GetLogBytes() { return log_bytes_; }
+
+  /**
+   * Accounts a log record written on behalf of this transaction.
+   * @param log_bytes size of the log record
+   */
+  inline void AddLogBytes(uint64_t log_bytes) { log_bytes_ += log_bytes; }
+
+  /** @return the commit timestamp of the newest versions this transaction can read under snapshot isolation */
+  inline timestamp_t GetReadTimestamp() const { return read_ts_; }
+
+  /**
+   * Set the read timestamp.
+   * @param read_ts the commit timestamp of the last transaction committed when this one began
+   */
+  inline void SetReadTimestamp(timestamp_t read_ts) { read_ts_ = read_ts; }
+
+  /** @return the commit timestamp of this transaction, 0 until it has committed a write */
+  inline timestamp_t GetCommitTimestamp() const { return commit_ts_; }
+
+  /**
+   * Set the commit timestamp.
+   * @param commit_ts the timestamp of the versions written by this transaction
+   */
+  inline void SetCommitTimestamp(timestamp_t commit_ts) { commit_ts_ = commit_ts; }
+
+  /** @return the quiescence slot of the transaction manager this transaction is counted in while it runs */
+  inline size_t GetQuiescenceSlot() const { return quiescence_slot_; }
+
+  /**
+   * Set the quiescence slot.
+   * @param slot the slot of the thread that began the transaction
+   */
+  inline void SetQuiescenceSlot(size_t slot) { quiescence_slot_ = slot; }
+
  private:
   /** The current transaction state. */
   TransactionState state_;
   /** The isolation level of the transaction. */
   IsolationLevel isolation_level_;
+  /** Whether the transaction was begun read-only. */
+  bool read_only_;
   /** The thread ID, used in single-threaded transactions. */
   std::thread::id thread_id_;
   /** The ID of this transaction. */
@@ -258,10 +411,27 @@ class Transaction {
 
   /** The undo set of table tuples. */
   std::shared_ptr<std::deque<TableWriteRecord>> table_write_set_;
+  /** Partitioned serial execution: the transaction needs no locks. */
+  bool serial_{false};
+  /** Optimistic concurrency control: the validated reads and the buffered writes. */
+  bool optimistic_{false};
+  std::shared_ptr<std::deque<TableReadRecord>> table_read_set_;
+  std::shared_ptr<std::deque<TableWriteRecord>> buffered_write_set_;
   /** The undo set of indexes. */
   std::shared_ptr<std::deque<IndexWriteRecord>> index_write_set_;
+  /** The tuples of the write sets and their undo images. */
+  Arena arena_;
   /** The LSN of the last record written by the transaction. */
   lsn_t prev_lsn_;
+  /** The LSN of the first record written by the transaction, recovery must keep the log from there on. */
+  lsn_t first_lsn_{INVALID_LSN};
+  /** The number of log bytes written by the transaction. */
+  uint64_t log_bytes_{0};
+  /** Snapshot isolation: the newest commit timestamp this transaction reads, and its own commit timestamp. */
+  timestamp_t read_ts_{0};
+  timestamp_t commit_ts_{0};
+  /** The transaction manager's running transaction counter this transaction was counted in when it began. */
+  size_t quiescence_slot_{0};
 
   /** Concurrent index: the pages that were latched during index operation. */
   std::shared_ptr<std::deque<Page *>> page_set_;
@@ -272,6 +442,12 @@ class Transaction {
   std::shared_ptr<std::unordered_set<RID>> shared_lock_set_;
   /** LockManager: the set of exclusive-locked tuples held by this transaction. */
   std::shared_ptr<std::unordered_set<RID>> exclusive_lock_set_;
+  /** LockManager: the tables locked by this transaction and their lock mode. */
+  std::shared_ptr<std::unordered_map<table_oid_t, LockMode>> table_lock_set_;
+  /** LockManager: the tuples locked through their table, counted for lock escalation. */
+  std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<RID>>> table_row_lock_set_;
+  /** The indexes this transaction locked key ranges in, released with its other locks. */
+  std::shared_ptr<std::unordered_set<IndexRangeLocks *>> index_range_lock_set_;
 };
 
 }  // namespace bustub
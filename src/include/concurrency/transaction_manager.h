@@ -12,12 +12,19 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <mutex>  // NOLINT
 #include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
+#include "concurrency/key_range_lock.h"
 #include "concurrency/lock_manager.h"
 #include "concurrency/transaction.h"
 #include "recovery/log_manager.h"
@@ -25,13 +32,60 @@
 namespace bustub {
 class LockManager;
 
+/**
+ * How transactions are isolated. Under TWO_PHASE_LOCKING they lock what they access. OPTIMISTIC transactions take no
+ * locks, they validate at commit that nothing they read has changed since and only then install their writes.
+ */
+enum class ConcurrencyMode { TWO_PHASE_LOCKING, OPTIMISTIC };
+
+/**
+ * TransactionRegistry maps the ids of the running transactions to the transactions. It is split into shards by
+ * transaction id with a latch each, so that transactions beginning and ending at the same time rarely meet.
+ */
+class TransactionRegistry {
+ public:
+  /**
+   * Adds a running transaction.
+   * @param txn the transaction
+   * @param last_commit_ts if given, the read timestamp of txn is taken from it under the shard latch, so that a scan
+   * that misses txn began before txn read the timestamp
+   */
+  void Insert(Transaction *txn, const std::atomic<timestamp_t> *last_commit_ts = nullptr);
+
+  /** Removes a transaction that is no longer running. */
+  void Erase(txn_id_t txn_id);
+
+  /** @return the running transaction with the given id, nullptr if there is none */
+  Transaction *Find(txn_id_t txn_id);
+
+  /** Calls visitor with every running transaction, latching one shard at a time. */
+  void ForEach(const std::function<void(Transaction *)> &visitor);
+
+ private:
+  /** A part of the registry with its own latch, padded to a cache line to keep the latches apart. */
+  struct alignas(64) Shard {
+    std::shared_mutex latch_;
+    std::unordered_map<txn_id_t, Transaction *> txns_;
+  };
+
+  inline Shard &GetShard(txn_id_t txn_id) { return shards_[static_cast<uint32_t>(txn_id) % TXN_REGISTRY_SHARDS]; }
+
+  std::array<Shard, TXN_REGISTRY_SHARDS> shards_;
+};
+
 /**
  * TransactionManager keeps track of all the transactions running in the system.
+ *
+ * A consistent checkpoint waits for the running transactions to quiesce. Every thread counts the transactions it
+ * begins in a slot of its own, so beginning and ending a transaction only touches a cache line no other thread
+ * writes to in the common case. BlockAllTransactions raises a flag that stops new transactions and waits until all
+ * slots are zero. A transaction that began before it saw the flag is counted already and is waited for.
  */
 class TransactionManager {
  public:
-  explicit TransactionManager(LockManager *lock_manager, LogManager *log_manager = nullptr)
-      : lock_manager_(lock_manager), log_manager_(log_manager) {}
+  explicit TransactionManager(LockManager *lock_manager, LogManager *log_manager = nullptr,
+                              ConcurrencyMode concurrency_mode = ConcurrencyMode::TWO_PHASE_LOCKING)
+      : lock_manager_(lock_manager), log_manager_(log_manager), concurrency_mode_(concurrency_mode) {}
 
   ~TransactionManager() = default;
 
@@ -44,40 +98,85 @@ class TransactionManager {
   Transaction *Begin(Transaction *txn = nullptr, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ);
 
   /**
-   * Commits a transaction.
-   * @param txn the transaction to commit
+   * Begins a read-only transaction. It reads the snapshot of the moment it begins without taking any locks, writes
+   * nothing to the log, has no write sets and does not hold up checkpoints, so beginning and ending it only registers
+   * and unregisters its snapshot. Writing in it throws a TransactionAbortException.
+   * @param txn an optional read-only SNAPSHOT transaction object to be initialized, otherwise a new one is created.
+   * @return an initialized transaction
    */
-  void Commit(Transaction *txn);
+  Transaction *BeginReadOnly(Transaction *txn = nullptr);
 
   /**
-   * Aborts a transaction
-   * @param txn the transaction to abort
+   * Begins a serial transaction, which takes no locks because nothing runs concurrently with it on the data it
+   * touches. The PartitionExecutor runs the transactions of each partition serially this way.
+   * @param txn an optional transaction object to be initialized, otherwise a new transaction is created.
+   * @return an initialized transaction
    */
-  void Abort(Transaction *txn);
+  Transaction *BeginSerial(Transaction *txn = nullptr);
 
   /**
-   * Global list of running transactions
+   * Commits a transaction. An optimistic transaction is aborted instead if it fails validation, the caller may then
+   * retry it as a new transaction.
+   * @param txn the transaction to commit
+   * @return false if the transaction was aborted
    */
+  bool Commit(Transaction *txn);
 
-  /** The transaction map is a global list of all the running transactions in the system. */
-  static std::unordered_map<txn_id_t, Transaction *> txn_map;
-  static std::shared_mutex txn_map_mutex;
+  /**
+   * Aborts a transaction
+   * @param txn the transaction to abort
+   */
+  void Abort(Transaction *txn);
 
   /**
    * Locates and returns the transaction with the given transaction ID.
    * @param txn_id the id of the transaction to be found, it must exist!
    * @return the transaction with the given transaction id
    */
-  static Transaction *GetTransaction(txn_id_t txn_id) {
-    TransactionManager::txn_map_mutex.lock_shared();
-    assert(TransactionManager::txn_map.find(txn_id) != TransactionManager::txn_map.end());
-    auto *res = TransactionManager::txn_map[txn_id];
+  Transaction *GetTransaction(txn_id_t txn_id) {
+    auto *res = txn_registry_.Find(txn_id);
     assert(res != nullptr);
-    TransactionManager::txn_map_mutex.unlock_shared();
     return res;
   }
 
-  /** Prevents all transactions from performing operations, used for checkpointing. */
+  /** @return the registry of the running transactions, which recovery adds the losers it rolls back to */
+  TransactionRegistry *GetTransactionRegistry() { return &txn_registry_; }
+
+  /**
+   * Collects the active transaction table, i.e. the most recent LSN of every running transaction that has logged.
+   * Used for fuzzy checkpointing, so it does not block running transactions.
+   * @param[out] active_txns pairs of transaction id and the LSN of its last log record
+   */
+  void GetActiveTransactionTable(std::vector<std::pair<txn_id_t, lsn_t>> *active_txns);
+
+  /** @return the first LSN of the oldest running transaction that has logged, INVALID_LSN if there is none */
+  lsn_t GetOldestActiveLSN();
+
+  /**
+   * @return the read timestamp of the oldest running snapshot or optimistic transaction, versions older than it are
+   * never read again
+   */
+  timestamp_t GetOldestSnapshot();
+
+  /** @return the log bytes written by the committed transactions, divided by their count for bytes per transaction */
+  inline uint64_t GetCommittedLogBytes() const { return committed_log_bytes_; }
+
+  /** @return the number of transactions that committed */
+  inline uint64_t GetCommittedCount() const { return committed_txns_; }
+
+  /** @return the commit timestamp of the last committed transaction that wrote something */
+  inline timestamp_t GetLastCommitTimestamp() const { return last_commit_ts_; }
+
+  /**
+   * Sets the id of the next transaction to begin. Used after recovery, so that new transactions never reuse the id
+   * of a transaction in the log.
+   * @param txn_id the id of the next transaction
+   */
+  void SetNextTxnId(txn_id_t txn_id) { next_txn_id_ = txn_id; }
+
+  /**
+   * Prevents new transactions from beginning and waits until the running ones have ended, used for checkpointing.
+   */
   void BlockAllTransactions();
 
   /** Resumes all transactions, used for checkpointing. */
@@ -99,14 +198,72 @@ class TransactionManager {
     for (auto locked_rid : lock_set) {
       lock_manager_->Unlock(txn, locked_rid);
     }
+    // Tables are unlocked after the rows below them.
+    std::vector<table_oid_t> table_set;
+    for (const auto &[oid, lock_mode] : *txn->GetTableLockSet()) {
+      table_set.push_back(oid);
+    }
+    for (auto oid : table_set) {
+      lock_manager_->UnlockTable(txn, oid);
+    }
+    for (auto index : *txn->GetIndexRangeLockSet()) {
+      index->UnlockAll(txn);
+    }
+    txn->GetIndexRangeLockSet()->clear();
   }
 
+  /** Counts a beginning transaction in the slot of its thread, waiting while transactions are blocked. */
+  void EnterQuiescenceSlot(Transaction *txn);
+
+  /** Ends counting a transaction that has released everything it held. */
+  void ExitQuiescenceSlot(Transaction *txn);
+
+  /**
+   * Stamps the versions written by a committing transaction with its commit timestamp and prunes the versions
+   * that no snapshot can see anymore. An optimistic transaction is validated and installs its writes first.
+   * @return false if the optimistic transaction failed validation
+   */
+  bool CommitVersions(Transaction *txn);
+
+  /**
+   * Validates that the tuples read by an optimistic transaction are still the newest committed versions, then
+   * installs its buffered writes. Caller holds the commit latch.
+   * @return false if validation or one of the writes failed
+   */
+  bool ValidateAndInstall(Transaction *txn);
+
   std::atomic<txn_id_t> next_txn_id_{0};
+  /**
+   * The running transactions of this manager. It is not global, so that a crash simulated by deleting the manager
+   * forgets the transactions deleted with it.
+   */
+  TransactionRegistry txn_registry_;
+  /**
+   * Snapshots begin at the last commit timestamp, which is only published once all versions of the commit are
+   * stamped. The commit latch serializes the stamping.
+   */
+  std::atomic<timestamp_t> last_commit_ts_{0};
+  /** Metrics of the committed transactions. */
+  std::atomic<uint64_t> committed_log_bytes_{0};
+  std::atomic<uint64_t> committed_txns_{0};
+  /** Optimistic transactions are also validated one at a time under the commit latch. */
+  std::mutex commit_latch_;
   LockManager *lock_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
+  ConcurrencyMode concurrency_mode_;
+
+  /** The number of running transactions begun by the threads of a slot, padded to a cache line. */
+  struct alignas(64) QuiescenceSlot {
+    std::atomic<uint32_t> running_{0};
+  };
 
-  /** The global transaction latch is used for checkpointing. */
-  ReaderWriterLatch global_txn_latch_;
+  /** Checkpoint barrier: the running transactions per thread and whether new ones are blocked. */
+  std::array<QuiescenceSlot, TXN_QUIESCENCE_SLOTS> quiescence_slots_;
+  std::atomic<bool> blocked_{false};
+  /** Serializes checkpoints and lets blocked transactions sleep until they are resumed. */
+  std::mutex block_latch_;
+  std::mutex resume_latch_;
+  std::condition_variable resume_cv_;
 };
 
 }  // namespace bustub
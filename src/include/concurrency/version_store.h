@@ -0,0 +1,134 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.h
+//
+// Identification: src/include/concurrency/version_store.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <deque>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "concurrency/transaction.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/** Where a snapshot finds the version of a tuple it can see. */
+enum class VisibleVersion { IN_PAGE, IN_STORE, NONE };
+
+/**
+ * VersionStore keeps the older versions of the tuples of one table heap for snapshot isolation and optimistic
+ * concurrency control.
+ *
+ * The table pages always hold the newest version of a tuple. A writer saves the version it replaces at the head of
+ * the tuple's undo chain while it holds the page's write latch, and the versions are stamped with the writer's commit
+ * timestamp when it commits. A snapshot reads the newest version committed at or before its read timestamp, walking
+ * back the chain if the page holds a newer or uncommitted one. Tuples without a chain are visible to everyone.
+ *
+ * Optimistic transactions read the newest committed version and validate that its commit timestamp is unchanged
+ * when they commit.
+ *
+ * Versions are pruned once no running snapshot can see them. A chain whose page version is visible to every snapshot
+ * is dropped entirely.
+ */
+class VersionStore {
+ public:
+  VersionStore() = default;
+  ~VersionStore() = default;
+
+  DISALLOW_COPY_AND_MOVE(VersionStore);
+
+  /**
+   * Saves the version of a tuple a transaction is replacing. Only its first write of the tuple saves a version, the
+   * later ones replace its own uncommitted version.
+   * @param rid the tuple being written
+   * @param txn the writing transaction
+   * @param old_tuple the replaced version, nullptr if the slot held no tuple
+   */
+  void RecordWrite(const RID &rid, Transaction *txn, const Tuple *old_tuple);
+
+  /** @return true if the tuple has a version that the snapshot of txn cannot see and that txn did not write */
+  bool IsWriteConflict(const RID &rid, Transaction *txn);
+
+  /**
+   * Finds the version of a tuple visible to the snapshot of a transaction.
+   * @param rid the tuple to read
+   * @param txn the reading transaction
+   * @param[out] tuple the visible version if it was found in the store
+   * @return where the visible version is, NONE if the tuple did not exist for the snapshot
+   */
+  VisibleVersion GetVisibleVersion(const RID &rid, Transaction *txn, Tuple *tuple);
+
+  /**
+   * Finds the newest committed version of a tuple for an optimistic transaction, or the version it wrote itself.
+   * @param rid the tuple to read
+   * @param txn the reading transaction
+   * @param[out] tuple the version if it was found in the store
+   * @param[out] version the commit timestamp of the version, 0 for versions committed before txn began, whose
+   * timestamps may have been forgotten already
+   * @return where the version is, NONE if the tuple does not exist
+   */
+  VisibleVersion GetCommittedVersion(const RID &rid, Transaction *txn, Tuple *tuple, timestamp_t *version);
+
+  /** @return the commit timestamp of the newest committed version of a tuple, as in GetCommittedVersion */
+  timestamp_t GetCommittedTimestamp(const RID &rid, Transaction *txn);
+
+  /** Stamps the page version of a tuple written by txn with its commit timestamp. */
+  void Commit(const RID &rid, Transaction *txn, timestamp_t commit_ts);
+
+  /** Drops the version saved by txn after its write of the tuple has been rolled back in the page. */
+  void Abort(const RID &rid, Transaction *txn);
+
+  /**
+   * Prunes the versions of a tuple that no snapshot can see anymore, then the versions of tuples that were kept for
+   * older snapshots when their writers committed.
+   * @param rid a tuple just committed
+   * @param watermark the read timestamp of the oldest running snapshot
+   */
+  void GarbageCollect(const RID &rid, timestamp_t watermark);
+
+  /** @return the number of versions kept outside the table pages */
+  size_t GetVersionCount();
+
+ private:
+  /** A replaced version and the commit timestamp it was written with, no tuple if the slot was empty. */
+  struct UndoVersion {
+    timestamp_t ts_;
+    std::optional<Tuple> tuple_;
+  };
+
+  /** The versions of one tuple. */
+  struct VersionChain {
+    /** The transaction whose uncommitted version is in the page, INVALID_TXN_ID if it is committed. */
+    txn_id_t writer_{INVALID_TXN_ID};
+    /** The commit timestamp of the page version once committed. */
+    timestamp_t ts_{0};
+    /** The replaced versions, newest first. */
+    std::deque<UndoVersion> undo_;
+  };
+
+  /** @return the commit timestamp of the newest committed version in the chain, as in GetCommittedVersion */
+  static timestamp_t CommittedTimestamp(const VersionChain &chain, Transaction *txn);
+
+  /** Prunes the chain of rid. Caller holds the latch in exclusive mode. */
+  void Prune(const RID &rid, timestamp_t watermark);
+
+  std::shared_mutex latch_;
+  std::unordered_map<RID, VersionChain> chains_;
+  /** Committed chains that were kept for older snapshots, with the timestamp they can be pruned at. */
+  std::deque<std::pair<timestamp_t, RID>> gc_queue_;
+};
+
+}  // namespace bustub
@@ -12,13 +12,16 @@
 
 #pragma once
 
+#include <initializer_list>
 #include <queue>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction.h"
 #include "container/hash/hash_function.h"
+#include "recovery/log_manager.h"
 #include "storage/page/hash_table_bucket_page.h"
 #include "storage/page/hash_table_directory_page.h"
 
@@ -30,6 +33,26 @@ namespace bustub {
  * Implementation of extendible hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
  * table grows/shrinks dynamically as buckets become full/empty.
+ *
+ * A directory page points to at most DIRECTORY_ARRAY_SIZE buckets, so the directories are extendible hashed in turn:
+ * the table's header page points to its directory pages. A table starts out with a single directory, which is split
+ * in two along with all of its buckets once it cannot double any more. Directories are not merged again.
+ *
+ * Lookups, inserts and removes share the table latch and latch only their bucket page. An insert into a full bucket
+ * or a remove that empties one lets go of its latches and takes the table latch exclusively to split or merge,
+ * looking up the key's bucket again since the directory may have changed meanwhile.
+ *
+ * Entries whose hashes agree on all the bits the header and directories split by are never told apart by a split, so a
+ * full bucket holding nothing else, e.g. many values of a hot key, is not split. It turns into the first page of a
+ * chain of overflow pages behind a new, empty bucket page instead. The overflow pages only hold entries agreeing on
+ * those bits, which go nowhere else, and move along with them when their bucket is split, so that the bucket page is
+ * left to the keys splits still tell apart. The latch of a bucket page covers its overflow pages, and chains are only
+ * linked and unlinked under the exclusive table latch. Overflow pages emptied by removes are unlinked when the bucket
+ * is considered for a merge.
+ *
+ * When logging is enabled, inserts and removes on behalf of a transaction are logged as HASH_INSERT and HASH_DELETE
+ * records, and the bucket splits and merges they cause as redo-only HASH_SPLIT and HASH_MERGE records, so that the
+ * table recovers in place.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class ExtendibleHashTable {
@@ -40,9 +63,19 @@ class ExtendibleHashTable {
    * @param buffer_pool_manager buffer pool manager to be used
    * @param comparator comparator for keys
    * @param hash_fn the hash function
+   * @param log_manager the log manager changes are logged to, nullptr to not log them
    */
   explicit ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn);
+                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                               LogManager *log_manager = nullptr);
+
+  /**
+   * Opens an existing ExtendibleHashTable, e.g. after recovery.
+   *
+   * @param header_page_id the header page of the table
+   */
+  ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
+                      HashFunction<KeyType> hash_fn, LogManager *log_manager, page_id_t header_page_id);
 
   /**
    * Inserts a key-value pair into the hash table.
@@ -75,12 +108,37 @@ class ExtendibleHashTable {
   bool GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result);
 
   /**
-   * Returns the global depth.  Do not touch.
+   * Looks up a batch of keys. The keys are hashed and grouped by bucket up front, so that every directory and bucket
+   * page is fetched and latched once for the whole batch.
+   *
+   * @param transaction the current transaction
+   * @param keys the keys to look up
+   * @param[out] results the value(s) associated with each key, in the order of the keys
+   * @return the number of keys found
+   */
+  size_t GetValues(Transaction *transaction, const std::vector<KeyType> &keys,
+                   std::vector<std::vector<ValueType>> *results);
+
+  /**
+   * Inserts a batch of key-value pairs, grouped by bucket like GetValues. The pairs whose bucket is full are inserted
+   * one at a time afterwards, splitting their buckets.
+   *
+   * @param transaction the current transaction
+   * @param batch the key-value pairs to insert
+   * @return the number of pairs inserted
+   */
+  size_t InsertBatch(Transaction *transaction, const std::vector<std::pair<KeyType, ValueType>> &batch);
+
+  /** @return the page id of the header page */
+  inline page_id_t GetHeaderPageId() const { return header_page_id_; }
+
+  /**
+   * Returns the global depth, the number of hash bits the header and the deepest directory use.
    */
   uint32_t GetGlobalDepth();
 
   /**
-   * Helper function to verify the integrity of the extendible hash table's directory.  Do not touch.
+   * Helper function to verify the integrity of the extendible hash table's header and directories.
    */
   void VerifyIntegrity();
 
@@ -122,11 +180,19 @@ class ExtendibleHashTable {
   inline uint32_t KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page);
 
   /**
-   * Fetches the directory page from the buffer pool manager.
+   * Fetches the header page from the buffer pool manager.
+   *
+   * @return a pointer to the header page
+   */
+  HashTableDirectoryPage *FetchHeaderPage();
+
+  /**
+   * Fetches the directory page a key's bucket is found through from the buffer pool manager.
    *
+   * @param key the key for lookup
    * @return a pointer to the directory page
    */
-  HashTableDirectoryPage *FetchDirectoryPage();
+  HashTableDirectoryPage *FetchDirectoryPage(const KeyType &key);
 
   /**
    * Fetches the a bucket page from the buffer pool manager using the bucket's page_id.
@@ -137,23 +203,127 @@ class ExtendibleHashTable {
   HASH_TABLE_BUCKET_TYPE *FetchBucketPage(page_id_t bucket_page_id);
 
   /**
-   * Performs insertion with an optional bucket splitting.
+   * Finds the bucket page of every key of a batch. The caller holds the table latch in shared mode.
+   *
+   * @param keys the first key of the batch
+   * @param batch_size the number of keys
+   * @param stride the distance of the keys in bytes
+   * @return (bucket page id, position in the batch) of every key, sorted so that the keys of a bucket are adjacent
+   */
+  std::vector<std::pair<page_id_t, size_t>> GroupByBucket(const KeyType *keys, size_t batch_size, size_t stride);
+
+  /**
+   * Calls visit(bucket_page_id, bucket_page, first, last) for every bucket of a grouped batch, whose keys are at
+   * [first, last) of it. The next bucket page is fetched ahead and the start of it prefetched into the CPU cache
+   * while the current one is visited. visit returns whether it changed the bucket page.
+   */
+  template <typename Visitor>
+  void ForEachBucket(const std::vector<std::pair<page_id_t, size_t>> &grouped, Visitor visit);
+
+  /** @return the bits of the key's hash the header and the directories split by */
+  inline uint32_t SplitHash(const KeyType &key) { return Hash(key) & SPLIT_HASH_MASK; }
+
+  /**
+   * Calls visit(page_id, overflow_page) on the overflow pages chained from a bucket page in order, until it returns
+   * true. Overflow pages only hold entries that agree on their split hash, so the walk ends at the first entry found
+   * if that does not agree with the key. The caller latches the bucket page.
+   *
+   * @return false if the overflow pages hold entries of another split hash than the key, whatever visit found
+   * before telling does not count then
+   */
+  template <typename Visitor>
+  bool ForEachOverflowPage(HASH_TABLE_BUCKET_TYPE *bucket_page, const KeyType &key, Visitor visit);
+
+  /**
+   * Finds the split hash the entries on the overflow pages of a bucket agree on.
+   *
+   * @param[out] split_hash the split hash of the entries
+   * @return false if the bucket has no overflow pages with entries
+   */
+  bool GetOverflowSplitHash(HASH_TABLE_BUCKET_TYPE *bucket_page, uint32_t *split_hash);
+
+  /** Collects the values of a key from a bucket page, which the caller latches, and its overflow pages. */
+  bool GetBucketValue(HASH_TABLE_BUCKET_TYPE *bucket_page, const KeyType &key, std::vector<ValueType> *result);
+
+  /**
+   * Inserts a key-value pair into a bucket page, which the caller latches exclusively, or one of its overflow pages.
+   *
+   * @param[out] is_full true if neither has the pair yet nor room for it
+   * @return true if the pair was inserted
+   */
+  bool InsertIntoChain(Transaction *transaction, page_id_t bucket_page_id, HASH_TABLE_BUCKET_TYPE *bucket_page,
+                       const KeyType &key, const ValueType &value, bool *is_full);
+
+  /**
+   * Inserts a key-value pair into the bucket the key maps to. The caller holds the table latch in either mode.
+   *
+   * @param transaction a pointer to the current transaction
+   * @param key the key to insert
+   * @param value the value to insert
+   * @param[out] needs_split true if the bucket is full and does not have the pair yet
+   * @return true if the pair was inserted
+   */
+  bool InsertIntoBucket(Transaction *transaction, const KeyType &key, const ValueType &value, bool *needs_split);
+
+  /**
+   * Splits the full bucket the key maps to, or its directory if that is full too. A bucket whose entries all agree
+   * with the key on their split hash gets another overflow page instead. The insertion is retried afterwards. The
+   * caller holds the table latch in exclusive mode.
    *
    * @param transaction a pointer to the current transaction
    * @param key the key to insert
    * @param value the value to insert
-   * @return whether or not the insertion was successful
+   * @return whether or not the bucket could be split
    */
   bool SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value);
 
+  /**
+   * Chains a new overflow page to the end of a bucket's chain. A full bucket without overflow pages becomes the first
+   * overflow page of a new, empty bucket page instead, which takes its place in the directory. The caller holds the
+   * table latch in exclusive mode.
+   *
+   * @param directory_page the directory the bucket is found through
+   * @return false if the buffer pool is out of pages
+   */
+  bool AppendOverflowPage(Transaction *transaction, HashTableDirectoryPage *directory_page, page_id_t bucket_page_id);
+
+  /**
+   * Unlinks the empty overflow pages of a bucket and deletes them. The caller holds the table latch in exclusive mode.
+   */
+  void PruneOverflowPages(Transaction *transaction, page_id_t bucket_page_id);
+
+  /**
+   * Chains an overflow page after a bucket or overflow page, or ends the chain there with INVALID_PAGE_ID. Changes to
+   * the chain are logged like directory changes, as a delta of the page header.
+   */
+  void SetOverflowPageId(Transaction *transaction, HASH_TABLE_BUCKET_TYPE *bucket_page, page_id_t overflow_page_id);
+
+  /**
+   * Splits the directory the key maps to in two by the next header bit. The new directory is a copy of the old one
+   * pointing to new buckets, which the entries whose hash has that bit set move to.
+   *
+   * The new buckets and directory are logged before the header points to them, and the entries are removed from the
+   * old buckets only afterwards, so a crash in between leaves at worst stale copies in the old buckets that no lookup
+   * reaches. The caller holds the table latch in exclusive mode.
+   *
+   * @param transaction a pointer to the current transaction
+   * @param key the key to insert
+   * @return whether or not the directory could be split
+   */
+  bool SplitDirectory(Transaction *transaction, const KeyType &key);
+
   /**
    * Optionally merges an empty bucket into it's pair.  This is called by Remove,
    * if Remove makes a bucket empty.
    *
-   * There are three conditions under which we skip the merge:
+   * The empty overflow pages of the bucket are unlinked first. There are four conditions under which we skip the
+   * merge:
    * 1. The bucket is no longer empty.
    * 2. The bucket has local depth 0.
    * 3. The bucket's local depth doesn't match its split image's local depth.
+   * 4. The bucket still has overflow pages.
+   *
+   * The caller holds the table latch in exclusive mode.
    *
    * @param transaction a pointer to the current transaction
    * @param key the key that was removed
@@ -161,12 +331,35 @@ class ExtendibleHashTable {
    */
   void Merge(Transaction *transaction, const KeyType &key, const ValueType &value);
 
+  /** @return true if changes made on behalf of the transaction are logged */
+  inline bool IsLogging(Transaction *transaction) const {
+    return enable_logging && log_manager_ != nullptr && transaction != nullptr;
+  }
+
+  /**
+   * Logs inserting or removing a single entry of a bucket.
+   *
+   * @param log_record_type HASH_INSERT or HASH_DELETE
+   * @param bucket_idx the index of the entry in the bucket
+   */
+  void LogBucketEntry(Transaction *transaction, LogRecordType log_record_type, page_id_t bucket_page_id,
+                      HASH_TABLE_BUCKET_TYPE *bucket_page, uint32_t bucket_idx, const KeyType &key,
+                      const ValueType &value);
+
+  /** Appends a log record made on behalf of the transaction and sets it as the LSN of the pages it changed. */
+  void AppendLogRecord(Transaction *transaction, LogRecord *log_record, std::initializer_list<Page *> pages);
+
+  /** The hash bits the header and its directories split by, keys that agree on them are never told apart. */
+  static constexpr uint32_t SPLIT_HASH_MASK = (1U << (2 * DIRECTORY_MAX_DEPTH)) - 1;
+
   // member variables
-  page_id_t directory_page_id_;
+  page_id_t header_page_id_;
   BufferPoolManager *buffer_pool_manager_;
+  LogManager *log_manager_;
   KeyComparator comparator_;
 
-  // Readers includes inserts and removes, writers are splits and merges
+  // Readers include lookups and the inserts and removes that fit their bucket, writers are splits and merges. Buckets
+  // are latched on their own for the readers.
   ReaderWriterLatch table_latch_;
   HashFunction<KeyType> hash_fn_;
 };
@@ -14,7 +14,7 @@
 
 #include <cstdint>
 
-#include "murmur3/MurmurHash3.h"
+#include "common/util/hash_util.h"
 
 namespace bustub {
 
@@ -26,11 +26,26 @@ class HashFunction {
    * @return the hashed value
    */
   virtual uint64_t GetHash(KeyType key) {
-    uint64_t hash[2];
-    murmur3::MurmurHash3_x64_128(reinterpret_cast<const void *>(&key), static_cast<int>(sizeof(KeyType)), 0,
-                                 reinterpret_cast<void *>(&hash));
-    return hash[0];
+    const auto *bytes = reinterpret_cast<const char *>(&key);
+    size_t length = TRIM_PADDING ? HashUtil::TrimZeroPadding(bytes, sizeof(KeyType)) : sizeof(KeyType);
+    return HashUtil::HashBytes(bytes, length);
   }
+
+  /**
+   * Hashes count keys at once, each to the same value as GetHash.
+   * @param keys the first key
+   * @param count the number of keys
+   * @param[out] hashes the hashed values
+   * @param stride the distance of the keys in bytes, e.g. the size of the pairs the keys are the first of
+   */
+  void GetHashes(const KeyType *keys, size_t count, uint64_t *hashes, size_t stride = sizeof(KeyType)) {
+    HashUtil::HashBytesBatch(reinterpret_cast<const char *>(keys), sizeof(KeyType), stride, count, hashes,
+                             TRIM_PADDING);
+  }
+
+ private:
+  /** Keys larger than a word, i.e. generic keys, are hashed without the zero padding after their columns. */
+  static constexpr bool TRIM_PADDING = sizeof(KeyType) > sizeof(uint64_t);
 };
 
 }  // namespace bustub
@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <queue>
 #include <string>
 #include <vector>
@@ -26,12 +28,23 @@
 
 namespace bustub {
 
-#define HASH_TABLE_TYPE LinearProbeHashTable<KeyType, ValueType, KeyComparator>
+#define LINEAR_PROBE_HASH_TABLE_TYPE LinearProbeHashTable<KeyType, ValueType, KeyComparator>
 
 /**
  * Implementation of linear probing hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
  * table dynamically grows once full.
+ *
+ * The slots of the table are spread over block pages, which its header page lists. Lookups, inserts and removes
+ * share the table latch and latch the blocks their probe sequence runs over, always in increasing block order, so
+ * that they cannot deadlock. Inserts and removes hold the block their key hashes to exclusively throughout, which
+ * orders the writers of a key.
+ *
+ * A table filled beyond MAX_LOAD_FACTOR is resized incrementally: a table twice as large is created and serves
+ * inserts right away, while every insert and remove migrates one more block of the old table into it. Until the
+ * last block is migrated, lookups and removes probe both tables, the old one first. A block is migrated under its
+ * exclusive latch, so an operation holding the latches of its probe in the old table sees the key's entries either
+ * all there or all in the new table. The table latch is only taken exclusively to swap tables.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator> {
@@ -87,8 +100,65 @@ class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator>
   size_t GetSize();
 
  private:
-  // member variable
-  page_id_t header_page_id_;
+  /** Past this ratio of occupied slots, tombstones included, the table is resized. */
+  static constexpr double MAX_LOAD_FACTOR = 0.75;
+
+  /** The in-memory copy of a table's header page, and the counters its resizes are decided by. */
+  struct Table {
+    page_id_t header_page_id_;
+    std::vector<page_id_t> block_page_ids_;
+    std::atomic<size_t> num_occupied_{0};
+    std::atomic<size_t> num_readable_{0};
+    /** While the table is migrated into a larger one: the next block to claim and the blocks done so far. */
+    std::atomic<size_t> next_migrated_block_{0};
+    std::atomic<size_t> num_migrated_blocks_{0};
+  };
+
+  /** The blocks a probe sequence ran over, which stay latched until released, and what it found there. */
+  struct Probe {
+    std::vector<Page *> latched_;
+    /** The readable slots holding the key. */
+    std::vector<std::pair<HASH_TABLE_BLOCK_TYPE *, slot_offset_t>> matches_;
+    /** The never occupied slot the probe ended at, nullptr if the table is full. */
+    HASH_TABLE_BLOCK_TYPE *free_block_{nullptr};
+    slot_offset_t free_slot_{0};
+  };
+
+  /** Creates a table of num_blocks empty blocks. */
+  std::unique_ptr<Table> NewTable(size_t num_blocks);
+
+  /**
+   * Latches the blocks of table the probe sequence of key runs over, from the slot it hashes to up to the first
+   * never occupied slot. A probe wrapping around to the start of the table lets go of its latches and latches its
+   * blocks again in order.
+   */
+  Probe ProbeKey(Table *table, const KeyType &key, bool exclusive);
+
+  /** Unlatches and unpins the blocks of a probe, marking dirty_block dirty. */
+  void Release(const Probe &probe, bool exclusive, const HASH_TABLE_BLOCK_TYPE *dirty_block = nullptr);
+
+  /** Inserts an entry into table without checking for duplicates. @return false if table is full */
+  bool InsertEntry(Table *table, const KeyType &key, const ValueType &value);
+
+  /**
+   * Migrates the next block of the old table, if one is left. Needs the table latch.
+   * @return true if it was the last block, so that the old table can be dropped
+   */
+  bool MigrateBlock();
+
+  /** Drops the old table once all its blocks are migrated. Takes the table latch exclusively. */
+  void FinishResize();
+
+  /**
+   * Starts resizing the table to at least twice initial_size slots, migrating whatever is left of a resize going on
+   * first. Needs the table latch exclusively.
+   * @return false if a header page cannot list enough blocks for the new table
+   */
+  bool StartResize(size_t initial_size);
+
+  /** Deletes the pages of a table. */
+  void DeleteTable(const Table &table);
+
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
 
@@ -97,6 +167,10 @@ class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator>
 
   // Hash function
   HashFunction<KeyType> hash_fn_;
+
+  /** The table inserts go to, and the table migrated into it while a resize goes on, nullptr otherwise. */
+  std::unique_ptr<Table> table_;
+  std::unique_ptr<Table> old_table_;
 };
 
 }  // namespace bustub
@@ -12,6 +12,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "recovery/log_manager.h"
@@ -19,7 +24,14 @@
 namespace bustub {
 
 /**
- * CheckpointManager creates consistent checkpoints by blocking all other transactions temporarily.
+ * CheckpointManager creates checkpoints. A consistent checkpoint (BeginCheckpoint/EndCheckpoint) blocks all other
+ * transactions temporarily, while a fuzzy checkpoint (BeginFuzzyCheckpoint) runs in the background next to them:
+ *
+ * 1. A BEGIN_CHECKPOINT record is appended without blocking any transaction.
+ * 2. The pages that were dirty at that point are written out by a background thread, at most
+ *    checkpoint_flush_batch pages every checkpoint_flush_interval.
+ * 3. An END_CHECKPOINT record carrying the active transaction table (ATT) and dirty page table (DPT) is appended and
+ *    forced to disk. Recovery only has to redo from the smallest recovery LSN in that DPT.
  */
 class CheckpointManager {
  public:
@@ -29,15 +41,40 @@ class CheckpointManager {
         log_manager_(log_manager),
         buffer_pool_manager_(buffer_pool_manager) {}
 
-  ~CheckpointManager() = default;
+  ~CheckpointManager() { WaitForFuzzyCheckpoint(); }
 
   void BeginCheckpoint();
   void EndCheckpoint();
 
+  /**
+   * Starts a fuzzy checkpoint and returns as soon as its BEGIN_CHECKPOINT record is appended. If a fuzzy checkpoint
+   * is still running, it is waited for first.
+   * @return the LSN of the BEGIN_CHECKPOINT record, or INVALID_LSN if logging is disabled
+   */
+  lsn_t BeginFuzzyCheckpoint();
+
+  /** Blocks until the running fuzzy checkpoint (if any) has written its END_CHECKPOINT record. */
+  void WaitForFuzzyCheckpoint();
+
+  /** @return the LSN of the BEGIN_CHECKPOINT record of the last completed fuzzy checkpoint */
+  inline lsn_t GetLastCheckpointLSN() { return last_checkpoint_lsn_; }
+
  private:
-  TransactionManager *transaction_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /**
+   * Body of the background checkpoint thread: writes out the given pages at the configured pace and then appends
+   * the END_CHECKPOINT record.
+   */
+  void RunFuzzyCheckpoint(lsn_t begin_lsn, std::vector<page_id_t> dirty_pages);
+
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+
+  /** Serializes starting and waiting for fuzzy checkpoints. */
+  std::mutex latch_;
+  /** The background thread of the running fuzzy checkpoint. */
+  std::thread *checkpoint_thread_{nullptr};
+  std::atomic<lsn_t> last_checkpoint_lsn_{INVALID_LSN};
 };
 
 }  // namespace bustub
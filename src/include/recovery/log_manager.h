@@ -16,6 +16,7 @@
 #include <condition_variable>  // NOLINT
 #include <future>              // NOLINT
 #include <mutex>               // NOLINT
+#include <thread>              // NOLINT
 
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
@@ -29,12 +30,13 @@ namespace bustub {
 class LogManager {
  public:
   explicit LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
+      : next_lsn_(0), persistent_lsn_(INVALID_LSN), flush_thread_(nullptr), disk_manager_(disk_manager) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
     flush_buffer_ = new char[LOG_BUFFER_SIZE];
   }
 
   ~LogManager() {
+    StopFlushThread();
     delete[] log_buffer_;
     delete[] flush_buffer_;
     log_buffer_ = nullptr;
@@ -46,29 +48,64 @@ class LogManager {
 
   lsn_t AppendLogRecord(LogRecord *log_record);
 
+  /**
+   * Wakes up the flush thread and blocks until every log record up to and including lsn is on disk.
+   * @param lsn the log sequence number that must be persistent when this returns
+   */
+  void ForceFlush(lsn_t lsn);
+
+  /**
+   * Records a complete checkpoint, whose records must be persistent, in the log segment headers so that recovery
+   * starts from it. Recycles the log segments that only hold records before truncate_lsn.
+   * @param checkpoint_lsn the LSN of the begin record of the checkpoint
+   * @param truncate_lsn the oldest LSN recovery still needs
+   */
+  void CompleteCheckpoint(lsn_t checkpoint_lsn, lsn_t truncate_lsn);
+
   inline lsn_t GetNextLSN() { return next_lsn_; }
+  inline void SetNextLSN(lsn_t lsn) { next_lsn_ = lsn; }
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
   inline char *GetLogBuffer() { return log_buffer_; }
 
+  /** @return the number of log bytes appended since the log manager was created, for exporting as a metric */
+  inline uint64_t GetAppendedBytes() const { return appended_bytes_; }
+
  private:
-  // TODO(students): you may add your own member variables
+  /** Serializes the log record into the log buffer at the given position. */
+  static void SerializeLogRecord(LogRecord *log_record, char *dest);
+
+  /** Swaps the log buffers and writes out the full one. Must be called by the flush thread with latch held. */
+  void FlushLogBuffer(std::unique_lock<std::mutex> *lock);
 
   /** The atomic counter which records the next log sequence number. */
   std::atomic<lsn_t> next_lsn_;
+  /** Written under the latch, read without it. */
+  std::atomic<uint64_t> appended_bytes_{0};
   /** The log records before and including the persistent lsn have been written to disk. */
   std::atomic<lsn_t> persistent_lsn_;
 
   char *log_buffer_;
   char *flush_buffer_;
+  /** The number of bytes used in the log buffer. */
+  int log_buffer_offset_{0};
+  /** True if someone is waiting on the flush thread, i.e. a full log buffer or a forced flush. */
+  bool need_flush_{false};
+  /** The position in the data area of the log segment the next record goes to. */
+  int segment_offset_{DiskManager::LOG_SEGMENT_DATA_SIZE};
+  /** If valid, the flush thread starts a new log segment with this LSN before writing the log buffer. */
+  lsn_t segment_start_lsn_{INVALID_LSN};
 
   std::mutex latch_;
 
-  std::thread *flush_thread_ __attribute__((__unused__));
+  std::thread *flush_thread_;
 
+  /** Wakes up the flush thread. */
   std::condition_variable cv_;
+  /** Notified by the flush thread whenever the persistent LSN advances. */
+  std::condition_variable flushed_cv_;
 
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
 };
 
 }  // namespace bustub
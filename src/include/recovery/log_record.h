@@ -13,9 +13,13 @@
 #pragma once
 
 #include <cassert>
+#include <cstring>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
+#include "storage/page/hash_table_page_defs.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
@@ -32,6 +36,44 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** Start of a fuzzy checkpoint. */
+  BEGIN_CHECKPOINT,
+  /** End of a fuzzy checkpoint, carries the active transaction and dirty page tables. */
+  END_CHECKPOINT,
+  /** An update that only carries the changed byte ranges of the tuple. */
+  UPDATE_DELTA,
+  /** Inserting an entry into a hash index bucket. */
+  HASH_INSERT,
+  /** Removing an entry from a hash index bucket. */
+  HASH_DELETE,
+  /** Splitting a hash index bucket, redo only. */
+  HASH_SPLIT,
+  /** Merging an empty hash index bucket into its split image, redo only. */
+  HASH_MERGE,
+  /** A compensation log record of a rollback, wraps a record of the compensating change. */
+  CLR,
+  /** Inserting an entry into a B+ tree leaf. */
+  BTREE_INSERT,
+  /** Removing an entry from a B+ tree leaf. */
+  BTREE_DELETE,
+  /** Inserting an entry into a B+ tree leaf that split, or into an empty tree. */
+  BTREE_SPLIT,
+  /** Merging or redistributing a B+ tree page that a delete left less than half full, redo only. */
+  BTREE_MERGE,
+};
+
+/**
+ * What log recovery needs to know about a B+ tree to redo and undo its changes without its key and value types. Leaf
+ * entries start at LEAF_PAGE_HEADER_SIZE, every entry starts with its key.
+ */
+struct BPlusTreeLayout {
+  /** The size of the key at the start of an entry, i.e. sizeof(KeyType). */
+  uint32_t key_size_{0};
+  /** The size of a leaf entry, i.e. sizeof(MappingType). */
+  uint32_t entry_size_{0};
+  /** The max sizes of the pages, which undo opens the tree with again. */
+  int32_t leaf_max_size_{0};
+  int32_t internal_max_size_{0};
 };
 
 /**
@@ -53,10 +95,49 @@ enum class LogRecordType {
  *-----------------------------------------------------------------------------------
  * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size | new_tuple_data |
  *-----------------------------------------------------------------------------------
+ * For delta update type log record (old and new tuple have the same size, only the changed ranges are kept)
+ *------------------------------------------------------------------------------------------
+ * | HEADER | tuple_rid | tuple_size | range_count | (offset, length, old_data, new_data) ... |
+ *------------------------------------------------------------------------------------------
  * For new page type log record
- *--------------------------
- * | HEADER | prev_page_id |
- *--------------------------
+ *-------------------------------------
+ * | HEADER | prev_page_id | page_id |
+ *-------------------------------------
+ * For begin checkpoint type log record
+ *----------
+ * | HEADER |
+ *----------
+ * For end checkpoint type log record (prevLSN is the LSN of the matching begin checkpoint record)
+ *----------------------------------------------------------------------------------------------
+ * | HEADER | att_size | (txn_id, last_lsn) ... | dpt_size | (page_id, rec_lsn) ... |
+ *----------------------------------------------------------------------------------------------
+ * For hash index type log record (HASH_INSERT/HASH_DELETE carry the one entry and the table's header page as
+ * directory_page_id, HASH_SPLIT the entries moved to the new bucket and HASH_SPLIT/HASH_MERGE the changed byte ranges
+ * of the directory page; a split of a whole directory logs the pages it changes one at a time, with the others
+ * INVALID_PAGE_ID)
+ *-------------------------------------------------------------------------------------------------------------------
+ * | HEADER | directory_page_id | bucket_page_id | new_bucket_page_id | capacity | entry_size | array_offset |
+ * | key_size | hash | entry_count | (bucket_idx, entry_data) ... | range_count |
+ * | (offset, length, old_data, new_data) ... |
+ *-------------------------------------------------------------------------------------------------------------------
+ * Structure modifications (HASH_SPLIT/HASH_MERGE) are not part of any transaction and are never undone.
+ *
+ * For B+ tree type log record (BTREE_INSERT/BTREE_DELETE carry the entry and its index in the leaf, BTREE_SPLIT the
+ * entry inserted, and BTREE_SPLIT/BTREE_MERGE the changed byte ranges of every page they change, without the old
+ * bytes; new pages are zeroed before their ranges are written)
+ *-------------------------------------------------------------------------------------------------------------------
+ * | HEADER | index_name (32) | key_size | entry_size | leaf_max_size | internal_max_size | leaf_page_id |
+ * | entry_index | entry_data | page_count | (page_id, new_page, range_count, (offset, length, new_data) ...) ... |
+ *-------------------------------------------------------------------------------------------------------------------
+ * BTREE_MERGE is not part of any transaction and is never undone. The entry of the other types is removed from or
+ * inserted into the tree again by undo, wherever it belongs by then.
+ *
+ * A compensation log record (CLR) logs a change made by a rollback. Its header has the type CLR and is followed by
+ * the undo-next LSN, i.e. the prevLSN of the compensated record, and by the compensating change as a record of its
+ * own type. CLRs are redone like that record but never undone.
+ *----------------------------------------------------------------
+ * | HEADER | undo_next_lsn | LogType | body of the LogType ... |
+ *----------------------------------------------------------------
  */
 class LogRecord {
   friend class LogManager;
@@ -85,17 +166,29 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(RID) + sizeof(int32_t) + tuple.GetLength();
   }
 
-  // constructor for UPDATE type
+  // constructor for UPDATE type, UPDATE_DELTA falls back to UPDATE unless the delta is smaller
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, const RID &update_rid,
             const Tuple &old_tuple, const Tuple &new_tuple)
-      : txn_id_(txn_id),
-        prev_lsn_(prev_lsn),
-        log_record_type_(log_record_type),
-        update_rid_(update_rid),
-        old_tuple_(old_tuple),
-        new_tuple_(new_tuple) {
+      : txn_id_(txn_id), prev_lsn_(prev_lsn), log_record_type_(log_record_type), update_rid_(update_rid) {
+    assert(log_record_type == LogRecordType::UPDATE || log_record_type == LogRecordType::UPDATE_DELTA);
     // calculate log record size
     size_ = HEADER_SIZE + sizeof(RID) + old_tuple.GetLength() + new_tuple.GetLength() + 2 * sizeof(int32_t);
+    if (log_record_type == LogRecordType::UPDATE_DELTA && old_tuple.GetLength() == new_tuple.GetLength()) {
+      ComputeUpdateDelta(old_tuple, new_tuple);
+      int32_t delta_size = HEADER_SIZE + sizeof(RID) + 2 * sizeof(int32_t) +
+                           delta_ranges_.size() * DELTA_RANGE_HEADER_SIZE + delta_old_.size() + delta_new_.size();
+      if (delta_size < size_) {
+        tuple_size_ = old_tuple.GetLength();
+        size_ = delta_size;
+        return;
+      }
+      delta_ranges_.clear();
+      delta_old_.clear();
+      delta_new_.clear();
+    }
+    log_record_type_ = LogRecordType::UPDATE;
+    old_tuple_ = old_tuple;
+    new_tuple_ = new_tuple;
   }
 
   // constructor for NEWPAGE type
@@ -110,8 +203,109 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
   }
 
+  // constructor for END_CHECKPOINT type
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
+            std::vector<std::pair<txn_id_t, lsn_t>> active_txns, std::vector<std::pair<page_id_t, lsn_t>> dirty_pages)
+      : txn_id_(txn_id),
+        prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type),
+        active_txns_(std::move(active_txns)),
+        dirty_pages_(std::move(dirty_pages)) {
+    assert(log_record_type == LogRecordType::END_CHECKPOINT);
+    // calculate log record size
+    size_ = HEADER_SIZE + 2 * sizeof(int32_t) + active_txns_.size() * (sizeof(txn_id_t) + sizeof(lsn_t)) +
+            dirty_pages_.size() * (sizeof(page_id_t) + sizeof(lsn_t));
+  }
+
+  // constructor for hash index types (HASH_INSERT/HASH_DELETE/HASH_SPLIT/HASH_MERGE), entries and the directory delta
+  // are added afterwards
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, page_id_t directory_page_id,
+            page_id_t bucket_page_id, page_id_t new_bucket_page_id, const HashTableBucketLayout &bucket_layout,
+            uint32_t hash)
+      : txn_id_(txn_id),
+        prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type),
+        directory_page_id_(directory_page_id),
+        bucket_page_id_(bucket_page_id),
+        new_bucket_page_id_(new_bucket_page_id),
+        bucket_layout_(bucket_layout),
+        hash_(hash) {
+    assert(log_record_type == LogRecordType::HASH_INSERT || log_record_type == LogRecordType::HASH_DELETE ||
+           log_record_type == LogRecordType::HASH_SPLIT || log_record_type == LogRecordType::HASH_MERGE);
+    // calculate log record size, header size + three page ids + layout + hash + entry count + range count
+    size_ = HEADER_SIZE + 3 * sizeof(page_id_t) + 7 * sizeof(uint32_t);
+  }
+
+  // constructor for B+ tree types (BTREE_INSERT/BTREE_DELETE/BTREE_SPLIT/BTREE_MERGE), the changed pages are added
+  // afterwards
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, const std::string &index_name,
+            const BPlusTreeLayout &tree_layout, page_id_t leaf_page_id, uint32_t entry_index, const char *entry)
+      : txn_id_(txn_id),
+        prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type),
+        index_name_(index_name),
+        tree_layout_(tree_layout),
+        leaf_page_id_(leaf_page_id),
+        entry_index_(entry_index),
+        tree_entry_(tree_layout.entry_size_) {
+    assert(log_record_type == LogRecordType::BTREE_INSERT || log_record_type == LogRecordType::BTREE_DELETE ||
+           log_record_type == LogRecordType::BTREE_SPLIT || log_record_type == LogRecordType::BTREE_MERGE);
+    assert(index_name.length() < INDEX_NAME_SIZE);
+    if (entry != nullptr) {
+      memcpy(tree_entry_.data(), entry, tree_layout.entry_size_);
+    }
+    // calculate log record size, header size + index name + layout + leaf page id + entry index + entry + page count
+    size_ = HEADER_SIZE + INDEX_NAME_SIZE + 6 * sizeof(uint32_t) + tree_layout.entry_size_ + sizeof(uint32_t);
+  }
+
   ~LogRecord() = default;
 
+  /**
+   * Turns the record into a compensation log record.
+   * @param undo_next_lsn the prevLSN of the compensated record, where the rollback continues
+   */
+  inline void SetCompensation(lsn_t undo_next_lsn) {
+    if (!compensation_) {
+      size_ += CLR_HEADER_SIZE;
+    }
+    compensation_ = true;
+    undo_next_lsn_ = undo_next_lsn;
+  }
+
+  /** @return true if this is a compensation log record, whose type is the type of the compensating change */
+  inline bool IsCompensation() { return compensation_; }
+
+  inline lsn_t GetUndoNextLSN() { return undo_next_lsn_; }
+
+  /** Adds a hash index entry of bucket_layout.entry_size_ bytes, stored at bucket_idx. */
+  inline void AddBucketEntry(uint32_t bucket_idx, const char *entry) {
+    bucket_indexes_.push_back(bucket_idx);
+    bucket_entries_.insert(bucket_entries_.end(), entry, entry + bucket_layout_.entry_size_);
+    size_ += sizeof(uint32_t) + bucket_layout_.entry_size_;
+  }
+
+  /** Adds the changed byte ranges between the old and new image of a hash index directory page. */
+  inline void AddDirectoryDelta(const char *old_data, const char *new_data, uint32_t size) {
+    ComputeDelta(old_data, new_data, size);
+    size_ += delta_ranges_.size() * DELTA_RANGE_HEADER_SIZE + delta_old_.size() + delta_new_.size();
+  }
+
+  /**
+   * Adds the changed byte ranges between the old and new image of a B+ tree page. Only the new bytes are kept, which
+   * is all redo needs.
+   * @param new_page true if the page was allocated by the change, whose old image is zeroed
+   */
+  inline void AddTreePage(page_id_t page_id, bool new_page, const char *old_data, const char *new_data,
+                          uint32_t size) {
+    size_t range_count = delta_ranges_.size();
+    size_t byte_count = delta_new_.size();
+    ComputeDelta(old_data, new_data, size);
+    delta_old_.clear();
+    tree_pages_.push_back({page_id, new_page, static_cast<uint32_t>(delta_ranges_.size() - range_count)});
+    size_ += TREE_PAGE_HEADER_SIZE + (delta_ranges_.size() - range_count) * DELTA_RANGE_HEADER_SIZE +
+             delta_new_.size() - byte_count;
+  }
+
   inline Tuple &GetDeleteTuple() { return delete_tuple_; }
 
   inline RID &GetDeleteRID() { return delete_rid_; }
@@ -126,8 +320,101 @@ class LogRecord {
 
   inline RID &GetUpdateRID() { return update_rid_; }
 
+  /**
+   * Rebuilds a full tuple from a delta update.
+   * @param tuple the tuple as stored before the update (for redo) or after it (for undo)
+   * @param undo true to rebuild the old tuple, false to rebuild the new one
+   * @return the tuple with the changed byte ranges replaced
+   */
+  inline Tuple ApplyUpdateDelta(const Tuple &tuple, bool undo) const {
+    assert(tuple.GetLength() == tuple_size_);
+    Tuple result(tuple);
+    ApplyDelta(result.GetData(), undo);
+    return result;
+  }
+
+  /**
+   * Replaces the changed byte ranges of a delta update or a hash index directory change.
+   * @param data the data as it was before the change (for redo) or after it (for undo)
+   * @param undo true to restore the old bytes, false to write the new ones
+   */
+  inline void ApplyDelta(char *data, bool undo) const {
+    const char *bytes = undo ? delta_old_.data() : delta_new_.data();
+    for (const auto &[offset, length] : delta_ranges_) {
+      memcpy(data + offset, bytes, length);
+      bytes += length;
+    }
+  }
+
+  inline page_id_t GetDirectoryPageId() { return directory_page_id_; }
+
+  inline page_id_t GetBucketPageId() { return bucket_page_id_; }
+
+  inline page_id_t GetNewBucketPageId() { return new_bucket_page_id_; }
+
+  inline const HashTableBucketLayout &GetBucketLayout() { return bucket_layout_; }
+
+  inline uint32_t GetHash() { return hash_; }
+
+  /** @return the number of hash index entries */
+  inline size_t GetBucketEntryCount() { return bucket_indexes_.size(); }
+
+  /** @return the bucket index of the i-th hash index entry */
+  inline uint32_t GetBucketIndex(size_t i) { return bucket_indexes_[i]; }
+
+  /** @return the data of the i-th hash index entry */
+  inline const char *GetBucketEntry(size_t i) { return bucket_entries_.data() + i * bucket_layout_.entry_size_; }
+
+  /**
+   * Writes the changed byte ranges of a B+ tree page, zeroing it first if the change allocated it.
+   * @param page_id the page, one of the pages added to the record
+   * @param data the page as it was before the change
+   */
+  inline void ApplyTreePage(page_id_t page_id, char *data) const {
+    auto range = delta_ranges_.begin();
+    const char *bytes = delta_new_.data();
+    for (const auto &tree_page : tree_pages_) {
+      if (tree_page.page_id_ == page_id && tree_page.new_page_) {
+        memset(data, 0, PAGE_SIZE);
+      }
+      for (uint32_t i = 0; i < tree_page.range_count_; i++, range++) {
+        if (tree_page.page_id_ == page_id) {
+          memcpy(data + range->first, bytes, range->second);
+        }
+        bytes += range->second;
+      }
+    }
+  }
+
+  inline const std::string &GetIndexName() { return index_name_; }
+
+  inline const BPlusTreeLayout &GetTreeLayout() { return tree_layout_; }
+
+  inline page_id_t GetLeafPageId() { return leaf_page_id_; }
+
+  /** @return the index of the B+ tree entry in its leaf */
+  inline uint32_t GetEntryIndex() { return entry_index_; }
+
+  /** @return the data of the B+ tree entry */
+  inline const char *GetTreeEntry() { return tree_entry_.data(); }
+
+  /** @return the number of B+ tree pages whose changed byte ranges are kept */
+  inline size_t GetTreePageCount() { return tree_pages_.size(); }
+
+  /** @return the id of the i-th B+ tree page whose changed byte ranges are kept */
+  inline page_id_t GetTreePageId(size_t i) { return tree_pages_[i].page_id_; }
+
+  /** @return true if any of the B+ tree pages kept has changed */
+  inline bool HasTreeChanges() const { return !delta_ranges_.empty(); }
+
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  inline page_id_t GetNewPageId() { return page_id_; }
+
+  inline std::vector<std::pair<txn_id_t, lsn_t>> &GetActiveTxns() { return active_txns_; }
+
+  inline std::vector<std::pair<page_id_t, lsn_t>> &GetDirtyPages() { return dirty_pages_; }
+
   inline int32_t GetSize() { return size_; }
 
   inline lsn_t GetLSN() { return lsn_; }
@@ -160,6 +447,10 @@ class LogRecord {
   lsn_t prev_lsn_{INVALID_LSN};
   LogRecordType log_record_type_{LogRecordType::INVALID};
 
+  // compensation log records wrap another type
+  bool compensation_{false};
+  lsn_t undo_next_lsn_{INVALID_LSN};
+
   // case1: for delete operation, delete_tuple_ for UNDO operation
   RID delete_rid_;
   Tuple delete_tuple_;
@@ -173,10 +464,190 @@ class LogRecord {
   Tuple old_tuple_;
   Tuple new_tuple_;
 
+  // case3b: for delta update operation, the changed (offset, length) ranges and their concatenated bytes
+  uint32_t tuple_size_{0};
+  std::vector<std::pair<uint32_t, uint32_t>> delta_ranges_;
+  std::vector<char> delta_old_;
+  std::vector<char> delta_new_;
+
   // case4: for new page operation
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
+
+  // case5: for end checkpoint operation
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns_;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages_;
+
+  // case6: for hash index operation, the directory delta is kept in the delta update fields
+  page_id_t directory_page_id_{INVALID_PAGE_ID};
+  page_id_t bucket_page_id_{INVALID_PAGE_ID};
+  page_id_t new_bucket_page_id_{INVALID_PAGE_ID};
+  HashTableBucketLayout bucket_layout_;
+  uint32_t hash_{0};
+  std::vector<uint32_t> bucket_indexes_;
+  std::vector<char> bucket_entries_;
+
+  // case7: for B+ tree operation, the changed ranges of the pages are kept in the delta update fields, page by page
+  struct TreePage {
+    page_id_t page_id_;
+    bool new_page_;
+    uint32_t range_count_;
+  };
+  std::string index_name_;
+  BPlusTreeLayout tree_layout_;
+  page_id_t leaf_page_id_{INVALID_PAGE_ID};
+  uint32_t entry_index_{0};
+  std::vector<char> tree_entry_;
+  std::vector<TreePage> tree_pages_;
+
   static const int HEADER_SIZE = 20;
+  /** A compensation log record adds the undo-next LSN and the type of the compensating change to the header. */
+  static constexpr int CLR_HEADER_SIZE = sizeof(lsn_t) + sizeof(LogRecordType);
+  /** Each changed range of a delta update is prefixed by its offset and length. */
+  static constexpr uint32_t DELTA_RANGE_HEADER_SIZE = 2 * sizeof(uint32_t);
+  /** Index names are stored zero padded, like in the header page. */
+  static constexpr uint32_t INDEX_NAME_SIZE = 32;
+  /** The changed ranges of a B+ tree page are prefixed by its id, whether it is new and their number. */
+  static constexpr uint32_t TREE_PAGE_HEADER_SIZE = sizeof(page_id_t) + 2 * sizeof(uint32_t);
+
+  /** Collects the byte ranges where two tuples of the same size differ. */
+  void ComputeUpdateDelta(const Tuple &old_tuple, const Tuple &new_tuple) {
+    ComputeDelta(old_tuple.GetData(), new_tuple.GetData(), old_tuple.GetLength());
+  }
+
+  /** Collects the byte ranges where two buffers of the given size differ. */
+  void ComputeDelta(const char *old_data, const char *new_data, uint32_t size) {
+    uint32_t i = 0;
+    while (i < size) {
+      if (old_data[i] == new_data[i]) {
+        i++;
+        continue;
+      }
+      uint32_t end = i + 1;
+      // Extend the range over short runs of equal bytes, which are cheaper to repeat than a new range header.
+      for (uint32_t j = end; j < size && 2 * (j - end) <= DELTA_RANGE_HEADER_SIZE; j++) {
+        if (old_data[j] != new_data[j]) {
+          end = j + 1;
+        }
+      }
+      delta_ranges_.emplace_back(i, end - i);
+      delta_old_.insert(delta_old_.end(), old_data + i, old_data + end);
+      delta_new_.insert(delta_new_.end(), new_data + i, new_data + end);
+      i = end;
+    }
+  }
+
+  /** Writes range_count and the changed ranges to pos, returns the position after them. */
+  char *SerializeDelta(char *pos) const {
+    auto range_count = static_cast<uint32_t>(delta_ranges_.size());
+    memcpy(pos, &range_count, sizeof(uint32_t));
+    pos += sizeof(uint32_t);
+    const char *old_data = delta_old_.data();
+    const char *new_data = delta_new_.data();
+    for (const auto &[offset, length] : delta_ranges_) {
+      memcpy(pos, &offset, sizeof(uint32_t));
+      memcpy(pos + sizeof(uint32_t), &length, sizeof(uint32_t));
+      pos += DELTA_RANGE_HEADER_SIZE;
+      memcpy(pos, old_data, length);
+      memcpy(pos + length, new_data, length);
+      pos += 2 * length;
+      old_data += length;
+      new_data += length;
+    }
+    return pos;
+  }
+
+  /** Writes the B+ tree fields and the changed ranges of its pages to pos, returns the position after them. */
+  char *SerializeTree(char *pos) const {
+    memset(pos, 0, INDEX_NAME_SIZE);
+    memcpy(pos, index_name_.c_str(), index_name_.length());
+    pos += INDEX_NAME_SIZE;
+    memcpy(pos, &tree_layout_.key_size_, sizeof(uint32_t));
+    memcpy(pos + sizeof(uint32_t), &tree_layout_.entry_size_, sizeof(uint32_t));
+    memcpy(pos + 2 * sizeof(uint32_t), &tree_layout_.leaf_max_size_, sizeof(int32_t));
+    memcpy(pos + 3 * sizeof(uint32_t), &tree_layout_.internal_max_size_, sizeof(int32_t));
+    memcpy(pos + 4 * sizeof(uint32_t), &leaf_page_id_, sizeof(page_id_t));
+    memcpy(pos + 5 * sizeof(uint32_t), &entry_index_, sizeof(uint32_t));
+    pos += 6 * sizeof(uint32_t);
+    memcpy(pos, tree_entry_.data(), tree_entry_.size());
+    pos += tree_entry_.size();
+    auto page_count = static_cast<uint32_t>(tree_pages_.size());
+    memcpy(pos, &page_count, sizeof(uint32_t));
+    pos += sizeof(uint32_t);
+    auto range = delta_ranges_.begin();
+    const char *new_data = delta_new_.data();
+    for (const auto &tree_page : tree_pages_) {
+      uint32_t new_page = tree_page.new_page_ ? 1 : 0;
+      memcpy(pos, &tree_page.page_id_, sizeof(page_id_t));
+      memcpy(pos + sizeof(page_id_t), &new_page, sizeof(uint32_t));
+      memcpy(pos + sizeof(page_id_t) + sizeof(uint32_t), &tree_page.range_count_, sizeof(uint32_t));
+      pos += TREE_PAGE_HEADER_SIZE;
+      for (uint32_t i = 0; i < tree_page.range_count_; i++, range++) {
+        memcpy(pos, &range->first, sizeof(uint32_t));
+        memcpy(pos + sizeof(uint32_t), &range->second, sizeof(uint32_t));
+        pos += DELTA_RANGE_HEADER_SIZE;
+        memcpy(pos, new_data, range->second);
+        pos += range->second;
+        new_data += range->second;
+      }
+    }
+    return pos;
+  }
+
+  /** Reads the B+ tree fields and the changed ranges of its pages from pos, returns the position after them. */
+  const char *DeserializeTree(const char *pos) {
+    index_name_ = std::string(pos, strnlen(pos, INDEX_NAME_SIZE));
+    pos += INDEX_NAME_SIZE;
+    memcpy(&tree_layout_.key_size_, pos, sizeof(uint32_t));
+    memcpy(&tree_layout_.entry_size_, pos + sizeof(uint32_t), sizeof(uint32_t));
+    memcpy(&tree_layout_.leaf_max_size_, pos + 2 * sizeof(uint32_t), sizeof(int32_t));
+    memcpy(&tree_layout_.internal_max_size_, pos + 3 * sizeof(uint32_t), sizeof(int32_t));
+    memcpy(&leaf_page_id_, pos + 4 * sizeof(uint32_t), sizeof(page_id_t));
+    memcpy(&entry_index_, pos + 5 * sizeof(uint32_t), sizeof(uint32_t));
+    pos += 6 * sizeof(uint32_t);
+    tree_entry_.assign(pos, pos + tree_layout_.entry_size_);
+    pos += tree_layout_.entry_size_;
+    uint32_t page_count;
+    memcpy(&page_count, pos, sizeof(uint32_t));
+    pos += sizeof(uint32_t);
+    tree_pages_.resize(page_count);
+    for (auto &tree_page : tree_pages_) {
+      uint32_t new_page;
+      memcpy(&tree_page.page_id_, pos, sizeof(page_id_t));
+      memcpy(&new_page, pos + sizeof(page_id_t), sizeof(uint32_t));
+      memcpy(&tree_page.range_count_, pos + sizeof(page_id_t) + sizeof(uint32_t), sizeof(uint32_t));
+      tree_page.new_page_ = new_page != 0;
+      pos += TREE_PAGE_HEADER_SIZE;
+      for (uint32_t i = 0; i < tree_page.range_count_; i++) {
+        uint32_t offset;
+        uint32_t length;
+        memcpy(&offset, pos, sizeof(uint32_t));
+        memcpy(&length, pos + sizeof(uint32_t), sizeof(uint32_t));
+        pos += DELTA_RANGE_HEADER_SIZE;
+        delta_ranges_.emplace_back(offset, length);
+        delta_new_.insert(delta_new_.end(), pos, pos + length);
+        pos += length;
+      }
+    }
+    return pos;
+  }
+
+  /** Reads range_count and the changed ranges from pos, returns the position after them. */
+  const char *DeserializeDelta(const char *pos) {
+    uint32_t range_count;
+    memcpy(&range_count, pos, sizeof(uint32_t));
+    pos += sizeof(uint32_t);
+    delta_ranges_.resize(range_count);
+    for (auto &[offset, length] : delta_ranges_) {
+      memcpy(&offset, pos, sizeof(uint32_t));
+      memcpy(&length, pos + sizeof(uint32_t), sizeof(uint32_t));
+      pos += DELTA_RANGE_HEADER_SIZE;
+      delta_old_.insert(delta_old_.end(), pos, pos + length);
+      delta_new_.insert(delta_new_.end(), pos + length, pos + 2 * length);
+      pos += 2 * length;
+    }
+    return pos;
+  }
 };  // namespace bustub
 
 }  // namespace bustub
@@ -13,17 +13,45 @@
 #pragma once
 
 #include <algorithm>
+#include <functional>
 #include <mutex>  // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "recovery/log_manager.h"
 #include "recovery/log_record.h"
+#include "storage/page/hash_table_directory_page.h"
+#include "storage/page/table_page.h"
 
 namespace bustub {
 
 /**
  * Read log file from disk, redo and undo.
+ *
+ * Redo first runs an analysis pass over the log that finds the last complete fuzzy checkpoint. Only records at or
+ * after the checkpoint's redo point, i.e. the smallest recovery LSN in its dirty page table, are redone. The
+ * checkpoint is found through the header of the current log segment, so analysis starts at the segment holding it.
+ *
+ * Instead of Redo and Undo, an instant restart only runs the analysis pass before new transactions are admitted.
+ * Pages are redone lazily when the buffer pool first reads them, and loser transactions are rolled back in the
+ * background while holding exclusive locks on everything they changed.
+ *
+ * Hash index pages are redone physiologically like table pages. Index inserts and deletes of losers are undone
+ * logically, in the bucket the entry's hash maps to when undo runs, while splits and merges are never undone.
+ * B+ tree pages are redone the same way. Undo removes or inserts the entry of a loser's insert, delete or split
+ * through the tree again, which may split or merge pages on its own.
+ *
+ * Pages allocated before the crash may never have been written, so recovery reserves every page id it finds in the
+ * log before pages are allocated again.
+ *
+ * The rollback of an instant restart logs compensation log records (CLRs), which are redone but never undone, so
+ * that a crash during the rollback does not undo any change twice.
  */
 class LogRecovery {
  public:
@@ -33,6 +61,7 @@ class LogRecovery {
   }
 
   ~LogRecovery() {
+    WaitForInstantRestart();
     delete[] log_buffer_;
     log_buffer_ = nullptr;
   }
@@ -41,16 +70,141 @@ class LogRecovery {
   void Undo();
   bool DeserializeLogRecord(const char *data, LogRecord *log_record);
 
+  /**
+   * Starts an instant restart and returns as soon as the analysis pass is done. The log manager's flush thread is
+   * started and logging continues after the last LSN and transaction id found in the log. Pages with pending log
+   * records are redone on their first FetchPage, and a background thread redoes the rest. Another background thread
+   * rolls back the loser transactions, which reacquire exclusive locks on their write sets before this returns. The
+   * rollback is logged like a normal abort.
+   * @param log_manager the log manager new transactions and the rollback log to
+   * @param lock_manager the lock manager new transactions lock with
+   * @param txn_manager the transaction manager that admits new transactions
+   */
+  void StartInstantRestart(LogManager *log_manager, LockManager *lock_manager, TransactionManager *txn_manager);
+
+  /** Blocks until the background redo and undo of an instant restart have finished. */
+  void WaitForInstantRestart();
+
+  /**
+   * Replays the pending log records of a page that was just read from disk. Called by the buffer pool during an
+   * instant restart while holding the page's write latch.
+   * @param page the page read from disk
+   * @return true if the page was modified
+   */
+  bool RedoPage(Page *page);
+
+  /** @return the LSN that redo started from, i.e. the redo point of the last checkpoint (INVALID_LSN if none) */
+  inline lsn_t GetRedoLSN() { return redo_lsn_; }
+
  private:
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /**
+   * Reads the log sequentially starting at the given log offset, continuing into the following segments.
+   * @param offset log offset of the first log record to read
+   * @param visitor called with every complete log record and its log offset, returns false to stop the scan
+   */
+  void ScanLog(log_offset_t offset, const std::function<bool(LogRecord *, log_offset_t)> &visitor);
+
+  /** @return the log offset of the record with the given LSN, -1 if it is no longer in the log */
+  log_offset_t LocateLogRecord(lsn_t lsn);
+
+  /** Reads the single log record at the given file offset, independently of the shared log buffer. */
+  bool ReadLogRecord(log_offset_t offset, LogRecord *log_record);
+
+  /** Deserializes a log record that must fit into the size bytes at data. */
+  bool DeserializeLogRecord(const char *data, int size, LogRecord *log_record);
+
+  /**
+   * Scans the log from the last complete checkpoint, or from the oldest segment if there is none, to find the loser
+   * transactions and the redo point.
+   */
+  void Analysis();
+
+  /** @return the table page a log record changes, INVALID_PAGE_ID if it changes none */
+  static page_id_t GetRecordPageId(LogRecord *log_record);
+
+  /** @return every table or index page a log record changes */
+  static std::vector<page_id_t> GetRecordPageIds(LogRecord *log_record);
+
+  /**
+   * Reapplies the change of the log record to one of the pages it touches if the page has not seen it yet.
+   * @return true if the page was modified
+   */
+  bool RedoLogRecord(LogRecord *log_record, Page *page);
+
+  /** Reapplies a hash index change to one of the directory or bucket pages it touches. */
+  void RedoIndexLogRecord(LogRecord *log_record, Page *page);
+
+  /** Reapplies a B+ tree change to one of the pages it touches. */
+  void RedoTreeLogRecord(LogRecord *log_record, Page *page);
+
+  /**
+   * Rolls back a transaction by following its chain of log records.
+   * @param last_lsn the LSN of the last record of the transaction
+   * @param txn the transaction to log the rollback for, or nullptr to roll back without logging
+   */
+  void UndoTransaction(lsn_t last_lsn, Transaction *txn);
+
+  /** Reverts the change of the log record, logged as a CLR on behalf of txn unless it is nullptr. */
+  void UndoLogRecord(LogRecord *log_record, Transaction *txn);
+
+  /**
+   * Logs the compensating change made to a page as a CLR of txn.
+   * @param clr the record of the compensating change
+   * @param log_record the compensated record
+   * @param page the page changed, whose LSN is set
+   * @param txn the transaction rolled back
+   */
+  void AppendCompensation(LogRecord *clr, LogRecord *log_record, Page *page, Transaction *txn);
+
+  /**
+   * Reverts a hash index insert or delete in whatever bucket the entry's hash maps to now, logged on behalf of txn
+   * unless it is nullptr.
+   */
+  void UndoIndexLogRecord(LogRecord *log_record, Transaction *txn);
+
+  /**
+   * Reverts a B+ tree insert or delete, or the insert of a split, through the tree as it is when undo runs, logged on
+   * behalf of txn unless it is nullptr. The tree's key type is picked by the key size of the record.
+   */
+  void UndoTreeLogRecord(LogRecord *log_record, Transaction *txn);
+
+  template <size_t KeySize>
+  void UndoTreeLogRecord(LogRecord *log_record, Transaction *txn);
+
+  /** Background redo of an instant restart: reads every page that still has pending log records. */
+  void RedoPendingPages();
+
+  /**
+   * Background undo of an instant restart: rolls back and aborts the loser transactions, then releases their locks.
+   * @param losers the loser transactions with the LSN of their last record in the log
+   */
+  void AbortLosers(std::vector<std::pair<Transaction *, lsn_t>> losers);
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  /** Log, lock and transaction managers of an instant restart, nullptr for an offline Redo and Undo. */
+  LogManager *log_manager_{nullptr};
+  LockManager *lock_manager_{nullptr};
+  TransactionManager *txn_manager_{nullptr};
 
   /** Maintain active transactions and its corresponding latest lsn. */
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
-  /** Mapping the log sequence number to log file offset for undos. */
-  std::unordered_map<lsn_t, int> lsn_mapping_;
+  /** Mapping the log sequence number to log offset for undos. */
+  std::unordered_map<lsn_t, log_offset_t> lsn_mapping_;
+  /** The log records still to be redone for every page, as file offsets in log order. */
+  std::unordered_map<page_id_t, std::vector<log_offset_t>> page_records_;
+  std::mutex page_records_latch_;
+  /** The LSN redo starts from. */
+  lsn_t redo_lsn_{INVALID_LSN};
+  /** The largest LSN and transaction id found in the log. */
+  lsn_t max_lsn_{INVALID_LSN};
+  txn_id_t max_txn_id_{INVALID_TXN_ID};
+
+  /** Background threads of an instant restart. */
+  std::thread redo_thread_;
+  std::thread undo_thread_;
 
-  int offset_ __attribute__((__unused__));
+  log_offset_t offset_;
   char *log_buffer_;
 };
 
@@ -15,7 +15,9 @@
 #include <atomic>
 #include <fstream>
 #include <future>  // NOLINT
-#include <mutex>   // NOLINT
+#include <map>
+#include <mutex>  // NOLINT
+#include <set>
 #include <string>
 
 #include "common/config.h"
@@ -25,9 +27,20 @@ namespace bustub {
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * The log is split into fixed-size segment files named after the log file plus a segment number. Every segment starts
+ * with a header holding its number, the LSN of its first record and the LSN of the last complete checkpoint. Log
+ * offsets are logical: segment number * LOG_SEGMENT_DATA_SIZE + position after the header. They are 64 bits wide,
+ * since recycled segments keep counting up and the offsets outgrow an int after 2 GB of log. Log records never span
+ * two segments. Segments that are no longer needed by recovery are recycled as preallocated spares.
  */
 class DiskManager {
  public:
+  /** Size of the header at the start of every log segment. */
+  static constexpr int LOG_SEGMENT_HEADER_SIZE = 512;
+  /** Log bytes a segment can hold. */
+  static constexpr int LOG_SEGMENT_DATA_SIZE = LOG_SEGMENT_SIZE - LOG_SEGMENT_HEADER_SIZE;
+
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
@@ -56,20 +69,51 @@ class DiskManager {
   void ReadPage(page_id_t page_id, char *page_data);
 
   /**
-   * Flush the entire log buffer into disk.
+   * Flush the entire log buffer into disk, appending to the current log segment.
    * @param log_data raw log data
    * @param size size of log entry
    */
   void WriteLog(char *log_data, int size);
 
   /**
-   * Read a log entry from the log file.
+   * Read a log entry from the log file. Reads never cross a segment, the remainder of the buffer is zeroed.
    * @param[out] log_data output buffer
    * @param size size of the log entry
-   * @param offset offset of the log entry in the file
-   * @return true if the read was successful, false otherwise
+   * @param offset log offset of the log entry
+   * @return true if the read was successful, false otherwise (i.e. no segment holds the offset)
+   */
+  bool ReadLog(char *log_data, int size, log_offset_t offset);
+
+  /**
+   * Starts a new log segment, reusing a preallocated spare if there is one. Subsequent log writes go to it.
+   * @param start_lsn the LSN of the first record that will be written to the segment
+   */
+  void StartLogSegment(lsn_t start_lsn);
+
+  /**
+   * Records the last complete checkpoint in the header of the current log segment and of all future ones.
+   * @param checkpoint_lsn the LSN of the begin record of the checkpoint
+   */
+  void SetLogCheckpoint(lsn_t checkpoint_lsn);
+
+  /** @return the LSN of the begin record of the last complete checkpoint, INVALID_LSN if there is none */
+  lsn_t GetLogCheckpointLSN();
+
+  /**
+   * Recycles or deletes every log segment that only holds records before the given LSN. The current segment is kept.
+   * @param lsn the oldest LSN that recovery still needs
+   */
+  void TruncateLog(lsn_t lsn);
+
+  /**
+   * Finds the log segment holding a record.
+   * @param lsn the LSN of the record
+   * @return the log offset of the first record of the segment holding lsn, -1 if no segment does
    */
-  bool ReadLog(char *log_data, int size, int offset);
+  log_offset_t FindLogSegment(lsn_t lsn);
+
+  /** @return the log offset of the first record of the oldest log segment, -1 if there is no log */
+  log_offset_t GetLogStartOffset();
 
   /** @return the number of disk flushes */
   int GetNumFlushes() const;
@@ -80,6 +124,9 @@ class DiskManager {
   /** @return the number of disk writes */
   int GetNumWrites() const;
 
+  /** @return the number of pages in the database file, i.e. one more than the largest page id written */
+  int GetNumPages();
+
   /**
    * Sets the future which is used to check for non-blocking flushes.
    * @param f the non-blocking flush check
@@ -91,9 +138,27 @@ class DiskManager {
 
  private:
   int GetFileSize(const std::string &file_name);
-  // stream to write log file
+  /** @return the file name of a log segment */
+  std::string GetLogSegmentName(int segment) const;
+  /** Writes the header of the current log segment, which marks its data area as empty if it was just started. */
+  void WriteLogSegmentHeader(bool clear_data);
+  /** Opens a log segment for reading, reusing the open stream if possible. */
+  bool OpenLogSegmentForRead(int segment);
+
+  // stream to write the current log segment
   std::fstream log_io_;
   std::string log_name_;
+  // stream to read older log segments
+  std::ifstream log_read_io_;
+  int log_read_segment_{-1};
+  // segment number to LSN of its first record, for every segment holding log records
+  std::map<int, lsn_t> log_segments_;
+  // preallocated segments ready for reuse, numbered after the newest segment
+  std::set<int> log_spares_;
+  // the segment log writes go to, and the write position in its data area
+  int log_segment_{-1};
+  int log_segment_offset_{0};
+  lsn_t log_checkpoint_lsn_{INVALID_LSN};
   // stream to write db file
   std::fstream db_io_;
   std::string file_name_;
@@ -103,6 +168,8 @@ class DiskManager {
   std::future<void> *flush_log_f_;
   // With multiple buffer pool instances, need to protect file access
   std::mutex db_io_latch_;
+  // Log records are read by recovery threads while the flush thread appends to the log
+  std::mutex log_io_latch_;
 };
 
 }  // namespace bustub
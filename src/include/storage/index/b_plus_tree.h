@@ -10,11 +10,15 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <functional>
 #include <queue>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "concurrency/transaction.h"
+#include "recovery/log_manager.h"
+#include "storage/index/external_sorter.h"
 #include "storage/index/index_iterator.h"
 #include "storage/page/b_plus_tree_internal_page.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
@@ -32,6 +36,24 @@ namespace bustub {
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
+ *
+ * The tree is thread safe. Lookups crab read latches from the root down, latching a child before releasing its
+ * parent. Inserts and removes first descend the same way but write latch the leaf, which is all they change unless
+ * the leaf has to split or merge. Only then they descend again, crabbing write latches and keeping those on the
+ * ancestors a split or merge may reach, up to the root latch when the root may change. Leaves are latched from
+ * left to right among siblings, the order iterators go in. A merge unlatches the pages of a level before it latches
+ * siblings on the level above, so that it never waits for a page above while keeping a leaf from an iterator.
+ *
+ * A leaf splits once it reaches its max size, an internal page once it exceeds it: internal pages hold one entry
+ * more than their max size while they split, which the default max size leaves room for.
+ *
+ * Changes made on behalf of a transaction are logged if the tree has a log manager. An insert or delete that only
+ * changes its leaf logs the entry, which redo puts into or takes out of the leaf again. An insert that splits logs
+ * the changed bytes of every page it changes in one record, before any of them is unlatched. A merge logs every
+ * level as a redo only record of its own before it unlatches the level, which leaves the tree searchable if the
+ * log ends in between. Undo inserts or removes the entry of a record through the tree again. Moving children to
+ * another parent is not logged, so parent page ids are only hints: splits and merges find the parents among the
+ * ancestors they latched.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTree {
@@ -40,20 +62,28 @@ class BPlusTree {
 
  public:
   explicit BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE);
+                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE,
+                     LogManager *log_manager = nullptr);
+
+  // Open a tree built before, whose root page id is recorded in the header page. Returns false if there is none.
+  bool LoadRootPageId();
 
   // Returns true if this B+ tree has no keys and values.
   bool IsEmpty() const;
 
-  // Insert a key-value pair into this B+ tree.
-  bool Insert(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
+  // Insert a key-value pair into this B+ tree. A rollback passes the undo-next LSN of the record it compensates.
+  bool Insert(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr,
+              lsn_t undo_next_lsn = INVALID_LSN);
 
-  // Remove a key and its value from this B+ tree.
-  void Remove(const KeyType &key, Transaction *transaction = nullptr);
+  // Remove a key and its value from this B+ tree. A rollback passes the undo-next LSN of the record it compensates.
+  void Remove(const KeyType &key, Transaction *transaction = nullptr, lsn_t undo_next_lsn = INVALID_LSN);
 
   // return the value associated with a given key
   bool GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr);
 
+  // Build this B+ tree from key-value pairs in any order, packing its pages bottom up.
+  void BulkLoad(const std::function<bool(MappingType *)> &next_entry, double fill_factor = BULK_LOAD_FILL_FACTOR);
+
   // index iterator
   INDEXITERATOR_TYPE Begin();
   INDEXITERATOR_TYPE Begin(const KeyType &key);
@@ -76,33 +106,110 @@ class BPlusTree {
 
   // read data from file and remove one by one
   void RemoveFromFile(const std::string &file_name, Transaction *transaction = nullptr);
-  // expose for test purpose
+  // expose for test purpose, the leaf is returned pinned and read latched
   Page *FindLeafPage(const KeyType &key, bool leftMost = false);
 
  private:
-  void StartNewTree(const KeyType &key, const ValueType &value);
+  /** What a descent to a leaf is for, which decides the latches it takes. */
+  enum class Operation { READ, INSERT, REMOVE };
+
+  /** A page changed by a split or merge, pinned with its image from before the change until the change is logged. */
+  struct ChangedPage {
+    Page *page_;
+    /** True if the page was allocated by the change. */
+    bool new_page_;
+    /** True if the page is kept write latched until the change is logged. */
+    bool latched_;
+    std::vector<char> old_data_;
+  };
+
+  /**
+   * Descends to the leaf holding a key, crabbing the latches.
+   * @param key the key to look for
+   * @param op the operation the leaf is looked for
+   * @param left_most true to find the left most leaf instead
+   * @param[out] ancestors nullptr to read latch the inner pages, write latching the leaf unless op is READ, else
+   * the write latched ancestors of the leaf a split or merge may reach, nullptr standing for the root latch
+   * @return the leaf pinned and latched, nullptr if the tree is empty
+   */
+  Page *FindLeaf(const KeyType &key, Operation op, bool left_most, std::vector<Page *> *ancestors);
+
+  /** @return true if an operation on a child of the page cannot split or merge it */
+  bool IsSafe(BPlusTreePage *node, Operation op, bool is_root) const;
+
+  /** Unlatches and unpins the ancestors kept by FindLeaf(). */
+  void ReleaseAncestors(std::vector<Page *> *ancestors, bool is_dirty);
 
-  bool InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
+  void StartNewTree(const KeyType &key, const ValueType &value, std::vector<ChangedPage> *changes);
+
+  void BulkLoadLeaf(MappingType *entries, int size, Page **last_leaf,
+                    std::vector<std::pair<KeyType, page_id_t>> *parents);
+
+  void BulkLoadInternal(std::pair<KeyType, page_id_t> *children, int size,
+                        std::vector<std::pair<KeyType, page_id_t>> *parents);
+
+  bool InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction, lsn_t undo_next_lsn);
+
+  void RemoveFromLeaf(const KeyType &key, Transaction *transaction, lsn_t undo_next_lsn);
+
+  /** Removes the key from its latched leaf and logs it. @return true if the leaf held the key */
+  bool RemoveEntry(Page *page, const KeyType &key, Transaction *transaction, lsn_t undo_next_lsn);
 
   void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
-                        Transaction *transaction = nullptr);
+                        const std::vector<Page *> &ancestors, size_t parent_index, std::vector<ChangedPage> *changes);
 
   template <typename N>
-  N *Split(N *node);
+  N *Split(N *node, std::vector<ChangedPage> *changes);
 
   template <typename N>
-  bool CoalesceOrRedistribute(N *node, Transaction *transaction = nullptr);
+  bool CoalesceOrRedistribute(Page *page, Page *parent_page, std::vector<page_id_t> *deleted_pages,
+                              Transaction *transaction);
 
   template <typename N>
-  bool Coalesce(N **neighbor_node, N **node, BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent,
-                int index, Transaction *transaction = nullptr);
+  void Coalesce(N *neighbor_node, N *node, InternalPage *parent, int index, std::vector<page_id_t> *deleted_pages);
 
   template <typename N>
-  void Redistribute(N *neighbor_node, N *node, int index);
+  void Redistribute(N *neighbor_node, N *node, InternalPage *parent, int index);
+
+  bool AdjustRoot(BPlusTreePage *node, std::vector<ChangedPage> *changes);
 
-  bool AdjustRoot(BPlusTreePage *node);
+  void UpdateRootPageId(int insert_record, std::vector<ChangedPage> *changes);
+
+  /** @return true if changes made on behalf of the transaction are logged */
+  inline bool IsLogging(Transaction *transaction) const {
+    return enable_logging && log_manager_ != nullptr && transaction != nullptr;
+  }
 
-  void UpdateRootPageId(int insert_record = 0);
+  /** @return what log recovery needs to know about this tree */
+  BPlusTreeLayout GetLayout() const;
+
+  /**
+   * Pins a page and keeps its image before a split or merge changes it, unless it is kept already.
+   * @param new_page true if the change allocated the page
+   * @param latched true if the caller latched the page for the change, to be unlatched once it is logged
+   * @param changes the pages changed so far, nullptr if the change is not logged
+   */
+  void TrackPage(Page *page, bool new_page, bool latched, std::vector<ChangedPage> *changes);
+
+  /**
+   * Logs the changed bytes of the pages of a split or merge, sets their LSN, then unlatches the pages latched for
+   * the change and unpins them all. Nothing is logged if no page changed.
+   * @param log_record_type BTREE_SPLIT, or BTREE_MERGE which is not part of the transaction
+   * @param entry the entry inserted by a split, nullptr for a merge
+   * @param changes the pages changed, nullptr if the change is not logged
+   */
+  void LogChanges(LogRecordType log_record_type, const MappingType *entry, Transaction *transaction,
+                  lsn_t undo_next_lsn, std::vector<ChangedPage> *changes);
+
+  /**
+   * Logs inserting an entry into its latched leaf or removing it, after the change, and sets the leaf's LSN.
+   * @param log_record_type BTREE_INSERT or BTREE_DELETE
+   */
+  void LogEntry(LogRecordType log_record_type, Page *page, const KeyType &key, const ValueType &value,
+                Transaction *transaction, lsn_t undo_next_lsn);
+
+  /** Appends a log record made on behalf of the transaction, as a CLR if undo_next_lsn is valid. @return its LSN */
+  lsn_t AppendLogRecord(Transaction *transaction, LogRecord *log_record, lsn_t undo_next_lsn);
 
   /* Debug Routines for FREE!! */
   void ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstream &out) const;
@@ -116,6 +223,9 @@ class BPlusTree {
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
+  /** Latched to read or change root_page_id_, it stands for the parent of the root. */
+  mutable ReaderWriterLatch root_latch_;
+  LogManager *log_manager_;
 };
 
 }  // namespace bustub
@@ -16,6 +16,7 @@
 #include <string>
 #include <vector>
 
+#include "concurrency/key_range_lock.h"
 #include "storage/index/b_plus_tree.h"
 #include "storage/index/index.h"
 
@@ -23,17 +24,49 @@ namespace bustub {
 
 #define BPLUSTREE_INDEX_TYPE BPlusTreeIndex<KeyType, ValueType, KeyComparator>
 
+/**
+ * BPlusTreeIndex is an ordered index. Given a lock manager, it locks the key ranges transactions read and write so
+ * that REPEATABLE_READ scans see no phantoms: scans and lookups lock what they read in shared mode, inserts and
+ * deletes lock their key in exclusive mode. Snapshot transactions do not lock what they read, optimistic and serial
+ * transactions lock nothing.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
  public:
-  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager);
+  /**
+   * @param metadata the metadata of the index
+   * @param buffer_pool_manager the buffer pool holding the tree
+   * @param lock_manager the lock manager of the transactions, nullptr to not lock key ranges
+   * @param log_manager the log manager the changes of transactions are logged to, nullptr to not log them
+   */
+  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                 LockManager *lock_manager = nullptr, LogManager *log_manager = nullptr);
 
+  /** Inserts an entry. A transaction that cannot lock the key is aborted and the entry is not inserted. */
   void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
+  /** Deletes an entry. A transaction that cannot lock the key is aborted and the entry is not deleted. */
   void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  /**
+   * Builds the tree from the entries sorted by key rather than one at a time. The index must not be in use yet, so
+   * no key is locked.
+   */
+  void BulkLoad(const std::function<bool(Tuple *, RID *)> &next_entry, Transaction *transaction) override;
+
+  /**
+   * Scans the entries with keys from low to high, both included. The range stays locked until the transaction ends,
+   * so no other transaction can insert into it in between.
+   * @param low the smallest key to scan
+   * @param high the largest key to scan
+   * @param[out] result the RIDs of the entries in key order
+   * @param transaction the scanning transaction
+   * @return false if the transaction was aborted while locking the range
+   */
+  bool ScanRange(const Tuple &low, const Tuple &high, std::vector<RID> *result, Transaction *transaction);
+
   INDEXITERATOR_TYPE GetBeginIterator();
 
   INDEXITERATOR_TYPE GetBeginIterator(const KeyType &key);
@@ -41,10 +74,22 @@ class BPlusTreeIndex : public Index {
   INDEXITERATOR_TYPE GetEndIterator();
 
  protected:
+  /** @return true if the transaction locks the keys it writes */
+  bool LocksWrites(Transaction *transaction) const {
+    return lock_manager_ != nullptr && enable_logging && transaction != nullptr && transaction->TakesLocks();
+  }
+
+  /** @return true if the transaction locks the keys it reads */
+  bool LocksReads(Transaction *transaction) const {
+    return LocksWrites(transaction) && transaction->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ;
+  }
+
   // comparator for key
   KeyComparator comparator_;
   // container
   BPlusTree<KeyType, ValueType, KeyComparator> container_;
+  LockManager *lock_manager_;
+  KeyRangeLockTable<KeyType, KeyComparator> range_locks_;
 };
 
 }  // namespace bustub
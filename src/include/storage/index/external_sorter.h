@@ -0,0 +1,220 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// external_sorter.h
+//
+// Identification: src/include/storage/index/external_sorter.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/config.h"
+#include "common/exception.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * ExternalSorter sorts fixed size records that may not fit in memory, to build indexes from. It holds a budget of
+ * pages worth of records in memory: records beyond are sorted that many at a time into runs, which are written to
+ * pages of the buffer pool, and so to disk once the pool needs their frames. The runs are then merged, as many at a
+ * time as the budget holds a page of each, until the last merge streams the records out in order. The pages of the
+ * runs are deleted as they are read.
+ */
+template <typename Record>
+class ExternalSorter {
+ public:
+  /** Orders the records. */
+  using Less = std::function<bool(const Record &, const Record &)>;
+
+  /** The number of records a page of a run holds. */
+  static constexpr size_t RECORDS_PER_PAGE = PAGE_SIZE / sizeof(Record);
+
+  /**
+   * @param buffer_pool_manager the buffer pool to write the runs to
+   * @param less orders the records
+   * @param memory_pages the pages worth of records held in memory, at least three
+   */
+  ExternalSorter(BufferPoolManager *buffer_pool_manager, Less less, size_t memory_pages = SORT_MEMORY_PAGES)
+      : buffer_pool_manager_(buffer_pool_manager),
+        less_(std::move(less)),
+        memory_pages_(std::max<size_t>(memory_pages, 3)) {}
+
+  /** Deletes the pages of the runs not read. */
+  ~ExternalSorter() {
+    for (auto &run : runs_) {
+      for (page_id_t page_id : run.pages_) {
+        buffer_pool_manager_->DeletePage(page_id);
+      }
+    }
+  }
+
+  DISALLOW_COPY_AND_MOVE(ExternalSorter);
+
+  /** Adds a record to sort. */
+  void Add(const Record &record) {
+    records_.push_back(record);
+    if (records_.size() == memory_pages_ * RECORDS_PER_PAGE) {
+      runs_.emplace_back();
+      std::sort(records_.begin(), records_.end(), less_);
+      WriteRun(records_.data(), records_.size(), &runs_.back());
+      records_.clear();
+    }
+  }
+
+  /** Sorts the records added, Next() returns them in order afterwards. */
+  void Sort() {
+    std::sort(records_.begin(), records_.end(), less_);
+    if (runs_.empty()) {
+      return;
+    }
+    if (!records_.empty()) {
+      runs_.emplace_back();
+      WriteRun(records_.data(), records_.size(), &runs_.back());
+    }
+    std::vector<Record>().swap(records_);
+
+    // A page of every run merged and one of the merged run fit in memory.
+    size_t fan_in = memory_pages_ - 1;
+    while (runs_.size() > fan_in) {
+      Run merged;
+      StartMerge(fan_in);
+      std::vector<Record> page;
+      Record record;
+      while (NextMerged(&record)) {
+        page.push_back(record);
+        if (page.size() == RECORDS_PER_PAGE) {
+          WriteRun(page.data(), page.size(), &merged);
+          page.clear();
+        }
+      }
+      WriteRun(page.data(), page.size(), &merged);
+      runs_.erase(runs_.begin(), runs_.begin() + fan_in);
+      runs_.push_back(std::move(merged));
+    }
+    StartMerge(runs_.size());
+  }
+
+  /**
+   * Gets the next record in order, after Sort().
+   * @param[out] record the next record
+   * @return false once there are no more records
+   */
+  bool Next(Record *record) {
+    if (!runs_.empty()) {
+      return NextMerged(record);
+    }
+    if (next_ == records_.size()) {
+      return false;
+    }
+    *record = records_[next_++];
+    return true;
+  }
+
+ private:
+  /** A sorted run of records written to pages. */
+  struct Run {
+    /** The pages not read yet, in order. */
+    std::deque<page_id_t> pages_;
+    /** The number of records in the pages not read yet. */
+    size_t size_{0};
+    /** The records of the page read last, and the next of them to merge. */
+    std::vector<Record> page_;
+    size_t next_{0};
+  };
+
+  /** Appends records to the pages of a run. */
+  void WriteRun(const Record *records, size_t count, Run *run) {
+    for (size_t begin = 0; begin < count; begin += RECORDS_PER_PAGE) {
+      size_t end = std::min(count, begin + RECORDS_PER_PAGE);
+      page_id_t page_id;
+      Page *page = buffer_pool_manager_->NewPage(&page_id);
+      if (page == nullptr) {
+        throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate a page for a sorted run.");
+      }
+      std::copy(records + begin, records + end, reinterpret_cast<Record *>(page->GetData()));
+      buffer_pool_manager_->UnpinPage(page_id, true);
+      run->pages_.push_back(page_id);
+      run->size_ += end - begin;
+    }
+  }
+
+  /** Reads the next page of a run once its records are merged. @return false if the run is merged entirely */
+  bool ReadRun(Run *run) {
+    if (run->next_ < run->page_.size()) {
+      return true;
+    }
+    if (run->pages_.empty()) {
+      return false;
+    }
+    page_id_t page_id = run->pages_.front();
+    size_t count = std::min(run->size_, RECORDS_PER_PAGE);
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    if (page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot fetch a page of a sorted run.");
+    }
+    auto *records = reinterpret_cast<Record *>(page->GetData());
+    run->page_.assign(records, records + count);
+    run->next_ = 0;
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    buffer_pool_manager_->DeletePage(page_id);
+    run->pages_.pop_front();
+    run->size_ -= count;
+    return true;
+  }
+
+  /** Starts merging the first runs. */
+  void StartMerge(size_t count) {
+    merging_.clear();
+    for (size_t i = 0; i < count; i++) {
+      if (ReadRun(&runs_[i])) {
+        merging_.push_back(&runs_[i]);
+      }
+    }
+    std::make_heap(merging_.begin(), merging_.end(), [this](Run *a, Run *b) { return Greater(a, b); });
+  }
+
+  /** Takes the least record of the runs merged. @return false once they are merged entirely */
+  bool NextMerged(Record *record) {
+    if (merging_.empty()) {
+      return false;
+    }
+    auto greater = [this](Run *a, Run *b) { return Greater(a, b); };
+    std::pop_heap(merging_.begin(), merging_.end(), greater);
+    Run *run = merging_.back();
+    *record = run->page_[run->next_++];
+    if (ReadRun(run)) {
+      std::push_heap(merging_.begin(), merging_.end(), greater);
+    } else {
+      merging_.pop_back();
+    }
+    return true;
+  }
+
+  /** Orders the runs merged, a min heap by their next record. */
+  bool Greater(Run *a, Run *b) const { return less_(b->page_[b->next_], a->page_[a->next_]); }
+
+  BufferPoolManager *buffer_pool_manager_;
+  Less less_;
+  size_t memory_pages_;
+  /** The records sorted in memory, and the next of them to return when there are no runs. */
+  std::vector<Record> records_;
+  size_t next_{0};
+  /** The runs not merged yet, which the merged ones are appended to. */
+  std::deque<Run> runs_;
+  /** A heap of the runs being merged. */
+  std::vector<Run *> merging_;
+};
+
+}  // namespace bustub
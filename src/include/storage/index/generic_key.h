@@ -19,45 +19,76 @@
 
 namespace bustub {
 
+/**
+ * KeyCodec encodes keys so that comparing two of them is a memcmp of their bytes, which orders them column by column
+ * as their values. Integers are written big endian with their sign bit flipped, timestamps big endian, and decimals
+ * with their sign bit flipped if positive, or all their bits if negative. Varchars are written as a byte telling nulls
+ * apart, then their characters with zero bytes escaped as 0x00 0xFF, then a 0x00 0x00 terminator, so that a string
+ * sorts before the longer ones it is a prefix of. Nulls of the other types are written as the values standing for
+ * them, and sort where those do.
+ */
+class KeyCodec {
+ public:
+  /**
+   * Encodes a key tuple, zero padding the rest of the buffer.
+   * @throw Exception if the encoded key does not fit the buffer
+   */
+  static void Encode(const Tuple &key, const Schema &key_schema, char *data, size_t size);
+
+  /** @return the value of a column of an encoded key */
+  static Value Decode(const char *data, const Schema &key_schema, uint32_t column_idx);
+
+  /** Encodes a bigint into 8 bytes. */
+  static void EncodeBigInt(int64_t value, char *data);
+
+  /** @return the bigint encoded in 8 bytes */
+  static int64_t DecodeBigInt(const char *data);
+
+  /** Encodes an integer into 4 bytes. */
+  static void EncodeInteger(int32_t value, char *data);
+
+  /** @return the integer encoded in 4 bytes */
+  static int32_t DecodeInteger(const char *data);
+};
+
 /**
  * Generic key is used for indexing with opaque data.
  *
  * This key type uses an fixed length array to hold data for indexing
  * purposes, the actual size of which is specified and instantiated
- * with a template argument.
+ * with a template argument. The key is held encoded by KeyCodec.
  */
 template <size_t KeySize>
 class GenericKey {
  public:
-  inline void SetFromKey(const Tuple &tuple) {
-    // intialize to 0
-    memset(data_, 0, KeySize);
-    memcpy(data_, tuple.GetData(), tuple.GetLength());
+  inline void SetFromKey(const Tuple &tuple, const Schema &key_schema) {
+    KeyCodec::Encode(tuple, key_schema, data_, KeySize);
   }
 
   // NOTE: for test purpose only
+  // a key shorter than a bigint holds the value as an integer
   inline void SetFromInteger(int64_t key) {
     memset(data_, 0, KeySize);
-    memcpy(data_, &key, sizeof(int64_t));
+    if constexpr (KeySize < sizeof(int64_t)) {
+      KeyCodec::EncodeInteger(static_cast<int32_t>(key), data_);
+    } else {
+      KeyCodec::EncodeBigInt(key, data_);
+    }
   }
 
   inline Value ToValue(Schema *schema, uint32_t column_idx) const {
-    const char *data_ptr;
-    const auto &col = schema->GetColumn(column_idx);
-    const TypeId column_type = col.GetType();
-    const bool is_inlined = col.IsInlined();
-    if (is_inlined) {
-      data_ptr = (data_ + col.GetOffset());
-    } else {
-      int32_t offset = *reinterpret_cast<int32_t *>(const_cast<char *>(data_ + col.GetOffset()));
-      data_ptr = (data_ + offset);
-    }
-    return Value::DeserializeFrom(data_ptr, column_type);
+    return KeyCodec::Decode(data_, *schema, column_idx);
   }
 
   // NOTE: for test purpose only
-  // interpret the first 8 bytes as int64_t from data vector
-  inline int64_t ToString() const { return *reinterpret_cast<int64_t *>(const_cast<char *>(data_)); }
+  // interpret the first 8 bytes as int64_t from data vector, or the first 4 as an integer if the key is shorter
+  inline int64_t ToString() const {
+    if constexpr (KeySize < sizeof(int64_t)) {
+      return KeyCodec::DecodeInteger(data_);
+    } else {
+      return KeyCodec::DecodeBigInt(data_);
+    }
+  }
 
   // NOTE: for test purpose only
   // interpret the first 8 bytes as int64_t from data vector
@@ -70,6 +101,41 @@ class GenericKey {
   char data_[KeySize];
 };
 
+/** Compares encoded keys byte by byte. @return -1, 0 or 1 as lhs is less than, equal to or greater than rhs */
+template <size_t KeySize>
+inline int CompareEncodedKeys(const char *lhs, const char *rhs) {
+  int cmp = memcmp(lhs, rhs, KeySize);
+  return (cmp > 0) - (cmp < 0);
+}
+
+/** A key of 4 bytes is usually a single integer, compared as a word. */
+template <>
+inline int CompareEncodedKeys<4>(const char *lhs, const char *rhs) {
+  uint32_t lhs_word;
+  uint32_t rhs_word;
+  memcpy(&lhs_word, lhs, sizeof(uint32_t));
+  memcpy(&rhs_word, rhs, sizeof(uint32_t));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  lhs_word = __builtin_bswap32(lhs_word);
+  rhs_word = __builtin_bswap32(rhs_word);
+#endif
+  return (lhs_word > rhs_word) - (lhs_word < rhs_word);
+}
+
+/** A key of 8 bytes is usually a single bigint, compared as a word. */
+template <>
+inline int CompareEncodedKeys<8>(const char *lhs, const char *rhs) {
+  uint64_t lhs_word;
+  uint64_t rhs_word;
+  memcpy(&lhs_word, lhs, sizeof(uint64_t));
+  memcpy(&rhs_word, rhs, sizeof(uint64_t));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  lhs_word = __builtin_bswap64(lhs_word);
+  rhs_word = __builtin_bswap64(rhs_word);
+#endif
+  return (lhs_word > rhs_word) - (lhs_word < rhs_word);
+}
+
 /**
  * Function object returns true if lhs < rhs, used for trees
  */
@@ -77,21 +143,7 @@ template <size_t KeySize>
 class GenericComparator {
  public:
   inline int operator()(const GenericKey<KeySize> &lhs, const GenericKey<KeySize> &rhs) const {
-    uint32_t column_count = key_schema_->GetColumnCount();
-
-    for (uint32_t i = 0; i < column_count; i++) {
-      Value lhs_value = (lhs.ToValue(key_schema_, i));
-      Value rhs_value = (rhs.ToValue(key_schema_, i));
-
-      if (lhs_value.CompareLessThan(rhs_value) == CmpBool::CmpTrue) {
-        return -1;
-      }
-      if (lhs_value.CompareGreaterThan(rhs_value) == CmpBool::CmpTrue) {
-        return 1;
-      }
-    }
-    // equals
-    return 0;
+    return CompareEncodedKeys<KeySize>(lhs.data_, rhs.data_);
   }
 
   GenericComparator(const GenericComparator &other) : key_schema_{other.key_schema_} {}
@@ -100,6 +152,7 @@ class GenericComparator {
   explicit GenericComparator(Schema *key_schema) : key_schema_(key_schema) {}
 
  private:
+  // The keys are encoded to compare without it.
   Schema *key_schema_;
 };
 
@@ -12,12 +12,14 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "catalog/schema.h"
+#include "common/config.h"
 #include "storage/table/tuple.h"
 #include "type/value.h"
 
@@ -175,6 +177,60 @@ class Index {
    */
   virtual void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) = 0;
 
+  ///////////////////////////////////////////////////////////////////
+  // Batched Operations
+  ///////////////////////////////////////////////////////////////////
+
+  /**
+   * Insert a batch of entries into the index. Indexes that insert a batch faster than one entry at a time override
+   * this, the entries may be inserted in any order.
+   * @param entries The index keys and the RIDs associated with them
+   * @param transaction The transaction context
+   */
+  virtual void InsertEntries(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction) {
+    for (const auto &[key, rid] : entries) {
+      InsertEntry(key, rid, transaction);
+    }
+  }
+
+  /**
+   * Search the index for a batch of keys. Indexes that look up a batch faster than one key at a time override this.
+   * @param keys The index keys
+   * @param results The collections of RIDs that are populated with the results of each key, in the order of the keys
+   * @param transaction The transaction context
+   */
+  virtual void ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                        Transaction *transaction) {
+    results->assign(keys.size(), std::vector<RID>());
+    for (size_t i = 0; i < keys.size(); i++) {
+      ScanKey(keys[i], &(*results)[i], transaction);
+    }
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  // Bulk Loading
+  ///////////////////////////////////////////////////////////////////
+
+  /**
+   * Build the index over existing data from all of its entries. Indexes that build faster from the whole set of
+   * entries than by inserting them override this, by default the entries are inserted INDEX_BATCH_SIZE at a time.
+   * @param next_entry Stores the next index key and its RID and returns true, returns false once there are no more
+   * @param transaction The transaction context
+   */
+  virtual void BulkLoad(const std::function<bool(Tuple *, RID *)> &next_entry, Transaction *transaction) {
+    std::vector<std::pair<Tuple, RID>> entries;
+    Tuple key;
+    RID rid;
+    while (next_entry(&key, &rid)) {
+      entries.emplace_back(key, rid);
+      if (entries.size() == static_cast<size_t>(INDEX_BATCH_SIZE)) {
+        InsertEntries(entries, transaction);
+        entries.clear();
+      }
+    }
+    InsertEntries(entries, transaction);
+  }
+
  private:
   /** The Index structure owns its metadata */
   std::unique_ptr<IndexMetadata> metadata_;
@@ -13,31 +13,64 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include "common/macros.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
 
 namespace bustub {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+/**
+ * IndexIterator walks the leaves of a B+ tree in key order. It keeps its current leaf pinned and read latched, and
+ * latches the next leaf before it lets go of the current one, so that it never misses entries moved between the two.
+ * Writers to the tree wait for the leaf it is on, the thread holding an iterator must not write to the tree.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
+  using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+
  public:
-  // you may define your own constructor based on your member variables
+  /** Creates an iterator past the last entry. */
   IndexIterator();
+
+  /**
+   * @param buffer_pool_manager the buffer pool holding the tree
+   * @param page the leaf to start on, pinned and read latched, the iterator releases it
+   * @param index the entry of the leaf to start at, may be past its last one
+   */
+  IndexIterator(BufferPoolManager *buffer_pool_manager, Page *page, int index);
+
   ~IndexIterator();
 
+  DISALLOW_COPY(IndexIterator);
+
+  IndexIterator(IndexIterator &&other) noexcept;
+
+  IndexIterator &operator=(IndexIterator &&other) noexcept;
+
   bool IsEnd();
 
   const MappingType &operator*();
 
   IndexIterator &operator++();
 
-  bool operator==(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  bool operator==(const IndexIterator &itr) const {
+    return page_ == itr.page_ && (page_ == nullptr || index_ == itr.index_);
+  }
 
-  bool operator!=(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  bool operator!=(const IndexIterator &itr) const { return !(*this == itr); }
 
  private:
-  // add your own private member variables here
+  /** Moves on to the next leaves until the index is at an entry, or the leaves run out. */
+  void SkipEmptyLeaves();
+
+  /** Unlatches and unpins the current leaf. */
+  void Release();
+
+  BufferPoolManager *buffer_pool_manager_{nullptr};
+  /** The current leaf, nullptr past the last entry. */
+  Page *page_{nullptr};
+  int index_{0};
 };
 
 }  // namespace bustub
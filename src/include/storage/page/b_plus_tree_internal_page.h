@@ -57,10 +57,13 @@ class BPlusTreeInternalPage : public BPlusTreePage {
   void MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                          BufferPoolManager *buffer_pool_manager);
 
- private:
+  // Bulk load utility method
   void CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager);
+
+ private:
   void CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
   void CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
+  void Adopt(const ValueType &child, BufferPoolManager *buffer_pool_manager);
   MappingType array_[0];
 };
 }  // namespace bustub
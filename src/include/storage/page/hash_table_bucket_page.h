@@ -25,13 +25,23 @@ namespace bustub {
  * non-unique keys.
  *
  * Bucket page format (keys are stored in order):
- *  ----------------------------------------------------------------
- * | KEY(1) + VALUE(1) | KEY(2) + VALUE(2) | ... | KEY(n) + VALUE(n)
- *  ----------------------------------------------------------------
+ *  -------------------------------------------------------------------------
+ * | HEADER | KEY(1) + VALUE(1) | KEY(2) + VALUE(2) | ... | KEY(n) + VALUE(n)
+ *  -------------------------------------------------------------------------
+ *
+ *  The 8 byte header holds the next overflow page and keeps the page LSN at the
+ *  same offset as every other page. Overflow pages are bucket pages chained from
+ *  a bucket for the entries a split could not tell apart, see
+ *  ExtendibleHashTable.
  *
  *  Here '+' means concatenation.
  *  The above format omits the space required for the occupied_ and
- *  readable_ arrays. More information is in storage/page/hash_table_page_defs.h.
+ *  readable_ arrays and the fingerprints_ of the keys. More information is in
+ *  storage/page/hash_table_page_defs.h.
+ *
+ *  Lookups compare the fingerprints of a group of entries at once with SIMD
+ *  instructions and only call the comparator on the entries whose fingerprint
+ *  matches. Free entries are found by scanning the bitmaps a byte at a time.
  *
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
@@ -53,16 +63,18 @@ class HashTableBucketPage {
    *
    * @param key key to insert
    * @param value value to insert
+   * @param[out] bucket_idx if not nullptr, the index the pair was inserted at
    * @return true if inserted, false if duplicate KV pair or bucket is full
    */
-  bool Insert(KeyType key, ValueType value, KeyComparator cmp);
+  bool Insert(KeyType key, ValueType value, KeyComparator cmp, uint32_t *bucket_idx = nullptr);
 
   /**
    * Removes a key and value.
    *
+   * @param[out] bucket_idx if not nullptr, the index the pair was removed from
    * @return true if removed, false if not found
    */
-  bool Remove(KeyType key, ValueType value, KeyComparator cmp);
+  bool Remove(KeyType key, ValueType value, KeyComparator cmp, uint32_t *bucket_idx = nullptr);
 
   /**
    * Gets the key at an index in the bucket.
@@ -140,11 +152,55 @@ class HashTableBucketPage {
    */
   void PrintBucket();
 
+  /** @return the page id of the next overflow page in the bucket's chain, INVALID_PAGE_ID if there is none */
+  page_id_t GetOverflowPageId() const { return HashTableBucketLayout::GetOverflowPageId(header_); }
+
+  /** Chains an overflow page after this page, or ends the chain here with INVALID_PAGE_ID. */
+  void SetOverflowPageId(page_id_t overflow_page_id) {
+    HashTableBucketLayout::SetOverflowPageId(header_, overflow_page_id);
+  }
+
+  /** @return the byte layout of this bucket page type, as logged for recovery */
+  static HashTableBucketLayout GetLayout();
+
  private:
+  /** The number of entries whose fingerprints are compared at once. */
+#ifdef __AVX2__
+  static constexpr uint32_t GROUP_SIZE = 32;
+#else
+  static constexpr uint32_t GROUP_SIZE = 16;
+#endif
+
+  /** @return the fingerprint of a key */
+  static uint8_t FingerprintOf(const KeyType &key);
+
+  /** @return the bits of a bitmap for the GROUP_SIZE entries from group_start on */
+  static uint32_t GroupBits(const char *bitmap, uint32_t group_start);
+
+  /** @return a bit for each of the GROUP_SIZE entries from group_start on whose fingerprint is fingerprint */
+  uint32_t MatchFingerprints(uint32_t group_start, uint8_t fingerprint) const;
+
+  /**
+   * Calls visit(bucket_idx) on the readable entries with the fingerprint until it returns true.
+   * @return the index visit returned true for, BUCKET_ARRAY_SIZE if it never did
+   */
+  template <typename Visitor>
+  uint32_t ForEachMatch(uint8_t fingerprint, Visitor visit) const;
+
+  /** @return the index of the entry holding the pair, BUCKET_ARRAY_SIZE if there is none */
+  uint32_t FindEntry(const KeyType &key, const ValueType &value, KeyComparator cmp, uint8_t fingerprint) const;
+
+  /** @return the first index that is not readable, BUCKET_ARRAY_SIZE if the bucket is full */
+  uint32_t FirstFreeIndex() const;
+
+  // Next overflow page and LSN, the LSN is set through Page::SetLSN.
+  char header_[HashTableBucketLayout::OFFSET_OCCUPIED];
   //  For more on BUCKET_ARRAY_SIZE see storage/page/hash_table_page_defs.h
   char occupied_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
   // 0 if tombstone/brand new (never occupied), 1 otherwise.
   char readable_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
+  // The fingerprint of the key of each occupied entry, see HashTableBucketLayout::Fingerprint.
+  uint8_t fingerprints_[BUCKET_ARRAY_SIZE];
   MappingType array_[0];
 };
 
@@ -30,6 +30,9 @@ namespace bustub {
  * --------------------------------------------------------------------------------------------
  * | LSN (4) | PageId(4) | GlobalDepth(4) | LocalDepths(512) | BucketPageIds(2048) | Free(1524)
  * --------------------------------------------------------------------------------------------
+ *
+ * The header page of a table is a directory page too, whose entries point to directory pages instead of buckets.
+ * It is indexed by the DIRECTORY_MAX_DEPTH hash bits above the ones the directories use, see HashToHeaderIndex.
  */
 class HashTableDirectoryPage {
  public:
@@ -99,6 +102,15 @@ class HashTableDirectoryPage {
    */
   uint32_t GetGlobalDepthMask();
 
+  /**
+   * Maps a hash to an index of this page as the header page of a table. The directories use the low
+   * DIRECTORY_MAX_DEPTH bits of the hash, the header the global depth bits above them.
+   *
+   * @param hash the hash of a key
+   * @return the header index of the directory page the key's bucket is found through
+   */
+  uint32_t HashToHeaderIndex(uint32_t hash);
+
   /**
    * GetLocalDepthMask - same as global depth mask, except it
    * uses the local depth of the bucket located at bucket_idx
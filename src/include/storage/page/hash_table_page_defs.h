@@ -12,6 +12,12 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+
+#include "common/config.h"
+#include "common/util/hash_util.h"
+
 #define MappingType std::pair<KeyType, ValueType>
 
 /**
@@ -33,12 +39,92 @@
  */
 #define HASH_TABLE_BUCKET_TYPE HashTableBucketPage<KeyType, ValueType, KeyComparator>
 #define DIRECTORY_ARRAY_SIZE 512
+/** The largest global depth of a directory page, DIRECTORY_ARRAY_SIZE is 2^DIRECTORY_MAX_DEPTH. */
+#define DIRECTORY_MAX_DEPTH 9
 
 /**
  * BUCKET_ARRAY_SIZE is the number of (key, value) pairs that can be stored in an extendible hashing bucket page.
  * It is an approximate calculation based on the size of MappingType (which is a std::pair of KeyType and ValueType).
- * For each key/value pair, we need two additional bits for occupied_ and readable_. 4 * (PAGE_SIZE - 4) / (4 * sizeof
- * (MappingType) + 1) = (PAGE_SIZE - 4)/(sizeof (MappingType) + 0.25) because 0.25 bytes = 2 bits is the space required
- * to maintain the occupied and readable flags for a key value pair.
+ * For each key/value pair, we need two additional bits for occupied_ and readable_ and a byte for its fingerprint.
+ * 4 * (PAGE_SIZE - 8) / (4 * sizeof (MappingType) + 5) = (PAGE_SIZE - 8)/(sizeof (MappingType) + 1.25) because 1.25
+ * bytes = 2 bits + 1 byte is the space required to maintain the flags and the fingerprint of a key value pair. The
+ * first 8 bytes hold the page header with the next overflow page and the page LSN.
+ */
+#define BUCKET_ARRAY_SIZE (4 * (PAGE_SIZE - 8) / (4 * sizeof(MappingType) + 5))
+
+namespace bustub {
+
+/**
+ * The byte layout of an extendible hashing bucket page, which lets log recovery redo and undo changes to bucket pages
+ * without knowing their key and value types. A bucket page starts with an 8 byte header, followed by the occupied_
+ * and readable_ bitmaps, the fingerprints of the keys and the array of entries. Every entry starts with its key.
  */
-#define BUCKET_ARRAY_SIZE (4 * PAGE_SIZE / (4 * sizeof(MappingType) + 1))
+struct HashTableBucketLayout {
+  /** The header starts with the id of the next overflow page plus one, so that a zeroed page has none. */
+  static constexpr uint32_t OFFSET_OVERFLOW = 0;
+  static constexpr uint32_t OFFSET_OCCUPIED = 8;
+
+  /** The number of entries, i.e. BUCKET_ARRAY_SIZE. */
+  uint32_t capacity_{0};
+  /** The size of an entry, i.e. sizeof(MappingType). */
+  uint32_t entry_size_{0};
+  /** The offset of the first entry in the page. */
+  uint32_t array_offset_{0};
+  /** The size of the key at the start of an entry, i.e. sizeof(KeyType). */
+  uint32_t key_size_{0};
+
+  /**
+   * The fingerprint kept for a key, the top byte of the hash of its bytes without their zero padding. Lookups only
+   * compare the keys whose fingerprint matches, which are equal to the key they look for only once in 256 times
+   * unless they are.
+   */
+  static inline uint8_t Fingerprint(const char *key, uint32_t key_size) {
+    return static_cast<uint8_t>(HashUtil::HashBytes(key, HashUtil::TrimZeroPadding(key, key_size)) >> 56);
+  }
+
+  static inline page_id_t GetOverflowPageId(const char *data) {
+    page_id_t next;
+    memcpy(&next, data + OFFSET_OVERFLOW, sizeof(next));
+    return next - 1;
+  }
+
+  static inline void SetOverflowPageId(char *data, page_id_t overflow_page_id) {
+    page_id_t next = overflow_page_id + 1;
+    memcpy(data + OFFSET_OVERFLOW, &next, sizeof(next));
+  }
+
+  inline uint32_t ReadableOffset() const { return OFFSET_OCCUPIED + (capacity_ - 1) / 8 + 1; }
+
+  inline uint32_t FingerprintOffset() const { return ReadableOffset() + (capacity_ - 1) / 8 + 1; }
+
+  inline bool IsOccupied(const char *data, uint32_t bucket_idx) const {
+    return 1 & (data[OFFSET_OCCUPIED + bucket_idx / 8] >> (bucket_idx % 8));
+  }
+
+  inline bool IsReadable(const char *data, uint32_t bucket_idx) const {
+    return 1 & (data[ReadableOffset() + bucket_idx / 8] >> (bucket_idx % 8));
+  }
+
+  inline void SetOccupied(char *data, uint32_t bucket_idx) const {
+    data[OFFSET_OCCUPIED + bucket_idx / 8] |= 1 << (bucket_idx % 8);
+  }
+
+  inline void SetReadable(char *data, uint32_t bucket_idx, bool readable) const {
+    if (readable) {
+      data[ReadableOffset() + bucket_idx / 8] |= 1 << (bucket_idx % 8);
+    } else {
+      data[ReadableOffset() + bucket_idx / 8] &= ~(1 << (bucket_idx % 8));
+    }
+  }
+
+  inline char *EntryAt(char *data, uint32_t bucket_idx) const {
+    return data + array_offset_ + bucket_idx * entry_size_;
+  }
+
+  /** Sets the fingerprint of the entry at bucket_idx from its key. */
+  inline void SetFingerprint(char *data, uint32_t bucket_idx) const {
+    data[FingerprintOffset() + bucket_idx] = static_cast<char>(Fingerprint(EntryAt(data, bucket_idx), key_size_));
+  }
+};
+
+}  // namespace bustub
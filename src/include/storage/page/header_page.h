@@ -19,12 +19,13 @@ namespace bustub {
 /**
  * Database use the first page (page_id = 0) as header page to store metadata, in
  * our case, we will contain information about table/index name (length less than
- * 32 bytes) and their corresponding root_id
+ * 32 bytes) and their corresponding root_id. B+ trees log the changes of their
+ * root_id, so the page keeps its LSN where every page does.
  *
  * Format (size in byte):
- *  -----------------------------------------------------------------
- * | RecordCount (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
- *  -----------------------------------------------------------------
+ *  -----------------------------------------------------------------------------
+ * | RecordCount (4) | LSN (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
+ *  -----------------------------------------------------------------------------
  */
 class HeaderPage : public Page {
  public:
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -63,8 +64,15 @@ class Page {
   /** @return the page LSN. */
   inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + OFFSET_LSN); }
 
-  /** Sets the page LSN. */
-  inline void SetLSN(lsn_t lsn) { memcpy(GetData() + OFFSET_LSN, &lsn, sizeof(lsn_t)); }
+  /** Sets the page LSN. The first LSN set since the page was last written out becomes its recovery LSN. */
+  inline void SetLSN(lsn_t lsn) {
+    memcpy(GetData() + OFFSET_LSN, &lsn, sizeof(lsn_t));
+    lsn_t no_rec_lsn = INVALID_LSN;
+    rec_lsn_.compare_exchange_strong(no_rec_lsn, lsn);
+  }
+
+  /** @return the LSN of the first log record that dirtied the page since it was last written to disk */
+  inline lsn_t GetRecLSN() { return rec_lsn_; }
 
  protected:
   static_assert(sizeof(page_id_t) == 4);
@@ -86,6 +94,8 @@ class Page {
   int pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
   bool is_dirty_ = false;
+  /** The recovery LSN, i.e. the oldest log record whose change may not be on disk yet. Used for checkpointing. */
+  std::atomic<lsn_t> rec_lsn_ = INVALID_LSN;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
@@ -40,6 +40,7 @@ namespace bustub {
  *  | TupleCount (4) | Tuple_1 offset (4) | Tuple_1 size (4) | ... |
  *  ----------------------------------------------------------------
  *
+ * Operations performed without a transaction replay the log during recovery: they are neither locked nor logged.
  */
 class TablePage : public Page {
  public:
@@ -77,7 +78,7 @@ class TablePage : public Page {
    * @param tuple tuple to insert
    * @param[out] rid rid of the inserted tuple
    * @param txn transaction performing the insert
-   * @param lock_manager the lock manager
+   * @param lock_manager the lock manager, nullptr if the transaction's table lock covers the new tuple
    * @param log_manager the log manager
    * @return true if the insert is successful (i.e. there is enough space)
    */
@@ -87,7 +88,7 @@ class TablePage : public Page {
    * Mark a tuple as deleted. This does not actually delete the tuple.
    * @param rid rid of the tuple to mark as deleted
    * @param txn transaction performing the delete
-   * @param lock_manager the lock manager
+   * @param lock_manager the lock manager, nullptr if the caller has locked the tuple
    * @param log_manager the log manager
    * @return true if marking the tuple as deleted is successful (i.e the tuple exists)
    */
@@ -99,7 +100,7 @@ class TablePage : public Page {
    * @param[out] old_tuple old value of the tuple
    * @param rid rid of the tuple
    * @param txn transaction performing the update
-   * @param lock_manager the lock manager
+   * @param lock_manager the lock manager, nullptr if the caller has locked the tuple
    * @param log_manager the log manager
    * @return true if updating the tuple succeeded
    */
@@ -112,12 +113,21 @@ class TablePage : public Page {
   /** To be called on abort. Rollback a delete, i.e. this reverses a MarkDelete. */
   void RollbackDelete(const RID &rid, Transaction *txn, LogManager *log_manager);
 
+  /**
+   * To be called on recovery. Puts a tuple back into the slot it was inserted into or removed from by ApplyDelete,
+   * without logging. Other tuples keep their rids, which an insert into the first free slot would not guarantee.
+   * @param tuple the tuple to put back
+   * @param rid rid of the tuple, its slot must be free or the next new one
+   * @return true if the slot was free and the page has enough space
+   */
+  bool RestoreTuple(const Tuple &tuple, const RID &rid);
+
   /**
    * Read a tuple from a table.
    * @param rid rid of the tuple to read
    * @param[out] tuple the tuple that was read
    * @param txn transaction performing the read
-   * @param lock_manager the lock manager
+   * @param lock_manager the lock manager, nullptr if the caller has locked the tuple
    * @return true if the read is successful (i.e. the tuple exists)
    */
   bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager);
@@ -126,16 +136,18 @@ class TablePage : public Page {
 
   /**
    * @param[out] first_rid the RID of the first tuple in this page
+   * @param include_deleted also return deleted tuples and empty slots, snapshots may still see older versions there
    * @return true if the first tuple exists, false otherwise
    */
-  bool GetFirstTupleRid(RID *first_rid);
+  bool GetFirstTupleRid(RID *first_rid, bool include_deleted = false);
 
   /**
    * @param cur_rid the RID of the current tuple
    * @param[out] next_rid the RID of the tuple following the current tuple
+   * @param include_deleted also return deleted tuples and empty slots
    * @return true if the next tuple exists, false otherwise
    */
-  bool GetNextTupleRid(const RID &cur_rid, RID *next_rid);
+  bool GetNextTupleRid(const RID &cur_rid, RID *next_rid, bool include_deleted = false);
 
  private:
   static_assert(sizeof(page_id_t) == 4);
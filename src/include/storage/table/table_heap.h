@@ -12,7 +12,10 @@
 
 #pragma once
 
+#include <optional>
+
 #include "buffer/buffer_pool_manager.h"
+#include "concurrency/version_store.h"
 #include "recovery/log_manager.h"
 #include "storage/page/table_page.h"
 #include "storage/table/table_iterator.h"
@@ -23,6 +26,12 @@ namespace bustub {
 /**
  * TableHeap represents a physical table on disk.
  * This is just a doubly-linked list of pages.
+ *
+ * The pages hold the newest version of every tuple, older versions are kept in the version store of the heap for
+ * transactions under snapshot isolation. Those read without taking any locks.
+ *
+ * Optimistic transactions do not lock either. They read the newest committed versions and record them in their read
+ * set, and they buffer their updates and deletes until they are validated at commit. Inserts happen right away.
  */
 class TableHeap {
   friend class TableIterator;
@@ -46,9 +55,10 @@ class TableHeap {
    * @param lock_manager the lock manager
    * @param log_manager the log manager
    * @param txn the creating transaction
+   * @param table_oid the oid of the table in the catalog, tuples are then locked through the table
    */
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-            Transaction *txn);
+            Transaction *txn, std::optional<table_oid_t> table_oid = std::nullopt);
 
   /**
    * Insert a tuple into the table. If the tuple is too large (>= page_size), return false.
@@ -108,11 +118,67 @@ class TableHeap {
   /** @return the id of the first page of this table */
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
+  /**
+   * Locks the whole table if the transaction locks tuples through the table.
+   * @param txn the transaction
+   * @param lock_mode the table lock mode
+   * @return false if the transaction is aborted
+   */
+  bool LockTable(Transaction *txn, LockMode lock_mode);
+
+  /** @return the older versions of the tuples of this table */
+  inline VersionStore *GetVersionStore() { return &version_store_; }
+
  private:
+  /** @return true if the transaction reads the versions of its snapshot */
+  static bool ReadsSnapshot(Transaction *txn) {
+    return txn != nullptr && !txn->IsOptimistic() && txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT;
+  }
+
+  /** @return true if the transaction reads from the version store instead of locking */
+  static bool ReadsVersions(Transaction *txn) { return txn != nullptr && (txn->IsOptimistic() || ReadsSnapshot(txn)); }
+
+  /** @return true if the transaction buffers its updates and deletes until it commits */
+  static bool BuffersWrites(Transaction *txn) {
+    return txn != nullptr && txn->IsOptimistic() && txn->GetState() == TransactionState::GROWING;
+  }
+
+  /** @return the lock manager the table pages lock tuples with, nullptr if they must not */
+  LockManager *PageLockManager(Transaction *txn) const {
+    return LocksThroughTable(txn) || (txn != nullptr && !txn->TakesLocks()) ? nullptr : lock_manager_;
+  }
+
+  /**
+   * Reads the version of a tuple visible to the snapshot of txn, or the newest committed one if txn is optimistic.
+   * Optimistic transactions record the read in their read set. The rid is taken by value, iterators pass the rid of
+   * the tuple they read into.
+   */
+  bool GetVersionedTuple(RID rid, Tuple *tuple, Transaction *txn);
+
+  /** Buffers an update or delete of an optimistic transaction, false if the tuple does not exist. */
+  bool BufferWrite(const RID &rid, WType wtype, const Tuple &tuple, Transaction *txn);
+
+  /** Aborts a read-only transaction that tries to write and throws a TransactionAbortException. */
+  static void RejectReadOnlyWrite(Transaction *txn);
+
+  /**
+   * Aborts a snapshot transaction that is about to overwrite a version it cannot see.
+   * @return true if the transaction was aborted
+   */
+  bool AbortOnWriteConflict(const RID &rid, Transaction *txn);
+
+  /** @return true if the transaction locks tuples through the table, otherwise the table pages lock them */
+  bool LocksThroughTable(Transaction *txn) const {
+    return table_oid_.has_value() && enable_logging && txn != nullptr && txn->TakesLocks();
+  }
+
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_{};
+  /** The catalog oid of the table, tuples are locked row by row by the table pages without one. */
+  std::optional<table_oid_t> table_oid_;
+  VersionStore version_store_;
 };
 
 }  // namespace bustub
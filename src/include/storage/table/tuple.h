@@ -16,6 +16,7 @@
 #include <vector>
 
 #include "catalog/schema.h"
+#include "common/arena.h"
 #include "common/rid.h"
 #include "type/value.h"
 
@@ -48,6 +49,18 @@ class Tuple {
   // assign operator, deep copy
   Tuple &operator=(const Tuple &other);
 
+  // move constructor, takes over the data
+  Tuple(Tuple &&other) noexcept;
+
+  // move assign operator, takes over the data
+  Tuple &operator=(Tuple &&other) noexcept;
+
+  // copy into the arena, the copy does not own its data and is valid until the arena is reset
+  Tuple CopyTo(Arena *arena) const;
+
+  // deep copy, also of a tuple that does not own its data
+  Tuple DeepCopy() const;
+
   ~Tuple() {
     if (allocated_) {
       delete[] data_;
@@ -82,7 +95,7 @@ class Tuple {
     Value value = GetValue(schema, column_idx);
     return value.IsNull();
   }
-  inline bool IsAllocated() { return allocated_; }
+  inline bool IsAllocated() const { return allocated_; }
 
   std::string ToString(const Schema *schema) const;
 
@@ -12,16 +12,95 @@
 
 #include "recovery/checkpoint_manager.h"
 
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
 namespace bustub {
 
 void CheckpointManager::BeginCheckpoint() {
   // Block all the transactions and ensure that both the WAL and all dirty buffer pool pages are persisted to disk,
   // creating a consistent checkpoint. Do NOT allow transactions to resume at the end of this method, resume them
   // in CheckpointManager::EndCheckpoint() instead. This is for grading purposes.
+  transaction_manager_->BlockAllTransactions();
+  log_manager_->ForceFlush(log_manager_->GetNextLSN() - 1);
+  buffer_pool_manager_->FlushAllPages();
 }
 
 void CheckpointManager::EndCheckpoint() {
   // Allow transactions to resume, completing the checkpoint.
+  transaction_manager_->ResumeTransactions();
+}
+
+lsn_t CheckpointManager::BeginFuzzyCheckpoint() {
+  std::scoped_lock lock(latch_);
+  if (checkpoint_thread_ != nullptr) {
+    checkpoint_thread_->join();
+    delete checkpoint_thread_;
+    checkpoint_thread_ = nullptr;
+  }
+  if (!enable_logging) {
+    return INVALID_LSN;
+  }
+
+  LogRecord begin_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::BEGIN_CHECKPOINT);
+  lsn_t begin_lsn = log_manager_->AppendLogRecord(&begin_record);
+
+  // Every page dirtied before the begin record is in this snapshot, so writing them out lets recovery skip
+  // everything before the begin record. Sort them to write the database file sequentially.
+  std::unordered_map<page_id_t, lsn_t> dirty_page_table;
+  buffer_pool_manager_->GetDirtyPageTable(&dirty_page_table);
+  std::vector<page_id_t> dirty_pages;
+  dirty_pages.reserve(dirty_page_table.size());
+  for (const auto &entry : dirty_page_table) {
+    dirty_pages.push_back(entry.first);
+  }
+  std::sort(dirty_pages.begin(), dirty_pages.end());
+
+  checkpoint_thread_ = new std::thread(&CheckpointManager::RunFuzzyCheckpoint, this, begin_lsn, std::move(dirty_pages));
+  return begin_lsn;
+}
+
+void CheckpointManager::WaitForFuzzyCheckpoint() {
+  std::scoped_lock lock(latch_);
+  if (checkpoint_thread_ != nullptr) {
+    checkpoint_thread_->join();
+    delete checkpoint_thread_;
+    checkpoint_thread_ = nullptr;
+  }
+}
+
+void CheckpointManager::RunFuzzyCheckpoint(lsn_t begin_lsn, std::vector<page_id_t> dirty_pages) {
+  size_t flushed = 0;
+  for (page_id_t page_id : dirty_pages) {
+    // Pages that were evicted in the meantime have already been written out.
+    if (buffer_pool_manager_->FlushPageFuzzy(page_id) && checkpoint_flush_batch > 0 &&
+        ++flushed % checkpoint_flush_batch == 0) {
+      std::this_thread::sleep_for(checkpoint_flush_interval);
+    }
+  }
+
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns;
+  transaction_manager_->GetActiveTransactionTable(&active_txns);
+  std::unordered_map<page_id_t, lsn_t> dirty_page_table;
+  buffer_pool_manager_->GetDirtyPageTable(&dirty_page_table);
+
+  // Recovery redoes from the oldest recovery LSN and undoes running transactions back to their first record.
+  lsn_t truncate_lsn = begin_lsn;
+  for (const auto &entry : dirty_page_table) {
+    truncate_lsn = std::min(truncate_lsn, entry.second);
+  }
+  lsn_t oldest_active_lsn = transaction_manager_->GetOldestActiveLSN();
+  if (oldest_active_lsn != INVALID_LSN) {
+    truncate_lsn = std::min(truncate_lsn, oldest_active_lsn);
+  }
+
+  LogRecord end_record(INVALID_TXN_ID, begin_lsn, LogRecordType::END_CHECKPOINT, std::move(active_txns),
+                       std::vector<std::pair<page_id_t, lsn_t>>(dirty_page_table.begin(), dirty_page_table.end()));
+  lsn_t end_lsn = log_manager_->AppendLogRecord(&end_record);
+  log_manager_->ForceFlush(end_lsn);
+  log_manager_->CompleteCheckpoint(begin_lsn, truncate_lsn);
+  last_checkpoint_lsn_ = begin_lsn;
 }
 
 }  // namespace bustub
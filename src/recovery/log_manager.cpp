@@ -22,33 +22,211 @@ namespace bustub {
  *
  * This thread runs forever until system shutdown/StopFlushThread
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  if (enable_logging) {
+    return;
+  }
+  enable_logging = true;
+  flush_thread_ = new std::thread([this] {
+    std::unique_lock<std::mutex> lock(latch_);
+    while (enable_logging) {
+      cv_.wait_for(lock, log_timeout, [this] { return need_flush_ || !enable_logging; });
+      FlushLogBuffer(&lock);
+    }
+    // Drain whatever was appended before the thread was stopped.
+    FlushLogBuffer(&lock);
+  });
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  if (flush_thread_ == nullptr) {
+    return;
+  }
+  {
+    std::scoped_lock lock(latch_);
+    enable_logging = false;
+  }
+  cv_.notify_one();
+  flush_thread_->join();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
+}
+
+void LogManager::FlushLogBuffer(std::unique_lock<std::mutex> *lock) {
+  need_flush_ = false;
+  if (log_buffer_offset_ == 0) {
+    flushed_cv_.notify_all();
+    return;
+  }
+  // Swap the buffers so that appenders can keep going while the full buffer is written out.
+  std::swap(log_buffer_, flush_buffer_);
+  int flush_size = log_buffer_offset_;
+  lsn_t last_lsn = next_lsn_ - 1;
+  log_buffer_offset_ = 0;
+  lsn_t segment_start_lsn = segment_start_lsn_;
+  segment_start_lsn_ = INVALID_LSN;
+
+  lock->unlock();
+  if (segment_start_lsn != INVALID_LSN) {
+    disk_manager_->StartLogSegment(segment_start_lsn);
+  }
+  disk_manager_->WriteLog(flush_buffer_, flush_size);
+  lock->lock();
+
+  persistent_lsn_ = last_lsn;
+  flushed_cv_.notify_all();
+}
+
+void LogManager::ForceFlush(lsn_t lsn) {
+  std::unique_lock<std::mutex> lock(latch_);
+  // Nothing beyond the last appended record can ever become persistent.
+  lsn = std::min<lsn_t>(lsn, next_lsn_ - 1);
+  while (enable_logging && persistent_lsn_ < lsn) {
+    need_flush_ = true;
+    cv_.notify_one();
+    flushed_cv_.wait(lock);
+  }
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
- *
- *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
  */
-lsn_t LogManager::AppendLogRecord(LogRecord *log_record) { return INVALID_LSN; }
+lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
+  BUSTUB_ASSERT(log_record->size_ <= LOG_BUFFER_SIZE, "Log record does not fit into the log buffer.");
+  std::unique_lock<std::mutex> lock(latch_);
+  // If the log buffer is full, wake up the flush thread and wait for it to swap in an empty one.
+  while (log_buffer_offset_ + log_record->size_ > LOG_BUFFER_SIZE) {
+    need_flush_ = true;
+    cv_.notify_one();
+    flushed_cv_.wait(lock);
+  }
+  // Log records never span two segments: write out the records of the current segment before starting a new one.
+  if (segment_offset_ + log_record->size_ > DiskManager::LOG_SEGMENT_DATA_SIZE) {
+    while (log_buffer_offset_ > 0) {
+      need_flush_ = true;
+      cv_.notify_one();
+      flushed_cv_.wait(lock);
+    }
+    segment_start_lsn_ = next_lsn_;
+    segment_offset_ = 0;
+  }
+  log_record->lsn_ = next_lsn_++;
+  SerializeLogRecord(log_record, log_buffer_ + log_buffer_offset_);
+  log_buffer_offset_ += log_record->size_;
+  segment_offset_ += log_record->size_;
+  appended_bytes_.fetch_add(log_record->size_, std::memory_order_relaxed);
+  return log_record->lsn_;
+}
+
+void LogManager::CompleteCheckpoint(lsn_t checkpoint_lsn, lsn_t truncate_lsn) {
+  disk_manager_->SetLogCheckpoint(checkpoint_lsn);
+  disk_manager_->TruncateLog(truncate_lsn);
+}
+
+void LogManager::SerializeLogRecord(LogRecord *log_record, char *dest) {
+  // First, serialize the must have fields (20 bytes in total).
+  memcpy(dest, &log_record->size_, sizeof(int32_t));
+  memcpy(dest + 4, &log_record->lsn_, sizeof(lsn_t));
+  memcpy(dest + 8, &log_record->txn_id_, sizeof(txn_id_t));
+  memcpy(dest + 12, &log_record->prev_lsn_, sizeof(lsn_t));
+  char *pos = dest + LogRecord::HEADER_SIZE;
+  if (log_record->compensation_) {
+    LogRecordType clr_type = LogRecordType::CLR;
+    memcpy(dest + 16, &clr_type, sizeof(LogRecordType));
+    memcpy(pos, &log_record->undo_next_lsn_, sizeof(lsn_t));
+    memcpy(pos + sizeof(lsn_t), &log_record->log_record_type_, sizeof(LogRecordType));
+    pos += LogRecord::CLR_HEADER_SIZE;
+  } else {
+    memcpy(dest + 16, &log_record->log_record_type_, sizeof(LogRecordType));
+  }
+
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(pos, &log_record->insert_rid_, sizeof(RID));
+      log_record->insert_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(pos, &log_record->delete_rid_, sizeof(RID));
+      log_record->delete_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(pos, &log_record->update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.SerializeTo(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.SerializeTo(pos);
+      break;
+    case LogRecordType::UPDATE_DELTA:
+      memcpy(pos, &log_record->update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      memcpy(pos, &log_record->tuple_size_, sizeof(uint32_t));
+      log_record->SerializeDelta(pos + sizeof(uint32_t));
+      break;
+    case LogRecordType::HASH_INSERT:
+    case LogRecordType::HASH_DELETE:
+    case LogRecordType::HASH_SPLIT:
+    case LogRecordType::HASH_MERGE: {
+      memcpy(pos, &log_record->directory_page_id_, sizeof(page_id_t));
+      memcpy(pos + sizeof(page_id_t), &log_record->bucket_page_id_, sizeof(page_id_t));
+      memcpy(pos + 2 * sizeof(page_id_t), &log_record->new_bucket_page_id_, sizeof(page_id_t));
+      pos += 3 * sizeof(page_id_t);
+      memcpy(pos, &log_record->bucket_layout_.capacity_, sizeof(uint32_t));
+      memcpy(pos + sizeof(uint32_t), &log_record->bucket_layout_.entry_size_, sizeof(uint32_t));
+      memcpy(pos + 2 * sizeof(uint32_t), &log_record->bucket_layout_.array_offset_, sizeof(uint32_t));
+      memcpy(pos + 3 * sizeof(uint32_t), &log_record->bucket_layout_.key_size_, sizeof(uint32_t));
+      memcpy(pos + 4 * sizeof(uint32_t), &log_record->hash_, sizeof(uint32_t));
+      auto entry_count = static_cast<uint32_t>(log_record->bucket_indexes_.size());
+      memcpy(pos + 5 * sizeof(uint32_t), &entry_count, sizeof(uint32_t));
+      pos += 6 * sizeof(uint32_t);
+      uint32_t entry_size = log_record->bucket_layout_.entry_size_;
+      for (uint32_t i = 0; i < entry_count; i++) {
+        memcpy(pos, &log_record->bucket_indexes_[i], sizeof(uint32_t));
+        memcpy(pos + sizeof(uint32_t), log_record->GetBucketEntry(i), entry_size);
+        pos += sizeof(uint32_t) + entry_size;
+      }
+      log_record->SerializeDelta(pos);
+      break;
+    }
+    case LogRecordType::BTREE_INSERT:
+    case LogRecordType::BTREE_DELETE:
+    case LogRecordType::BTREE_SPLIT:
+    case LogRecordType::BTREE_MERGE:
+      log_record->SerializeTree(pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      memcpy(pos, &log_record->prev_page_id_, sizeof(page_id_t));
+      memcpy(pos + sizeof(page_id_t), &log_record->page_id_, sizeof(page_id_t));
+      break;
+    case LogRecordType::END_CHECKPOINT: {
+      auto att_size = static_cast<int32_t>(log_record->active_txns_.size());
+      memcpy(pos, &att_size, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      for (const auto &[txn_id, last_lsn] : log_record->active_txns_) {
+        memcpy(pos, &txn_id, sizeof(txn_id_t));
+        memcpy(pos + sizeof(txn_id_t), &last_lsn, sizeof(lsn_t));
+        pos += sizeof(txn_id_t) + sizeof(lsn_t);
+      }
+      auto dpt_size = static_cast<int32_t>(log_record->dirty_pages_.size());
+      memcpy(pos, &dpt_size, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      for (const auto &[page_id, rec_lsn] : log_record->dirty_pages_) {
+        memcpy(pos, &page_id, sizeof(page_id_t));
+        memcpy(pos + sizeof(page_id_t), &rec_lsn, sizeof(lsn_t));
+        pos += sizeof(page_id_t) + sizeof(lsn_t);
+      }
+      break;
+    }
+    default:
+      // BEGIN/COMMIT/ABORT/BEGIN_CHECKPOINT only carry the header.
+      break;
+  }
+}
 
 }  // namespace bustub
@@ -12,6 +12,7 @@
 
 #include "recovery/log_recovery.h"
 
+#include "storage/index/b_plus_tree.h"
 #include "storage/page/table_page.h"
 
 namespace bustub {
@@ -20,7 +21,300 @@ namespace bustub {
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
  */
-bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) { return false; }
+bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) {
+  return DeserializeLogRecord(data, static_cast<int>(log_buffer_ + LOG_BUFFER_SIZE - data), log_record);
+}
+
+bool LogRecovery::DeserializeLogRecord(const char *data, int size, LogRecord *log_record) {
+  if (size < LogRecord::HEADER_SIZE) {
+    return false;
+  }
+  int32_t record_size;
+  memcpy(&record_size, data, sizeof(int32_t));
+  // A zero size means we reached the end of the log.
+  if (record_size < LogRecord::HEADER_SIZE || record_size > size) {
+    return false;
+  }
+  size = record_size;
+  log_record->size_ = size;
+  memcpy(&log_record->lsn_, data + 4, sizeof(lsn_t));
+  memcpy(&log_record->txn_id_, data + 8, sizeof(txn_id_t));
+  memcpy(&log_record->prev_lsn_, data + 12, sizeof(lsn_t));
+  memcpy(&log_record->log_record_type_, data + 16, sizeof(LogRecordType));
+  const char *pos = data + LogRecord::HEADER_SIZE;
+  if (log_record->log_record_type_ == LogRecordType::CLR) {
+    log_record->compensation_ = true;
+    memcpy(&log_record->undo_next_lsn_, pos, sizeof(lsn_t));
+    memcpy(&log_record->log_record_type_, pos + sizeof(lsn_t), sizeof(LogRecordType));
+    pos += LogRecord::CLR_HEADER_SIZE;
+  }
+
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(&log_record->insert_rid_, pos, sizeof(RID));
+      log_record->insert_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(&log_record->delete_rid_, pos, sizeof(RID));
+      log_record->delete_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(&log_record->update_rid_, pos, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.DeserializeFrom(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.DeserializeFrom(pos);
+      break;
+    case LogRecordType::UPDATE_DELTA:
+      memcpy(&log_record->update_rid_, pos, sizeof(RID));
+      pos += sizeof(RID);
+      memcpy(&log_record->tuple_size_, pos, sizeof(uint32_t));
+      log_record->DeserializeDelta(pos + sizeof(uint32_t));
+      break;
+    case LogRecordType::HASH_INSERT:
+    case LogRecordType::HASH_DELETE:
+    case LogRecordType::HASH_SPLIT:
+    case LogRecordType::HASH_MERGE: {
+      memcpy(&log_record->directory_page_id_, pos, sizeof(page_id_t));
+      memcpy(&log_record->bucket_page_id_, pos + sizeof(page_id_t), sizeof(page_id_t));
+      memcpy(&log_record->new_bucket_page_id_, pos + 2 * sizeof(page_id_t), sizeof(page_id_t));
+      pos += 3 * sizeof(page_id_t);
+      memcpy(&log_record->bucket_layout_.capacity_, pos, sizeof(uint32_t));
+      memcpy(&log_record->bucket_layout_.entry_size_, pos + sizeof(uint32_t), sizeof(uint32_t));
+      memcpy(&log_record->bucket_layout_.array_offset_, pos + 2 * sizeof(uint32_t), sizeof(uint32_t));
+      memcpy(&log_record->bucket_layout_.key_size_, pos + 3 * sizeof(uint32_t), sizeof(uint32_t));
+      memcpy(&log_record->hash_, pos + 4 * sizeof(uint32_t), sizeof(uint32_t));
+      uint32_t entry_count;
+      memcpy(&entry_count, pos + 5 * sizeof(uint32_t), sizeof(uint32_t));
+      pos += 6 * sizeof(uint32_t);
+      uint32_t entry_size = log_record->bucket_layout_.entry_size_;
+      log_record->bucket_indexes_.resize(entry_count);
+      for (uint32_t i = 0; i < entry_count; i++) {
+        memcpy(&log_record->bucket_indexes_[i], pos, sizeof(uint32_t));
+        log_record->bucket_entries_.insert(log_record->bucket_entries_.end(), pos + sizeof(uint32_t),
+                                           pos + sizeof(uint32_t) + entry_size);
+        pos += sizeof(uint32_t) + entry_size;
+      }
+      log_record->DeserializeDelta(pos);
+      break;
+    }
+    case LogRecordType::BTREE_INSERT:
+    case LogRecordType::BTREE_DELETE:
+    case LogRecordType::BTREE_SPLIT:
+    case LogRecordType::BTREE_MERGE:
+      log_record->DeserializeTree(pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      memcpy(&log_record->prev_page_id_, pos, sizeof(page_id_t));
+      memcpy(&log_record->page_id_, pos + sizeof(page_id_t), sizeof(page_id_t));
+      break;
+    case LogRecordType::END_CHECKPOINT: {
+      int32_t att_size;
+      memcpy(&att_size, pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      log_record->active_txns_.resize(att_size);
+      for (auto &[txn_id, last_lsn] : log_record->active_txns_) {
+        memcpy(&txn_id, pos, sizeof(txn_id_t));
+        memcpy(&last_lsn, pos + sizeof(txn_id_t), sizeof(lsn_t));
+        pos += sizeof(txn_id_t) + sizeof(lsn_t);
+      }
+      int32_t dpt_size;
+      memcpy(&dpt_size, pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      log_record->dirty_pages_.resize(dpt_size);
+      for (auto &[page_id, rec_lsn] : log_record->dirty_pages_) {
+        memcpy(&page_id, pos, sizeof(page_id_t));
+        memcpy(&rec_lsn, pos + sizeof(page_id_t), sizeof(lsn_t));
+        pos += sizeof(page_id_t) + sizeof(lsn_t);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return true;
+}
+
+void LogRecovery::ScanLog(log_offset_t offset, const std::function<bool(LogRecord *, log_offset_t)> &visitor) {
+  lsn_t next_lsn = INVALID_LSN;
+  // Prefetch a whole log buffer at a time, and restart at the first record that did not fit.
+  while (disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset)) {
+    if (offset % DiskManager::LOG_SEGMENT_DATA_SIZE == 0) {
+      next_lsn = INVALID_LSN;
+    }
+    int pos = 0;
+    while (true) {
+      LogRecord log_record;
+      // LSNs are consecutive, anything else was left behind by the segment's previous use.
+      if (!DeserializeLogRecord(log_buffer_ + pos, &log_record) ||
+          (next_lsn != INVALID_LSN && log_record.GetLSN() != next_lsn)) {
+        break;
+      }
+      if (!visitor(&log_record, offset + pos)) {
+        return;
+      }
+      next_lsn = log_record.GetLSN() + 1;
+      pos += log_record.GetSize();
+    }
+    // Records never span segments, so the rest of this segment is unused.
+    offset = pos == 0 ? (offset / DiskManager::LOG_SEGMENT_DATA_SIZE + 1) * DiskManager::LOG_SEGMENT_DATA_SIZE
+                      : offset + pos;
+  }
+}
+
+log_offset_t LogRecovery::LocateLogRecord(lsn_t lsn) {
+  auto entry = lsn_mapping_.find(lsn);
+  if (entry != lsn_mapping_.end()) {
+    return entry->second;
+  }
+  log_offset_t offset = disk_manager_->FindLogSegment(lsn);
+  if (offset == -1) {
+    return -1;
+  }
+  ScanLog(offset, [this, lsn](LogRecord *log_record, log_offset_t record_offset) {
+    lsn_mapping_[log_record->GetLSN()] = record_offset;
+    return log_record->GetLSN() < lsn;
+  });
+  entry = lsn_mapping_.find(lsn);
+  return entry == lsn_mapping_.end() ? -1 : entry->second;
+}
+
+bool LogRecovery::ReadLogRecord(log_offset_t offset, LogRecord *log_record) {
+  char header[LogRecord::HEADER_SIZE];
+  if (!disk_manager_->ReadLog(header, LogRecord::HEADER_SIZE, offset)) {
+    return false;
+  }
+  int32_t size;
+  memcpy(&size, header, sizeof(int32_t));
+  if (size < LogRecord::HEADER_SIZE) {
+    return false;
+  }
+  std::vector<char> data(size);
+  return disk_manager_->ReadLog(data.data(), size, offset) && DeserializeLogRecord(data.data(), size, log_record);
+}
+
+page_id_t LogRecovery::GetRecordPageId(LogRecord *log_record) {
+  switch (log_record->GetLogRecordType()) {
+    case LogRecordType::INSERT:
+      return log_record->GetInsertRID().GetPageId();
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      return log_record->GetDeleteRID().GetPageId();
+    case LogRecordType::UPDATE:
+    case LogRecordType::UPDATE_DELTA:
+      return log_record->GetUpdateRID().GetPageId();
+    case LogRecordType::NEWPAGE:
+      return log_record->GetNewPageId();
+    default:
+      return INVALID_PAGE_ID;
+  }
+}
+
+std::vector<page_id_t> LogRecovery::GetRecordPageIds(LogRecord *log_record) {
+  switch (log_record->GetLogRecordType()) {
+    case LogRecordType::NEWPAGE:
+      // The previous page is linked to the new page.
+      if (log_record->GetNewPageRecord() != INVALID_PAGE_ID) {
+        return {log_record->GetNewPageId(), log_record->GetNewPageRecord()};
+      }
+      return {log_record->GetNewPageId()};
+    case LogRecordType::HASH_INSERT:
+    case LogRecordType::HASH_DELETE:
+      return {log_record->GetBucketPageId()};
+    case LogRecordType::HASH_SPLIT: {
+      // Splitting a directory fills new buckets and empties old ones apart from changing any directory.
+      std::vector<page_id_t> page_ids;
+      for (page_id_t page_id :
+           {log_record->GetDirectoryPageId(), log_record->GetBucketPageId(), log_record->GetNewBucketPageId()}) {
+        if (page_id != INVALID_PAGE_ID) {
+          page_ids.push_back(page_id);
+        }
+      }
+      return page_ids;
+    }
+    case LogRecordType::HASH_MERGE:
+      return {log_record->GetDirectoryPageId()};
+    case LogRecordType::BTREE_INSERT:
+    case LogRecordType::BTREE_DELETE:
+      return {log_record->GetLeafPageId()};
+    case LogRecordType::BTREE_SPLIT:
+    case LogRecordType::BTREE_MERGE: {
+      std::vector<page_id_t> page_ids;
+      for (size_t i = 0; i < log_record->GetTreePageCount(); i++) {
+        page_ids.push_back(log_record->GetTreePageId(i));
+      }
+      return page_ids;
+    }
+    default: {
+      page_id_t page_id = GetRecordPageId(log_record);
+      if (page_id == INVALID_PAGE_ID) {
+        return {};
+      }
+      return {page_id};
+    }
+  }
+}
+
+void LogRecovery::Analysis() {
+  // Start at the segment holding the last complete checkpoint, or at the oldest segment if there is none.
+  lsn_t checkpoint_lsn = disk_manager_->GetLogCheckpointLSN();
+  log_offset_t start_offset = checkpoint_lsn == INVALID_LSN ? -1 : disk_manager_->FindLogSegment(checkpoint_lsn);
+  if (start_offset == -1) {
+    checkpoint_lsn = INVALID_LSN;
+    start_offset = disk_manager_->GetLogStartOffset();
+  }
+  offset_ = start_offset;
+  if (start_offset == -1) {
+    return;
+  }
+
+  // Track unfinished transactions and find the redo point of the last complete checkpoint.
+  std::unordered_set<txn_id_t> finished_txns;
+  ScanLog(start_offset, [this, checkpoint_lsn, &finished_txns](LogRecord *log_record, log_offset_t offset) {
+    lsn_mapping_[log_record->GetLSN()] = offset;
+    if (log_record->GetLSN() < checkpoint_lsn) {
+      return true;
+    }
+    max_lsn_ = std::max(max_lsn_, log_record->GetLSN());
+    max_txn_id_ = std::max(max_txn_id_, log_record->GetTxnId());
+    switch (log_record->GetLogRecordType()) {
+      case LogRecordType::END_CHECKPOINT:
+        // Everything before the begin record or the oldest recovery LSN of a dirty page is on disk.
+        redo_lsn_ = log_record->GetPrevLSN();
+        for (const auto &entry : log_record->GetDirtyPages()) {
+          redo_lsn_ = std::min(redo_lsn_, entry.second);
+        }
+        // Transactions that logged or finished since the checkpoint began are tracked already.
+        for (const auto &[txn_id, last_lsn] : log_record->GetActiveTxns()) {
+          max_txn_id_ = std::max(max_txn_id_, txn_id);
+          if (finished_txns.count(txn_id) == 0) {
+            active_txn_.emplace(txn_id, last_lsn);
+          }
+        }
+        break;
+      case LogRecordType::COMMIT:
+      case LogRecordType::ABORT:
+        active_txn_.erase(log_record->GetTxnId());
+        finished_txns.insert(log_record->GetTxnId());
+        break;
+      default:
+        if (log_record->GetTxnId() != INVALID_TXN_ID) {
+          active_txn_[log_record->GetTxnId()] = log_record->GetLSN();
+        }
+        break;
+    }
+    return true;
+  });
+
+  // Only the records starting at the redo point are redone.
+  if (redo_lsn_ != INVALID_LSN) {
+    log_offset_t redo_offset = LocateLogRecord(redo_lsn_);
+    offset_ = redo_offset == -1 ? start_offset : redo_offset;
+  }
+}
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
@@ -29,12 +323,606 @@ bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record)
  *LSN with log_record's sequence number, and also build active_txn_ table &
  *lsn_mapping_ table
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  Analysis();
+  // Redo: repeat history starting at the redo point.
+  page_id_t max_page_id = disk_manager_->GetNumPages() - 1;
+  ScanLog(offset_, [this, &max_page_id](LogRecord *log_record, log_offset_t offset) {
+    for (page_id_t page_id : GetRecordPageIds(log_record)) {
+      max_page_id = std::max(max_page_id, page_id);
+      Page *page = buffer_pool_manager_->FetchPage(page_id);
+      BUSTUB_ASSERT(page != nullptr, "Couldn't fetch a page during redo.");
+      buffer_pool_manager_->UnpinPage(page_id, RedoLogRecord(log_record, page));
+    }
+    return true;
+  });
+  // Undo may allocate pages, which must not reuse the ids of pages that never made it to disk.
+  buffer_pool_manager_->ReservePageIds(max_page_id);
+}
+
+bool LogRecovery::RedoLogRecord(LogRecord *log_record, Page *page) {
+  auto *table_page = static_cast<TablePage *>(page);
+  if (log_record->GetLogRecordType() == LogRecordType::NEWPAGE && page->GetPageId() != log_record->GetNewPageId()) {
+    // Linking the previous page is not logged on its own and does not change its LSN, so it is redone whenever the
+    // link is missing.
+    if (table_page->GetNextPageId() == log_record->GetNewPageId()) {
+      return false;
+    }
+    table_page->SetNextPageId(log_record->GetNewPageId());
+    return true;
+  }
+  // The page already reflects this change.
+  if (page->GetLSN() >= log_record->GetLSN()) {
+    return false;
+  }
+
+  switch (log_record->GetLogRecordType()) {
+    case LogRecordType::INSERT: {
+      bool restored = table_page->RestoreTuple(log_record->GetInsertTuple(), log_record->GetInsertRID());
+      BUSTUB_ASSERT(restored, "Redo must insert into the same slot.");
+      break;
+    }
+    case LogRecordType::MARKDELETE:
+      table_page->MarkDelete(log_record->GetDeleteRID(), nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE:
+      table_page->ApplyDelete(log_record->GetDeleteRID(), nullptr, nullptr);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      table_page->RollbackDelete(log_record->GetDeleteRID(), nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE: {
+      Tuple old_tuple;
+      table_page->UpdateTuple(log_record->GetUpdateTuple(), &old_tuple, log_record->GetUpdateRID(), nullptr, nullptr,
+                              nullptr);
+      break;
+    }
+    case LogRecordType::UPDATE_DELTA: {
+      Tuple old_tuple;
+      bool found = table_page->GetTuple(log_record->GetUpdateRID(), &old_tuple, nullptr, nullptr);
+      BUSTUB_ASSERT(found, "Redo must find the updated tuple.");
+      table_page->UpdateTuple(log_record->ApplyUpdateDelta(old_tuple, false), &old_tuple, log_record->GetUpdateRID(),
+                              nullptr, nullptr, nullptr);
+      break;
+    }
+    case LogRecordType::NEWPAGE:
+      table_page->Init(log_record->GetNewPageId(), PAGE_SIZE, log_record->GetNewPageRecord(), nullptr, nullptr);
+      break;
+    case LogRecordType::HASH_INSERT:
+    case LogRecordType::HASH_DELETE:
+    case LogRecordType::HASH_SPLIT:
+    case LogRecordType::HASH_MERGE:
+      RedoIndexLogRecord(log_record, page);
+      break;
+    case LogRecordType::BTREE_INSERT:
+    case LogRecordType::BTREE_DELETE:
+    case LogRecordType::BTREE_SPLIT:
+    case LogRecordType::BTREE_MERGE:
+      RedoTreeLogRecord(log_record, page);
+      break;
+    default:
+      break;
+  }
+  page->SetLSN(log_record->GetLSN());
+  return true;
+}
+
+void LogRecovery::RedoTreeLogRecord(LogRecord *log_record, Page *page) {
+  char *data = page->GetData();
+  auto *node = reinterpret_cast<BPlusTreePage *>(data);
+  uint32_t entry_size = log_record->GetTreeLayout().entry_size_;
+  char *entry = data + LEAF_PAGE_HEADER_SIZE + log_record->GetEntryIndex() * entry_size;
+  // The entries of a leaf are kept sorted, so the ones after the entry's index move.
+  uint32_t moved = (node->GetSize() - log_record->GetEntryIndex()) * entry_size;
+  switch (log_record->GetLogRecordType()) {
+    case LogRecordType::BTREE_INSERT:
+      memmove(entry + entry_size, entry, moved);
+      memcpy(entry, log_record->GetTreeEntry(), entry_size);
+      node->IncreaseSize(1);
+      break;
+    case LogRecordType::BTREE_DELETE:
+      memmove(entry, entry + entry_size, moved - entry_size);
+      node->IncreaseSize(-1);
+      break;
+    default:
+      log_record->ApplyTreePage(page->GetPageId(), data);
+      break;
+  }
+}
+
+void LogRecovery::RedoIndexLogRecord(LogRecord *log_record, Page *page) {
+  if (page->GetPageId() == log_record->GetDirectoryPageId()) {
+    log_record->ApplyDelta(page->GetData(), false);
+    return;
+  }
+  const HashTableBucketLayout &layout = log_record->GetBucketLayout();
+  char *data = page->GetData();
+  switch (log_record->GetLogRecordType()) {
+    case LogRecordType::HASH_INSERT:
+      memcpy(layout.EntryAt(data, log_record->GetBucketIndex(0)), log_record->GetBucketEntry(0), layout.entry_size_);
+      layout.SetFingerprint(data, log_record->GetBucketIndex(0));
+      layout.SetOccupied(data, log_record->GetBucketIndex(0));
+      layout.SetReadable(data, log_record->GetBucketIndex(0), true);
+      break;
+    case LogRecordType::HASH_DELETE:
+      layout.SetReadable(data, log_record->GetBucketIndex(0), false);
+      break;
+    case LogRecordType::HASH_SPLIT:
+      if (page->GetPageId() == log_record->GetBucketPageId()) {
+        for (size_t i = 0; i < log_record->GetBucketEntryCount(); i++) {
+          layout.SetReadable(data, log_record->GetBucketIndex(i), false);
+        }
+        break;
+      }
+      // The new bucket holds nothing but the moved entries, in order.
+      memset(data + HashTableBucketLayout::OFFSET_OCCUPIED, 0,
+             layout.array_offset_ - HashTableBucketLayout::OFFSET_OCCUPIED);
+      for (uint32_t i = 0; i < log_record->GetBucketEntryCount(); i++) {
+        memcpy(layout.EntryAt(data, i), log_record->GetBucketEntry(i), layout.entry_size_);
+        layout.SetFingerprint(data, i);
+        layout.SetOccupied(data, i);
+        layout.SetReadable(data, i, true);
+      }
+      break;
+    default:
+      break;
+  }
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  for (const auto &[txn_id, last_lsn] : active_txn_) {
+    UndoTransaction(last_lsn, nullptr);
+  }
+  active_txn_.clear();
+  lsn_mapping_.clear();
+}
+
+void LogRecovery::UndoTransaction(lsn_t last_lsn, Transaction *txn) {
+  // The CLRs of an interrupted rollback name the records they compensated by their undo-next LSN, which is the
+  // compensated record's prevLSN. Index changes are rolled back out of order, so the chain is followed record by
+  // record and the compensated ones are skipped, instead of jumping to the undo-next LSN.
+  std::unordered_set<lsn_t> compensated;
+  lsn_t lsn = last_lsn;
+  while (lsn != INVALID_LSN) {
+    log_offset_t offset = LocateLogRecord(lsn);
+    BUSTUB_ASSERT(offset != -1, "Undo needs every record of a loser transaction.");
+    LogRecord log_record;
+    bool read = ReadLogRecord(offset, &log_record);
+    BUSTUB_ASSERT(read, "Couldn't read a log record during undo.");
+    if (log_record.GetLogRecordType() == LogRecordType::BEGIN) {
+      break;
+    }
+    if (log_record.IsCompensation()) {
+      compensated.insert(log_record.GetUndoNextLSN());
+    } else if (compensated.count(log_record.GetPrevLSN()) == 0) {
+      UndoLogRecord(&log_record, txn);
+    }
+    lsn = log_record.GetPrevLSN();
+  }
+}
+
+void LogRecovery::UndoLogRecord(LogRecord *log_record, Transaction *txn) {
+  if (log_record->GetLogRecordType() == LogRecordType::HASH_INSERT ||
+      log_record->GetLogRecordType() == LogRecordType::HASH_DELETE) {
+    // An instant restart rolls back index changes before it admits new transactions.
+    if (txn == nullptr) {
+      UndoIndexLogRecord(log_record, nullptr);
+    }
+    return;
+  }
+  if (log_record->GetLogRecordType() == LogRecordType::BTREE_INSERT ||
+      log_record->GetLogRecordType() == LogRecordType::BTREE_DELETE ||
+      log_record->GetLogRecordType() == LogRecordType::BTREE_SPLIT) {
+    if (txn == nullptr) {
+      UndoTreeLogRecord(log_record, nullptr);
+    }
+    return;
+  }
+  page_id_t page_id = GetRecordPageId(log_record);
+  // New pages stay allocated, they are simply empty.
+  if (page_id == INVALID_PAGE_ID || log_record->GetLogRecordType() == LogRecordType::NEWPAGE) {
+    return;
+  }
+
+  auto *page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  BUSTUB_ASSERT(page != nullptr, "Couldn't fetch a page during undo.");
+  // During an instant restart new transactions run concurrently. The loser holds the locks of its changes already, so
+  // the page is changed without locking or logging, and the change is logged as a CLR afterwards.
+  page->WLatch();
+  Tuple dummy_tuple;
+  switch (log_record->GetLogRecordType()) {
+    case LogRecordType::INSERT:
+      page->ApplyDelete(log_record->GetInsertRID(), nullptr, nullptr);
+      if (txn != nullptr) {
+        LogRecord clr(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::APPLYDELETE,
+                      log_record->GetInsertRID(), log_record->GetInsertTuple());
+        AppendCompensation(&clr, log_record, page, txn);
+      }
+      break;
+    case LogRecordType::MARKDELETE:
+      page->RollbackDelete(log_record->GetDeleteRID(), nullptr, nullptr);
+      if (txn != nullptr) {
+        LogRecord clr(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ROLLBACKDELETE,
+                      log_record->GetDeleteRID(), dummy_tuple);
+        AppendCompensation(&clr, log_record, page, txn);
+      }
+      break;
+    case LogRecordType::APPLYDELETE: {
+      // Other records of the loser and the rids stored in indexes refer to the tuple by its rid.
+      bool restored = page->RestoreTuple(log_record->GetDeleteTuple(), log_record->GetDeleteRID());
+      BUSTUB_ASSERT(restored, "Undo must put a deleted tuple back into its slot.");
+      if (txn != nullptr) {
+        LogRecord clr(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERT, log_record->GetDeleteRID(),
+                      log_record->GetDeleteTuple());
+        AppendCompensation(&clr, log_record, page, txn);
+      }
+      break;
+    }
+    case LogRecordType::ROLLBACKDELETE:
+      page->MarkDelete(log_record->GetDeleteRID(), nullptr, nullptr, nullptr);
+      if (txn != nullptr) {
+        LogRecord clr(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::MARKDELETE,
+                      log_record->GetDeleteRID(), dummy_tuple);
+        AppendCompensation(&clr, log_record, page, txn);
+      }
+      break;
+    case LogRecordType::UPDATE:
+    case LogRecordType::UPDATE_DELTA: {
+      Tuple new_tuple;
+      bool found = page->GetTuple(log_record->GetUpdateRID(), &new_tuple, nullptr, nullptr);
+      BUSTUB_ASSERT(found, "Undo must find the updated tuple.");
+      Tuple old_tuple = log_record->GetLogRecordType() == LogRecordType::UPDATE
+                            ? log_record->GetOriginalTuple()
+                            : log_record->ApplyUpdateDelta(new_tuple, true);
+      page->UpdateTuple(old_tuple, &new_tuple, log_record->GetUpdateRID(), nullptr, nullptr, nullptr);
+      if (txn != nullptr) {
+        LogRecord clr(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::UPDATE_DELTA,
+                      log_record->GetUpdateRID(), new_tuple, old_tuple);
+        AppendCompensation(&clr, log_record, page, txn);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+void LogRecovery::AppendCompensation(LogRecord *clr, LogRecord *log_record, Page *page, Transaction *txn) {
+  clr->SetCompensation(log_record->GetPrevLSN());
+  lsn_t lsn = log_manager_->AppendLogRecord(clr);
+  page->SetLSN(lsn);
+  txn->SetPrevLSN(lsn);
+  txn->AddLogBytes(clr->GetSize());
+}
+
+void LogRecovery::UndoIndexLogRecord(LogRecord *log_record, Transaction *txn) {
+  // Splits and merges may have moved the entry since, so its bucket is looked up through the header page and its
+  // directory again.
+  Page *header_page = buffer_pool_manager_->FetchPage(log_record->GetDirectoryPageId());
+  BUSTUB_ASSERT(header_page != nullptr, "Couldn't fetch a hash header page during undo.");
+  header_page->RLatch();
+  auto *header = reinterpret_cast<HashTableDirectoryPage *>(header_page->GetData());
+  page_id_t directory_page_id = header->GetBucketPageId(header->HashToHeaderIndex(log_record->GetHash()));
+  header_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(log_record->GetDirectoryPageId(), false);
+  Page *directory_page = buffer_pool_manager_->FetchPage(directory_page_id);
+  BUSTUB_ASSERT(directory_page != nullptr, "Couldn't fetch a hash directory page during undo.");
+  directory_page->RLatch();
+  auto *directory = reinterpret_cast<HashTableDirectoryPage *>(directory_page->GetData());
+  page_id_t bucket_page_id = directory->GetBucketPageId(log_record->GetHash() & directory->GetGlobalDepthMask());
+  directory_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(directory_page_id, false);
+
+  Page *bucket_page = buffer_pool_manager_->FetchPage(bucket_page_id);
+  BUSTUB_ASSERT(bucket_page != nullptr, "Couldn't fetch a hash bucket page during undo.");
+  bucket_page->WLatch();
+  const HashTableBucketLayout &layout = log_record->GetBucketLayout();
+  const char *entry = log_record->GetBucketEntry(0);
+  // Find the entry on the bucket page or its overflow pages, whose latch covers them, and the first free index in
+  // case it has to be inserted again. The overflow pages only hold entries of one hash, so they only take the entry
+  // back if it was removed from one of them. Occupied entries form a prefix of every page.
+  page_id_t entry_page_id = INVALID_PAGE_ID;
+  uint32_t entry_idx = layout.capacity_;
+  page_id_t free_page_id = INVALID_PAGE_ID;
+  uint32_t free_idx = layout.capacity_;
+  for (page_id_t page_id = bucket_page_id; page_id != INVALID_PAGE_ID && entry_page_id == INVALID_PAGE_ID;) {
+    Page *page = page_id == bucket_page_id ? bucket_page : buffer_pool_manager_->FetchPage(page_id);
+    BUSTUB_ASSERT(page != nullptr, "Couldn't fetch a hash overflow page during undo.");
+    char *data = page->GetData();
+    bool takes_entry = page_id == bucket_page_id || page_id == log_record->GetBucketPageId();
+    for (uint32_t idx = 0; idx < layout.capacity_; idx++) {
+      if (!layout.IsOccupied(data, idx) || !layout.IsReadable(data, idx)) {
+        if (takes_entry && free_page_id == INVALID_PAGE_ID) {
+          free_page_id = page_id;
+          free_idx = idx;
+        }
+        if (!layout.IsOccupied(data, idx)) {
+          break;
+        }
+      } else if (memcmp(layout.EntryAt(data, idx), entry, layout.entry_size_) == 0) {
+        entry_page_id = page_id;
+        entry_idx = idx;
+        break;
+      }
+    }
+    page_id_t next_page_id = HashTableBucketLayout::GetOverflowPageId(data);
+    if (page != bucket_page) {
+      buffer_pool_manager_->UnpinPage(page_id, false);
+    }
+    page_id = next_page_id;
+  }
+
+  LogRecordType undo_type = LogRecordType::INVALID;
+  page_id_t undo_page_id = INVALID_PAGE_ID;
+  uint32_t undo_idx = layout.capacity_;
+  if (log_record->GetLogRecordType() == LogRecordType::HASH_INSERT && entry_page_id != INVALID_PAGE_ID) {
+    undo_type = LogRecordType::HASH_DELETE;
+    undo_page_id = entry_page_id;
+    undo_idx = entry_idx;
+  } else if (log_record->GetLogRecordType() == LogRecordType::HASH_DELETE && entry_page_id == INVALID_PAGE_ID) {
+    if (free_page_id == INVALID_PAGE_ID) {
+      // Growing the table needs the key type, the index has to be rebuilt to get the entry back.
+      LOG_WARN("Hash bucket page %d is full, undo could not restore an index entry.", bucket_page_id);
+    } else {
+      undo_type = LogRecordType::HASH_INSERT;
+      undo_page_id = free_page_id;
+      undo_idx = free_idx;
+    }
+  }
+  if (undo_type != LogRecordType::INVALID) {
+    Page *page = undo_page_id == bucket_page_id ? bucket_page : buffer_pool_manager_->FetchPage(undo_page_id);
+    BUSTUB_ASSERT(page != nullptr, "Couldn't fetch a hash overflow page during undo.");
+    char *data = page->GetData();
+    if (undo_type == LogRecordType::HASH_DELETE) {
+      layout.SetReadable(data, undo_idx, false);
+    } else {
+      memcpy(layout.EntryAt(data, undo_idx), entry, layout.entry_size_);
+      layout.SetFingerprint(data, undo_idx);
+      layout.SetOccupied(data, undo_idx);
+      layout.SetReadable(data, undo_idx, true);
+    }
+    if (txn != nullptr) {
+      LogRecord undo_record(txn->GetTransactionId(), txn->GetPrevLSN(), undo_type, log_record->GetDirectoryPageId(),
+                            undo_page_id, INVALID_PAGE_ID, layout, log_record->GetHash());
+      undo_record.AddBucketEntry(undo_idx, entry);
+      AppendCompensation(&undo_record, log_record, page, txn);
+    }
+    if (page != bucket_page) {
+      buffer_pool_manager_->UnpinPage(undo_page_id, true);
+    }
+  }
+  bucket_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(bucket_page_id, undo_page_id == bucket_page_id);
+}
+
+void LogRecovery::UndoTreeLogRecord(LogRecord *log_record, Transaction *txn) {
+  switch (log_record->GetTreeLayout().key_size_) {
+    case 4:
+      UndoTreeLogRecord<4>(log_record, txn);
+      break;
+    case 8:
+      UndoTreeLogRecord<8>(log_record, txn);
+      break;
+    case 16:
+      UndoTreeLogRecord<16>(log_record, txn);
+      break;
+    case 32:
+      UndoTreeLogRecord<32>(log_record, txn);
+      break;
+    case 64:
+      UndoTreeLogRecord<64>(log_record, txn);
+      break;
+    default:
+      LOG_WARN("B+ tree %s has no key type to undo with.", log_record->GetIndexName().c_str());
+      break;
+  }
+}
+
+template <size_t KeySize>
+void LogRecovery::UndoTreeLogRecord(LogRecord *log_record, Transaction *txn) {
+  const BPlusTreeLayout &layout = log_record->GetTreeLayout();
+  BPlusTree<GenericKey<KeySize>, RID, GenericComparator<KeySize>> tree(
+      log_record->GetIndexName(), buffer_pool_manager_, GenericComparator<KeySize>(nullptr), layout.leaf_max_size_,
+      layout.internal_max_size_, log_manager_);
+  tree.LoadRootPageId();
+  std::pair<GenericKey<KeySize>, RID> entry;
+  memcpy(reinterpret_cast<char *>(&entry), log_record->GetTreeEntry(), sizeof(entry));
+  // The entry is looked up through the tree, splits and merges may have moved it since.
+  if (log_record->GetLogRecordType() == LogRecordType::BTREE_DELETE) {
+    tree.Insert(entry.first, entry.second, txn, log_record->GetPrevLSN());
+    return;
+  }
+  std::vector<RID> result;
+  if (tree.GetValue(entry.first, &result) && result[0] == entry.second) {
+    tree.Remove(entry.first, txn, log_record->GetPrevLSN());
+  }
+}
+
+void LogRecovery::StartInstantRestart(LogManager *log_manager, LockManager *lock_manager,
+                                      TransactionManager *txn_manager) {
+  Analysis();
+  log_manager_ = log_manager;
+  lock_manager_ = lock_manager;
+  txn_manager_ = txn_manager;
+
+  // Continue after the last record, so that new records never reuse an LSN or transaction id found in the log.
+  log_manager_->SetNextLSN(max_lsn_ + 1);
+  log_manager_->SetPersistentLSN(max_lsn_);
+  txn_manager_->SetNextTxnId(max_txn_id_ + 1);
+  log_manager_->RunFlushThread();
+
+  // Index the records to redo by page.
+  page_id_t max_page_id = disk_manager_->GetNumPages() - 1;
+  ScanLog(offset_, [this, &max_page_id](LogRecord *log_record, log_offset_t offset) {
+    for (page_id_t page_id : GetRecordPageIds(log_record)) {
+      max_page_id = std::max(max_page_id, page_id);
+      page_records_[page_id].push_back(offset);
+    }
+    return true;
+  });
+  // New transactions must not reuse the ids of pages that never made it to disk.
+  buffer_pool_manager_->ReservePageIds(max_page_id);
+
+  // The losers take their locks back before any new transaction can run, so nobody sees their changes.
+  std::vector<std::pair<Transaction *, lsn_t>> losers;
+  std::vector<std::pair<Transaction *, log_offset_t>> index_records;
+  for (const auto &[txn_id, last_lsn] : active_txn_) {
+    auto *txn = new Transaction(txn_id);
+    txn->SetPrevLSN(last_lsn);
+    // Follow the loser's records back to its begin record, which also keeps its log segments from being truncated.
+    // Index changes compensated by an earlier rollback are not rolled back again.
+    std::unordered_set<lsn_t> compensated;
+    for (lsn_t lsn = last_lsn; lsn != INVALID_LSN;) {
+      log_offset_t offset = LocateLogRecord(lsn);
+      BUSTUB_ASSERT(offset != -1, "Instant restart needs every record of a loser transaction.");
+      LogRecord log_record;
+      bool read = ReadLogRecord(offset, &log_record);
+      BUSTUB_ASSERT(read, "Couldn't read a log record of a loser transaction.");
+      txn->SetFirstLSN(lsn);
+      RID rid;
+      switch (log_record.GetLogRecordType()) {
+        case LogRecordType::INSERT:
+          rid = log_record.GetInsertRID();
+          break;
+        case LogRecordType::UPDATE:
+        case LogRecordType::UPDATE_DELTA:
+          rid = log_record.GetUpdateRID();
+          break;
+        case LogRecordType::MARKDELETE:
+        case LogRecordType::APPLYDELETE:
+        case LogRecordType::ROLLBACKDELETE:
+          rid = log_record.GetDeleteRID();
+          break;
+        case LogRecordType::HASH_INSERT:
+        case LogRecordType::HASH_DELETE:
+        case LogRecordType::BTREE_INSERT:
+        case LogRecordType::BTREE_DELETE:
+        case LogRecordType::BTREE_SPLIT:
+          if (!log_record.IsCompensation() && compensated.count(log_record.GetPrevLSN()) == 0) {
+            index_records.emplace_back(txn, offset);
+          }
+          break;
+        default:
+          break;
+      }
+      if (log_record.IsCompensation()) {
+        compensated.insert(log_record.GetUndoNextLSN());
+      }
+      if (rid.GetPageId() != INVALID_PAGE_ID && !txn->IsExclusiveLocked(rid)) {
+        lock_manager_->LockExclusive(txn, rid);
+      }
+      lsn = log_record.GetLogRecordType() == LogRecordType::BEGIN ? INVALID_LSN : log_record.GetPrevLSN();
+    }
+    txn_manager_->GetTransactionRegistry()->Insert(txn);
+    losers.emplace_back(txn, last_lsn);
+  }
+
+  buffer_pool_manager_->SetLogRecovery(this);
+  // Index pages are latched by their index, not by the pages themselves, so new transactions could run into the
+  // rollback of the losers' index changes. They are rolled back right away instead, reading the pages on demand.
+  for (const auto &[txn, offset] : index_records) {
+    LogRecord log_record;
+    bool read = ReadLogRecord(offset, &log_record);
+    BUSTUB_ASSERT(read, "Couldn't read a log record of a loser transaction.");
+    if (log_record.GetLogRecordType() == LogRecordType::HASH_INSERT ||
+        log_record.GetLogRecordType() == LogRecordType::HASH_DELETE) {
+      UndoIndexLogRecord(&log_record, txn);
+    } else {
+      UndoTreeLogRecord(&log_record, txn);
+    }
+  }
+  redo_thread_ = std::thread(&LogRecovery::RedoPendingPages, this);
+  undo_thread_ = std::thread(&LogRecovery::AbortLosers, this, std::move(losers));
+}
+
+void LogRecovery::WaitForInstantRestart() {
+  if (redo_thread_.joinable()) {
+    redo_thread_.join();
+  }
+  if (undo_thread_.joinable()) {
+    undo_thread_.join();
+  }
+  if (log_manager_ != nullptr) {
+    buffer_pool_manager_->SetLogRecovery(nullptr);
+    log_manager_ = nullptr;
+    lock_manager_ = nullptr;
+    txn_manager_ = nullptr;
+  }
+}
+
+bool LogRecovery::RedoPage(Page *page) {
+  std::vector<log_offset_t> offsets;
+  {
+    std::scoped_lock lock(page_records_latch_);
+    auto entry = page_records_.find(page->GetPageId());
+    if (entry == page_records_.end()) {
+      return false;
+    }
+    offsets = std::move(entry->second);
+    page_records_.erase(entry);
+  }
+  bool redone = false;
+  for (log_offset_t offset : offsets) {
+    LogRecord log_record;
+    bool read = ReadLogRecord(offset, &log_record);
+    BUSTUB_ASSERT(read, "Couldn't read a log record during redo.");
+    redone = RedoLogRecord(&log_record, page) || redone;
+  }
+  return redone;
+}
+
+void LogRecovery::RedoPendingPages() {
+  while (true) {
+    std::vector<page_id_t> page_ids;
+    {
+      std::scoped_lock lock(page_records_latch_);
+      for (const auto &entry : page_records_) {
+        page_ids.push_back(entry.first);
+      }
+    }
+    if (page_ids.empty()) {
+      return;
+    }
+    std::sort(page_ids.begin(), page_ids.end());
+    bool all_fetched = true;
+    for (page_id_t page_id : page_ids) {
+      // Reading the page from disk redoes it, unless a transaction got there first.
+      if (buffer_pool_manager_->FetchPage(page_id) == nullptr) {
+        all_fetched = false;
+        continue;
+      }
+      buffer_pool_manager_->UnpinPage(page_id, false);
+    }
+    // Every frame is pinned, give the transactions time to release some.
+    if (!all_fetched) {
+      std::this_thread::sleep_for(log_timeout);
+    }
+  }
+}
+
+void LogRecovery::AbortLosers(std::vector<std::pair<Transaction *, lsn_t>> losers) {
+  for (const auto &[txn, last_lsn] : losers) {
+    // Start at the last record found in the log, the index rollback logged since then is not undone.
+    UndoTransaction(last_lsn, txn);
+    txn->SetState(TransactionState::ABORTED);
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+    txn->AddLogBytes(log_record.GetSize());
+    txn_manager_->GetTransactionRegistry()->Erase(txn->GetTransactionId());
+
+    std::unordered_set<RID> lock_set(txn->GetExclusiveLockSet()->begin(), txn->GetExclusiveLockSet()->end());
+    lock_set.insert(txn->GetSharedLockSet()->begin(), txn->GetSharedLockSet()->end());
+    for (const RID &rid : lock_set) {
+      lock_manager_->Unlock(txn, rid);
+    }
+    delete txn;
+  }
+}
 
 }  // namespace bustub
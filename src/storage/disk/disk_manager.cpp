@@ -11,8 +11,10 @@
 //===----------------------------------------------------------------------===//
 
 #include <sys/stat.h>
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <mutex>  // NOLINT
 #include <string>
@@ -26,6 +28,15 @@ namespace bustub {
 
 static char *buffer_used;
 
+/** The header at the start of every log segment file. */
+struct LogSegmentHeader {
+  uint32_t magic_;
+  int32_t segment_;
+  lsn_t start_lsn_;
+  lsn_t checkpoint_lsn_;
+};
+static constexpr uint32_t LOG_SEGMENT_MAGIC = 0x42544c47;
+
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
@@ -39,17 +50,31 @@ DiskManager::DiskManager(const std::string &db_file)
   }
   log_name_ = file_name_.substr(0, n) + ".log";
 
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app | std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-    if (!log_io_.is_open()) {
-      throw Exception("can't open dblog file");
+  // Find the log segments of a previous run. Files without a valid header are preallocated spares.
+  std::filesystem::path log_path(log_name_);
+  std::string segment_prefix = log_path.filename().string() + ".";
+  std::error_code error;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(log_path.has_parent_path() ? log_path.parent_path() : ".", error)) {
+    std::string name = entry.path().filename().string();
+    if (name.compare(0, segment_prefix.size(), segment_prefix) != 0 || name.size() == segment_prefix.size() ||
+        name.find_first_not_of("0123456789", segment_prefix.size()) != std::string::npos) {
+      continue;
+    }
+    int segment = std::stoi(name.substr(segment_prefix.size()));
+    LogSegmentHeader header{};
+    std::ifstream segment_io(entry.path(), std::ios::binary | std::ios::in);
+    segment_io.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (segment_io.gcount() == sizeof(header) && header.magic_ == LOG_SEGMENT_MAGIC && header.segment_ == segment) {
+      log_segments_[segment] = header.start_lsn_;
+      if (segment == log_segments_.rbegin()->first) {
+        log_checkpoint_lsn_ = header.checkpoint_lsn_;
+      }
+    } else if (GetFileSize(entry.path().string()) == LOG_SEGMENT_SIZE) {
+      log_spares_.insert(segment);
+    } else {
+      // A segment that was not completely preallocated.
+      std::filesystem::remove(entry.path(), error);
     }
   }
 
@@ -78,7 +103,9 @@ void DiskManager::ShutDown() {
     std::scoped_lock scoped_db_io_latch(db_io_latch_);
     db_io_.close();
   }
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
   log_io_.close();
+  log_read_io_.close();
 }
 
 /**
@@ -149,8 +176,14 @@ void DiskManager::WriteLog(char *log_data, int size) {
     assert(flush_log_f_->wait_for(std::chrono::seconds(10)) == std::future_status::ready);
   }
 
+  if (log_segment_ == -1) {
+    StartLogSegment(INVALID_LSN);
+  }
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  assert(log_segment_offset_ + size <= LOG_SEGMENT_DATA_SIZE);
   num_flushes_ += 1;
   // sequence write
+  log_io_.seekp(LOG_SEGMENT_HEADER_SIZE + log_segment_offset_);
   log_io_.write(log_data, size);
 
   // check for I/O error
@@ -160,6 +193,7 @@ void DiskManager::WriteLog(char *log_data, int size) {
   }
   // needs to flush to keep disk file in sync
   log_io_.flush();
+  log_segment_offset_ += size;
   flush_log_ = false;
 }
 
@@ -168,29 +202,139 @@ void DiskManager::WriteLog(char *log_data, int size) {
  * Always read from the beginning and perform sequence read
  * @return: false means already reach the end
  */
-bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
+bool DiskManager::ReadLog(char *log_data, int size, log_offset_t offset) {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  auto segment = static_cast<int>(offset / LOG_SEGMENT_DATA_SIZE);
+  auto position = static_cast<int>(offset % LOG_SEGMENT_DATA_SIZE);
+  if (offset < 0 || log_segments_.count(segment) == 0 || !OpenLogSegmentForRead(segment)) {
     // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
+  log_read_io_.seekg(LOG_SEGMENT_HEADER_SIZE + position);
+  log_read_io_.read(log_data, std::min(size, LOG_SEGMENT_DATA_SIZE - position));
 
-  if (log_io_.bad()) {
+  if (log_read_io_.bad()) {
     LOG_DEBUG("I/O error while reading log");
     return false;
   }
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
+  // if log segment ends before reading "size"
+  int read_count = log_read_io_.gcount();
   if (read_count < size) {
-    log_io_.clear();
+    log_read_io_.clear();
     memset(log_data + read_count, 0, size - read_count);
   }
 
   return true;
 }
 
+void DiskManager::StartLogSegment(lsn_t start_lsn) {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  int segment = log_segments_.empty() ? (log_spares_.empty() ? 0 : *log_spares_.begin())
+                                      : log_segments_.rbegin()->first + 1;
+  std::string segment_name = GetLogSegmentName(segment);
+  if (log_spares_.erase(segment) == 0) {
+    if (!log_spares_.empty()) {
+      std::filesystem::rename(GetLogSegmentName(*log_spares_.begin()), segment_name);
+      log_spares_.erase(log_spares_.begin());
+    } else {
+      // Preallocate the whole segment, so that log writes never change the file size.
+      std::ofstream(segment_name, std::ios::binary | std::ios::trunc | std::ios::out).close();
+      std::filesystem::resize_file(segment_name, LOG_SEGMENT_SIZE);
+    }
+  }
+
+  log_io_.close();
+  log_io_.clear();
+  log_io_.open(segment_name, std::ios::binary | std::ios::in | std::ios::out);
+  if (!log_io_.is_open()) {
+    throw Exception("can't open log segment");
+  }
+  log_segments_[segment] = start_lsn;
+  log_segment_ = segment;
+  log_segment_offset_ = 0;
+  WriteLogSegmentHeader(true);
+}
+
+void DiskManager::SetLogCheckpoint(lsn_t checkpoint_lsn) {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  log_checkpoint_lsn_ = checkpoint_lsn;
+  if (log_segment_ != -1) {
+    WriteLogSegmentHeader(false);
+  }
+}
+
+lsn_t DiskManager::GetLogCheckpointLSN() {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  return log_checkpoint_lsn_;
+}
+
+void DiskManager::TruncateLog(lsn_t lsn) {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  for (auto entry = log_segments_.begin(); entry != log_segments_.end();) {
+    // The records of a segment end where the next segment starts.
+    auto next = std::next(entry);
+    if (entry->first == log_segment_ || next == log_segments_.end() || next->second == INVALID_LSN ||
+        next->second > lsn) {
+      return;
+    }
+    if (log_read_segment_ == entry->first) {
+      log_read_io_.close();
+      log_read_segment_ = -1;
+    }
+    std::string segment_name = GetLogSegmentName(entry->first);
+    if (static_cast<int>(log_spares_.size()) < LOG_SEGMENT_SPARES) {
+      // Recycle the segment under a future number, invalidating its header so its records are never read again.
+      int spare = std::max(log_segments_.rbegin()->first, log_spares_.empty() ? 0 : *log_spares_.rbegin()) + 1;
+      std::filesystem::rename(segment_name, GetLogSegmentName(spare));
+      char header[LOG_SEGMENT_HEADER_SIZE] = {0};
+      std::fstream spare_io(GetLogSegmentName(spare), std::ios::binary | std::ios::in | std::ios::out);
+      spare_io.write(header, LOG_SEGMENT_HEADER_SIZE);
+      log_spares_.insert(spare);
+    } else {
+      std::filesystem::remove(segment_name);
+    }
+    entry = log_segments_.erase(entry);
+  }
+}
+
+log_offset_t DiskManager::FindLogSegment(lsn_t lsn) {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  for (auto entry = log_segments_.rbegin(); entry != log_segments_.rend(); ++entry) {
+    if (entry->second != INVALID_LSN && entry->second <= lsn) {
+      return static_cast<log_offset_t>(entry->first) * LOG_SEGMENT_DATA_SIZE;
+    }
+  }
+  return -1;
+}
+
+log_offset_t DiskManager::GetLogStartOffset() {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  return log_segments_.empty() ? -1 : static_cast<log_offset_t>(log_segments_.begin()->first) * LOG_SEGMENT_DATA_SIZE;
+}
+
+std::string DiskManager::GetLogSegmentName(int segment) const { return log_name_ + "." + std::to_string(segment); }
+
+void DiskManager::WriteLogSegmentHeader(bool clear_data) {
+  // A zero record size right after the header marks an empty data area.
+  char header[LOG_SEGMENT_HEADER_SIZE + sizeof(int32_t)] = {0};
+  LogSegmentHeader segment_header{LOG_SEGMENT_MAGIC, log_segment_, log_segments_[log_segment_], log_checkpoint_lsn_};
+  memcpy(header, &segment_header, sizeof(segment_header));
+  log_io_.seekp(0);
+  log_io_.write(header, clear_data ? sizeof(header) : LOG_SEGMENT_HEADER_SIZE);
+  log_io_.flush();
+}
+
+bool DiskManager::OpenLogSegmentForRead(int segment) {
+  if (log_read_segment_ == segment && log_read_io_.is_open()) {
+    return true;
+  }
+  log_read_io_.close();
+  log_read_io_.clear();
+  log_read_io_.open(GetLogSegmentName(segment), std::ios::binary | std::ios::in);
+  log_read_segment_ = log_read_io_.is_open() ? segment : -1;
+  return log_read_io_.is_open();
+}
+
 /**
  * Returns number of flushes made so far
  */
@@ -201,6 +345,11 @@ int DiskManager::GetNumFlushes() const { return num_flushes_; }
  */
 int DiskManager::GetNumWrites() const { return num_writes_; }
 
+int DiskManager::GetNumPages() {
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  return (std::max(GetFileSize(file_name_), 0) + PAGE_SIZE - 1) / PAGE_SIZE;
+}
+
 /**
  * Returns true if the log is currently being flushed
  */
@@ -9,7 +9,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <string>
+#include <type_traits>
+#include <utility>
 
 #include "common/exception.h"
 #include "common/rid.h"
@@ -19,19 +22,44 @@
 namespace bustub {
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                          int leaf_max_size, int internal_max_size)
+                          int leaf_max_size, int internal_max_size, LogManager *log_manager)
     : index_name_(std::move(name)),
       root_page_id_(INVALID_PAGE_ID),
       buffer_pool_manager_(buffer_pool_manager),
       comparator_(comparator),
       leaf_max_size_(leaf_max_size),
-      internal_max_size_(internal_max_size) {}
+      internal_max_size_(internal_max_size),
+      log_manager_(log_manager) {}
+
+/*
+ * Read the root page id of a tree built before from the header page
+ * @return : false if the header page has no record of the tree
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::LoadRootPageId() {
+  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  header_page->RLatch();
+  root_latch_.WLock();
+  bool found = header_page->GetRootId(index_name_, &root_page_id_);
+  if (!found) {
+    root_page_id_ = INVALID_PAGE_ID;
+  }
+  root_latch_.WUnlock();
+  header_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  return found;
+}
 
 /*
  * Helper function to decide whether current b+tree is empty
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::IsEmpty() const { return true; }
+bool BPLUSTREE_TYPE::IsEmpty() const {
+  root_latch_.RLock();
+  bool empty = root_page_id_ == INVALID_PAGE_ID;
+  root_latch_.RUnlock();
+  return empty;
+}
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
@@ -42,7 +70,18 @@ bool BPLUSTREE_TYPE::IsEmpty() const { return true; }
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) {
-  return false;
+  Page *page = FindLeaf(key, Operation::READ, false, nullptr);
+  if (page == nullptr) {
+    return false;
+  }
+  ValueType value;
+  bool found = reinterpret_cast<LeafPage *>(page->GetData())->Lookup(key, &value, comparator_);
+  if (found) {
+    result->push_back(value);
+  }
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  return found;
 }
 
 /*****************************************************************************
@@ -52,11 +91,38 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
  * Insert constant key & value pair into b+ tree
  * if current tree is empty, start new tree, update root page id and insert
  * entry, otherwise insert into leaf page.
+ * Most inserts only change their leaf, they latch it alone for writing and go
+ * on to InsertIntoLeaf() only when the leaf may split.
  * @return: since we only support unique key, if user try to insert duplicate
  * keys return false, otherwise return true.
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) { return false; }
+bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction,
+                            lsn_t undo_next_lsn) {
+  Page *page = FindLeaf(key, Operation::INSERT, false, nullptr);
+  if (page != nullptr) {
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    int size = leaf->GetSize();
+    bool done = IsSafe(leaf, Operation::INSERT, false);
+    bool inserted = false;
+    if (done) {
+      inserted = leaf->Insert(key, value, comparator_) > size;
+      if (inserted) {
+        LogEntry(LogRecordType::BTREE_INSERT, page, key, value, transaction, undo_next_lsn);
+      }
+    } else {
+      // A duplicate key splits nothing.
+      ValueType old_value;
+      done = leaf->Lookup(key, &old_value, comparator_);
+    }
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), inserted);
+    if (done) {
+      return inserted;
+    }
+  }
+  return InsertIntoLeaf(key, value, transaction, undo_next_lsn);
+}
 /*
  * Insert constant key & value pair into an empty tree
  * User needs to first ask for new page from buffer pool manager(NOTICE: throw
@@ -64,19 +130,64 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
  * tree's root page id and insert entry directly into leaf page.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {}
+void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value, std::vector<ChangedPage> *changes) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate a new page.");
+  }
+  TrackPage(page, true, false, changes);
+  auto *root = reinterpret_cast<LeafPage *>(page->GetData());
+  root->Init(page_id, INVALID_PAGE_ID, leaf_max_size_);
+  root->Insert(key, value, comparator_);
+  root_page_id_ = page_id;
+  UpdateRootPageId(1, changes);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
 
 /*
  * Insert constant key & value pair into leaf page
  * User needs to first find the right leaf page as insertion target, then look
  * through leaf page to see whether insert key exist or not. If exist, return
  * immdiately, otherwise insert entry. Remember to deal with split if necessary.
+ * The leaf is found write crabbing, so that the pages the split reaches stay latched.
+ * A split is logged as a whole while they are.
  * @return: since we only support unique key, if user try to insert duplicate
  * keys return false, otherwise return true.
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction) {
-  return false;
+bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction,
+                                    lsn_t undo_next_lsn) {
+  std::vector<Page *> ancestors;
+  std::vector<ChangedPage> changes;
+  std::vector<ChangedPage> *tracked = IsLogging(transaction) ? &changes : nullptr;
+  MappingType entry(key, value);
+  Page *page = FindLeaf(key, Operation::INSERT, false, &ancestors);
+  if (page == nullptr) {
+    StartNewTree(key, value, tracked);
+    LogChanges(LogRecordType::BTREE_SPLIT, &entry, transaction, undo_next_lsn, tracked);
+    ReleaseAncestors(&ancestors, true);
+    return true;
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  ValueType old_value;
+  bool inserted = !leaf->Lookup(key, &old_value, comparator_);
+  if (inserted && leaf->GetSize() + 1 < leaf->GetMaxSize()) {
+    leaf->Insert(key, value, comparator_);
+    LogEntry(LogRecordType::BTREE_INSERT, page, key, value, transaction, undo_next_lsn);
+  } else if (inserted) {
+    TrackPage(page, false, false, tracked);
+    leaf->Insert(key, value, comparator_);
+    LeafPage *new_leaf = Split(leaf, tracked);
+    // The leaf was not safe, so its parent is the last ancestor.
+    InsertIntoParent(leaf, new_leaf->KeyAt(0), new_leaf, ancestors, ancestors.size() - 1, tracked);
+    buffer_pool_manager_->UnpinPage(new_leaf->GetPageId(), true);
+    LogChanges(LogRecordType::BTREE_SPLIT, &entry, transaction, undo_next_lsn, tracked);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), inserted);
+  ReleaseAncestors(&ancestors, inserted);
+  return inserted;
 }
 
 /*
@@ -88,8 +199,23 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-N *BPLUSTREE_TYPE::Split(N *node) {
-  return nullptr;
+N *BPLUSTREE_TYPE::Split(N *node, std::vector<ChangedPage> *changes) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate a new page.");
+  }
+  TrackPage(page, true, false, changes);
+  // Nobody reaches the new page before its parent and its left sibling are unlatched.
+  auto *new_node = reinterpret_cast<N *>(page->GetData());
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    new_node->Init(page_id, node->GetParentPageId(), leaf_max_size_);
+    node->MoveHalfTo(new_node);
+  } else {
+    new_node->Init(page_id, node->GetParentPageId(), internal_max_size_);
+    node->MoveHalfTo(new_node, buffer_pool_manager_);
+  }
+  return new_node;
 }
 
 /*
@@ -97,13 +223,191 @@ N *BPLUSTREE_TYPE::Split(N *node) {
  * @param   old_node      input page from split() method
  * @param   key
  * @param   new_node      returned page from split() method
- * User needs to first find the parent page of old_node, parent node must be
- * adjusted to take info of new_node into account. Remember to deal with split
- * recursively if necessary.
+ * @param   ancestors     the ancestors latched by FindLeaf()
+ * @param   parent_index  the index of the parent of old_node among them
+ * The parent of old_node is latched among the ancestors, which are unsafe up
+ * to the one the split stops at. Parent node must be adjusted to take info of
+ * new_node into account. Remember to deal with split recursively if necessary.
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
-                                      Transaction *transaction) {}
+                                      const std::vector<Page *> &ancestors, size_t parent_index,
+                                      std::vector<ChangedPage> *changes) {
+  // The root latch stands for the parent of the root.
+  Page *parent_page = ancestors[parent_index];
+  if (parent_page == nullptr) {
+    page_id_t root_page_id;
+    Page *page = buffer_pool_manager_->NewPage(&root_page_id);
+    if (page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate a new page.");
+    }
+    TrackPage(page, true, false, changes);
+    auto *root = reinterpret_cast<InternalPage *>(page->GetData());
+    root->Init(root_page_id, INVALID_PAGE_ID, internal_max_size_);
+    root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
+    old_node->SetParentPageId(root_page_id);
+    new_node->SetParentPageId(root_page_id);
+    root_page_id_ = root_page_id;
+    UpdateRootPageId(0, changes);
+    buffer_pool_manager_->UnpinPage(root_page_id, true);
+    return;
+  }
+
+  TrackPage(parent_page, false, false, changes);
+  auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  if (parent->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId()) > parent->GetMaxSize()) {
+    InternalPage *new_parent = Split(parent, changes);
+    InsertIntoParent(parent, new_parent->KeyAt(0), new_parent, ancestors, parent_index - 1, changes);
+    buffer_pool_manager_->UnpinPage(new_parent->GetPageId(), true);
+  }
+}
+
+/*****************************************************************************
+ * BULK LOADING
+ *****************************************************************************/
+/*
+ * Build an empty tree from key & value pairs in any order
+ * The pairs are sorted, externally if they do not fit in memory, then packed
+ * into leaves left to right, and the leaves into internal pages level by level
+ * up to the root. Every page but the last two of a level is filled to the fill
+ * factor, and those two share what is left, so that no page is less than half
+ * full. A tree that is not empty has the pairs inserted one at a time instead.
+ * Bulk loading is not logged, the pages are written out once built instead.
+ * @param   next_entry     stores the next pair and returns true, returns
+ * false once there are no more
+ * @param   fill_factor    how full to pack the pages, leaving room for the
+ * inserts to come
+ * NOTE: since we only support unique key, one pair of a duplicate key is kept
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BulkLoad(const std::function<bool(MappingType *)> &next_entry, double fill_factor) {
+  MappingType entry;
+  root_latch_.WLock();
+  if (root_page_id_ != INVALID_PAGE_ID) {
+    root_latch_.WUnlock();
+    while (next_entry(&entry)) {
+      Insert(entry.first, entry.second);
+    }
+    return;
+  }
+
+  ExternalSorter<MappingType> sorter(buffer_pool_manager_, [this](const MappingType &a, const MappingType &b) {
+    return comparator_(a.first, b.first) < 0;
+  });
+  while (next_entry(&entry)) {
+    sorter.Add(entry);
+  }
+  sorter.Sort();
+
+  // Leaves hold one pair less than their max size, which they split at.
+  int leaf_fill = std::clamp(static_cast<int>(fill_factor * (leaf_max_size_ - 1)), leaf_max_size_ / 2,
+                             leaf_max_size_ - 1);
+  std::vector<std::pair<KeyType, page_id_t>> level;
+  std::vector<MappingType> pending;
+  Page *last_leaf = nullptr;
+  while (sorter.Next(&entry)) {
+    if (!pending.empty() && comparator_(pending.back().first, entry.first) == 0) {
+      continue;
+    }
+    // Two leaves are held back for the end.
+    if (pending.size() == static_cast<size_t>(2 * leaf_fill)) {
+      BulkLoadLeaf(pending.data(), leaf_fill, &last_leaf, &level);
+      pending.erase(pending.begin(), pending.begin() + leaf_fill);
+    }
+    pending.push_back(entry);
+  }
+  int rest = static_cast<int>(pending.size());
+  if (rest > leaf_max_size_ - 1) {
+    BulkLoadLeaf(pending.data(), rest / 2, &last_leaf, &level);
+    BulkLoadLeaf(pending.data() + rest / 2, rest - rest / 2, &last_leaf, &level);
+  } else if (rest > 0) {
+    BulkLoadLeaf(pending.data(), rest, &last_leaf, &level);
+  }
+  if (last_leaf != nullptr) {
+    buffer_pool_manager_->UnpinPage(last_leaf->GetPageId(), true);
+  }
+  // Later changes are logged against the pages as they are on disk.
+  bool flush = enable_logging && log_manager_ != nullptr;
+  std::vector<page_id_t> built_pages;
+  for (const auto &child : level) {
+    built_pages.push_back(child.second);
+  }
+
+  int internal_fill = std::clamp(static_cast<int>(fill_factor * internal_max_size_),
+                                 std::max(2, (internal_max_size_ + 1) / 2), internal_max_size_);
+  while (level.size() > 1) {
+    std::vector<std::pair<KeyType, page_id_t>> parents;
+    size_t begin = 0;
+    while (level.size() - begin > static_cast<size_t>(2 * internal_fill)) {
+      BulkLoadInternal(level.data() + begin, internal_fill, &parents);
+      begin += internal_fill;
+    }
+    rest = static_cast<int>(level.size() - begin);
+    if (rest > internal_max_size_) {
+      BulkLoadInternal(level.data() + begin, rest / 2, &parents);
+      BulkLoadInternal(level.data() + begin + rest / 2, rest - rest / 2, &parents);
+    } else {
+      BulkLoadInternal(level.data() + begin, rest, &parents);
+    }
+    for (const auto &child : parents) {
+      built_pages.push_back(child.second);
+    }
+    level = std::move(parents);
+  }
+
+  if (!level.empty()) {
+    root_page_id_ = level[0].second;
+    UpdateRootPageId(1, nullptr);
+    built_pages.push_back(HEADER_PAGE_ID);
+  }
+  if (flush) {
+    for (page_id_t page_id : built_pages) {
+      buffer_pool_manager_->FlushPage(page_id);
+    }
+  }
+  root_latch_.WUnlock();
+}
+
+/*
+ * Pack pairs into a new leaf after the last one, and add it to the level above
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BulkLoadLeaf(MappingType *entries, int size, Page **last_leaf,
+                                  std::vector<std::pair<KeyType, page_id_t>> *parents) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate a new page.");
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  leaf->Init(page_id, INVALID_PAGE_ID, leaf_max_size_);
+  leaf->CopyNFrom(entries, size);
+  if (*last_leaf != nullptr) {
+    reinterpret_cast<LeafPage *>((*last_leaf)->GetData())->SetNextPageId(page_id);
+    buffer_pool_manager_->UnpinPage((*last_leaf)->GetPageId(), true);
+  }
+  *last_leaf = page;
+  parents->emplace_back(entries[0].first, page_id);
+}
+
+/*
+ * Pack children into a new internal page, and add it to the level above
+ * The key of the first child is the one the level above gets.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BulkLoadInternal(std::pair<KeyType, page_id_t> *children, int size,
+                                      std::vector<std::pair<KeyType, page_id_t>> *parents) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate a new page.");
+  }
+  auto *node = reinterpret_cast<InternalPage *>(page->GetData());
+  node->Init(page_id, INVALID_PAGE_ID, internal_max_size_);
+  node->CopyNFrom(children, size, buffer_pool_manager_);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  parents->emplace_back(children[0].first, page_id);
+}
 
 /*****************************************************************************
  * REMOVE
@@ -114,41 +418,179 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
  * If not, User needs to first find the right leaf page as deletion target, then
  * delete entry from leaf page. Remember to deal with redistribute or merge if
  * necessary.
+ * Like inserts, removes latch the leaf alone for writing and go on to
+ * RemoveFromLeaf() only when the leaf may merge.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {}
+void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction, lsn_t undo_next_lsn) {
+  Page *page = FindLeaf(key, Operation::REMOVE, false, nullptr);
+  if (page == nullptr) {
+    return;
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  bool done = IsSafe(leaf, Operation::REMOVE, false);
+  bool removed = false;
+  if (done) {
+    removed = RemoveEntry(page, key, transaction, undo_next_lsn);
+  } else {
+    // A missing key merges nothing.
+    ValueType old_value;
+    done = !leaf->Lookup(key, &old_value, comparator_);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), removed);
+  if (!done) {
+    RemoveFromLeaf(key, transaction, undo_next_lsn);
+  }
+}
+
+/*
+ * Delete the key from its leaf found write crabbing, so that the pages a merge
+ * reaches stay latched, then delete the pages merged away once unlatched.
+ * A merge is carried up one level at a time, and every level is unlatched
+ * before the level above latches its siblings: an iterator waiting for a leaf
+ * kept latched here could hold a leaf that a reader of a sibling above waits
+ * for. So every level is logged on its own, after the delete itself.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RemoveFromLeaf(const KeyType &key, Transaction *transaction, lsn_t undo_next_lsn) {
+  std::vector<Page *> ancestors;
+  Page *page = FindLeaf(key, Operation::REMOVE, false, &ancestors);
+  if (page == nullptr) {
+    ReleaseAncestors(&ancestors, false);
+    return;
+  }
+  bool removed = RemoveEntry(page, key, transaction, undo_next_lsn);
+  std::vector<page_id_t> deleted_pages;
+  // A page that may merge has its parent kept latched last among the ancestors, the root has the root latch.
+  bool merged = removed && CoalesceOrRedistribute<LeafPage>(page, ancestors.empty() ? nullptr : ancestors.back(),
+                                                            &deleted_pages, transaction);
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), removed);
+  while (merged) {
+    Page *parent_page = ancestors.back();
+    ancestors.pop_back();
+    merged = CoalesceOrRedistribute<InternalPage>(parent_page, ancestors.empty() ? nullptr : ancestors.back(),
+                                                  &deleted_pages, transaction);
+    parent_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
+  }
+  ReleaseAncestors(&ancestors, removed);
+  for (page_id_t page_id : deleted_pages) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+}
+
+/*
+ * Removes the key from its latched leaf and logs it
+ * @return : true if the leaf held the key
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::RemoveEntry(Page *page, const KeyType &key, Transaction *transaction, lsn_t undo_next_lsn) {
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int size = leaf->GetSize();
+  ValueType value;
+  // Undo inserts the value again.
+  bool logged = IsLogging(transaction) && leaf->Lookup(key, &value, comparator_);
+  bool removed = leaf->RemoveAndDeleteRecord(key, comparator_) < size;
+  if (logged) {
+    LogEntry(LogRecordType::BTREE_DELETE, page, key, value, transaction, undo_next_lsn);
+  }
+  return removed;
+}
 
 /*
  * User needs to first find the sibling of input page. If sibling's size + input
  * page's size > page's max size, then redistribute. Otherwise, merge.
  * Using template N to represent either internal page or leaf page.
- * @return: true means target leaf page should be deleted, false means no
- * deletion happens
+ * Nothing is done while the page is at least half full. The pages to delete
+ * are added to deleted_pages, to be deleted once unlatched. The changes are
+ * logged before the page and its sibling are unlatched.
+ * @param   page          the latched page of the node
+ * @param   parent_page   its latched parent unless the node is safe or the root
+ * @return : true if the page merged, removing an entry from its parent, which
+ * the caller goes on with once it unlatched this level
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
-  return false;
+bool BPLUSTREE_TYPE::CoalesceOrRedistribute(Page *page, Page *parent_page, std::vector<page_id_t> *deleted_pages,
+                                            Transaction *transaction) {
+  auto *node = reinterpret_cast<N *>(page->GetData());
+  std::vector<ChangedPage> changes;
+  std::vector<ChangedPage> *tracked = IsLogging(transaction) ? &changes : nullptr;
+  if (node->IsRootPage()) {
+    TrackPage(page, false, false, tracked);
+    if (AdjustRoot(node, tracked)) {
+      deleted_pages->push_back(node->GetPageId());
+    }
+    LogChanges(LogRecordType::BTREE_MERGE, nullptr, transaction, INVALID_LSN, tracked);
+    return false;
+  }
+  if (node->GetSize() >= node->GetMinSize()) {
+    return false;
+  }
+
+  auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  if (parent->GetSize() == 1) {
+    // The log may have ended between the levels of a merge, leaving the node without siblings. It stays as it is.
+    return false;
+  }
+  int index = parent->ValueIndex(node->GetPageId());
+  page_id_t neighbor_page_id = parent->ValueAt(index == 0 ? 1 : index - 1);
+  Page *neighbor_page = buffer_pool_manager_->FetchPage(neighbor_page_id);
+  if (index == 0) {
+    neighbor_page->WLatch();
+  } else {
+    // Siblings are latched from left to right. The node can be unlatched meanwhile: nothing reaches it but through
+    // its parent, which stays latched, or through the leaf chain, which only reads it. Its changes are logged.
+    page->WUnlatch();
+    neighbor_page->WLatch();
+    page->WLatch();
+  }
+  auto *neighbor = reinterpret_cast<N *>(neighbor_page->GetData());
+  TrackPage(page, false, false, tracked);
+  TrackPage(neighbor_page, false, false, tracked);
+  TrackPage(parent_page, false, false, tracked);
+
+  // A leaf merged into a full one would split right away.
+  int size = node->GetSize() + neighbor->GetSize();
+  bool merge = node->IsLeafPage() ? size < node->GetMaxSize() : size <= node->GetMaxSize();
+  if (!merge) {
+    Redistribute(neighbor, node, parent, index);
+  } else if (index == 0) {
+    Coalesce(node, neighbor, parent, 1, deleted_pages);
+  } else {
+    Coalesce(neighbor, node, parent, index, deleted_pages);
+  }
+  LogChanges(LogRecordType::BTREE_MERGE, nullptr, transaction, INVALID_LSN, tracked);
+  neighbor_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(neighbor_page_id, true);
+  return merge;
 }
 
 /*
  * Move all the key & value pairs from one page to its sibling page, and notify
  * buffer pool manager to delete this page. Parent page must be adjusted to
- * take info of deletion into account. Remember to deal with coalesce or
- * redistribute recursively if necessary.
+ * take info of deletion into account. The caller deals with coalesce or
+ * redistribute of the parent.
  * Using template N to represent either internal page or leaf page.
- * @param   neighbor_node      sibling page of input "node"
- * @param   node               input from method coalesceOrRedistribute()
+ * @param   neighbor_node      left sibling of input "node"
+ * @param   node               page to move into its left sibling
  * @param   parent             parent page of input "node"
- * @return  true means parent node should be deleted, false means no deletion
- * happend
+ * @param   index              index of input "node" in its parent
+ * @param   deleted_pages      the pages to delete once unlatched
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-bool BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
-                              BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent, int index,
-                              Transaction *transaction) {
-  return false;
+void BPLUSTREE_TYPE::Coalesce(N *neighbor_node, N *node, InternalPage *parent, int index,
+                              std::vector<page_id_t> *deleted_pages) {
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    node->MoveAllTo(neighbor_node);
+  } else {
+    node->MoveAllTo(neighbor_node, parent->KeyAt(index), buffer_pool_manager_);
+  }
+  deleted_pages->push_back(node->GetPageId());
+  parent->Remove(index);
 }
 
 /*
@@ -159,10 +601,28 @@ bool BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
  * Using template N to represent either internal page or leaf page.
  * @param   neighbor_node      sibling page of input "node"
  * @param   node               input from method coalesceOrRedistribute()
+ * @param   parent             parent page of input "node"
+ * @param   index              index of input "node" in its parent
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
+void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, InternalPage *parent, int index) {
+  if (index == 0) {
+    if constexpr (std::is_same_v<N, LeafPage>) {
+      neighbor_node->MoveFirstToEndOf(node);
+    } else {
+      neighbor_node->MoveFirstToEndOf(node, parent->KeyAt(1), buffer_pool_manager_);
+    }
+    parent->SetKeyAt(1, neighbor_node->KeyAt(0));
+  } else {
+    if constexpr (std::is_same_v<N, LeafPage>) {
+      neighbor_node->MoveLastToFrontOf(node);
+    } else {
+      neighbor_node->MoveLastToFrontOf(node, parent->KeyAt(index), buffer_pool_manager_);
+    }
+    parent->SetKeyAt(index, node->KeyAt(0));
+  }
+}
 /*
  * Update root page if necessary
  * NOTE: size of root page can be less than min size and this method is only
@@ -174,7 +634,29 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
  * happend
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) { return false; }
+bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node, std::vector<ChangedPage> *changes) {
+  if (!old_root_node->IsLeafPage() && old_root_node->GetSize() == 1) {
+    // The only child was unlatched after it merged, iterators may be reading it. It stays latched until the change
+    // is logged.
+    root_page_id_ = reinterpret_cast<InternalPage *>(old_root_node)->RemoveAndReturnOnlyChild();
+    Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
+    page->WLatch();
+    TrackPage(page, false, true, changes);
+    reinterpret_cast<BPlusTreePage *>(page->GetData())->SetParentPageId(INVALID_PAGE_ID);
+    if (changes == nullptr) {
+      page->WUnlatch();
+    }
+    buffer_pool_manager_->UnpinPage(root_page_id_, true);
+    UpdateRootPageId(0, changes);
+    return true;
+  }
+  if (old_root_node->IsLeafPage() && old_root_node->GetSize() == 0) {
+    root_page_id_ = INVALID_PAGE_ID;
+    UpdateRootPageId(0, changes);
+    return true;
+  }
+  return false;
+}
 
 /*****************************************************************************
  * INDEX ITERATOR
@@ -185,7 +667,13 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) { return false; }
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() {
+  Page *page = FindLeafPage(KeyType{}, true);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, page, 0);
+}
 
 /*
  * Input parameter is low key, find the leaf page that contains the input key
@@ -193,7 +681,14 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() { return INDEXITERATOR_TYPE(); }
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
+  Page *page = FindLeafPage(key);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  int index = reinterpret_cast<LeafPage *>(page->GetData())->KeyIndex(key, comparator_);
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, page, index);
+}
 
 /*
  * Input parameter is void, construct an index iterator representing the end
@@ -212,7 +707,85 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::End() { return INDEXITERATOR_TYPE(); }
  */
 INDEX_TEMPLATE_ARGUMENTS
 Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
-  throw Exception(ExceptionType::NOT_IMPLEMENTED, "Implement this for test");
+  return FindLeaf(key, Operation::READ, leftMost, nullptr);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeaf(const KeyType &key, Operation op, bool left_most, std::vector<Page *> *ancestors) {
+  bool pessimistic = ancestors != nullptr;
+  if (pessimistic) {
+    root_latch_.WLock();
+    ancestors->push_back(nullptr);
+  } else {
+    root_latch_.RLock();
+  }
+  if (root_page_id_ == INVALID_PAGE_ID) {
+    if (!pessimistic) {
+      root_latch_.RUnlock();
+    }
+    return nullptr;
+  }
+
+  Page *parent_page = nullptr;
+  page_id_t page_id = root_page_id_;
+  while (true) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    // A page stays a leaf or an internal page while it is in the tree, which the latched parent keeps it in.
+    if (pessimistic || (op != Operation::READ && node->IsLeafPage())) {
+      page->WLatch();
+    } else {
+      page->RLatch();
+    }
+    if (pessimistic) {
+      if (IsSafe(node, op, parent_page == nullptr)) {
+        ReleaseAncestors(ancestors, false);
+      }
+    } else if (parent_page == nullptr) {
+      root_latch_.RUnlock();
+    } else {
+      parent_page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), false);
+    }
+    if (node->IsLeafPage()) {
+      return page;
+    }
+    if (pessimistic) {
+      ancestors->push_back(page);
+    }
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    page_id = left_most ? internal->ValueAt(0) : internal->Lookup(key, comparator_);
+    parent_page = page;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsSafe(BPlusTreePage *node, Operation op, bool is_root) const {
+  switch (op) {
+    case Operation::INSERT:
+      return node->IsLeafPage() ? node->GetSize() + 1 < node->GetMaxSize() : node->GetSize() < node->GetMaxSize();
+    case Operation::REMOVE:
+      if (is_root) {
+        // A root leaf may shrink down to one key, a root internal page down to two children.
+        return node->GetSize() > (node->IsLeafPage() ? 1 : 2);
+      }
+      return node->GetSize() > node->GetMinSize();
+    default:
+      return true;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleaseAncestors(std::vector<Page *> *ancestors, bool is_dirty) {
+  for (Page *page : *ancestors) {
+    if (page == nullptr) {
+      root_latch_.WUnlock();
+    } else {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), is_dirty);
+    }
+  }
+  ancestors->clear();
 }
 
 /*
@@ -222,20 +795,109 @@ Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
  * @parameter: insert_record      defualt value is false. When set to true,
  * insert a record <index_name, root_page_id> into header page instead of
  * updating it.
+ * @parameter: changes      the pages changed by the split or merge, which
+ * the header page stays latched among until they are logged
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
+void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record, std::vector<ChangedPage> *changes) {
   HeaderPage *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
-  if (insert_record != 0) {
-    // create a new record<index_name + root_page_id> in header_page
-    header_page->InsertRecord(index_name_, root_page_id_);
-  } else {
+  // Several trees share the header page.
+  header_page->WLatch();
+  TrackPage(header_page, false, true, changes);
+  // A tree emptied before has its record still.
+  if (insert_record == 0 || !header_page->InsertRecord(index_name_, root_page_id_)) {
     // update root_page_id in header_page
     header_page->UpdateRecord(index_name_, root_page_id_);
   }
+  if (changes == nullptr) {
+    header_page->WUnlatch();
+  }
   buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+BPlusTreeLayout BPLUSTREE_TYPE::GetLayout() const {
+  BPlusTreeLayout layout;
+  layout.key_size_ = sizeof(KeyType);
+  layout.entry_size_ = sizeof(MappingType);
+  layout.leaf_max_size_ = leaf_max_size_;
+  layout.internal_max_size_ = internal_max_size_;
+  return layout;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::TrackPage(Page *page, bool new_page, bool latched, std::vector<ChangedPage> *changes) {
+  if (changes == nullptr) {
+    return;
+  }
+  for (const auto &changed : *changes) {
+    if (changed.page_ == page) {
+      return;
+    }
+  }
+  buffer_pool_manager_->FetchPage(page->GetPageId());
+  changes->push_back({page, new_page, latched, std::vector<char>(page->GetData(), page->GetData() + PAGE_SIZE)});
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogChanges(LogRecordType log_record_type, const MappingType *entry, Transaction *transaction,
+                                lsn_t undo_next_lsn, std::vector<ChangedPage> *changes) {
+  if (changes == nullptr) {
+    return;
+  }
+  // Merges are not undone with the transaction.
+  bool merge = log_record_type == LogRecordType::BTREE_MERGE;
+  LogRecord log_record(merge ? INVALID_TXN_ID : transaction->GetTransactionId(),
+                       merge ? INVALID_LSN : transaction->GetPrevLSN(), log_record_type, index_name_, GetLayout(),
+                       INVALID_PAGE_ID, 0, reinterpret_cast<const char *>(entry));
+  for (const auto &changed : *changes) {
+    log_record.AddTreePage(changed.page_->GetPageId(), changed.new_page_, changed.old_data_.data(),
+                           changed.page_->GetData(), PAGE_SIZE);
+  }
+  bool changed_any = log_record.HasTreeChanges();
+  lsn_t lsn = INVALID_LSN;
+  if (changed_any) {
+    lsn = AppendLogRecord(transaction, &log_record, merge ? INVALID_LSN : undo_next_lsn);
+  }
+  for (const auto &changed : *changes) {
+    if (changed_any) {
+      changed.page_->SetLSN(lsn);
+    }
+    if (changed.latched_) {
+      changed.page_->WUnlatch();
+    }
+    buffer_pool_manager_->UnpinPage(changed.page_->GetPageId(), changed_any);
+  }
+  changes->clear();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogEntry(LogRecordType log_record_type, Page *page, const KeyType &key, const ValueType &value,
+                              Transaction *transaction, lsn_t undo_next_lsn) {
+  if (!IsLogging(transaction)) {
+    return;
+  }
+  // The entry is at the index of its key once inserted, and the key's index is where it was once removed.
+  MappingType entry(key, value);
+  int index = reinterpret_cast<LeafPage *>(page->GetData())->KeyIndex(key, comparator_);
+  LogRecord log_record(transaction->GetTransactionId(), transaction->GetPrevLSN(), log_record_type, index_name_,
+                       GetLayout(), page->GetPageId(), index, reinterpret_cast<const char *>(&entry));
+  page->SetLSN(AppendLogRecord(transaction, &log_record, undo_next_lsn));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+lsn_t BPLUSTREE_TYPE::AppendLogRecord(Transaction *transaction, LogRecord *log_record, lsn_t undo_next_lsn) {
+  if (undo_next_lsn != INVALID_LSN) {
+    log_record->SetCompensation(undo_next_lsn);
+  }
+  lsn_t lsn = log_manager_->AppendLogRecord(log_record);
+  if (log_record->GetTxnId() != INVALID_TXN_ID) {
+    transaction->SetPrevLSN(lsn);
+  }
+  transaction->AddLogBytes(log_record->GetSize());
+  return lsn;
+}
+
 /*
  * This method is used for test only
  * Read data from file and insert one by one
@@ -16,17 +16,25 @@ namespace bustub {
  * Constructor
  */
 INDEX_TEMPLATE_ARGUMENTS
-BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager)
+BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                                     LockManager *lock_manager, LogManager *log_manager)
     : Index(std::move(metadata)),
       comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_) {}
+      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE,
+                 log_manager),
+      lock_manager_(lock_manager),
+      range_locks_(comparator_, lock_manager) {}
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct insert index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, *GetKeySchema());
 
+  if (LocksWrites(transaction) && !range_locks_.LockKey(transaction, LockMode::EXCLUSIVE, index_key)) {
+    transaction->SetState(TransactionState::ABORTED);
+    return;
+  }
   container_.Insert(index_key, rid, transaction);
 }
 
@@ -34,8 +42,12 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct delete index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, *GetKeySchema());
 
+  if (LocksWrites(transaction) && !range_locks_.LockKey(transaction, LockMode::EXCLUSIVE, index_key)) {
+    transaction->SetState(TransactionState::ABORTED);
+    return;
+  }
   container_.Remove(index_key, transaction);
 }
 
@@ -43,11 +55,47 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
   // construct scan index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, *GetKeySchema());
 
+  // A missing key stays locked too, so that it is still missing when read again.
+  if (LocksReads(transaction) && !range_locks_.LockKey(transaction, LockMode::SHARED, index_key)) {
+    return;
+  }
   container_.GetValue(index_key, result, transaction);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::BulkLoad(const std::function<bool(Tuple *, RID *)> &next_entry, Transaction *transaction) {
+  Tuple key;
+  RID rid;
+  container_.BulkLoad([&](MappingType *entry) {
+    if (!next_entry(&key, &rid)) {
+      return false;
+    }
+    entry->first.SetFromKey(key, *GetKeySchema());
+    entry->second = rid;
+    return true;
+  });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_INDEX_TYPE::ScanRange(const Tuple &low, const Tuple &high, std::vector<RID> *result,
+                                     Transaction *transaction) {
+  KeyType low_key;
+  low_key.SetFromKey(low, *GetKeySchema());
+  KeyType high_key;
+  high_key.SetFromKey(high, *GetKeySchema());
+
+  // The range is locked before it is read, entries inserted into it afterwards wait for the transaction to end.
+  if (LocksReads(transaction) && !range_locks_.LockRange(transaction, LockMode::SHARED, low_key, high_key)) {
+    return false;
+  }
+  for (auto it = container_.Begin(low_key); !it.IsEnd() && comparator_((*it).first, high_key) <= 0; ++it) {
+    result->push_back((*it).second);
+  }
+  return true;
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator() { return container_.Begin(); }
 
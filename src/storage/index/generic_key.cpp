@@ -0,0 +1,198 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// generic_key.cpp
+//
+// Identification: src/storage/index/generic_key.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/generic_key.h"
+
+#include <string>
+
+#include "common/exception.h"
+
+namespace bustub {
+
+namespace {
+
+constexpr uint64_t SIGN_BIT = 1ULL << 63;
+
+/** Writes the low bytes of a word big endian. */
+void WriteBigEndian(uint64_t word, size_t size, char *data) {
+  for (size_t i = 0; i < size; i++) {
+    data[i] = static_cast<char>(word >> (8 * (size - 1 - i)));
+  }
+}
+
+/** Reads a word written big endian. */
+uint64_t ReadBigEndian(const char *data, size_t size) {
+  uint64_t word = 0;
+  for (size_t i = 0; i < size; i++) {
+    word = word << 8 | static_cast<uint8_t>(data[i]);
+  }
+  return word;
+}
+
+/** Reads a native integer of a size into a word. */
+uint64_t ReadNative(const char *data, size_t size) {
+  switch (size) {
+    case 1:
+      return *reinterpret_cast<const uint8_t *>(data);
+    case 2:
+      return *reinterpret_cast<const uint16_t *>(data);
+    case 4:
+      return *reinterpret_cast<const uint32_t *>(data);
+    default:
+      return *reinterpret_cast<const uint64_t *>(data);
+  }
+}
+
+/** Writes the low bytes of a word as a native integer of a size. */
+void WriteNative(uint64_t word, size_t size, char *data) {
+  switch (size) {
+    case 1:
+      *reinterpret_cast<uint8_t *>(data) = static_cast<uint8_t>(word);
+      break;
+    case 2:
+      *reinterpret_cast<uint16_t *>(data) = static_cast<uint16_t>(word);
+      break;
+    case 4:
+      *reinterpret_cast<uint32_t *>(data) = static_cast<uint32_t>(word);
+      break;
+    default:
+      *reinterpret_cast<uint64_t *>(data) = word;
+  }
+}
+
+/** @return the bit of a type that is flipped for its encoding to sort as its values, 0 if there is none */
+uint64_t FlippedBit(TypeId type, size_t size) {
+  switch (type) {
+    case TypeId::BOOLEAN:
+    case TypeId::TINYINT:
+    case TypeId::SMALLINT:
+    case TypeId::INTEGER:
+    case TypeId::BIGINT:
+      return 1ULL << (8 * size - 1);
+    default:
+      return 0;
+  }
+}
+
+/** @return the size of an encoded varchar */
+size_t VarcharSize(const char *data) {
+  if (data[0] == 0) {
+    return 1;
+  }
+  size_t i = 1;
+  while (data[i] != 0 || data[i + 1] != 0) {
+    i += data[i] == 0 ? 2 : 1;
+  }
+  return i + 2;
+}
+
+}  // namespace
+
+void KeyCodec::Encode(const Tuple &key, const Schema &key_schema, char *data, size_t size) {
+  size_t used = 0;
+  auto reserve = [&](size_t bytes) {
+    if (used + bytes > size) {
+      throw Exception(ExceptionType::OUT_OF_RANGE, "Key does not fit the size of the index key.");
+    }
+  };
+  for (const auto &column : key_schema.GetColumns()) {
+    const char *value = key.GetData() + column.GetOffset();
+    if (column.GetType() == TypeId::VARCHAR) {
+      value = key.GetData() + *reinterpret_cast<const uint32_t *>(value);
+      uint32_t length = *reinterpret_cast<const uint32_t *>(value);
+      reserve(1);
+      if (length == BUSTUB_VALUE_NULL) {
+        data[used++] = 0;
+        continue;
+      }
+      data[used++] = 1;
+      // The length counts the terminating zero byte of the characters.
+      for (uint32_t i = 0; i + 1 < length; i++) {
+        char c = value[sizeof(uint32_t) + i];
+        reserve(c == 0 ? 2 : 1);
+        data[used++] = c;
+        if (c == 0) {
+          data[used++] = static_cast<char>(0xFF);
+        }
+      }
+      reserve(2);
+      data[used++] = 0;
+      data[used++] = 0;
+      continue;
+    }
+
+    size_t column_size = column.GetFixedLength();
+    reserve(column_size);
+    uint64_t word;
+    if (column.GetType() == TypeId::DECIMAL) {
+      // Zero and negative zero are equal, and encoded alike.
+      double decimal = *reinterpret_cast<const double *>(value);
+      decimal = decimal == 0 ? 0 : decimal;
+      memcpy(&word, &decimal, sizeof(word));
+      word = (word & SIGN_BIT) != 0 ? ~word : word ^ SIGN_BIT;
+    } else {
+      word = ReadNative(value, column_size) ^ FlippedBit(column.GetType(), column_size);
+    }
+    WriteBigEndian(word, column_size, data + used);
+    used += column_size;
+  }
+  memset(data + used, 0, size - used);
+}
+
+Value KeyCodec::Decode(const char *data, const Schema &key_schema, uint32_t column_idx) {
+  // The varchars before the column make its offset vary.
+  for (uint32_t i = 0; i < column_idx; i++) {
+    const auto &column = key_schema.GetColumn(i);
+    data += column.GetType() == TypeId::VARCHAR ? VarcharSize(data) : column.GetFixedLength();
+  }
+
+  const auto &column = key_schema.GetColumn(column_idx);
+  if (column.GetType() == TypeId::VARCHAR) {
+    if (data[0] == 0) {
+      return Value(TypeId::VARCHAR, nullptr, 0, false);
+    }
+    std::string characters;
+    for (size_t i = 1; data[i] != 0 || data[i + 1] != 0; i += data[i] == 0 ? 2 : 1) {
+      characters.push_back(data[i]);
+    }
+    return Value(TypeId::VARCHAR, characters);
+  }
+
+  size_t column_size = column.GetFixedLength();
+  uint64_t word = ReadBigEndian(data, column_size);
+  if (column.GetType() == TypeId::DECIMAL) {
+    word = (word & SIGN_BIT) != 0 ? word ^ SIGN_BIT : ~word;
+  } else {
+    word ^= FlippedBit(column.GetType(), column_size);
+  }
+  char value[sizeof(uint64_t)];
+  WriteNative(word, column_size, value);
+  return Value::DeserializeFrom(value, column.GetType());
+}
+
+void KeyCodec::EncodeBigInt(int64_t value, char *data) {
+  WriteBigEndian(static_cast<uint64_t>(value) ^ SIGN_BIT, sizeof(int64_t), data);
+}
+
+int64_t KeyCodec::DecodeBigInt(const char *data) {
+  return static_cast<int64_t>(ReadBigEndian(data, sizeof(int64_t)) ^ SIGN_BIT);
+}
+
+void KeyCodec::EncodeInteger(int32_t value, char *data) {
+  WriteBigEndian(static_cast<uint32_t>(value) ^ FlippedBit(TypeId::INTEGER, sizeof(int32_t)), sizeof(int32_t), data);
+}
+
+int32_t KeyCodec::DecodeInteger(const char *data) {
+  return static_cast<int32_t>(ReadBigEndian(data, sizeof(int32_t)) ^ FlippedBit(TypeId::INTEGER, sizeof(int32_t)));
+}
+
+}  // namespace bustub
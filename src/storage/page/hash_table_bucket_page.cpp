@@ -10,6 +10,13 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include "storage/page/hash_table_bucket_page.h"
 #include "common/logger.h"
 #include "common/util/hash_util.h"
@@ -22,60 +29,52 @@ namespace bustub {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) {
   bool find_key = false;
-  for (size_t bucket_idx = 0; bucket_idx < BUCKET_ARRAY_SIZE; bucket_idx++) {
-    if (!IsOccupied(bucket_idx)) {
-      break;
-    }
-    if (IsReadable(bucket_idx) && cmp(key, array_[bucket_idx].first) == 0) {
+  ForEachMatch(FingerprintOf(key), [&](uint32_t bucket_idx) {
+    if (cmp(key, array_[bucket_idx].first) == 0) {
       result->push_back(array_[bucket_idx].second);
       find_key = true;
     }
-  }
+    return false;
+  });
   return find_key;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_BUCKET_TYPE::Insert(KeyType key, ValueType value, KeyComparator cmp) {
-  if (IsFull() || CheckKeyValueExist(key, value, cmp)) {
+bool HASH_TABLE_BUCKET_TYPE::Insert(KeyType key, ValueType value, KeyComparator cmp, uint32_t *bucket_idx) {
+  uint8_t fingerprint = FingerprintOf(key);
+  if (FindEntry(key, value, cmp, fingerprint) != BUCKET_ARRAY_SIZE) {
     return false;
   }
-  for (size_t bucket_idx = 0; bucket_idx < BUCKET_ARRAY_SIZE; bucket_idx++) {
-    if (!IsOccupied(bucket_idx)) {
-      SetOccupied(bucket_idx);
-      SetReadable(bucket_idx);
-      array_[bucket_idx] = std::make_pair(key, value);
-      break;
-    }
-    if (!IsReadable(bucket_idx)) {
-      SetReadable(bucket_idx);
-      array_[bucket_idx] = std::make_pair(key, value);
-      break;
-    }
+  uint32_t idx = FirstFreeIndex();
+  if (idx == BUCKET_ARRAY_SIZE) {
+    return false;
+  }
+  array_[idx] = std::make_pair(key, value);
+  fingerprints_[idx] = fingerprint;
+  SetOccupied(idx);
+  SetReadable(idx);
+  if (bucket_idx != nullptr) {
+    *bucket_idx = idx;
   }
   return true;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator cmp) {
-  for (size_t bucket_idx = 0; bucket_idx < BUCKET_ARRAY_SIZE; bucket_idx++) {
-    if (IsOccupied(bucket_idx) && IsReadable(bucket_idx) && cmp(array_[bucket_idx].first, key) == 0 &&
-        array_[bucket_idx].second == value) {
-      RemoveAt(bucket_idx);
-      return true;
-    }
+bool HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator cmp, uint32_t *bucket_idx) {
+  uint32_t idx = FindEntry(key, value, cmp, FingerprintOf(key));
+  if (idx == BUCKET_ARRAY_SIZE) {
+    return false;
+  }
+  RemoveAt(idx);
+  if (bucket_idx != nullptr) {
+    *bucket_idx = idx;
   }
-  return false;
+  return true;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_BUCKET_TYPE::CheckKeyValueExist(KeyType key, ValueType value, KeyComparator cmp) {
-  for (size_t bucket_idx = 0; bucket_idx < BUCKET_ARRAY_SIZE; bucket_idx++) {
-    if (IsOccupied(bucket_idx) && IsReadable(bucket_idx) && cmp(array_[bucket_idx].first, key) == 0 &&
-        array_[bucket_idx].second == value) {
-      return true;
-    }
-  }
-  return false;
+  return FindEntry(key, value, cmp, FingerprintOf(key)) != BUCKET_ARRAY_SIZE;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
@@ -117,24 +116,15 @@ void HASH_TABLE_BUCKET_TYPE::SetReadable(uint32_t bucket_idx) {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_BUCKET_TYPE::IsFull() {
-  for (size_t bucket_idx = 0; bucket_idx < BUCKET_ARRAY_SIZE; bucket_idx++) {
-    if (!IsOccupied(bucket_idx) || !IsReadable(bucket_idx)) {
-      return false;
-    }
-  }
-  return true;
+  return FirstFreeIndex() == BUCKET_ARRAY_SIZE;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 uint32_t HASH_TABLE_BUCKET_TYPE::NumReadable() {
+  // Readable entries are occupied, and the bits past the last entry are never set.
   uint32_t num = 0;
-  for (size_t bucket_idx = 0; bucket_idx < BUCKET_ARRAY_SIZE; bucket_idx++) {
-    if (!IsOccupied(bucket_idx)) {
-      break;
-    }
-    if (IsReadable(bucket_idx)) {
-      num++;
-    }
+  for (char bits : readable_) {
+    num += __builtin_popcount(static_cast<uint8_t>(bits));
   }
   return num;
 }
@@ -175,6 +165,95 @@ void HASH_TABLE_BUCKET_TYPE::PrintBucket() {
   LOG_INFO("Bucket Capacity: %lu, Size: %u, Taken: %u, Free: %u", BUCKET_ARRAY_SIZE, size, taken, free);
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HashTableBucketLayout HASH_TABLE_BUCKET_TYPE::GetLayout() {
+  static_assert(offsetof(HASH_TABLE_BUCKET_TYPE, occupied_) == HashTableBucketLayout::OFFSET_OCCUPIED);
+  static_assert(offsetof(HASH_TABLE_BUCKET_TYPE, fingerprints_) ==
+                HashTableBucketLayout::OFFSET_OCCUPIED + 2 * ((BUCKET_ARRAY_SIZE - 1) / 8 + 1));
+  static_assert(offsetof(HASH_TABLE_BUCKET_TYPE, array_) + BUCKET_ARRAY_SIZE * sizeof(MappingType) <= PAGE_SIZE);
+  HashTableBucketLayout layout;
+  layout.capacity_ = BUCKET_ARRAY_SIZE;
+  layout.entry_size_ = sizeof(MappingType);
+  layout.array_offset_ = offsetof(HASH_TABLE_BUCKET_TYPE, array_);
+  layout.key_size_ = sizeof(KeyType);
+  return layout;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint8_t HASH_TABLE_BUCKET_TYPE::FingerprintOf(const KeyType &key) {
+  return HashTableBucketLayout::Fingerprint(reinterpret_cast<const char *>(&key), sizeof(KeyType));
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint32_t HASH_TABLE_BUCKET_TYPE::GroupBits(const char *bitmap, uint32_t group_start) {
+  constexpr uint32_t bitmap_size = (BUCKET_ARRAY_SIZE - 1) / 8 + 1;
+  uint32_t bits = 0;
+  for (uint32_t i = 0; i < GROUP_SIZE / 8 && group_start / 8 + i < bitmap_size; i++) {
+    bits |= static_cast<uint32_t>(static_cast<uint8_t>(bitmap[group_start / 8 + i])) << (8 * i);
+  }
+  return bits;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint32_t HASH_TABLE_BUCKET_TYPE::MatchFingerprints(uint32_t group_start, uint8_t fingerprint) const {
+  // The last group reads past the fingerprints into the entries, which stay in the page. The readable bits of an
+  // entry past the last one are never set.
+#if defined(__AVX2__)
+  __m256i group = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(fingerprints_ + group_start));
+  __m256i matches = _mm256_cmpeq_epi8(group, _mm256_set1_epi8(static_cast<char>(fingerprint)));
+  return static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+#elif defined(__SSE2__)
+  __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(fingerprints_ + group_start));
+  __m128i matches = _mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(fingerprint)));
+  return static_cast<uint32_t>(_mm_movemask_epi8(matches));
+#else
+  uint32_t matches = 0;
+  for (uint32_t i = 0; i < GROUP_SIZE && group_start + i < BUCKET_ARRAY_SIZE; i++) {
+    matches |= static_cast<uint32_t>(fingerprints_[group_start + i] == fingerprint) << i;
+  }
+  return matches;
+#endif
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename Visitor>
+uint32_t HASH_TABLE_BUCKET_TYPE::ForEachMatch(uint8_t fingerprint, Visitor visit) const {
+  for (uint32_t group_start = 0; group_start < BUCKET_ARRAY_SIZE; group_start += GROUP_SIZE) {
+    // Occupied entries form a prefix, no entry after a group without any is either.
+    if (GroupBits(occupied_, group_start) == 0) {
+      break;
+    }
+    uint32_t matches = MatchFingerprints(group_start, fingerprint) & GroupBits(readable_, group_start);
+    for (; matches != 0; matches &= matches - 1) {
+      uint32_t bucket_idx = group_start + __builtin_ctz(matches);
+      if (visit(bucket_idx)) {
+        return bucket_idx;
+      }
+    }
+  }
+  return BUCKET_ARRAY_SIZE;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint32_t HASH_TABLE_BUCKET_TYPE::FindEntry(const KeyType &key, const ValueType &value, KeyComparator cmp,
+                                           uint8_t fingerprint) const {
+  return ForEachMatch(fingerprint, [&](uint32_t bucket_idx) {
+    return cmp(array_[bucket_idx].first, key) == 0 && array_[bucket_idx].second == value;
+  });
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint32_t HASH_TABLE_BUCKET_TYPE::FirstFreeIndex() const {
+  for (uint32_t i = 0; i < sizeof(readable_); i++) {
+    auto free = static_cast<uint8_t>(~readable_[i]);
+    if (free != 0) {
+      // The bits past the last entry are free too.
+      return std::min<uint32_t>(i * 8 + __builtin_ctz(free), BUCKET_ARRAY_SIZE);
+    }
+  }
+  return BUCKET_ARRAY_SIZE;
+}
+
 // DO NOT REMOVE ANYTHING BELOW THIS LINE
 template class HashTableBucketPage<int, int, IntComparator>;
 
@@ -16,6 +16,8 @@
 #include "common/logger.h"
 
 namespace bustub {
+static_assert(DIRECTORY_ARRAY_SIZE == 1 << DIRECTORY_MAX_DEPTH);
+
 page_id_t HashTableDirectoryPage::GetPageId() const { return page_id_; }
 
 void HashTableDirectoryPage::SetPageId(bustub::page_id_t page_id) { page_id_ = page_id; }
@@ -38,6 +40,10 @@ uint32_t HashTableDirectoryPage::GetGlobalDepthMask() {
   return mask;
 }
 
+uint32_t HashTableDirectoryPage::HashToHeaderIndex(uint32_t hash) {
+  return (hash >> DIRECTORY_MAX_DEPTH) & GetGlobalDepthMask();
+}
+
 void HashTableDirectoryPage::IncrGlobalDepth() {
   global_depth_++;
   uint32_t mask = GetGlobalDepthMask();
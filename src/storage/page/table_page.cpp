@@ -21,12 +21,13 @@ void TablePage::Init(page_id_t page_id, uint32_t page_size, page_id_t prev_page_
   // Set the page ID.
   memcpy(GetData(), &page_id, sizeof(page_id));
   // Log that we are creating a new page.
-  if (enable_logging) {
+  if (enable_logging && txn != nullptr) {
     LogRecord log_record =
         LogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::NEWPAGE, prev_page_id, page_id);
     lsn_t lsn = log_manager->AppendLogRecord(&log_record);
     SetLSN(lsn);
     txn->SetPrevLSN(lsn);
+    txn->AddLogBytes(log_record.GetSize());
   }
   // Set the previous and next page IDs.
   SetPrevPageId(prev_page_id);
@@ -72,15 +73,18 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, Lock
   }
 
   // Write the log record.
-  if (enable_logging) {
-    BUSTUB_ASSERT(!txn->IsSharedLocked(*rid) && !txn->IsExclusiveLocked(*rid), "A new tuple should not be locked.");
-    // Acquire an exclusive lock on the new tuple.
-    bool locked = lock_manager->LockExclusive(txn, *rid);
-    BUSTUB_ASSERT(locked, "Locking a new tuple should always work.");
+  if (enable_logging && txn != nullptr) {
+    BUSTUB_ASSERT(!txn->IsSharedLocked(*rid), "A new tuple should not be locked.");
+    // Acquire an exclusive lock on the new tuple. Rolling back a delete may reuse a slot the transaction still holds.
+    if (lock_manager != nullptr && !txn->IsExclusiveLocked(*rid)) {
+      bool locked = lock_manager->LockExclusive(txn, *rid);
+      BUSTUB_ASSERT(locked, "Locking a new tuple should always work.");
+    }
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERT, *rid, tuple);
     lsn_t lsn = log_manager->AppendLogRecord(&log_record);
     SetLSN(lsn);
     txn->SetPrevLSN(lsn);
+    txn->AddLogBytes(log_record.GetSize());
   }
   return true;
 }
@@ -89,7 +93,7 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_m
   uint32_t slot_num = rid.GetSlotNum();
   // If the slot number is invalid, abort the transaction.
   if (slot_num >= GetTupleCount()) {
-    if (enable_logging) {
+    if (enable_logging && txn != nullptr) {
       txn->SetState(TransactionState::ABORTED);
     }
     return false;
@@ -98,19 +102,20 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_m
   uint32_t tuple_size = GetTupleSize(slot_num);
   // If the tuple is already deleted, abort the transaction.
   if (IsDeleted(tuple_size)) {
-    if (enable_logging) {
+    if (enable_logging && txn != nullptr) {
       txn->SetState(TransactionState::ABORTED);
     }
     return false;
   }
 
-  if (enable_logging) {
-    // Acquire an exclusive lock, upgrading from a shared lock if necessary.
-    if (txn->IsSharedLocked(rid)) {
+  if (enable_logging && txn != nullptr) {
+    // Acquire an exclusive lock, upgrading from a shared lock if necessary. Without a lock manager, the caller has
+    // locked the tuple already.
+    if (lock_manager != nullptr && txn->IsSharedLocked(rid)) {
       if (!lock_manager->LockUpgrade(txn, rid)) {
         return false;
       }
-    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
+    } else if (lock_manager != nullptr && !txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
       return false;
     }
     Tuple dummy_tuple;
@@ -118,6 +123,7 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_m
     lsn_t lsn = log_manager->AppendLogRecord(&log_record);
     SetLSN(lsn);
     txn->SetPrevLSN(lsn);
+    txn->AddLogBytes(log_record.GetSize());
   }
 
   // Mark the tuple as deleted.
@@ -133,7 +139,7 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID
   uint32_t slot_num = rid.GetSlotNum();
   // If the slot number is invalid, abort the transaction.
   if (slot_num >= GetTupleCount()) {
-    if (enable_logging) {
+    if (enable_logging && txn != nullptr) {
       txn->SetState(TransactionState::ABORTED);
     }
     return false;
@@ -141,7 +147,7 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID
   uint32_t tuple_size = GetTupleSize(slot_num);
   // If the tuple is deleted, abort the transaction.
   if (IsDeleted(tuple_size)) {
-    if (enable_logging) {
+    if (enable_logging && txn != nullptr) {
       txn->SetState(TransactionState::ABORTED);
     }
     return false;
@@ -151,30 +157,33 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID
     return false;
   }
 
-  // Copy out the old value.
+  // Copy out the old value. A transaction keeps it as its undo image until it ends, so it goes into its arena.
   uint32_t tuple_offset = GetTupleOffsetAtSlot(slot_num);
   old_tuple->size_ = tuple_size;
   if (old_tuple->allocated_) {
     delete[] old_tuple->data_;
   }
-  old_tuple->data_ = new char[old_tuple->size_];
+  old_tuple->allocated_ = txn == nullptr;
+  old_tuple->data_ = txn == nullptr ? new char[old_tuple->size_] : txn->GetArena()->Allocate(old_tuple->size_);
   memcpy(old_tuple->data_, GetData() + tuple_offset, old_tuple->size_);
   old_tuple->rid_ = rid;
-  old_tuple->allocated_ = true;
 
-  if (enable_logging) {
-    // Acquire an exclusive lock, upgrading from shared if necessary.
-    if (txn->IsSharedLocked(rid)) {
+  if (enable_logging && txn != nullptr) {
+    // Acquire an exclusive lock, upgrading from shared if necessary, unless the caller has locked the tuple.
+    if (lock_manager != nullptr && txn->IsSharedLocked(rid)) {
       if (!lock_manager->LockUpgrade(txn, rid)) {
         return false;
       }
-    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
+    } else if (lock_manager != nullptr && !txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
       return false;
     }
-    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::UPDATE, rid, *old_tuple, new_tuple);
+    // Only the changed bytes are logged if the tuple keeps its size.
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::UPDATE_DELTA, rid, *old_tuple,
+                         new_tuple);
     lsn_t lsn = log_manager->AppendLogRecord(&log_record);
     SetLSN(lsn);
     txn->SetPrevLSN(lsn);
+    txn->AddLogBytes(log_record.GetSize());
   }
 
   // Perform the update.
@@ -217,13 +226,14 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_ma
   delete_tuple.rid_ = rid;
   delete_tuple.allocated_ = true;
 
-  if (enable_logging) {
-    BUSTUB_ASSERT(txn->IsExclusiveLocked(rid), "We must own the exclusive lock!");
+  if (enable_logging && txn != nullptr) {
+    BUSTUB_ASSERT(txn->IsExclusiveLocked(rid) || !txn->TakesLocks(), "We must own the exclusive lock!");
 
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::APPLYDELETE, rid, delete_tuple);
     lsn_t lsn = log_manager->AppendLogRecord(&log_record);
     SetLSN(lsn);
     txn->SetPrevLSN(lsn);
+    txn->AddLogBytes(log_record.GetSize());
   }
 
   uint32_t free_space_pointer = GetFreeSpacePointer();
@@ -246,13 +256,14 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_ma
 
 void TablePage::RollbackDelete(const RID &rid, Transaction *txn, LogManager *log_manager) {
   // Log the rollback.
-  if (enable_logging) {
-    BUSTUB_ASSERT(txn->IsExclusiveLocked(rid), "We must own an exclusive lock on the RID.");
+  if (enable_logging && txn != nullptr) {
+    BUSTUB_ASSERT(txn->IsExclusiveLocked(rid) || !txn->TakesLocks(), "We must own an exclusive lock on the RID.");
     Tuple dummy_tuple;
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ROLLBACKDELETE, rid, dummy_tuple);
     lsn_t lsn = log_manager->AppendLogRecord(&log_record);
     SetLSN(lsn);
     txn->SetPrevLSN(lsn);
+    txn->AddLogBytes(log_record.GetSize());
   }
 
   uint32_t slot_num = rid.GetSlotNum();
@@ -265,12 +276,33 @@ void TablePage::RollbackDelete(const RID &rid, Transaction *txn, LogManager *log
   }
 }
 
+bool TablePage::RestoreTuple(const Tuple &tuple, const RID &rid) {
+  BUSTUB_ASSERT(tuple.size_ > 0, "Cannot have empty tuples.");
+  uint32_t slot_num = rid.GetSlotNum();
+  bool new_slot = slot_num == GetTupleCount();
+  if (slot_num > GetTupleCount() || (!new_slot && GetTupleSize(slot_num) != 0)) {
+    return false;
+  }
+  if (GetFreeSpaceRemaining() < tuple.size_ + (new_slot ? SIZE_TUPLE : 0)) {
+    return false;
+  }
+
+  SetFreeSpacePointer(GetFreeSpacePointer() - tuple.size_);
+  memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
+  SetTupleOffsetAtSlot(slot_num, GetFreeSpacePointer());
+  SetTupleSize(slot_num, tuple.size_);
+  if (new_slot) {
+    SetTupleCount(GetTupleCount() + 1);
+  }
+  return true;
+}
+
 bool TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager) {
   // Get the current slot number.
   uint32_t slot_num = rid.GetSlotNum();
   // If somehow we have more slots than tuples, abort the transaction.
   if (slot_num >= GetTupleCount()) {
-    if (enable_logging) {
+    if (enable_logging && txn != nullptr) {
       txn->SetState(TransactionState::ABORTED);
     }
     return false;
@@ -279,15 +311,16 @@ bool TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockMan
   uint32_t tuple_size = GetTupleSize(slot_num);
   // If the tuple is deleted, abort the transaction.
   if (IsDeleted(tuple_size)) {
-    if (enable_logging) {
+    if (enable_logging && txn != nullptr) {
       txn->SetState(TransactionState::ABORTED);
     }
     return false;
   }
 
-  // Otherwise we have a valid tuple, try to acquire at least a shared lock.
-  if (enable_logging) {
-    if (!txn->IsSharedLocked(rid) && !txn->IsExclusiveLocked(rid) && !lock_manager->LockShared(txn, rid)) {
+  // Otherwise we have a valid tuple, try to acquire at least a shared lock unless reading uncommitted data.
+  if (enable_logging && txn != nullptr) {
+    if (lock_manager != nullptr && txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED &&
+        !txn->IsSharedLocked(rid) && !txn->IsExclusiveLocked(rid) && !lock_manager->LockShared(txn, rid)) {
       return false;
     }
   }
@@ -305,10 +338,10 @@ bool TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockMan
   return true;
 }
 
-bool TablePage::GetFirstTupleRid(RID *first_rid) {
+bool TablePage::GetFirstTupleRid(RID *first_rid, bool include_deleted) {
   // Find and return the first valid tuple.
   for (uint32_t i = 0; i < GetTupleCount(); ++i) {
-    if (!IsDeleted(GetTupleSize(i))) {
+    if (include_deleted || !IsDeleted(GetTupleSize(i))) {
       first_rid->Set(GetTablePageId(), i);
       return true;
     }
@@ -317,11 +350,11 @@ bool TablePage::GetFirstTupleRid(RID *first_rid) {
   return false;
 }
 
-bool TablePage::GetNextTupleRid(const RID &cur_rid, RID *next_rid) {
+bool TablePage::GetNextTupleRid(const RID &cur_rid, RID *next_rid, bool include_deleted) {
   BUSTUB_ASSERT(cur_rid.GetPageId() == GetTablePageId(), "Wrong table!");
   // Find and return the first valid tuple after our current slot number.
   for (auto i = cur_rid.GetSlotNum() + 1; i < GetTupleCount(); ++i) {
-    if (!IsDeleted(GetTupleSize(i))) {
+    if (include_deleted || !IsDeleted(GetTupleSize(i))) {
       next_rid->Set(GetTablePageId(), i);
       return true;
     }
@@ -25,8 +25,11 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_m
       first_page_id_(first_page_id) {}
 
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-                     Transaction *txn)
-    : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager), log_manager_(log_manager) {
+                     Transaction *txn, std::optional<table_oid_t> table_oid)
+    : buffer_pool_manager_(buffer_pool_manager),
+      lock_manager_(lock_manager),
+      log_manager_(log_manager),
+      table_oid_(table_oid) {
   // Initialize the first table page.
   auto first_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->NewPage(&first_page_id_));
   BUSTUB_ASSERT(first_page != nullptr, "Couldn't create a page for the table heap.");
@@ -37,11 +40,24 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_m
 }
 
 bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
+  RejectReadOnlyWrite(txn);
   if (tuple.size_ + 32 > PAGE_SIZE) {  // larger than one page size
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
 
+  // The new tuple is locked while the page is latched, so the table lock must not block there. Optimistic
+  // transactions insert right away without locking, the new tuple is invisible to others until they commit.
+  LockManager *page_lock_manager = txn->TakesLocks() ? lock_manager_ : nullptr;
+  if (LocksThroughTable(txn)) {
+    if (!lock_manager_->LockTable(txn, LockMode::INTENTION_EXCLUSIVE, *table_oid_)) {
+      return false;
+    }
+    if (txn->IsTableLocked(*table_oid_, LockMode::EXCLUSIVE)) {
+      page_lock_manager = nullptr;
+    }
+  }
+
   auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
   if (cur_page == nullptr) {
     txn->SetState(TransactionState::ABORTED);
@@ -51,7 +67,7 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
   cur_page->WLatch();
   // Insert into the first page with enough space. If no such page exists, create a new page and insert into that.
   // INVARIANT: cur_page is WLatched if you leave the loop normally.
-  while (!cur_page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_)) {
+  while (!cur_page->InsertTuple(tuple, rid, txn, page_lock_manager, log_manager_)) {
     auto next_page_id = cur_page->GetNextPageId();
     // If the next page is a valid page,
     if (next_page_id != INVALID_PAGE_ID) {
@@ -81,16 +97,32 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
       cur_page = new_page;
     }
   }
+  // Snapshots must not see the new tuple before it commits.
+  version_store_.RecordWrite(*rid, txn, nullptr);
   // This line has caused most of us to double-take and "whoa double unlatch".
   // We are not, in fact, double unlatching. See the invariant above.
   cur_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
   // Update the transaction's write set.
-  txn->GetWriteSet()->emplace_back(*rid, WType::INSERT, Tuple{}, this);
+  txn->GetWriteSet()->emplace_back(*rid, WType::INSERT, Tuple{}, this, txn->GetArena());
+  // Count the new row lock towards escalation.
+  if (page_lock_manager != nullptr && LocksThroughTable(txn)) {
+    return lock_manager_->LockRow(txn, LockMode::EXCLUSIVE, *table_oid_, *rid);
+  }
   return true;
 }
 
 bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
+  RejectReadOnlyWrite(txn);
+  if (BuffersWrites(txn)) {
+    return BufferWrite(rid, WType::DELETE, Tuple{}, txn);
+  }
+  if (LocksThroughTable(txn) && !lock_manager_->LockRow(txn, LockMode::EXCLUSIVE, *table_oid_, rid)) {
+    return false;
+  }
+  if (AbortOnWriteConflict(rid, txn)) {
+    return false;
+  }
   // TODO(Amadou): remove empty page
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
@@ -99,17 +131,34 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
-  // Otherwise, mark the tuple as deleted.
+  // Otherwise, mark the tuple as deleted. The deleted version stays readable for snapshots.
   page->WLatch();
-  page->MarkDelete(rid, txn, lock_manager_, log_manager_);
+  Tuple old_tuple;
+  page->GetTuple(rid, &old_tuple, nullptr, nullptr);
+  bool is_deleted = page->MarkDelete(rid, txn, PageLockManager(txn), log_manager_);
+  if (is_deleted) {
+    version_store_.RecordWrite(rid, txn, &old_tuple);
+  }
   page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
+  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_deleted);
   // Update the transaction's write set.
-  txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this);
-  return true;
+  if (is_deleted) {
+    txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this, txn->GetArena());
+  }
+  return is_deleted;
 }
 
 bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn) {
+  RejectReadOnlyWrite(txn);
+  if (BuffersWrites(txn)) {
+    return BufferWrite(rid, WType::UPDATE, tuple, txn);
+  }
+  if (LocksThroughTable(txn) && !lock_manager_->LockRow(txn, LockMode::EXCLUSIVE, *table_oid_, rid)) {
+    return false;
+  }
+  if (AbortOnWriteConflict(rid, txn)) {
+    return false;
+  }
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -117,15 +166,20 @@ bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
-  // Update the tuple; but first save the old value for rollbacks.
+  // Update the tuple; but first save the old value for rollbacks and snapshots.
   Tuple old_tuple;
   page->WLatch();
-  bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
+  bool is_updated =
+      page->UpdateTuple(tuple, &old_tuple, rid, txn, PageLockManager(txn), log_manager_);
+  if (is_updated) {
+    version_store_.RecordWrite(rid, txn, &old_tuple);
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
-  // Update the transaction's write set.
-  if (is_updated && txn->GetState() != TransactionState::ABORTED) {
-    txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this);
+  // Update the transaction's write set, also if a wound aborted the transaction meanwhile. Rollbacks ignore the
+  // records they add themselves.
+  if (is_updated) {
+    txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this, txn->GetArena());
   }
   return is_updated;
 }
@@ -137,7 +191,9 @@ void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
   // Delete the tuple from the page.
   page->WLatch();
   page->ApplyDelete(rid, txn, log_manager_);
-  lock_manager_->Unlock(txn, rid);
+  if (txn->TakesLocks()) {
+    lock_manager_->Unlock(txn, rid);
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
 }
@@ -154,6 +210,15 @@ void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
 }
 
 bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
+  if (ReadsVersions(txn)) {
+    return GetVersionedTuple(rid, tuple, txn);
+  }
+  // Lock before latching the page, a table lock may have to wait for writers of this page. Read uncommitted reads
+  // without locks.
+  if (LocksThroughTable(txn) && txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED &&
+      !lock_manager_->LockRow(txn, LockMode::SHARED, *table_oid_, rid)) {
+    return false;
+  }
   // Find the page which contains the tuple.
   auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -163,12 +228,90 @@ bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
   }
   // Read the tuple from the page.
   page->RLatch();
-  bool res = page->GetTuple(rid, tuple, txn, lock_manager_);
+  bool res = page->GetTuple(rid, tuple, txn, PageLockManager(txn));
   page->RUnlatch();
   buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
   return res;
 }
 
+bool TableHeap::GetVersionedTuple(RID rid, Tuple *tuple, Transaction *txn) {
+  // Optimistic transactions read their own buffered writes.
+  if (txn->IsOptimistic()) {
+    auto writes = txn->GetBufferedWriteSet();
+    for (auto write = writes->rbegin(); write != writes->rend(); ++write) {
+      if (write->table_ == this && write->rid_ == rid) {
+        if (write->wtype_ == WType::DELETE) {
+          return false;
+        }
+        // The buffered tuple lives in the arena, the caller may keep its copy after the transaction ended.
+        *tuple = write->tuple_.DeepCopy();
+        tuple->rid_ = rid;
+        return true;
+      }
+    }
+  }
+  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  if (page == nullptr) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  // Writers change the page and the version store under the page's write latch.
+  page->RLatch();
+  timestamp_t version = 0;
+  VisibleVersion visible = txn->IsOptimistic() ? version_store_.GetCommittedVersion(rid, txn, tuple, &version)
+                                               : version_store_.GetVisibleVersion(rid, txn, tuple);
+  bool res = false;
+  switch (visible) {
+    case VisibleVersion::IN_PAGE:
+      // Without a transaction the page neither locks the tuple nor aborts us if it is deleted.
+      res = page->GetTuple(rid, tuple, nullptr, nullptr);
+      break;
+    case VisibleVersion::IN_STORE:
+      tuple->rid_ = rid;
+      res = true;
+      break;
+    case VisibleVersion::NONE:
+      break;
+  }
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
+  // Validated when the transaction commits, also if the tuple did not exist.
+  if (txn->IsOptimistic()) {
+    txn->GetReadSet()->emplace_back(rid, version, this);
+  }
+  return res;
+}
+
+bool TableHeap::BufferWrite(const RID &rid, WType wtype, const Tuple &tuple, Transaction *txn) {
+  // Reading the tuple first validates that it still exists when the write is installed.
+  Tuple current;
+  if (!GetVersionedTuple(rid, &current, txn)) {
+    return false;
+  }
+  txn->GetBufferedWriteSet()->emplace_back(rid, wtype, tuple, this, txn->GetArena());
+  return true;
+}
+
+void TableHeap::RejectReadOnlyWrite(Transaction *txn) {
+  if (txn != nullptr && txn->IsReadOnly()) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::WRITE_ON_READ_ONLY);
+  }
+}
+
+bool TableHeap::AbortOnWriteConflict(const RID &rid, Transaction *txn) {
+  // Under locking the exclusive lock is held, so no other writer can commit a newer version from here on.
+  if (ReadsSnapshot(txn) && version_store_.IsWriteConflict(rid, txn)) {
+    txn->SetState(TransactionState::ABORTED);
+    return true;
+  }
+  return false;
+}
+
+bool TableHeap::LockTable(Transaction *txn, LockMode lock_mode) {
+  return !LocksThroughTable(txn) || lock_manager_->LockTable(txn, lock_mode, *table_oid_);
+}
+
 TableIterator TableHeap::Begin(Transaction *txn) {
   // Start an iterator from the first page.
   // TODO(Wuwen): Hacky fix for now. Removing empty pages is a better way to handle this.
@@ -178,7 +321,7 @@ TableIterator TableHeap::Begin(Transaction *txn) {
     auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
     page->RLatch();
     // If this fails because there is no tuple, then RID will be the default-constructed value, which means EOF.
-    auto found_tuple = page->GetFirstTupleRid(&rid);
+    auto found_tuple = page->GetFirstTupleRid(&rid, ReadsVersions(txn));
     page->RUnlatch();
     buffer_pool_manager_->UnpinPage(page_id, false);
     if (found_tuple) {
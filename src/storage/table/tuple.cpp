@@ -87,6 +87,47 @@ Tuple &Tuple::operator=(const Tuple &other) {
   return *this;
 }
 
+Tuple::Tuple(Tuple &&other) noexcept
+    : allocated_(other.allocated_), rid_(other.rid_), size_(other.size_), data_(other.data_) {
+  other.allocated_ = false;
+  other.data_ = nullptr;
+}
+
+Tuple &Tuple::operator=(Tuple &&other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+  if (allocated_) {
+    delete[] data_;
+  }
+  allocated_ = other.allocated_;
+  rid_ = other.rid_;
+  size_ = other.size_;
+  data_ = other.data_;
+  other.allocated_ = false;
+  other.data_ = nullptr;
+  return *this;
+}
+
+Tuple Tuple::CopyTo(Arena *arena) const {
+  Tuple copy(rid_);
+  copy.size_ = size_;
+  if (size_ > 0) {
+    copy.data_ = arena->Allocate(size_);
+    memcpy(copy.data_, data_, size_);
+  }
+  return copy;
+}
+
+Tuple Tuple::DeepCopy() const {
+  Tuple copy(rid_);
+  copy.size_ = size_;
+  copy.allocated_ = true;
+  copy.data_ = new char[size_];
+  memcpy(copy.data_, data_, size_);
+  return copy;
+}
+
 Value Tuple::GetValue(const Schema *schema, const uint32_t column_idx) const {
   assert(schema);
   assert(data_);
@@ -141,4 +141,40 @@ TEST(BufferPoolManagerInstanceTest, DISABLED_SampleTest) {
   delete disk_manager;
 }
 
+// A deleted page's frame is handed out from the free list only, never also evicted by the replacer while in use
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, DeletePageTest) {
+  auto *disk_manager = new DiskManager("delete_page_test.db");
+  auto *bpm = new BufferPoolManagerInstance(3, disk_manager);
+
+  page_id_t page_ids[3];
+  for (auto &page_id : page_ids) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[2], false));
+  EXPECT_TRUE(bpm->DeletePage(page_ids[2]));
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[1], false));
+
+  // The new page takes the deleted page's frame, the next one has to evict the unpinned page.
+  page_id_t reused_page_id;
+  Page *reused_page = bpm->NewPage(&reused_page_id);
+  ASSERT_NE(nullptr, reused_page);
+  snprintf(reused_page->GetData(), PAGE_SIZE, "Pinned");
+  page_id_t evicting_page_id;
+  Page *evicting_page = bpm->NewPage(&evicting_page_id);
+  ASSERT_NE(nullptr, evicting_page);
+  EXPECT_NE(reused_page, evicting_page);
+  EXPECT_EQ(0, strcmp(reused_page->GetData(), "Pinned"));
+  EXPECT_EQ(reused_page_id, reused_page->GetPageId());
+
+  // Every frame is pinned now.
+  page_id_t page_id;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+
+  disk_manager->ShutDown();
+  remove("delete_page_test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
 }  // namespace bustub
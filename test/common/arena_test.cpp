@@ -0,0 +1,70 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// arena_test.cpp
+//
+// Identification: test/common/arena_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "common/arena.h"
+#include "gtest/gtest.h"
+#include "storage/table/tuple.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(ArenaTest, AllocateAndResetTest) {
+  Arena arena;
+  EXPECT_EQ(arena.GetAllocatedBytes(), 0);
+  // Allocations do not overlap and are aligned, also across blocks and for oversized ones.
+  std::vector<char *> allocations;
+  for (int i = 0; i < 1000; i++) {
+    size_t size = i % 100 == 0 ? 10000 : i % 50 + 1;
+    char *data = arena.Allocate(size);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data) % alignof(std::max_align_t), 0);
+    memset(data, i % 128, size);
+    allocations.push_back(data);
+  }
+  for (int i = 0; i < 1000; i++) {
+    size_t size = i % 100 == 0 ? 10000 : i % 50 + 1;
+    for (size_t j = 0; j < size; j++) {
+      ASSERT_EQ(allocations[i][j], i % 128);
+    }
+  }
+  EXPECT_GT(arena.GetAllocatedBytes(), 10 * 10000);
+
+  // The first block is reused after a reset.
+  arena.Reset();
+  EXPECT_EQ(arena.GetAllocatedBytes(), 0);
+  EXPECT_EQ(arena.Allocate(8), allocations[0]);
+}
+
+// NOLINTNEXTLINE
+TEST(ArenaTest, TupleCopyTest) {
+  Schema schema({Column("a", TypeId::INTEGER), Column("b", TypeId::VARCHAR, 20)});
+  Tuple tuple({ValueFactory::GetIntegerValue(7), ValueFactory::GetVarcharValue("arena")}, &schema);
+  Arena arena;
+  Tuple copy = tuple.CopyTo(&arena);
+  EXPECT_FALSE(copy.IsAllocated());
+  EXPECT_EQ(copy.GetValue(&schema, 0).GetAs<int32_t>(), 7);
+  EXPECT_EQ(copy.GetValue(&schema, 1).ToString(), "arena");
+  // Copies of the arena copy share its data, a deep copy owns its own.
+  Tuple shallow = copy;
+  EXPECT_EQ(shallow.GetData(), copy.GetData());
+  Tuple deep = copy.DeepCopy();
+  EXPECT_TRUE(deep.IsAllocated());
+  EXPECT_NE(deep.GetData(), copy.GetData());
+  arena.Reset();
+  EXPECT_EQ(deep.GetValue(&schema, 1).ToString(), "arena");
+}
+
+}  // namespace bustub
@@ -0,0 +1,148 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// hash_util_test.cpp
+//
+// Identification: test/common/hash_util_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "common/logger.h"
+#include "common/util/hash_util.h"
+#include "container/hash/hash_function.h"
+#include "gtest/gtest.h"
+#include "murmur3/MurmurHash3.h"
+#include "storage/index/generic_key.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(HashUtilTest, HashBytesBatchTest) {
+  std::mt19937 gen(0);
+  const size_t length = 37;
+  for (size_t count : {0, 1, 3, 4, 5, 64, 103}) {
+    std::vector<char> bytes(count * length);
+    for (size_t i = 0; i < count; i++) {
+      // Strings with zero padding of all lengths, some of them only padding.
+      size_t used = gen() % (length + 1);
+      for (size_t j = 0; j < used; j++) {
+        bytes[i * length + j] = static_cast<char>(gen());
+      }
+    }
+    for (bool trim_padding : {false, true}) {
+      std::vector<hash_t> hashes(count);
+      HashUtil::HashBytesBatch(bytes.data(), length, length, count, hashes.data(), trim_padding);
+      for (size_t i = 0; i < count; i++) {
+        const char *key = bytes.data() + i * length;
+        size_t key_length = trim_padding ? HashUtil::TrimZeroPadding(key, length) : length;
+        EXPECT_EQ(hashes[i], HashUtil::HashBytes(key, key_length)) << "Wrong hash of string " << i;
+      }
+    }
+  }
+
+  std::string padded("abc\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 20);
+  EXPECT_EQ(HashUtil::TrimZeroPadding(padded.data(), padded.size()), 4);
+  EXPECT_NE(HashUtil::HashBytes(padded.data(), 3), HashUtil::HashBytes(padded.data(), 4));
+  EXPECT_NE(HashUtil::HashBytes(padded.data(), 3), HashUtil::HashBytes(padded.data() + 1, 3));
+  EXPECT_NE(HashUtil::HashBytes(padded.data(), 11), HashUtil::HashBytes(padded.data() + 1, 11));
+}
+
+// Generic keys holding an integer hash to distinct values, the same one at a time and in batches
+// NOLINTNEXTLINE
+TEST(HashUtilTest, HashFunctionTest) {
+  const int num_keys = 100000;
+  std::vector<GenericKey<64>> keys(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    keys[i].SetFromInteger(i);
+  }
+  HashFunction<GenericKey<64>> hash_fn;
+  std::vector<uint64_t> hashes(num_keys);
+  hash_fn.GetHashes(keys.data(), num_keys, hashes.data());
+  std::unordered_set<uint64_t> distinct;
+  std::vector<int> low_bits(256);
+  for (int i = 0; i < num_keys; i++) {
+    EXPECT_EQ(hashes[i], hash_fn.GetHash(keys[i]));
+    distinct.insert(hashes[i]);
+    low_bits[hashes[i] & 0xff]++;
+  }
+  // A CRC has 32 bits, of 100000 keys about one pair collides.
+  EXPECT_GT(distinct.size(), static_cast<size_t>(num_keys - 10));
+  // Extendible hashing picks buckets by the low bits, which have to be spread evenly.
+  for (int count : low_bits) {
+    EXPECT_GT(count, num_keys / 256 / 2);
+    EXPECT_LT(count, num_keys / 256 * 2);
+  }
+
+  std::vector<std::pair<GenericKey<64>, RID>> pairs;
+  for (int i = 0; i < 10; i++) {
+    pairs.emplace_back(keys[i], RID(i, i));
+  }
+  std::vector<uint64_t> pair_hashes(pairs.size());
+  hash_fn.GetHashes(&pairs[0].first, pairs.size(), pair_hashes.data(), sizeof(pairs[0]));
+  for (size_t i = 0; i < pairs.size(); i++) {
+    EXPECT_EQ(pair_hashes[i], hashes[i]);
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(HashUtilTest, HashColumnTest) {
+  std::vector<Value> column{ValueFactory::GetIntegerValue(42),
+                            ValueFactory::GetBigIntValue(-7),
+                            ValueFactory::GetTinyIntValue(3),
+                            ValueFactory::GetSmallIntValue(1000),
+                            ValueFactory::GetDecimalValue(2.5),
+                            ValueFactory::GetTimestampValue(123456789),
+                            ValueFactory::GetBooleanValue(true),
+                            ValueFactory::GetVarcharValue("hello"),
+                            ValueFactory::GetIntegerValue(43)};
+  std::vector<hash_t> hashes(column.size());
+  HashUtil::HashColumn(column, hashes.data());
+  for (size_t i = 0; i < column.size(); i++) {
+    EXPECT_EQ(hashes[i], HashUtil::HashValue(&column[i])) << "Wrong hash of value " << i;
+  }
+}
+
+// Compares hashing generic keys holding an integer with MurmurHash3 over the whole key
+// NOLINTNEXTLINE
+TEST(HashUtilTest, Benchmark) {
+  const int num_keys = 1000000;
+  std::vector<GenericKey<64>> keys(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    keys[i].SetFromInteger(i);
+  }
+  HashFunction<GenericKey<64>> hash_fn;
+  std::vector<uint64_t> hashes(num_keys);
+  auto rate = [&](auto task) {
+    auto start = std::chrono::steady_clock::now();
+    task();
+    return num_keys / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+  double murmur = rate([&] {
+    for (int i = 0; i < num_keys; i++) {
+      uint64_t hash[2];
+      murmur3::MurmurHash3_x64_128(&keys[i], sizeof(keys[i]), 0, hash);
+      hashes[i] = hash[0];
+    }
+  });
+  double single = rate([&] {
+    for (int i = 0; i < num_keys; i++) {
+      hashes[i] = hash_fn.GetHash(keys[i]);
+    }
+  });
+  double batched = rate([&] { hash_fn.GetHashes(keys.data(), num_keys, hashes.data()); });
+  EXPECT_EQ(hashes[num_keys - 1], hash_fn.GetHash(keys[num_keys - 1]));
+  LOG_INFO("GenericKey<64>: murmur3 %.0f keys/s, GetHash %.0f keys/s, GetHashes %.0f keys/s", murmur, single, batched);
+}
+
+}  // namespace bustub
@@ -2,13 +2,23 @@
  * lock_manager_test.cpp
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <future>  // NOLINT
 #include <random>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "common/config.h"
+#include "common/logger.h"
+#include "concurrency/key_range_lock.h"
 #include "concurrency/lock_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "gtest/gtest.h"
+#include "storage/index/generic_key.h"
+#include "test_util.h"  // NOLINT
 
 namespace bustub {
 
@@ -77,7 +87,7 @@ void BasicTest1() {
     delete txns[i];
   }
 }
-TEST(LockManagerTest, DISABLED_BasicTest) { BasicTest1(); }
+TEST(LockManagerTest, BasicTest) { BasicTest1(); }
 
 void TwoPLTest() {
   LockManager lock_mgr{};
@@ -123,7 +133,7 @@ void TwoPLTest() {
 
   delete txn;
 }
-TEST(LockManagerTest, DISABLED_TwoPLTest) { TwoPLTest(); }
+TEST(LockManagerTest, TwoPLTest) { TwoPLTest(); }
 
 void UpgradeTest() {
   LockManager lock_mgr{};
@@ -150,7 +160,7 @@ void UpgradeTest() {
   txn_mgr.Commit(&txn);
   CheckCommitted(&txn);
 }
-TEST(LockManagerTest, DISABLED_UpgradeLockTest) { UpgradeTest(); }
+TEST(LockManagerTest, UpgradeLockTest) { UpgradeTest(); }
 
 void WoundWaitBasicTest() {
   LockManager lock_mgr{};
@@ -202,6 +212,449 @@ void WoundWaitBasicTest() {
   txn_mgr.Commit(&txn_hold);
   CheckCommitted(&txn_hold);
 }
-TEST(LockManagerTest, DISABLED_WoundWaitBasicTest) { WoundWaitBasicTest(); }
+TEST(LockManagerTest, WoundWaitBasicTest) { WoundWaitBasicTest(); }
+
+// A transaction that is wounded while it waits for another record has to stop waiting
+void WoundWaitWakeWaiterTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid_a{0, 0};
+  RID rid_b{1, 0};
+
+  Transaction txn_old(0);
+  Transaction txn_mid(1);
+  Transaction txn_young(2);
+  txn_mgr.Begin(&txn_old);
+  txn_mgr.Begin(&txn_mid);
+  txn_mgr.Begin(&txn_young);
+
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn_young, rid_a));
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn_mid, rid_b));
+
+  // The young transaction waits for the older one on rid_b.
+  std::promise<bool> young_done;
+  std::future<bool> young_future = young_done.get_future();
+  std::thread young_thread{[&] { young_done.set_value(lock_mgr.LockExclusive(&txn_young, rid_b)); }};
+  EXPECT_EQ(young_future.wait_for(std::chrono::milliseconds(100)), std::future_status::timeout);
+
+  // Wounding it on rid_a wakes it up.
+  std::thread old_thread{[&] { EXPECT_TRUE(lock_mgr.LockExclusive(&txn_old, rid_a)); }};
+  EXPECT_FALSE(young_future.get());
+  CheckAborted(&txn_young);
+  CheckTxnLockSize(&txn_young, 0, 1);
+  txn_mgr.Abort(&txn_young);
+  old_thread.join();
+  young_thread.join();
+
+  CheckTxnLockSize(&txn_old, 0, 1);
+  txn_mgr.Commit(&txn_old);
+  txn_mgr.Commit(&txn_mid);
+  CheckCommitted(&txn_old);
+  CheckCommitted(&txn_mid);
+}
+TEST(LockManagerTest, WoundWaitWakeWaiterTest) { WoundWaitWakeWaiterTest(); }
+
+// Shared locks are given up early under read committed without leaving the growing phase
+void ReadCommittedTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid0{0, 0};
+  RID rid1{0, 1};
+
+  auto txn = txn_mgr.Begin(nullptr, IsolationLevel::READ_COMMITTED);
+  EXPECT_TRUE(lock_mgr.LockShared(txn, rid0));
+  EXPECT_TRUE(lock_mgr.Unlock(txn, rid0));
+  CheckGrowing(txn);
+  EXPECT_TRUE(lock_mgr.LockExclusive(txn, rid1));
+  EXPECT_TRUE(lock_mgr.Unlock(txn, rid1));
+  CheckShrinking(txn);
+  txn_mgr.Commit(txn);
+  delete txn;
+
+  txn = txn_mgr.Begin(nullptr, IsolationLevel::READ_UNCOMMITTED);
+  EXPECT_THROW(lock_mgr.LockShared(txn, rid0), TransactionAbortException);
+  CheckAborted(txn);
+  CheckTxnLockSize(txn, 0, 0);
+  txn_mgr.Abort(txn);
+  delete txn;
+}
+TEST(LockManagerTest, ReadCommittedTest) { ReadCommittedTest(); }
+
+// Table locks in intention modes admit each other, shared and exclusive table locks do not
+void HierarchicalLockTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t oid = 0;
+  RID rid0{0, 0};
+  RID rid1{0, 1};
+
+  auto txn0 = txn_mgr.Begin();
+  auto txn1 = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockRow(txn0, LockMode::EXCLUSIVE, oid, rid0));
+  EXPECT_TRUE(txn0->IsTableLocked(oid, LockMode::INTENTION_EXCLUSIVE));
+  EXPECT_TRUE(lock_mgr.LockRow(txn1, LockMode::SHARED, oid, rid1));
+  EXPECT_TRUE(txn1->IsTableLocked(oid, LockMode::INTENTION_SHARED));
+  CheckTxnLockSize(txn0, 0, 1);
+  CheckTxnLockSize(txn1, 1, 0);
+
+  // Reading the whole table on top of the intention to write only conflicts with writers.
+  EXPECT_TRUE(lock_mgr.LockTable(txn0, LockMode::SHARED, oid));
+  EXPECT_TRUE(txn0->IsTableLocked(oid, LockMode::SHARED_INTENTION_EXCLUSIVE));
+  // The table lock covers reading rows.
+  EXPECT_TRUE(lock_mgr.LockRow(txn0, LockMode::SHARED, oid, rid1));
+  CheckTxnLockSize(txn0, 0, 1);
+
+  // The exclusive table lock waits for both transactions.
+  auto txn2 = txn_mgr.Begin();
+  std::promise<bool> locked;
+  std::future<bool> locked_future = locked.get_future();
+  std::thread thread2{[&] { locked.set_value(lock_mgr.LockTable(txn2, LockMode::EXCLUSIVE, oid)); }};
+  EXPECT_EQ(locked_future.wait_for(std::chrono::milliseconds(50)), std::future_status::timeout);
+  txn_mgr.Commit(txn1);
+  EXPECT_EQ(locked_future.wait_for(std::chrono::milliseconds(50)), std::future_status::timeout);
+  txn_mgr.Commit(txn0);
+  EXPECT_TRUE(locked_future.get());
+  thread2.join();
+  txn_mgr.Commit(txn2);
+  EXPECT_TRUE(txn0->GetTableLockSet()->empty());
+  EXPECT_TRUE(txn1->GetTableLockSet()->empty());
+  delete txn0;
+  delete txn1;
+  delete txn2;
+}
+TEST(LockManagerTest, HierarchicalLockTest) { HierarchicalLockTest(); }
+
+// Row locks past the threshold are replaced by a table lock
+void LockEscalationTest() {
+  auto threshold = lock_escalation_threshold;
+  lock_escalation_threshold = 4;
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t oid = 0;
+
+  auto txn = txn_mgr.Begin();
+  for (uint32_t i = 0; i < 4; i++) {
+    EXPECT_TRUE(lock_mgr.LockRow(txn, LockMode::SHARED, oid, RID{0, i}));
+  }
+  CheckTxnLockSize(txn, 4, 0);
+  EXPECT_TRUE(lock_mgr.LockRow(txn, LockMode::SHARED, oid, RID{0, 4}));
+  CheckTxnLockSize(txn, 0, 0);
+  EXPECT_TRUE(txn->IsTableLocked(oid, LockMode::SHARED));
+  CheckGrowing(txn);
+
+  // Writes take row locks again below a shared intention exclusive lock, then escalate to an exclusive lock.
+  for (uint32_t i = 0; i < 5; i++) {
+    EXPECT_TRUE(lock_mgr.LockRow(txn, LockMode::EXCLUSIVE, oid, RID{1, i}));
+  }
+  CheckTxnLockSize(txn, 0, 0);
+  EXPECT_TRUE(txn->IsTableLocked(oid, LockMode::EXCLUSIVE));
+
+  // Another transaction cannot even read a row now.
+  auto reader = txn_mgr.Begin();
+  std::promise<bool> read;
+  std::future<bool> read_future = read.get_future();
+  std::thread reader_thread{[&] { read.set_value(lock_mgr.LockRow(reader, LockMode::SHARED, oid, RID{0, 0})); }};
+  EXPECT_EQ(read_future.wait_for(std::chrono::milliseconds(50)), std::future_status::timeout);
+  txn_mgr.Commit(txn);
+  EXPECT_TRUE(read_future.get());
+  reader_thread.join();
+  txn_mgr.Commit(reader);
+  delete txn;
+  delete reader;
+  lock_escalation_threshold = threshold;
+}
+TEST(LockManagerTest, LockEscalationTest) { LockEscalationTest(); }
+
+void WaitsForGraphTest() {
+  LockManager lock_mgr{};
+  txn_id_t victim;
+  lock_mgr.AddEdge(0, 1);
+  lock_mgr.AddEdge(1, 2);
+  lock_mgr.AddEdge(1, 2);
+  EXPECT_EQ(lock_mgr.GetEdgeList().size(), 2);
+  EXPECT_FALSE(lock_mgr.HasCycle(&victim));
+
+  lock_mgr.AddEdge(2, 0);
+  lock_mgr.AddEdge(3, 0);
+  EXPECT_TRUE(lock_mgr.HasCycle(&victim));
+  EXPECT_EQ(victim, 2);
+
+  lock_mgr.RemoveEdge(1, 2);
+  EXPECT_EQ(lock_mgr.GetEdgeList().size(), 3);
+  EXPECT_FALSE(lock_mgr.HasCycle(&victim));
+}
+TEST(LockManagerTest, WaitsForGraphTest) { WaitsForGraphTest(); }
+
+// The detector aborts the younger of two transactions waiting for each other
+void DeadlockDetectionTest() {
+  auto interval = cycle_detection_interval;
+  cycle_detection_interval = std::chrono::milliseconds(10);
+  LockManager lock_mgr{DeadlockMode::DETECTION};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid0{0, 0};
+  RID rid1{0, 1};
+
+  auto txn0 = txn_mgr.Begin();
+  auto txn1 = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockExclusive(txn0, rid0));
+  EXPECT_TRUE(lock_mgr.LockShared(txn1, rid1));
+
+  std::thread thread0{[&] {
+    EXPECT_TRUE(lock_mgr.LockExclusive(txn0, rid1));
+    CheckGrowing(txn0);
+    txn_mgr.Commit(txn0);
+  }};
+  // Wait until txn0 blocks on txn1, then close the cycle.
+  while (lock_mgr.GetEdgeList().empty()) {
+    std::this_thread::yield();
+  }
+  EXPECT_FALSE(lock_mgr.LockShared(txn1, rid0));
+  CheckAborted(txn1);
+  txn_mgr.Abort(txn1);
+  thread0.join();
+
+  CheckCommitted(txn0);
+  EXPECT_EQ(lock_mgr.GetDeadlockAbortCount(), 1);
+  EXPECT_GT(lock_mgr.GetMaxDetectionLatency().count(), 0);
+  EXPECT_LT(lock_mgr.GetMaxDetectionLatency(), std::chrono::seconds(1));
+  EXPECT_TRUE(lock_mgr.GetEdgeList().empty());
+  delete txn0;
+  delete txn1;
+  cycle_detection_interval = interval;
+}
+TEST(LockManagerTest, DeadlockDetectionTest) { DeadlockDetectionTest(); }
+
+// A scanned key range blocks inserts into it until the scan ends, inserts elsewhere go ahead
+void KeyRangeLockTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  auto key_schema = ParseCreateStatement("a bigint");
+  KeyRangeLockTable<GenericKey<8>, GenericComparator<8>> range_locks{GenericComparator<8>(key_schema.get()), &lock_mgr};
+  auto key = [](int64_t value) {
+    GenericKey<8> index_key;
+    index_key.SetFromInteger(value);
+    return index_key;
+  };
+
+  Transaction txn_scan(0);
+  Transaction txn_insert(1);
+  txn_mgr.Begin(&txn_scan);
+  txn_mgr.Begin(&txn_insert);
+
+  EXPECT_TRUE(range_locks.LockRange(&txn_scan, LockMode::SHARED, key(10), key(20)));
+  // Locks covered by one already held are not taken again.
+  EXPECT_TRUE(range_locks.LockKey(&txn_scan, LockMode::SHARED, key(15)));
+  EXPECT_EQ(range_locks.GetLockCount(), 1);
+
+  // Readers share the range, writers outside of it do not wait.
+  EXPECT_TRUE(range_locks.LockRange(&txn_insert, LockMode::SHARED, key(5), key(12)));
+  EXPECT_TRUE(range_locks.LockKey(&txn_insert, LockMode::EXCLUSIVE, key(21)));
+
+  // The younger inserter waits for the scan to end.
+  std::promise<bool> insert_done;
+  std::future<bool> insert_future = insert_done.get_future();
+  std::thread insert_thread{
+      [&] { insert_done.set_value(range_locks.LockKey(&txn_insert, LockMode::EXCLUSIVE, key(20))); }};
+  EXPECT_EQ(insert_future.wait_for(std::chrono::milliseconds(100)), std::future_status::timeout);
+  txn_mgr.Commit(&txn_scan);
+  EXPECT_TRUE(insert_future.get());
+  insert_thread.join();
+  CheckGrowing(&txn_insert);
+  EXPECT_EQ(range_locks.GetLockCount(), 3);
+
+  txn_mgr.Commit(&txn_insert);
+  EXPECT_EQ(range_locks.GetLockCount(), 0);
+  EXPECT_TRUE(txn_insert.GetIndexRangeLockSet()->empty());
+}
+TEST(LockManagerTest, KeyRangeLockTest) { KeyRangeLockTest(); }
+
+// An older scan wounds a younger writer holding a key in its range, also while the writer waits for a row lock
+void KeyRangeWoundWaitTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  auto key_schema = ParseCreateStatement("a bigint");
+  KeyRangeLockTable<GenericKey<8>, GenericComparator<8>> range_locks{GenericComparator<8>(key_schema.get()), &lock_mgr};
+  GenericKey<8> low;
+  low.SetFromInteger(0);
+  GenericKey<8> high;
+  high.SetFromInteger(100);
+  GenericKey<8> key;
+  key.SetFromInteger(50);
+  RID rid{0, 0};
+
+  Transaction txn_old(0);
+  Transaction txn_mid(1);
+  Transaction txn_young(2);
+  txn_mgr.Begin(&txn_old);
+  txn_mgr.Begin(&txn_mid);
+  txn_mgr.Begin(&txn_young);
+
+  EXPECT_TRUE(range_locks.LockKey(&txn_young, LockMode::EXCLUSIVE, key));
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn_mid, rid));
+
+  // The young writer waits for the older one on a row.
+  std::promise<bool> young_done;
+  std::future<bool> young_future = young_done.get_future();
+  std::thread young_thread{[&] { young_done.set_value(lock_mgr.LockExclusive(&txn_young, rid)); }};
+  EXPECT_EQ(young_future.wait_for(std::chrono::milliseconds(100)), std::future_status::timeout);
+
+  // Scanning over its key wounds it and wakes it up.
+  std::thread old_thread{[&] { EXPECT_TRUE(range_locks.LockRange(&txn_old, LockMode::SHARED, low, high)); }};
+  EXPECT_FALSE(young_future.get());
+  CheckAborted(&txn_young);
+  // A wounded transaction keeps the ranges it locked to roll back its writes, but gets no new ones.
+  EXPECT_TRUE(range_locks.LockKey(&txn_young, LockMode::EXCLUSIVE, key));
+  EXPECT_FALSE(range_locks.LockKey(&txn_young, LockMode::EXCLUSIVE, high));
+  txn_mgr.Abort(&txn_young);
+  old_thread.join();
+  young_thread.join();
+
+  txn_mgr.Commit(&txn_old);
+  txn_mgr.Commit(&txn_mid);
+  CheckCommitted(&txn_old);
+  CheckCommitted(&txn_mid);
+  EXPECT_EQ(range_locks.GetLockCount(), 0);
+}
+TEST(LockManagerTest, KeyRangeWoundWaitTest) { KeyRangeWoundWaitTest(); }
+
+// A transaction locking many keys and ranges takes time near linear in their number, and only conflicting ones block
+void KeyRangeLockScaleTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  auto key_schema = ParseCreateStatement("a bigint");
+  KeyRangeLockTable<GenericKey<8>, GenericComparator<8>> range_locks{GenericComparator<8>(key_schema.get()), &lock_mgr};
+  auto key = [](int64_t value) {
+    GenericKey<8> index_key;
+    index_key.SetFromInteger(value);
+    return index_key;
+  };
+  const int num_keys = 20000;
+  std::vector<int64_t> values(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    values[i] = 2 * i;
+  }
+  std::shuffle(values.begin(), values.end(), std::mt19937(0));
+
+  Transaction txn_large(0);
+  Transaction txn_small(1);
+  txn_mgr.Begin(&txn_large);
+  txn_mgr.Begin(&txn_small);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t value : values) {
+    EXPECT_TRUE(range_locks.LockKey(&txn_large, LockMode::EXCLUSIVE, key(value)));
+  }
+  // Scans over the keys locked exclusively, and locks covered by those scans.
+  for (int64_t value : values) {
+    EXPECT_TRUE(range_locks.LockRange(&txn_large, LockMode::SHARED, key(value), key(value + 2)));
+    EXPECT_TRUE(range_locks.LockKey(&txn_large, LockMode::SHARED, key(value + 1)));
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  EXPECT_EQ(range_locks.GetLockCount(), 2 * num_keys);
+  LOG_INFO("%d key and %d range locks in one transaction: %.0f locks/s", num_keys, num_keys,
+           3 * num_keys / seconds);
+
+  // Keys past the ones locked are free.
+  EXPECT_TRUE(range_locks.LockKey(&txn_small, LockMode::EXCLUSIVE, key(2 * num_keys + 1)));
+  txn_mgr.Commit(&txn_large);
+  EXPECT_EQ(range_locks.GetLockCount(), 1);
+  EXPECT_TRUE(range_locks.LockRange(&txn_small, LockMode::SHARED, key(0), key(2 * num_keys)));
+  txn_mgr.Commit(&txn_small);
+  EXPECT_EQ(range_locks.GetLockCount(), 0);
+}
+TEST(LockManagerTest, KeyRangeLockScaleTest) { KeyRangeLockScaleTest(); }
+
+// Transactions lock records drawn from a Zipfian distribution, so that most of them contend for a few hot records.
+// Every committed write increments its record while still holding the exclusive lock, which loses increments if two
+// transactions ever hold the lock at once.
+void ZipfianContention(DeadlockMode deadlock_mode) {
+  const int num_threads = 8;
+  const int num_rids = 1000;
+  const int txns_per_thread = 200;
+  const int ops_per_txn = 8;
+  const double theta = 0.99;
+
+  LockManager lock_mgr{deadlock_mode};
+  TransactionManager txn_mgr{&lock_mgr};
+  std::vector<double> weights(num_rids);
+  for (int i = 0; i < num_rids; i++) {
+    weights[i] = 1.0 / std::pow(i + 1, theta);
+  }
+  std::vector<int> values(num_rids, 0);
+  std::atomic<int> committed_writes{0};
+  std::atomic<int> aborts{0};
+
+  auto task = [&](int thread_id) {
+    std::mt19937 gen(thread_id);
+    std::discrete_distribution<int> zipfian(weights.begin(), weights.end());
+    std::bernoulli_distribution is_write(0.5);
+    for (int i = 0; i < txns_per_thread; i++) {
+      while (true) {
+        Transaction *txn = txn_mgr.Begin();
+        std::vector<int> writes;
+        bool locked = true;
+        try {
+          for (int op = 0; op < ops_per_txn && locked; op++) {
+            int slot = zipfian(gen);
+            RID rid{0, static_cast<uint32_t>(slot)};
+            if (is_write(gen)) {
+              locked = lock_mgr.LockExclusive(txn, rid);
+              writes.push_back(slot);
+            } else {
+              locked = lock_mgr.LockShared(txn, rid);
+            }
+          }
+        } catch (TransactionAbortException &e) {
+          locked = false;
+        }
+        if (locked && txn->GetState() != TransactionState::ABORTED) {
+          for (int slot : writes) {
+            values[slot]++;
+          }
+          committed_writes += writes.size();
+          txn_mgr.Commit(txn);
+          delete txn;
+          break;
+        }
+        txn_mgr.Abort(txn);
+        delete txn;
+        aborts++;
+      }
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(task, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  int total = 0;
+  for (int value : values) {
+    total += value;
+  }
+  EXPECT_EQ(total, committed_writes);
+  EXPECT_EQ(lock_mgr.GetDeadlockAbortCount() > 0, aborts > 0);
+  LOG_INFO("%s: %d transactions in %.3fs (%.0f txn/s), %d aborts, detection latency avg %ldus max %ldus",
+           deadlock_mode == DeadlockMode::PREVENTION ? "wound-wait" : "detection", num_threads * txns_per_thread,
+           elapsed, num_threads * txns_per_thread / elapsed, aborts.load(),
+           static_cast<int64_t>(lock_mgr.GetAverageDetectionLatency().count()),
+           static_cast<int64_t>(lock_mgr.GetMaxDetectionLatency().count()));
+}
+
+// Compares wound-wait with deadlock detection under high contention
+void ZipfianContentionBenchmark() {
+  auto interval = cycle_detection_interval;
+  cycle_detection_interval = std::chrono::milliseconds(5);
+  ZipfianContention(DeadlockMode::PREVENTION);
+  ZipfianContention(DeadlockMode::DETECTION);
+  cycle_detection_interval = interval;
+}
+TEST(LockManagerTest, ZipfianContentionBenchmark) { ZipfianContentionBenchmark(); }
 
 }  // namespace bustub
@@ -11,15 +11,22 @@
 //===----------------------------------------------------------------------===//
 
 #include <atomic>
+#include <chrono>  // NOLINT
+#include <cmath>
 #include <cstdio>
+#include <filesystem>
+#include <future>  // NOLINT
+#include <map>
 #include <memory>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "catalog/table_generator.h"
+#include "concurrency/partition_executor.h"
 #include "concurrency/transaction.h"
 #include "concurrency/transaction_manager.h"
 #include "execution/execution_engine.h"
@@ -161,6 +168,20 @@ void CheckTxnLockSize(Transaction *txn, size_t shared_size, size_t exclusive_siz
   EXPECT_EQ(txn->GetExclusiveLockSet()->size(), exclusive_size);
 }
 
+// Reads colA -> colB of all tuples of a two-column integer table visible to txn.
+std::map<int32_t, int32_t> ScanTable(TableInfo *table_info, Transaction *txn) {
+  std::map<int32_t, int32_t> rows;
+  for (auto it = table_info->table_->Begin(txn); it != table_info->table_->End(); ++it) {
+    rows[it->GetValue(&table_info->schema_, 0).GetAs<int32_t>()] =
+        it->GetValue(&table_info->schema_, 1).GetAs<int32_t>();
+  }
+  return rows;
+}
+
+Tuple MakeRow(TableInfo *table_info, int32_t col_a, int32_t col_b) {
+  return Tuple({ValueFactory::GetIntegerValue(col_a), ValueFactory::GetIntegerValue(col_b)}, &table_info->schema_);
+}
+
 // NOLINTNEXTLINE
 TEST_F(TransactionTest, DISABLED_SimpleInsertRollbackTest) {
   // txn1: INSERT INTO empty_table2 VALUES (200, 20), (201, 21), (202, 22)
@@ -253,4 +274,558 @@ TEST_F(TransactionTest, DISABLED_DirtyReadsTest) {
   delete txn2;
 }
 
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, SnapshotIsolationTest) {
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto table = table_info->table_.get();
+  std::vector<RID> rids(2);
+  auto txn1 = GetTxnManager()->Begin();
+  ASSERT_TRUE(table->InsertTuple(MakeRow(table_info, 200, 20), &rids[0], txn1));
+  ASSERT_TRUE(table->InsertTuple(MakeRow(table_info, 201, 21), &rids[1], txn1));
+  // Nobody sees the inserts before they commit.
+  auto snapshot1 = GetTxnManager()->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  EXPECT_TRUE(ScanTable(table_info, snapshot1).empty());
+  GetTxnManager()->Commit(txn1);
+  EXPECT_TRUE(ScanTable(table_info, snapshot1).empty());
+
+  // txn2: UPDATE 200 to 99, DELETE 201, INSERT 202
+  auto snapshot2 = GetTxnManager()->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  auto txn2 = GetTxnManager()->Begin();
+  ASSERT_TRUE(table->UpdateTuple(MakeRow(table_info, 200, 99), rids[0], txn2));
+  ASSERT_TRUE(table->MarkDelete(rids[1], txn2));
+  RID rid;
+  ASSERT_TRUE(table->InsertTuple(MakeRow(table_info, 202, 22), &rid, txn2));
+  const std::map<int32_t, int32_t> before{{200, 20}, {201, 21}};
+  const std::map<int32_t, int32_t> after{{200, 99}, {202, 22}};
+  EXPECT_EQ(ScanTable(table_info, snapshot2), before);
+  // So does a snapshot that begins before the commit.
+  auto snapshot3 = GetTxnManager()->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  GetTxnManager()->Commit(txn2);
+  // The deleted tuple is gone from the page, but not from the older snapshots.
+  EXPECT_EQ(ScanTable(table_info, snapshot2), before);
+  EXPECT_EQ(ScanTable(table_info, snapshot3), before);
+  Tuple tuple;
+  EXPECT_FALSE(table->GetTuple(rids[1], &tuple, txn2));
+  ASSERT_TRUE(table->GetTuple(rids[1], &tuple, snapshot2));
+  EXPECT_EQ(tuple.GetValue(&table_info->schema_, 1).GetAs<int32_t>(), 21);
+  EXPECT_EQ(tuple.GetRid(), rids[1]);
+  EXPECT_TRUE(ScanTable(table_info, snapshot1).empty());
+
+  auto snapshot4 = GetTxnManager()->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  EXPECT_EQ(ScanTable(table_info, snapshot4), after);
+
+  // First updater wins: snapshot3 cannot update a tuple changed after it began, snapshot4 can.
+  EXPECT_FALSE(table->UpdateTuple(MakeRow(table_info, 200, 1), rids[0], snapshot3));
+  CheckAborted(snapshot3);
+  GetTxnManager()->Abort(snapshot3);
+  ASSERT_TRUE(table->UpdateTuple(MakeRow(table_info, 200, 2), rids[0], snapshot4));
+  ASSERT_TRUE(table->UpdateTuple(MakeRow(table_info, 200, 3), rids[0], snapshot4));
+  EXPECT_EQ(ScanTable(table_info, snapshot4), (std::map<int32_t, int32_t>{{200, 3}, {202, 22}}));
+  // A rolled back update shows the committed version again, not an intermediate one.
+  GetTxnManager()->Abort(snapshot4);
+  auto snapshot5 = GetTxnManager()->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  EXPECT_EQ(ScanTable(table_info, snapshot5), after);
+
+  // Versions stay around as long as older snapshots run.
+  EXPECT_GT(table->GetVersionStore()->GetVersionCount(), 0);
+  for (auto txn : {snapshot1, snapshot2, snapshot5}) {
+    GetTxnManager()->Commit(txn);
+  }
+  auto txn3 = GetTxnManager()->Begin();
+  ASSERT_TRUE(table->UpdateTuple(MakeRow(table_info, 202, 23), rid, txn3));
+  GetTxnManager()->Commit(txn3);
+  EXPECT_EQ(table->GetVersionStore()->GetVersionCount(), 0);
+
+  for (auto txn : {txn1, txn2, txn3, snapshot1, snapshot2, snapshot3, snapshot4, snapshot5}) {
+    delete txn;
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, SnapshotConsistentScanTest) {
+  // A writer moves value between rows while snapshots scan the table. Every snapshot sees the same total.
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto table = table_info->table_.get();
+  const int32_t num_rows = 10;
+  std::vector<RID> rids(num_rows);
+  auto load = GetTxnManager()->Begin();
+  for (int32_t i = 0; i < num_rows; i++) {
+    ASSERT_TRUE(table->InsertTuple(MakeRow(table_info, i, 10), &rids[i], load));
+  }
+  GetTxnManager()->Commit(load);
+  delete load;
+
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    std::mt19937 generator(15445);
+    std::uniform_int_distribution<int32_t> row(0, num_rows - 1);
+    for (int i = 0; i < 500; i++) {
+      int32_t from = row(generator);
+      int32_t to = (from + 1 + row(generator) % (num_rows - 1)) % num_rows;
+      auto txn = GetTxnManager()->Begin();
+      Tuple from_tuple;
+      Tuple to_tuple;
+      table->GetTuple(rids[from], &from_tuple, txn);
+      table->GetTuple(rids[to], &to_tuple, txn);
+      table->UpdateTuple(MakeRow(table_info, from, from_tuple.GetValue(&table_info->schema_, 1).GetAs<int32_t>() - 1),
+                         rids[from], txn);
+      table->UpdateTuple(MakeRow(table_info, to, to_tuple.GetValue(&table_info->schema_, 1).GetAs<int32_t>() + 1),
+                         rids[to], txn);
+      if (i % 5 == 0) {
+        GetTxnManager()->Abort(txn);
+      } else {
+        GetTxnManager()->Commit(txn);
+      }
+      delete txn;
+    }
+    done = true;
+  });
+
+  std::vector<std::thread> readers;
+  std::atomic<int> scans{0};
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+      do {
+        auto txn = GetTxnManager()->Begin(nullptr, IsolationLevel::SNAPSHOT);
+        auto rows = ScanTable(table_info, txn);
+        int32_t total = 0;
+        for (const auto &[col_a, col_b] : rows) {
+          total += col_b;
+        }
+        EXPECT_EQ(rows.size(), num_rows);
+        EXPECT_EQ(total, num_rows * 10);
+        GetTxnManager()->Commit(txn);
+        delete txn;
+        scans++;
+      } while (!done);
+    });
+  }
+  writer.join();
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  LOG_INFO("%d consistent snapshot scans during 500 transfers", scans.load());
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, OptimisticValidationTest) {
+  TransactionManager txn_mgr{GetLockManager(), nullptr, ConcurrencyMode::OPTIMISTIC};
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto table = table_info->table_.get();
+  std::vector<RID> rids(2);
+  auto load = txn_mgr.Begin();
+  EXPECT_TRUE(load->IsOptimistic());
+  ASSERT_TRUE(table->InsertTuple(MakeRow(table_info, 200, 20), &rids[0], load));
+  ASSERT_TRUE(table->InsertTuple(MakeRow(table_info, 201, 21), &rids[1], load));
+  ASSERT_TRUE(txn_mgr.Commit(load));
+
+  // txn1 and txn2 both update 200, the second one to commit fails validation.
+  auto txn1 = txn_mgr.Begin();
+  auto txn2 = txn_mgr.Begin();
+  Tuple tuple;
+  ASSERT_TRUE(table->GetTuple(rids[0], &tuple, txn2));
+  ASSERT_TRUE(table->UpdateTuple(MakeRow(table_info, 200, 30), rids[0], txn1));
+  ASSERT_TRUE(table->UpdateTuple(MakeRow(table_info, 200, 40), rids[0], txn2));
+  // The writes are buffered, only the writer sees them.
+  EXPECT_EQ(ScanTable(table_info, txn1), (std::map<int32_t, int32_t>{{200, 30}, {201, 21}}));
+  EXPECT_EQ(ScanTable(table_info, txn2), (std::map<int32_t, int32_t>{{200, 40}, {201, 21}}));
+  auto reader = txn_mgr.Begin();
+  EXPECT_EQ(ScanTable(table_info, reader), (std::map<int32_t, int32_t>{{200, 20}, {201, 21}}));
+  EXPECT_TRUE(txn_mgr.Commit(txn1));
+  EXPECT_FALSE(txn_mgr.Commit(txn2));
+  CheckAborted(txn2);
+  // The reader saw 200 before txn1 committed.
+  EXPECT_FALSE(txn_mgr.Commit(reader));
+
+  // txn3 writes 200 based on 201, which txn4 deletes. A read-only transaction whose reads are unchanged commits.
+  auto txn3 = txn_mgr.Begin();
+  auto txn4 = txn_mgr.Begin();
+  auto txn5 = txn_mgr.Begin();
+  ASSERT_TRUE(table->GetTuple(rids[1], &tuple, txn3));
+  ASSERT_TRUE(table->GetTuple(rids[0], &tuple, txn5));
+  EXPECT_EQ(tuple.GetValue(&table_info->schema_, 1).GetAs<int32_t>(), 30);
+  ASSERT_TRUE(table->MarkDelete(rids[1], txn4));
+  EXPECT_FALSE(table->GetTuple(rids[1], &tuple, txn4));
+  EXPECT_TRUE(txn_mgr.Commit(txn4));
+  ASSERT_TRUE(table->UpdateTuple(MakeRow(table_info, 200, 21), rids[0], txn3));
+  EXPECT_FALSE(txn_mgr.Commit(txn3));
+  EXPECT_TRUE(txn_mgr.Commit(txn5));
+
+  // Writes to a deleted tuple fail right away.
+  auto txn6 = txn_mgr.Begin();
+  EXPECT_FALSE(table->UpdateTuple(MakeRow(table_info, 201, 23), rids[1], txn6));
+  EXPECT_EQ(ScanTable(table_info, txn6), (std::map<int32_t, int32_t>{{200, 30}}));
+  EXPECT_TRUE(txn_mgr.Commit(txn6));
+
+  for (auto txn : {load, txn1, txn2, reader, txn3, txn4, txn5, txn6}) {
+    delete txn;
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, ReadOnlyTransactionTest) {
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto table = table_info->table_.get();
+  RID rid;
+  auto load = GetTxnManager()->Begin();
+  ASSERT_TRUE(table->InsertTuple(MakeRow(table_info, 200, 20), &rid, load));
+  GetTxnManager()->Commit(load);
+
+  // A read-only transaction reads its snapshot and has nothing to track.
+  auto reader = GetTxnManager()->BeginReadOnly();
+  EXPECT_TRUE(reader->IsReadOnly());
+  EXPECT_EQ(reader->GetIsolationLevel(), IsolationLevel::SNAPSHOT);
+  EXPECT_EQ(reader->GetWriteSet(), nullptr);
+  EXPECT_EQ(GetTxnManager()->GetTransaction(reader->GetTransactionId()), reader);
+  auto writer = GetTxnManager()->Begin();
+  ASSERT_TRUE(table->UpdateTuple(MakeRow(table_info, 200, 21), rid, writer));
+  GetTxnManager()->Commit(writer);
+  EXPECT_EQ(ScanTable(table_info, reader), (std::map<int32_t, int32_t>{{200, 20}}));
+  CheckTxnLockSize(reader, 0, 0);
+  EXPECT_TRUE(GetTxnManager()->Commit(reader));
+  CheckCommitted(reader);
+
+  // Checkpoints do not wait for read-only transactions, nor do they hold them up. The fixture's transaction keeps
+  // running, so the checkpoint is taken by another transaction manager.
+  TransactionManager txn_mgr{GetLockManager()};
+  auto running_reader = txn_mgr.BeginReadOnly();
+  txn_mgr.BlockAllTransactions();
+  auto blocked_reader = txn_mgr.BeginReadOnly();
+  EXPECT_EQ(ScanTable(table_info, blocked_reader).size(), 1);
+  EXPECT_TRUE(txn_mgr.Commit(running_reader));
+
+  // Writes are rejected.
+  EXPECT_THROW(table->InsertTuple(MakeRow(table_info, 201, 22), &rid, blocked_reader), TransactionAbortException);
+  CheckAborted(blocked_reader);
+  txn_mgr.Abort(blocked_reader);
+  txn_mgr.ResumeTransactions();
+
+  for (auto txn : {load, reader, writer, running_reader, blocked_reader}) {
+    delete txn;
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, PartitionExecutorTest) {
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto table = table_info->table_.get();
+  const int32_t num_partitions = 4;
+  std::vector<RID> rids(num_partitions);
+  auto add = [&](int32_t partition, int32_t delta, Transaction *txn) {
+    Tuple tuple;
+    return table->GetTuple(rids[partition], &tuple, txn) &&
+           table->UpdateTuple(
+               MakeRow(table_info, partition, tuple.GetValue(&table_info->schema_, 1).GetAs<int32_t>() + delta),
+               rids[partition], txn);
+  };
+  {
+    PartitionExecutor executor{GetTxnManager(), num_partitions};
+    std::vector<std::future<bool>> results;
+    for (int32_t i = 0; i < num_partitions; i++) {
+      results.push_back(executor.Submit(i, [&, i](Transaction *txn) {
+        EXPECT_TRUE(txn->IsSerial());
+        EXPECT_FALSE(txn->TakesLocks());
+        return table->InsertTuple(MakeRow(table_info, i, 0), &rids[i], txn);
+      }));
+    }
+    for (auto &result : results) {
+      EXPECT_TRUE(result.get());
+    }
+
+    // Every partition gets 100 increments, the aborted transactions are rolled back.
+    results.clear();
+    for (int32_t i = 0; i < 100 * num_partitions; i++) {
+      int32_t partition = i % num_partitions;
+      results.push_back(
+          executor.Submit(partition, [&, partition](Transaction *txn) { return add(partition, 1, txn); }));
+      results.push_back(executor.Submit(partition, [&, partition](Transaction *txn) {
+        add(partition, 1000, txn);
+        return false;
+      }));
+    }
+    // Moving values between partitions runs once the transactions submitted before are done.
+    EXPECT_TRUE(executor.ExecuteMultiPartition(
+        {0, 1, 1}, [&](Transaction *txn) { return add(0, -50, txn) && add(1, 50, txn); }));
+    for (size_t i = 0; i < results.size(); i++) {
+      EXPECT_EQ(results[i].get(), i % 2 == 0);
+    }
+  }
+
+  auto txn = GetTxnManager()->Begin();
+  EXPECT_EQ(ScanTable(table_info, txn), (std::map<int32_t, int32_t>{{0, 50}, {1, 150}, {2, 100}, {3, 100}}));
+  GetTxnManager()->Commit(txn);
+  delete txn;
+}
+
+// NOLINTNEXTLINE
+TEST(TransactionManagerTest, CheckpointBarrierTest) {
+  LockManager lock_manager;
+  TransactionManager txn_mgr{&lock_manager};
+  auto running = txn_mgr.Begin();
+  EXPECT_EQ(txn_mgr.GetTransaction(running->GetTransactionId()), running);
+
+  // The checkpoint waits for the running transaction.
+  std::atomic<bool> blocked{false};
+  std::thread checkpoint([&] {
+    txn_mgr.BlockAllTransactions();
+    blocked = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(blocked);
+  // A transaction may end on another thread than the one it began on.
+  std::thread([&] { txn_mgr.Commit(running); }).join();
+  checkpoint.join();
+  EXPECT_TRUE(blocked);
+
+  // New transactions wait until the checkpoint is over.
+  std::atomic<bool> begun{false};
+  std::thread waiting([&] {
+    auto txn = txn_mgr.Begin();
+    begun = true;
+    txn_mgr.Commit(txn);
+    delete txn;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(begun);
+  txn_mgr.ResumeTransactions();
+  waiting.join();
+  EXPECT_TRUE(begun);
+  delete running;
+}
+
+// The log is split into segment files named after ycsb_test.log.
+void RemoveYcsbFiles() {
+  remove("ycsb_test.db");
+  for (const auto &entry : std::filesystem::directory_iterator(".")) {
+    if (entry.path().filename().string().rfind("ycsb_test.log", 0) == 0) {
+      std::filesystem::remove(entry.path());
+    }
+  }
+}
+
+// A YCSB-style workload: every transaction reads or increments a few rows drawn from a Zipfian distribution.
+// Transactions that abort are retried until they commit. The rows must add up to the number of committed increments.
+void Ycsb(ConcurrencyMode mode, double theta) {
+  const int num_threads = 8;
+  const int num_rows = 1000;
+  const int txns_per_thread = 250;
+  const int ops_per_txn = 4;
+
+  RemoveYcsbFiles();
+  DiskManager disk_manager("ycsb_test.db");
+  LogManager log_manager(&disk_manager);
+  BufferPoolManagerInstance bpm(64, &disk_manager, &log_manager);
+  LockManager lock_manager;
+  TransactionManager txn_mgr(&lock_manager, &log_manager, mode);
+  // Locking only happens while logging.
+  log_manager.RunFlushThread();
+
+  Schema schema({Column("key", TypeId::INTEGER), Column("value", TypeId::INTEGER)});
+  auto make_row = [&](int32_t key, int32_t value) {
+    return Tuple({ValueFactory::GetIntegerValue(key), ValueFactory::GetIntegerValue(value)}, &schema);
+  };
+  auto load = txn_mgr.Begin();
+  TableHeap table(&bpm, &lock_manager, &log_manager, load, 0);
+  std::vector<RID> rids(num_rows);
+  for (int32_t i = 0; i < num_rows; i++) {
+    ASSERT_TRUE(table.InsertTuple(make_row(i, 0), &rids[i], load));
+  }
+  ASSERT_TRUE(txn_mgr.Commit(load));
+  delete load;
+
+  std::vector<double> weights(num_rows);
+  for (int i = 0; i < num_rows; i++) {
+    weights[i] = 1.0 / std::pow(i + 1, theta);
+  }
+  std::atomic<int> increments{0};
+  std::atomic<int> aborts{0};
+  auto task = [&](int thread_id) {
+    std::mt19937 gen(thread_id);
+    std::discrete_distribution<int> zipfian(weights.begin(), weights.end());
+    std::bernoulli_distribution is_update(0.5);
+    for (int i = 0; i < txns_per_thread; i++) {
+      while (true) {
+        Transaction *txn = txn_mgr.Begin();
+        int txn_increments = 0;
+        bool ok = true;
+        try {
+          for (int op = 0; op < ops_per_txn && ok; op++) {
+            RID rid = rids[zipfian(gen)];
+            Tuple tuple;
+            ok = table.GetTuple(rid, &tuple, txn);
+            if (ok && is_update(gen)) {
+              int32_t value = tuple.GetValue(&schema, 1).GetAs<int32_t>();
+              ok = table.UpdateTuple(make_row(tuple.GetValue(&schema, 0).GetAs<int32_t>(), value + 1), rid, txn);
+              txn_increments++;
+            }
+          }
+        } catch (TransactionAbortException &e) {
+          ok = false;
+        }
+        // A failed commit has aborted the transaction already.
+        bool committed = false;
+        if (ok && txn->GetState() != TransactionState::ABORTED) {
+          committed = txn_mgr.Commit(txn);
+        } else {
+          txn_mgr.Abort(txn);
+        }
+        delete txn;
+        if (committed) {
+          increments += txn_increments;
+          break;
+        }
+        aborts++;
+      }
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(task, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  auto check = txn_mgr.Begin();
+  int32_t total = 0;
+  for (auto it = table.Begin(check); it != table.End(); ++it) {
+    total += it->GetValue(&schema, 1).GetAs<int32_t>();
+  }
+  EXPECT_EQ(total, increments);
+  txn_mgr.Commit(check);
+  delete check;
+  log_manager.StopFlushThread();
+
+  LOG_INFO("%s theta %.2f: %.0f txns/s, %d aborts", mode == ConcurrencyMode::OPTIMISTIC ? "OCC" : "2PL", theta,
+           num_threads * txns_per_thread / elapsed, aborts.load());
+  disk_manager.ShutDown();
+  RemoveYcsbFiles();
+}
+
+// Compares optimistic concurrency control with two-phase locking at increasing skew
+TEST(TransactionBenchmark, YcsbSkewBenchmark) {
+  for (double theta : {0.0, 0.6, 0.9, 0.99}) {
+    Ycsb(ConcurrencyMode::TWO_PHASE_LOCKING, theta);
+    Ycsb(ConcurrencyMode::OPTIMISTIC, theta);
+  }
+}
+
+// The YCSB workload on a table partitioned by key, run by a PartitionExecutor. A transaction reads or increments
+// rows of one partition, or of two with the given probability.
+void PartitionedYcsb(double theta, double multi_partition_fraction) {
+  const int num_partitions = 8;
+  const int num_rows = 1000;
+  const int num_txns = 8 * 250;
+  const int ops_per_txn = 4;
+  const int rows_per_partition = num_rows / num_partitions;
+
+  RemoveYcsbFiles();
+  DiskManager disk_manager("ycsb_test.db");
+  LogManager log_manager(&disk_manager);
+  BufferPoolManagerInstance bpm(64, &disk_manager, &log_manager);
+  LockManager lock_manager;
+  TransactionManager txn_mgr(&lock_manager, &log_manager);
+  log_manager.RunFlushThread();
+
+  Schema schema({Column("key", TypeId::INTEGER), Column("value", TypeId::INTEGER)});
+  auto make_row = [&](int32_t key, int32_t value) {
+    return Tuple({ValueFactory::GetIntegerValue(key), ValueFactory::GetIntegerValue(value)}, &schema);
+  };
+  auto load = txn_mgr.Begin();
+  TableHeap table(&bpm, &lock_manager, &log_manager, load, 0);
+  // Row key lives in partition key % num_partitions.
+  std::vector<RID> rids(num_rows);
+  for (int32_t i = 0; i < num_rows; i++) {
+    ASSERT_TRUE(table.InsertTuple(make_row(i, 0), &rids[i], load));
+  }
+  ASSERT_TRUE(txn_mgr.Commit(load));
+  delete load;
+
+  std::vector<double> weights(rows_per_partition);
+  for (int i = 0; i < rows_per_partition; i++) {
+    weights[i] = 1.0 / std::pow(i + 1, theta);
+  }
+  std::mt19937 gen(15445);
+  std::discrete_distribution<int> zipfian(weights.begin(), weights.end());
+  std::uniform_int_distribution<int> partition(0, num_partitions - 1);
+  std::bernoulli_distribution is_multi_partition(multi_partition_fraction);
+  std::bernoulli_distribution is_update(0.5);
+  // The operations are drawn up front, the workers only run them: a row and whether to increment it.
+  std::vector<std::vector<std::pair<int, bool>>> txns(num_txns);
+  std::vector<std::vector<size_t>> txn_partitions(num_txns);
+  int increments = 0;
+  for (int i = 0; i < num_txns; i++) {
+    txn_partitions[i].push_back(partition(gen));
+    if (is_multi_partition(gen)) {
+      txn_partitions[i].push_back((txn_partitions[i][0] + 1 + partition(gen) % (num_partitions - 1)) % num_partitions);
+    }
+    for (int op = 0; op < ops_per_txn; op++) {
+      int row = zipfian(gen) * num_partitions + txn_partitions[i][op % txn_partitions[i].size()];
+      txns[i].emplace_back(row, is_update(gen));
+      increments += txns[i].back().second ? 1 : 0;
+    }
+  }
+  auto run = [&](int i) {
+    return [&, i](Transaction *txn) {
+      for (auto [row, update] : txns[i]) {
+        Tuple tuple;
+        if (!table.GetTuple(rids[row], &tuple, txn)) {
+          return false;
+        }
+        if (update && !table.UpdateTuple(make_row(row, tuple.GetValue(&schema, 1).GetAs<int32_t>() + 1), rids[row],
+                                         txn)) {
+          return false;
+        }
+      }
+      return true;
+    };
+  };
+
+  int multi_partition_txns = 0;
+  auto start = std::chrono::steady_clock::now();
+  {
+    PartitionExecutor executor(&txn_mgr, num_partitions);
+    std::vector<std::future<bool>> results;
+    for (int i = 0; i < num_txns; i++) {
+      if (txn_partitions[i].size() == 1) {
+        results.push_back(executor.Submit(txn_partitions[i][0], run(i)));
+      } else {
+        EXPECT_TRUE(executor.ExecuteMultiPartition(txn_partitions[i], run(i)));
+        multi_partition_txns++;
+      }
+    }
+    for (auto &result : results) {
+      EXPECT_TRUE(result.get());
+    }
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  auto check = txn_mgr.Begin();
+  int32_t total = 0;
+  for (auto it = table.Begin(check); it != table.End(); ++it) {
+    total += it->GetValue(&schema, 1).GetAs<int32_t>();
+  }
+  EXPECT_EQ(total, increments);
+  txn_mgr.Commit(check);
+  delete check;
+  log_manager.StopFlushThread();
+
+  LOG_INFO("Partitioned theta %.2f, %d multi-partition: %.0f txns/s", theta, multi_partition_txns,
+           num_txns / elapsed);
+  disk_manager.ShutDown();
+  RemoveYcsbFiles();
+}
+
+// Compares partitioned serial execution with two-phase locking, with and without multi-partition transactions
+TEST(TransactionBenchmark, PartitionedYcsbBenchmark) {
+  for (double theta : {0.0, 0.99}) {
+    Ycsb(ConcurrencyMode::TWO_PHASE_LOCKING, theta);
+    PartitionedYcsb(theta, 0.0);
+    PartitionedYcsb(theta, 0.1);
+  }
+}
+
 }  // namespace bustub
@@ -114,4 +114,61 @@ TEST(HashTablePageTest, DISABLED_BucketPageSampleTest) {
   delete bpm;
 }
 
+// Fills a bucket past several fingerprint groups, with keys that have more than one value
+// NOLINTNEXTLINE
+TEST(HashTablePageTest, BucketPageFingerprintTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(5, disk_manager);
+  page_id_t bucket_page_id = INVALID_PAGE_ID;
+  Page *page = bpm->NewPage(&bucket_page_id, nullptr);
+  auto bucket_page = reinterpret_cast<HashTableBucketPage<int, int, IntComparator> *>(page->GetData());
+  const HashTableBucketLayout layout = HashTableBucketPage<int, int, IntComparator>::GetLayout();
+  const auto capacity = static_cast<int>(layout.capacity_);
+
+  // Every key gets two values.
+  for (int i = 0; i < capacity; i++) {
+    uint32_t bucket_idx;
+    EXPECT_TRUE(bucket_page->Insert(i / 2, i, IntComparator(), &bucket_idx));
+    EXPECT_EQ(i, bucket_idx);
+    EXPECT_FALSE(bucket_page->Insert(i / 2, i, IntComparator()));
+  }
+  EXPECT_TRUE(bucket_page->IsFull());
+  EXPECT_EQ(capacity, bucket_page->NumReadable());
+  EXPECT_FALSE(bucket_page->Insert(capacity, capacity, IntComparator()));
+  for (int i = 0; i < capacity; i++) {
+    int key = i / 2;
+    EXPECT_EQ(HashTableBucketLayout::Fingerprint(reinterpret_cast<const char *>(&key), sizeof(int)),
+              static_cast<uint8_t>(page->GetData()[layout.FingerprintOffset() + i]));
+  }
+  for (int key = 0; key < capacity / 2; key++) {
+    std::vector<int> res;
+    EXPECT_TRUE(bucket_page->GetValue(key, IntComparator(), &res));
+    EXPECT_EQ((std::vector<int>{2 * key, 2 * key + 1}), res);
+  }
+  std::vector<int> res;
+  EXPECT_FALSE(bucket_page->GetValue(capacity, IntComparator(), &res));
+  EXPECT_FALSE(bucket_page->GetValue(-1, IntComparator(), &res));
+
+  // Removed entries are reused in order.
+  for (int i = capacity - 1; i >= 0; i -= 7) {
+    EXPECT_TRUE(bucket_page->Remove(i / 2, i, IntComparator()));
+    EXPECT_FALSE(bucket_page->Remove(i / 2, i, IntComparator()));
+    EXPECT_FALSE(bucket_page->CheckKeyValueExist(i / 2, i, IntComparator()));
+  }
+  EXPECT_FALSE(bucket_page->IsFull());
+  for (int i = (capacity - 1) % 7; i < capacity; i += 7) {
+    uint32_t bucket_idx;
+    EXPECT_TRUE(bucket_page->Insert(-i, i, IntComparator(), &bucket_idx));
+    EXPECT_EQ(i, bucket_idx);
+    EXPECT_TRUE(bucket_page->CheckKeyValueExist(-i, i, IntComparator()));
+  }
+  EXPECT_TRUE(bucket_page->IsFull());
+
+  bpm->UnpinPage(bucket_page_id, true, nullptr);
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
 }  // namespace bustub
@@ -10,7 +10,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
 #include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
@@ -18,6 +22,8 @@
 #include "container/hash/extendible_hash_table.h"
 #include "gtest/gtest.h"
 #include "murmur3/MurmurHash3.h"
+#include "storage/index/generic_key.h"
+#include "test_util.h"  // NOLINT
 
 namespace bustub {
 
@@ -117,4 +123,304 @@ TEST(HashTableTest, DISABLED_SampleTest) {
   delete bpm;
 }
 
+// Inserts and removes from many threads split and merge buckets concurrently
+// NOLINTNEXTLINE
+TEST(HashTableTest, ConcurrentInsertRemoveTest) {
+  const int num_threads = 8;
+  const int keys_per_thread = 5000;
+  auto *disk_manager = new DiskManager("hash_concurrent_test.db");
+  auto *bpm = new BufferPoolManagerInstance(256, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  auto run = [&](auto task) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back(task, i);
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  };
+  run([&](int thread_id) {
+    for (int key = thread_id; key < num_threads * keys_per_thread; key += num_threads) {
+      EXPECT_TRUE(ht.Insert(nullptr, key, key));
+    }
+  });
+  ht.VerifyIntegrity();
+  EXPECT_GT(ht.GetGlobalDepth(), 0);
+
+  // Remove the odd keys while looking up the even ones.
+  run([&](int thread_id) {
+    for (int key = thread_id; key < num_threads * keys_per_thread; key += num_threads) {
+      std::vector<int> res;
+      if (key % 2 == 1) {
+        EXPECT_TRUE(ht.Remove(nullptr, key, key));
+      } else {
+        ht.GetValue(nullptr, key, &res);
+        EXPECT_EQ(res, std::vector<int>{key});
+      }
+    }
+  });
+  ht.VerifyIntegrity();
+  for (int key = 0; key < num_threads * keys_per_thread; key++) {
+    std::vector<int> res;
+    ht.GetValue(nullptr, key, &res);
+    EXPECT_EQ(res.size(), key % 2 == 0 ? 1 : 0) << "Wrong values for key " << key;
+  }
+
+  // Emptying the table merges the buckets again.
+  uint32_t global_depth = ht.GetGlobalDepth();
+  run([&](int thread_id) {
+    for (int key = thread_id * 2; key < num_threads * keys_per_thread; key += num_threads * 2) {
+      EXPECT_TRUE(ht.Remove(nullptr, key, key));
+    }
+  });
+  ht.VerifyIntegrity();
+  EXPECT_LT(ht.GetGlobalDepth(), global_depth);
+
+  disk_manager->ShutDown();
+  remove("hash_concurrent_test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// More keys than the buckets of one directory hold split the directory, and the table keeps growing
+// NOLINTNEXTLINE
+TEST(HashTableTest, DirectorySplitTest) {
+  const int num_keys = 100000;
+  auto *disk_manager = new DiskManager("hash_directory_test.db");
+  auto *bpm = new BufferPoolManagerInstance(64, disk_manager);
+  auto key_schema = ParseCreateStatement("a bigint");
+  // Large keys fill the buckets quickly.
+  ExtendibleHashTable<GenericKey<64>, RID, GenericComparator<64>> ht(
+      "blah", bpm, GenericComparator<64>(key_schema.get()), HashFunction<GenericKey<64>>());
+  auto key = [](int64_t value) {
+    GenericKey<64> index_key;
+    index_key.SetFromInteger(value);
+    return index_key;
+  };
+
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, key(i), RID(i, i))) << "Failed to insert " << i;
+  }
+  ht.VerifyIntegrity();
+  EXPECT_GT(ht.GetGlobalDepth(), DIRECTORY_MAX_DEPTH);
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<RID> res;
+    ht.GetValue(nullptr, key(i), &res);
+    ASSERT_EQ(res, std::vector<RID>{RID(i, i)}) << "Failed to keep " << i;
+  }
+
+  for (int i = 0; i < num_keys; i += 2) {
+    ASSERT_TRUE(ht.Remove(nullptr, key(i), RID(i, i)));
+  }
+  ht.VerifyIntegrity();
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<RID> res;
+    ht.GetValue(nullptr, key(i), &res);
+    EXPECT_EQ(res.size(), i % 2) << "Wrong values for key " << i;
+  }
+
+  disk_manager->ShutDown();
+  remove("hash_directory_test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// A hot key with more values than a bucket holds gets overflow pages instead of splitting the directory to its limit
+// NOLINTNEXTLINE
+TEST(HashTableTest, OverflowTest) {
+  const int hot_key = 7;
+  const int num_values = 5000;
+  auto *disk_manager = new DiskManager("hash_overflow_test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  for (int i = 0; i < num_values; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, hot_key, i)) << "Failed to insert value " << i;
+  }
+  // Other keys still split the buckets they share with the hot key, they are told apart from it.
+  for (int key = 0; key < 1000; key++) {
+    if (key != hot_key) {
+      ASSERT_TRUE(ht.Insert(nullptr, key, key));
+    }
+  }
+  std::vector<std::pair<int, int>> batch;
+  for (int i = num_values - 10; i < num_values + 10; i++) {
+    batch.emplace_back(hot_key, i);
+  }
+  EXPECT_EQ(10, ht.InsertBatch(nullptr, batch));
+  EXPECT_FALSE(ht.Insert(nullptr, hot_key, 0));
+  EXPECT_FALSE(ht.Insert(nullptr, hot_key, num_values - 1));
+  ht.VerifyIntegrity();
+  EXPECT_LT(ht.GetGlobalDepth(), 6);
+
+  std::vector<int> res;
+  EXPECT_TRUE(ht.GetValue(nullptr, hot_key, &res));
+  std::sort(res.begin(), res.end());
+  ASSERT_EQ(res.size(), num_values + 10);
+  for (int i = 0; i < num_values + 10; i++) {
+    EXPECT_EQ(res[i], i);
+  }
+  std::vector<std::vector<int>> results;
+  EXPECT_EQ(3, ht.GetValues(nullptr, {hot_key, 0, 999, 1000}, &results));
+  EXPECT_EQ(results[0].size(), num_values + 10);
+  EXPECT_EQ(results[1], std::vector<int>{0});
+  EXPECT_EQ(results[2], std::vector<int>{999});
+  EXPECT_TRUE(results[3].empty());
+
+  // Removing the values empties the overflow pages, which are unlinked again, and the values fit back in.
+  for (int i = 0; i < num_values + 10; i++) {
+    ASSERT_TRUE(ht.Remove(nullptr, hot_key, i)) << "Failed to remove value " << i;
+  }
+  EXPECT_FALSE(ht.Remove(nullptr, hot_key, 0));
+  res.clear();
+  EXPECT_FALSE(ht.GetValue(nullptr, hot_key, &res));
+  for (int i = 0; i < num_values; i += 2) {
+    ASSERT_TRUE(ht.Insert(nullptr, hot_key, i));
+  }
+  ht.GetValue(nullptr, hot_key, &res);
+  EXPECT_EQ(res.size(), num_values / 2);
+  for (int key = 0; key < 1000; key++) {
+    res.clear();
+    ht.GetValue(nullptr, key, &res);
+    EXPECT_EQ(res.size(), key == hot_key ? num_values / 2 : 1) << "Wrong values for key " << key;
+  }
+  ht.VerifyIntegrity();
+
+  disk_manager->ShutDown();
+  remove("hash_overflow_test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// Batches group their keys by bucket, the pairs that do not fit split buckets afterwards
+// NOLINTNEXTLINE
+TEST(HashTableTest, BatchTest) {
+  auto *disk_manager = new DiskManager("hash_batch_test.db");
+  auto *bpm = new BufferPoolManagerInstance(64, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  // Every key gets two values, and each pair comes twice.
+  std::vector<std::pair<int, int>> batch;
+  for (int i = 0; i < 20000; i++) {
+    batch.emplace_back(i / 2, i);
+    batch.emplace_back(i / 2, i);
+  }
+  EXPECT_EQ(20000, ht.InsertBatch(nullptr, batch));
+  EXPECT_EQ(0, ht.InsertBatch(nullptr, batch));
+  ht.VerifyIntegrity();
+  EXPECT_GT(ht.GetGlobalDepth(), 1);
+
+  std::vector<int> keys;
+  for (int key = -5000; key < 15000; key++) {
+    keys.push_back(key);
+  }
+  std::vector<std::vector<int>> results;
+  EXPECT_EQ(10000, ht.GetValues(nullptr, keys, &results));
+  ASSERT_EQ(keys.size(), results.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    std::vector<int> res;
+    ht.GetValue(nullptr, keys[i], &res);
+    std::sort(results[i].begin(), results[i].end());
+    std::sort(res.begin(), res.end());
+    EXPECT_EQ(res, results[i]) << "Wrong values for key " << keys[i];
+    EXPECT_EQ(keys[i] >= 0 && keys[i] < 10000 ? 2 : 0, res.size());
+  }
+
+  disk_manager->ShutDown();
+  remove("hash_batch_test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// Compares looking up keys one at a time with looking them up in batches
+// NOLINTNEXTLINE
+TEST(HashTableTest, BatchBenchmark) {
+  const int num_keys = 100000;
+  const size_t batch_size = 1024;
+  auto *disk_manager = new DiskManager("hash_batch_benchmark_test.db");
+  auto *bpm = new BufferPoolManagerInstance(512, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+  std::vector<std::pair<int, int>> batch;
+  for (int key = 0; key < num_keys; key++) {
+    batch.emplace_back(key, key);
+  }
+  EXPECT_EQ(num_keys, ht.InsertBatch(nullptr, batch));
+
+  auto rate = [&](auto task) {
+    auto start = std::chrono::steady_clock::now();
+    task();
+    return num_keys / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+  double single = rate([&] {
+    std::vector<int> res;
+    for (int key = 0; key < num_keys; key++) {
+      res.clear();
+      ht.GetValue(nullptr, key, &res);
+    }
+  });
+  size_t found = 0;
+  double batched = rate([&] {
+    std::vector<int> keys;
+    std::vector<std::vector<int>> results;
+    for (int key = 0; key < num_keys; key++) {
+      keys.push_back(key);
+      if (keys.size() == batch_size || key == num_keys - 1) {
+        found += ht.GetValues(nullptr, keys, &results);
+        keys.clear();
+      }
+    }
+  });
+  EXPECT_EQ(num_keys, found);
+  LOG_INFO("single lookups: %.0f keys/s, batches of %zu: %.0f keys/s", single, batch_size, batched);
+
+  disk_manager->ShutDown();
+  remove("hash_batch_benchmark_test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// Measures insert and lookup throughput with an increasing number of threads
+// NOLINTNEXTLINE
+TEST(HashTableTest, MultiThreadedBenchmark) {
+  const int num_keys = 80000;
+  for (int num_threads : {1, 2, 4, 8}) {
+    auto *disk_manager = new DiskManager("hash_benchmark_test.db");
+    auto *bpm = new BufferPoolManagerInstance(512, disk_manager);
+    ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+    auto run = [&](auto task) {
+      auto start = std::chrono::steady_clock::now();
+      std::vector<std::thread> threads;
+      for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back(task, i);
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      return num_keys / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    double inserts = run([&](int thread_id) {
+      for (int key = thread_id; key < num_keys; key += num_threads) {
+        ht.Insert(nullptr, key, key);
+      }
+    });
+    double lookups = run([&](int thread_id) {
+      std::vector<int> res;
+      for (int key = thread_id; key < num_keys; key += num_threads) {
+        res.clear();
+        ht.GetValue(nullptr, key, &res);
+        EXPECT_EQ(res.size(), 1);
+      }
+    });
+    LOG_INFO("%d threads: %.0f inserts/s, %.0f lookups/s", num_threads, inserts, lookups);
+
+    disk_manager->ShutDown();
+    remove("hash_benchmark_test.db");
+    delete disk_manager;
+    delete bpm;
+  }
+}
+
 }  // namespace bustub
@@ -0,0 +1,211 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// linear_probe_hash_table_test.cpp
+//
+// Identification: test/container/linear_probe_hash_table_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "common/logger.h"
+#include "container/hash/extendible_hash_table.h"
+#include "container/hash/linear_probe_hash_table.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(LinearProbeHashTableTest, SampleTest) {
+  auto *disk_manager = new DiskManager("linear_probe_test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  LinearProbeHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 1000, HashFunction<int>());
+
+  // insert a few values
+  for (int i = 0; i < 5; i++) {
+    EXPECT_TRUE(ht.Insert(nullptr, i, i));
+    std::vector<int> res;
+    EXPECT_TRUE(ht.GetValue(nullptr, i, &res));
+    EXPECT_EQ(res, std::vector<int>{i});
+  }
+
+  // a key holds several values, but a key/value pair is only inserted once
+  for (int i = 0; i < 5; i++) {
+    EXPECT_FALSE(ht.Insert(nullptr, i, i));
+    EXPECT_TRUE(ht.Insert(nullptr, i, 2 * i + 1));
+    std::vector<int> res;
+    ht.GetValue(nullptr, i, &res);
+    EXPECT_EQ(res.size(), 2);
+  }
+
+  // removed pairs leave tombstones the probes for the later pairs go on past
+  for (int i = 0; i < 5; i++) {
+    EXPECT_TRUE(ht.Remove(nullptr, i, i));
+    EXPECT_FALSE(ht.Remove(nullptr, i, i));
+    std::vector<int> res;
+    EXPECT_TRUE(ht.GetValue(nullptr, i, &res));
+    EXPECT_EQ(res, std::vector<int>{2 * i + 1});
+  }
+  std::vector<int> res;
+  EXPECT_FALSE(ht.GetValue(nullptr, 20, &res));
+
+  disk_manager->ShutDown();
+  remove("linear_probe_test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// A table filled past its load factor grows, migrating its blocks while it serves lookups, inserts and removes
+// NOLINTNEXTLINE
+TEST(LinearProbeHashTableTest, ResizeTest) {
+  const int num_keys = 20000;
+  auto *disk_manager = new DiskManager("linear_probe_resize_test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  LinearProbeHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 10, HashFunction<int>());
+  size_t initial_size = ht.GetSize();
+
+  for (int key = 0; key < num_keys; key++) {
+    EXPECT_TRUE(ht.Insert(nullptr, key, key));
+  }
+  EXPECT_GE(ht.GetSize(), static_cast<size_t>(num_keys));
+  EXPECT_GT(ht.GetSize(), initial_size);
+
+  // Every operation until the old blocks are migrated finds the keys in either table.
+  size_t size = ht.GetSize();
+  ht.Resize(size);
+  EXPECT_GE(ht.GetSize(), 2 * size);
+  for (int key = 0; key < num_keys; key++) {
+    std::vector<int> res;
+    EXPECT_TRUE(ht.GetValue(nullptr, key, &res));
+    EXPECT_EQ(res, std::vector<int>{key});
+    EXPECT_FALSE(ht.Insert(nullptr, key, key));
+    if (key % 2 == 1) {
+      EXPECT_TRUE(ht.Remove(nullptr, key, key));
+    }
+  }
+  for (int key = 0; key < num_keys; key++) {
+    std::vector<int> res;
+    ht.GetValue(nullptr, key, &res);
+    EXPECT_EQ(res.size(), key % 2 == 0 ? 1 : 0) << "Wrong values for key " << key;
+  }
+
+  disk_manager->ShutDown();
+  remove("linear_probe_resize_test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// Inserts from many threads resize the table concurrently, while other threads look up and remove keys
+// NOLINTNEXTLINE
+TEST(LinearProbeHashTableTest, ConcurrentInsertRemoveTest) {
+  const int num_threads = 8;
+  const int keys_per_thread = 5000;
+  auto *disk_manager = new DiskManager("linear_probe_concurrent_test.db");
+  auto *bpm = new BufferPoolManagerInstance(256, disk_manager);
+  LinearProbeHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 10, HashFunction<int>());
+
+  auto run = [&](auto task) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back(task, i);
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  };
+  run([&](int thread_id) {
+    for (int key = thread_id; key < num_threads * keys_per_thread; key += num_threads) {
+      EXPECT_TRUE(ht.Insert(nullptr, key, key));
+    }
+  });
+
+  // Remove the odd keys and insert new ones while looking up the even ones.
+  run([&](int thread_id) {
+    for (int key = thread_id; key < num_threads * keys_per_thread; key += num_threads) {
+      std::vector<int> res;
+      if (key % 2 == 1) {
+        EXPECT_TRUE(ht.Remove(nullptr, key, key));
+        EXPECT_TRUE(ht.Insert(nullptr, key + num_threads * keys_per_thread, key));
+      } else {
+        ht.GetValue(nullptr, key, &res);
+        EXPECT_EQ(res, std::vector<int>{key});
+      }
+    }
+  });
+  for (int key = 0; key < num_threads * keys_per_thread; key++) {
+    std::vector<int> res;
+    ht.GetValue(nullptr, key, &res);
+    EXPECT_EQ(res.size(), key % 2 == 0 ? 1 : 0) << "Wrong values for key " << key;
+    res.clear();
+    ht.GetValue(nullptr, key + num_threads * keys_per_thread, &res);
+    EXPECT_EQ(res.size(), key % 2 == 1 ? 1 : 0) << "Wrong values for key " << key + num_threads * keys_per_thread;
+  }
+
+  disk_manager->ShutDown();
+  remove("linear_probe_concurrent_test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// Compares insert and lookup throughput with the extendible hash table, with an increasing number of threads
+// NOLINTNEXTLINE
+TEST(LinearProbeHashTableTest, Benchmark) {
+  const int num_keys = 80000;
+  for (int num_threads : {1, 4}) {
+    auto *disk_manager = new DiskManager("linear_probe_benchmark_test.db");
+    auto *bpm = new BufferPoolManagerInstance(1024, disk_manager);
+    LinearProbeHashTable<int, int, IntComparator> linear_probe("blah", bpm, IntComparator(), 1000,
+                                                               HashFunction<int>());
+    ExtendibleHashTable<int, int, IntComparator> extendible("blah", bpm, IntComparator(), HashFunction<int>());
+
+    auto run = [&](auto task) {
+      auto start = std::chrono::steady_clock::now();
+      std::vector<std::thread> threads;
+      for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back(task, i);
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      return num_keys / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    auto inserts = [&](auto *ht) {
+      return run([&](int thread_id) {
+        for (int key = thread_id; key < num_keys; key += num_threads) {
+          ht->Insert(nullptr, key, key);
+        }
+      });
+    };
+    auto lookups = [&](auto *ht) {
+      return run([&](int thread_id) {
+        std::vector<int> res;
+        for (int key = thread_id; key < num_keys; key += num_threads) {
+          res.clear();
+          ht->GetValue(nullptr, key, &res);
+          EXPECT_EQ(res.size(), 1);
+        }
+      });
+    };
+    double linear_probe_inserts = inserts(&linear_probe);
+    double linear_probe_lookups = lookups(&linear_probe);
+    double extendible_inserts = inserts(&extendible);
+    double extendible_lookups = lookups(&extendible);
+    LOG_INFO("%d threads: linear probing %.0f inserts/s, %.0f lookups/s; extendible %.0f inserts/s, %.0f lookups/s",
+             num_threads, linear_probe_inserts, linear_probe_lookups, extendible_inserts, extendible_lookups);
+
+    disk_manager->ShutDown();
+    remove("linear_probe_benchmark_test.db");
+    delete disk_manager;
+    delete bpm;
+  }
+}
+
+}  // namespace bustub
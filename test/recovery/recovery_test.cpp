@@ -10,19 +10,31 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <filesystem>
+#include <fstream>
+#include <random>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "common/bustub_instance.h"
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
 #include "concurrency/transaction_manager.h"
+#include "container/hash/extendible_hash_table.h"
 #include "gtest/gtest.h"
 #include "logging/common.h"
 #include "recovery/log_recovery.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/generic_key.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
+#include "test_util.h"  // NOLINT
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -31,15 +43,24 @@ class RecoveryTest : public ::testing::Test {
   // This function is called before every test.
   void SetUp() override {
     remove("test.db");
-    remove("test.log");
+    RemoveLog();
   }
 
   // This function is called after every test.
   void TearDown() override {
     LOG_INFO("Tearing down the system..");
     remove("test.db");
-    remove("test.log");
+    RemoveLog();
   };
+
+  // The log is split into segment files named after test.log.
+  static void RemoveLog() {
+    for (const auto &entry : std::filesystem::directory_iterator(".")) {
+      if (entry.path().filename().string().rfind("test.log", 0) == 0) {
+        std::filesystem::remove(entry.path());
+      }
+    }
+  }
 };
 
 // NOLINTNEXTLINE
@@ -314,4 +335,825 @@ TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
   LOG_INFO("Shutdown System");
   delete bustub_instance;
 }
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, FuzzyCheckpointTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  std::vector<RID> committed_rids;
+  for (int i = 0; i < 200; i++) {
+    RID rid;
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+    committed_rids.push_back(rid);
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // Write out one page at a time so that the checkpoint is still running while the next transaction executes.
+  checkpoint_flush_batch = 1;
+  checkpoint_flush_interval = std::chrono::milliseconds(20);
+  lsn_t begin_lsn = bustub_instance->checkpoint_manager_->BeginFuzzyCheckpoint();
+  ASSERT_NE(INVALID_LSN, begin_lsn);
+
+  // Transactions are not blocked by the running checkpoint.
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < 20; i++) {
+    RID rid;
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+    committed_rids.push_back(rid);
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  bustub_instance->checkpoint_manager_->WaitForFuzzyCheckpoint();
+  EXPECT_EQ(begin_lsn, bustub_instance->checkpoint_manager_->GetLastCheckpointLSN());
+  checkpoint_flush_batch = 16;
+  checkpoint_flush_interval = std::chrono::milliseconds(10);
+
+  // A loser transaction whose insert reaches the disk before the crash.
+  txn = bustub_instance->transaction_manager_->Begin();
+  RID loser_rid;
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &loser_rid, txn));
+  bustub_instance->buffer_pool_manager_->FlushPage(loser_rid.GetPageId());
+  delete txn;
+  delete test_table;
+
+  LOG_INFO("System crash before commit");
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery log_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery.Redo();
+  // Redo skips everything the checkpoint made durable.
+  EXPECT_NE(INVALID_LSN, log_recovery.GetRedoLSN());
+  EXPECT_LE(log_recovery.GetRedoLSN(), begin_lsn);
+  EXPECT_GT(log_recovery.GetRedoLSN(), 0);
+  log_recovery.Undo();
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple result;
+  for (const auto &rid : committed_rids) {
+    ASSERT_TRUE(test_table->GetTuple(rid, &result, txn));
+  }
+  EXPECT_FALSE(test_table->GetTuple(loser_rid, &result, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// Measures the update throughput with and without a fuzzy checkpoint writing out pages in the background
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, CheckpointThroughputBenchmark) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  // The table is larger than the buffer pool, so updates evict dirty pages whose log records are not durable yet.
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  std::vector<RID> rids;
+  for (int i = 0; i < 3000; i++) {
+    RID rid;
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+    rids.push_back(rid);
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  const int num_threads = 2;
+  const auto duration = std::chrono::milliseconds(500);
+  auto measure = [&](bool checkpoint) {
+    std::atomic<bool> stop{false};
+    std::atomic<int64_t> updates{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&, t] {
+        std::mt19937 gen(t);
+        while (!stop) {
+          Transaction *update_txn = bustub_instance->transaction_manager_->Begin();
+          for (int i = 0; i < 10; i++) {
+            // Each thread updates its own tuples, so that the threads never wait for each other's locks.
+            size_t index = gen() % (rids.size() / num_threads) * num_threads + t;
+            EXPECT_TRUE(test_table->UpdateTuple(tuple, rids[index], update_txn));
+          }
+          bustub_instance->transaction_manager_->Commit(update_txn);
+          delete update_txn;
+          updates += 10;
+        }
+      });
+    }
+    auto start = std::chrono::steady_clock::now();
+    int checkpoints = 0;
+    while (std::chrono::steady_clock::now() - start < duration) {
+      if (checkpoint) {
+        bustub_instance->checkpoint_manager_->BeginFuzzyCheckpoint();
+        bustub_instance->checkpoint_manager_->WaitForFuzzyCheckpoint();
+        checkpoints++;
+      } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+    }
+    stop = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("%s: %.0f updates/s, %d checkpoints", checkpoint ? "fuzzy checkpoints" : "no checkpoint",
+             updates / seconds, checkpoints);
+    EXPECT_GT(updates, 0);
+  };
+
+  checkpoint_flush_batch = 4;
+  checkpoint_flush_interval = std::chrono::milliseconds(1);
+  measure(false);
+  measure(true);
+  checkpoint_flush_batch = 16;
+  checkpoint_flush_interval = std::chrono::milliseconds(10);
+
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, InstantRestartTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+  const Tuple new_tuple = ConstructTuple(&schema);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  std::vector<RID> committed_rids;
+  for (int i = 0; i < 100; i++) {
+    RID rid;
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+    committed_rids.push_back(rid);
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // A loser transaction deletes, updates and inserts, and none of its pages reach the disk.
+  txn = bustub_instance->transaction_manager_->Begin();
+  txn_id_t loser_txn_id = txn->GetTransactionId();
+  RID loser_rid;
+  ASSERT_TRUE(test_table->MarkDelete(committed_rids[0], txn));
+  ASSERT_TRUE(test_table->UpdateTuple(new_tuple, committed_rids[1], txn));
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &loser_rid, txn));
+  delete txn;
+  delete test_table;
+
+  LOG_INFO("System crash before commit");
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->StartInstantRestart(bustub_instance->log_manager_, bustub_instance->lock_manager_,
+                                    bustub_instance->transaction_manager_);
+  ASSERT_TRUE(enable_logging);
+
+  // New transactions run right away, and see the committed tuples redone on demand.
+  txn = bustub_instance->transaction_manager_->Begin();
+  EXPECT_GT(txn->GetTransactionId(), loser_txn_id);
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple result;
+  ASSERT_TRUE(test_table->GetTuple(committed_rids.back(), &result, txn));
+  EXPECT_EQ(CmpBool::CmpTrue, result.GetValue(&schema, 0).CompareEquals(tuple.GetValue(&schema, 0)));
+  RID new_rid;
+  ASSERT_TRUE(test_table->InsertTuple(new_tuple, &new_rid, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  log_recovery->WaitForInstantRestart();
+  delete log_recovery;
+
+  auto check_table = [&]() {
+    txn = bustub_instance->transaction_manager_->Begin();
+    for (const auto &rid : committed_rids) {
+      ASSERT_TRUE(test_table->GetTuple(rid, &result, txn));
+      EXPECT_EQ(CmpBool::CmpTrue, result.GetValue(&schema, 0).CompareEquals(tuple.GetValue(&schema, 0)));
+    }
+    ASSERT_TRUE(test_table->GetTuple(new_rid, &result, txn));
+    EXPECT_EQ(CmpBool::CmpTrue, result.GetValue(&schema, 0).CompareEquals(new_tuple.GetValue(&schema, 0)));
+    bustub_instance->transaction_manager_->Commit(txn);
+    delete txn;
+    // The new transaction may have reused the slot of the rolled back insert. Reading a missing tuple aborts.
+    if (!(loser_rid == new_rid)) {
+      txn = bustub_instance->transaction_manager_->Begin();
+      EXPECT_FALSE(test_table->GetTuple(loser_rid, &result, txn));
+      bustub_instance->transaction_manager_->Abort(txn);
+      delete txn;
+    }
+  };
+  check_table();
+  delete test_table;
+
+  // The rollback was logged, so recovering again keeps the loser rolled back.
+  LOG_INFO("System crash after instant restart");
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+  log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  check_table();
+
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, DeltaUpdateTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"counter", TypeId::INTEGER};
+  Column col2{"name", TypeId::VARCHAR, 100};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  std::string name(80, 'x');
+  auto make_tuple = [&](int32_t counter, const std::string &name) {
+    return Tuple({ValueFactory::GetIntegerValue(counter), ValueFactory::GetVarcharValue(name)}, &schema);
+  };
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  RID counter_rid;
+  RID name_rid;
+  ASSERT_TRUE(test_table->InsertTuple(make_tuple(0, name), &counter_rid, txn));
+  ASSERT_TRUE(test_table->InsertTuple(make_tuple(0, name), &name_rid, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // Incrementing the counter only logs the changed bytes.
+  txn = bustub_instance->transaction_manager_->Begin();
+  uint64_t log_bytes = txn->GetLogBytes();
+  Tuple counter_tuple = make_tuple(1, name);
+  ASSERT_TRUE(test_table->UpdateTuple(counter_tuple, counter_rid, txn));
+  uint64_t update_bytes = txn->GetLogBytes() - log_bytes;
+  EXPECT_LT(update_bytes, counter_tuple.GetLength());
+  // Changing the size of a tuple logs both full tuples.
+  log_bytes = txn->GetLogBytes();
+  ASSERT_TRUE(test_table->UpdateTuple(make_tuple(0, name + "y"), name_rid, txn));
+  EXPECT_GT(txn->GetLogBytes() - log_bytes, 2 * counter_tuple.GetLength());
+  uint64_t appended_bytes = bustub_instance->log_manager_->GetAppendedBytes();
+  uint64_t committed_log_bytes = bustub_instance->transaction_manager_->GetCommittedLogBytes();
+  uint64_t committed_count = bustub_instance->transaction_manager_->GetCommittedCount();
+  bustub_instance->transaction_manager_->Commit(txn);
+  // The log bytes of the transaction add up in the metrics once it commits.
+  EXPECT_GT(bustub_instance->log_manager_->GetAppendedBytes(), appended_bytes);
+  EXPECT_EQ(bustub_instance->transaction_manager_->GetCommittedLogBytes(), committed_log_bytes + txn->GetLogBytes());
+  EXPECT_EQ(bustub_instance->transaction_manager_->GetCommittedCount(), committed_count + 1);
+  EXPECT_GE(bustub_instance->log_manager_->GetAppendedBytes(),
+            bustub_instance->transaction_manager_->GetCommittedLogBytes());
+  delete txn;
+
+  // A loser increments the counter again.
+  txn = bustub_instance->transaction_manager_->Begin();
+  ASSERT_TRUE(test_table->UpdateTuple(make_tuple(2, name), counter_rid, txn));
+  delete txn;
+  delete test_table;
+
+  LOG_INFO("System crash before commit");
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery log_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery.Redo();
+  log_recovery.Undo();
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple result;
+  ASSERT_TRUE(test_table->GetTuple(counter_rid, &result, txn));
+  EXPECT_EQ(1, result.GetValue(&schema, 0).GetAs<int32_t>());
+  EXPECT_EQ(name, result.GetValue(&schema, 1).ToString());
+  ASSERT_TRUE(test_table->GetTuple(name_rid, &result, txn));
+  EXPECT_EQ(name + "y", result.GetValue(&schema, 1).ToString());
+  bustub_instance->transaction_manager_->Commit(txn);
+
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// Undo restores deleted tuples at their rids and skips the changes compensated by an interrupted rollback
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, CompensationTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"id", TypeId::INTEGER};
+  Column col2{"name", TypeId::VARCHAR, 20};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  auto make_tuple = [&](int32_t id) {
+    return Tuple({ValueFactory::GetIntegerValue(id), ValueFactory::GetVarcharValue("tuple")}, &schema);
+  };
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  std::vector<RID> rids(5);
+  for (int i = 0; i < 5; i++) {
+    ASSERT_TRUE(test_table->InsertTuple(make_tuple(i), &rids[i], txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // A loser deletes three tuples for good, which frees their slots.
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i : {1, 3, 4}) {
+    ASSERT_TRUE(test_table->MarkDelete(rids[i], txn));
+  }
+  lsn_t last_delete_prev_lsn = INVALID_LSN;
+  for (int i : {1, 3, 4}) {
+    last_delete_prev_lsn = txn->GetPrevLSN();
+    test_table->ApplyDelete(rids[i], txn);
+  }
+  // Its rollback crashed after putting back the last tuple, which it logged as a CLR.
+  LogRecord clr(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERT, rids[4], make_tuple(4));
+  clr.SetCompensation(last_delete_prev_lsn);
+  txn->SetPrevLSN(bustub_instance->log_manager_->AppendLogRecord(&clr));
+  delete txn;
+  delete test_table;
+
+  LOG_INFO("System crash during rollback");
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery log_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery.Redo();
+  log_recovery.Undo();
+
+  // Every tuple is back in its own slot, and the compensated delete was not rolled back a second time.
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple result;
+  for (int i = 0; i < 5; i++) {
+    ASSERT_TRUE(test_table->GetTuple(rids[i], &result, txn));
+    EXPECT_EQ(i, result.GetValue(&schema, 0).GetAs<int32_t>());
+  }
+  int count = 0;
+  for (auto iter = test_table->Begin(txn); iter != test_table->End(); ++iter) {
+    count++;
+  }
+  EXPECT_EQ(5, count);
+  bustub_instance->transaction_manager_->Commit(txn);
+
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, LogSegmentTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"counter", TypeId::INTEGER};
+  Column col2{"name", TypeId::VARCHAR, 1000};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  // Every update changes the size of the tuple, so it logs both full tuples.
+  auto make_tuple = [&](int32_t counter) {
+    return Tuple({ValueFactory::GetIntegerValue(counter),
+                  ValueFactory::GetVarcharValue(std::string(counter % 2 == 0 ? 900 : 1000, 'x'))},
+                 &schema);
+  };
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  RID rid;
+  ASSERT_TRUE(test_table->InsertTuple(make_tuple(0), &rid, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  int32_t counter = 0;
+  auto run_updates = [&](int count) {
+    for (int i = 0; i < count; i++) {
+      txn = bustub_instance->transaction_manager_->Begin();
+      ASSERT_TRUE(test_table->UpdateTuple(make_tuple(++counter), rid, txn));
+      bustub_instance->transaction_manager_->Commit(txn);
+      delete txn;
+    }
+  };
+  // Fill more than two segments.
+  run_updates(3 * DiskManager::LOG_SEGMENT_DATA_SIZE / 1900);
+  EXPECT_TRUE(std::filesystem::exists("test.log.2"));
+
+  // A checkpoint makes the segments before it unnecessary.
+  lsn_t begin_lsn = bustub_instance->checkpoint_manager_->BeginFuzzyCheckpoint();
+  bustub_instance->checkpoint_manager_->WaitForFuzzyCheckpoint();
+  EXPECT_EQ(begin_lsn, bustub_instance->disk_manager_->GetLogCheckpointLSN());
+  EXPECT_FALSE(std::filesystem::exists("test.log.0"));
+  EXPECT_FALSE(std::filesystem::exists("test.log.1"));
+
+  // Logging goes on in recycled segments.
+  run_updates(2 * DiskManager::LOG_SEGMENT_DATA_SIZE / 1900);
+
+  // A loser update reaches the disk before the crash.
+  txn = bustub_instance->transaction_manager_->Begin();
+  ASSERT_TRUE(test_table->UpdateTuple(make_tuple(counter + 1), rid, txn));
+  bustub_instance->buffer_pool_manager_->FlushPage(rid.GetPageId());
+  delete txn;
+  delete test_table;
+
+  LOG_INFO("System crash before commit");
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery log_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery.Redo();
+  EXPECT_NE(INVALID_LSN, log_recovery.GetRedoLSN());
+  log_recovery.Undo();
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple result;
+  ASSERT_TRUE(test_table->GetTuple(rid, &result, txn));
+  EXPECT_EQ(counter, result.GetValue(&schema, 0).GetAs<int32_t>());
+  EXPECT_EQ(make_tuple(counter).GetLength(), result.GetLength());
+  bustub_instance->transaction_manager_->Commit(txn);
+
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// Recovery reads a log whose offsets are beyond the range of an int
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, LargeLogOffsetTest) {
+  // The log starts in a preallocated spare with a high number.
+  std::string segment_name = "test.log.5000";
+  std::ofstream(segment_name, std::ios::binary | std::ios::trunc | std::ios::out).close();
+  std::filesystem::resize_file(segment_name, LOG_SEGMENT_SIZE);
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  RID committed_rid;
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &committed_rid, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  EXPECT_GT(bustub_instance->disk_manager_->GetLogStartOffset(), INT32_MAX);
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  RID loser_rid;
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &loser_rid, txn));
+  bustub_instance->buffer_pool_manager_->FlushPage(loser_rid.GetPageId());
+  delete txn;
+  delete test_table;
+
+  LOG_INFO("System crash before commit");
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery log_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery.Redo();
+  log_recovery.Undo();
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple result;
+  EXPECT_TRUE(test_table->GetTuple(committed_rid, &result, txn));
+  EXPECT_FALSE(test_table->GetTuple(loser_rid, &result, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, HashIndexRecoveryTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  auto *hash_table = new ExtendibleHashTable<int, int, IntComparator>("index", bustub_instance->buffer_pool_manager_,
+                                                                      IntComparator(), HashFunction<int>(),
+                                                                      bustub_instance->log_manager_);
+  page_id_t header_page_id = hash_table->GetHeaderPageId();
+
+  // Committed inserts split buckets, and committed removes empty and merge them again.
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < 2000; i++) {
+    ASSERT_TRUE(hash_table->Insert(txn, i, i));
+  }
+  EXPECT_GT(hash_table->GetGlobalDepth(), 2);
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 10; i < 2000; i++) {
+    ASSERT_TRUE(hash_table->Remove(txn, i, i));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 2000; i < 3000; i++) {
+    ASSERT_TRUE(hash_table->Insert(txn, i, i));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // A loser inserts enough to split buckets, and removes committed entries.
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 3000; i < 4000; i++) {
+    ASSERT_TRUE(hash_table->Insert(txn, i, i));
+  }
+  for (int i = 0; i < 5; i++) {
+    ASSERT_TRUE(hash_table->Remove(txn, i, i));
+  }
+  bustub_instance->log_manager_->ForceFlush(txn->GetPrevLSN());
+  delete txn;
+  delete hash_table;
+
+  LOG_INFO("System crash before commit");
+  delete bustub_instance;
+
+  auto check_index = [&](BustubInstance *instance) {
+    ExtendibleHashTable<int, int, IntComparator> index("index", instance->buffer_pool_manager_, IntComparator(),
+                                                       HashFunction<int>(), instance->log_manager_, header_page_id);
+    index.VerifyIntegrity();
+    for (int i = 0; i < 4000; i++) {
+      std::vector<int> result;
+      bool committed = i < 10 || (i >= 2000 && i < 3000);
+      ASSERT_EQ(committed, index.GetValue(nullptr, i, &result)) << "key " << i;
+    }
+  };
+
+  // The loser's index changes are rolled back before new transactions are admitted.
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->StartInstantRestart(bustub_instance->log_manager_, bustub_instance->lock_manager_,
+                                    bustub_instance->transaction_manager_);
+  check_index(bustub_instance);
+  log_recovery->WaitForInstantRestart();
+  delete log_recovery;
+
+  // The rollback was logged, so recovering again keeps the loser rolled back.
+  LOG_INFO("System crash after instant restart");
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+  log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+  check_index(bustub_instance);
+
+  delete bustub_instance;
+}
+
+// Overflow pages of a hot key are redone, and a loser's entries on them are rolled back
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, HashIndexOverflowRecoveryTest) {
+  const int hot_key = 7;
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  auto *hash_table = new ExtendibleHashTable<int, int, IntComparator>("index", bustub_instance->buffer_pool_manager_,
+                                                                      IntComparator(), HashFunction<int>(),
+                                                                      bustub_instance->log_manager_);
+  page_id_t header_page_id = hash_table->GetHeaderPageId();
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < 2000; i++) {
+    ASSERT_TRUE(hash_table->Insert(txn, hot_key, i));
+  }
+  for (int key = 100; key < 600; key++) {
+    ASSERT_TRUE(hash_table->Insert(txn, key, key));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // A loser chains more overflow pages, and removes committed values from the ones there are.
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 2000; i < 3000; i++) {
+    ASSERT_TRUE(hash_table->Insert(txn, hot_key, i));
+  }
+  for (int i = 0; i < 1000; i += 10) {
+    ASSERT_TRUE(hash_table->Remove(txn, hot_key, i));
+  }
+  for (int key = 100; key < 110; key++) {
+    ASSERT_TRUE(hash_table->Remove(txn, key, key));
+  }
+  bustub_instance->log_manager_->ForceFlush(txn->GetPrevLSN());
+  delete txn;
+  delete hash_table;
+
+  LOG_INFO("System crash before commit");
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+  ExtendibleHashTable<int, int, IntComparator> index("index", bustub_instance->buffer_pool_manager_, IntComparator(),
+                                                     HashFunction<int>(), bustub_instance->log_manager_,
+                                                     header_page_id);
+  index.VerifyIntegrity();
+  std::vector<int> result;
+  ASSERT_TRUE(index.GetValue(nullptr, hot_key, &result));
+  std::sort(result.begin(), result.end());
+  ASSERT_EQ(result.size(), 2000);
+  for (int i = 0; i < 2000; i++) {
+    EXPECT_EQ(result[i], i);
+  }
+  for (int key = 100; key < 600; key++) {
+    result.clear();
+    ASSERT_TRUE(index.GetValue(nullptr, key, &result)) << "key " << key;
+  }
+
+  delete bustub_instance;
+}
+
+// Directory splits are redone, and a loser's entries are found through the new directories when it is rolled back
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, HashIndexDirectorySplitRecoveryTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<64> comparator(key_schema.get());
+  auto key = [](int64_t value) {
+    GenericKey<64> index_key;
+    index_key.SetFromInteger(value);
+    return index_key;
+  };
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  auto *hash_table = new ExtendibleHashTable<GenericKey<64>, RID, GenericComparator<64>>(
+      "index", bustub_instance->buffer_pool_manager_, comparator, HashFunction<GenericKey<64>>(),
+      bustub_instance->log_manager_);
+  page_id_t header_page_id = hash_table->GetHeaderPageId();
+
+  // A committed transaction and a loser both insert enough to split directories.
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < 30000; i++) {
+    ASSERT_TRUE(hash_table->Insert(txn, key(i), RID(i, i)));
+  }
+  EXPECT_GT(hash_table->GetGlobalDepth(), DIRECTORY_MAX_DEPTH);
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 30000; i < 60000; i++) {
+    ASSERT_TRUE(hash_table->Insert(txn, key(i), RID(i, i)));
+  }
+  uint32_t global_depth = hash_table->GetGlobalDepth();
+  bustub_instance->log_manager_->ForceFlush(txn->GetPrevLSN());
+  delete txn;
+  delete hash_table;
+
+  LOG_INFO("System crash before commit");
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+  ExtendibleHashTable<GenericKey<64>, RID, GenericComparator<64>> index(
+      "index", bustub_instance->buffer_pool_manager_, comparator, HashFunction<GenericKey<64>>(),
+      bustub_instance->log_manager_, header_page_id);
+  index.VerifyIntegrity();
+  // The splits themselves are not undone.
+  EXPECT_EQ(global_depth, index.GetGlobalDepth());
+  for (int i = 0; i < 60000; i++) {
+    std::vector<RID> result;
+    ASSERT_EQ(i < 30000, index.GetValue(nullptr, key(i), &result)) << "key " << i;
+  }
+
+  delete bustub_instance;
+}
+
+// B+ tree splits and merges are redone, and a loser's entries are rolled back through the tree
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, BPlusTreeRecoveryTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  auto key = [](int64_t value) {
+    GenericKey<8> index_key;
+    index_key.SetFromInteger(value);
+    return index_key;
+  };
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  page_id_t header_page_id;
+  bustub_instance->buffer_pool_manager_->NewPage(&header_page_id);
+  ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+  bustub_instance->buffer_pool_manager_->UnpinPage(header_page_id, true);
+  auto *tree = new BPlusTree<GenericKey<8>, RID, GenericComparator<8>>(
+      "index", bustub_instance->buffer_pool_manager_, comparator, 16, 8, bustub_instance->log_manager_);
+
+  // Committed inserts split pages, and committed removes merge them again.
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_TRUE(tree->Insert(key(i), RID(i, i), txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 500; i < 900; i++) {
+    tree->Remove(key(i), txn);
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // A loser inserts enough to split pages, and removes enough committed entries to merge them.
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 1000; i < 1500; i++) {
+    ASSERT_TRUE(tree->Insert(key(i), RID(i, i), txn));
+  }
+  for (int i = 0; i < 200; i++) {
+    tree->Remove(key(i), txn);
+  }
+  bustub_instance->log_manager_->ForceFlush(txn->GetPrevLSN());
+  delete txn;
+  delete tree;
+
+  LOG_INFO("System crash before commit");
+  delete bustub_instance;
+
+  auto check_index = [&](BustubInstance *instance) {
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> index("index", instance->buffer_pool_manager_, comparator, 16,
+                                                               8, instance->log_manager_);
+    ASSERT_TRUE(index.LoadRootPageId());
+    for (int i = 0; i < 1500; i++) {
+      std::vector<RID> result;
+      bool committed = i < 500 || (i >= 900 && i < 1000);
+      ASSERT_EQ(committed, index.GetValue(key(i), &result)) << "key " << i;
+    }
+    int64_t expected = 0;
+    for (auto it = index.Begin(); !it.IsEnd(); ++it) {
+      EXPECT_EQ(expected, (*it).second.GetSlotNum());
+      expected = expected == 499 ? 900 : expected + 1;
+    }
+    EXPECT_EQ(1000, expected);
+  };
+
+  // The loser's index changes are rolled back before new transactions are admitted.
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->StartInstantRestart(bustub_instance->log_manager_, bustub_instance->lock_manager_,
+                                    bustub_instance->transaction_manager_);
+  check_index(bustub_instance);
+  log_recovery->WaitForInstantRestart();
+  delete log_recovery;
+
+  // The rollback was logged, so recovering again keeps the loser rolled back.
+  LOG_INFO("System crash after instant restart");
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+  log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+  check_index(bustub_instance);
+
+  delete bustub_instance;
+}
 }  // namespace bustub
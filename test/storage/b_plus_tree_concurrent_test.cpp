@@ -14,8 +14,10 @@
 #include <cstdio>
 #include <functional>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include "common/logger.h"
 #include "gtest/gtest.h"
 #include "storage/index/b_plus_tree.h"
 #include "test_util.h"  // NOLINT
@@ -100,7 +102,7 @@ void DeleteHelperSplit(BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree
   delete transaction;
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest1) {
+TEST(BPlusTreeConcurrentTest, InsertTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -152,7 +154,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest2) {
+TEST(BPlusTreeConcurrentTest, InsertTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -203,7 +205,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest2) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest1) {
+TEST(BPlusTreeConcurrentTest, DeleteTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -245,7 +247,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest2) {
+TEST(BPlusTreeConcurrentTest, DeleteTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -288,7 +290,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest2) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_MixTest) {
+TEST(BPlusTreeConcurrentTest, MixTest) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -333,4 +335,133 @@ TEST(BPlusTreeConcurrentTest, DISABLED_MixTest) {
   remove("test.log");
 }
 
+// Small pages split and merge all the time while threads insert, remove, look up and scan keys
+// NOLINTNEXTLINE
+TEST(BPlusTreeConcurrentTest, StressTest) {
+  const int num_threads = 8;
+  const int64_t num_keys = 8000;
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(256, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < num_keys; key++) {
+    keys.push_back(key);
+  }
+  LaunchParallelTest(num_threads, InsertHelperSplit, &tree, keys, num_threads);
+
+  // Remove the odd keys and insert them again shifted past the others, while looking up and scanning the even ones.
+  auto mix = [&](uint64_t thread_itr) {
+    GenericKey<8> index_key;
+    std::vector<RID> rids;
+    for (int64_t key = thread_itr; key < num_keys; key += num_threads) {
+      index_key.SetFromInteger(key);
+      if (key % 2 == 1) {
+        tree.Remove(index_key, nullptr);
+        index_key.SetFromInteger(key + num_keys);
+        EXPECT_TRUE(tree.Insert(index_key, RID(0, key + num_keys)));
+      } else {
+        rids.clear();
+        EXPECT_TRUE(tree.GetValue(index_key, &rids));
+        EXPECT_FALSE(tree.Insert(index_key, RID(0, key)));
+      }
+      if (key % 100 == 0) {
+        int64_t previous = -1;
+        for (auto iterator = tree.Begin(index_key); !iterator.IsEnd(); ++iterator) {
+          int64_t current = (*iterator).second.GetSlotNum();
+          EXPECT_LT(previous, current);
+          previous = current;
+        }
+      }
+    }
+  };
+  LaunchParallelTest(num_threads, mix);
+
+  int64_t size = 0;
+  int64_t previous = -1;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    int64_t current = (*iterator).second.GetSlotNum();
+    EXPECT_LT(previous, current);
+    EXPECT_EQ(current < num_keys, current % 2 == 0);
+    previous = current;
+    size++;
+  }
+  EXPECT_EQ(size, num_keys);
+
+  // Removing every key from many threads merges the tree down to nothing.
+  keys.clear();
+  for (int64_t key = 0; key < 2 * num_keys; key++) {
+    keys.push_back(key);
+  }
+  LaunchParallelTest(num_threads, DeleteHelperSplit, &tree, keys, num_threads);
+  EXPECT_TRUE(tree.IsEmpty());
+  EXPECT_TRUE(tree.Begin().IsEnd());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// Measures inserts, lookups and a mix of lookups with inserts and removes with an increasing number of threads
+// NOLINTNEXTLINE
+TEST(BPlusTreeConcurrentTest, Benchmark) {
+  const int64_t num_keys = 40000;
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  for (int num_threads : {1, 2, 4, 8}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManagerInstance(1024, disk_manager);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+
+    auto run = [&](auto task) {
+      auto start = std::chrono::steady_clock::now();
+      LaunchParallelTest(num_threads, [&](uint64_t thread_itr) {
+        GenericKey<8> index_key;
+        std::vector<RID> rids;
+        // Threads go through the keys interleaved, so that they share leaves.
+        for (int64_t key = thread_itr; key < num_keys; key += num_threads) {
+          index_key.SetFromInteger(key);
+          rids.clear();
+          task(key, index_key, &rids);
+        }
+      });
+      return num_keys / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    double inserts = run([&](int64_t key, const GenericKey<8> &index_key, std::vector<RID> * /*rids*/) {
+      tree.Insert(index_key, RID(0, key));
+    });
+    double lookups = run([&](int64_t /*key*/, const GenericKey<8> &index_key, std::vector<RID> *rids) {
+      tree.GetValue(index_key, rids);
+      EXPECT_EQ(rids->size(), 1);
+    });
+    // One in ten operations writes, half of them removing a key and half of them inserting it back.
+    double mixed = run([&](int64_t key, const GenericKey<8> &index_key, std::vector<RID> *rids) {
+      if (key % 20 == 0) {
+        tree.Remove(index_key);
+      } else if (key % 20 == 10) {
+        tree.Insert(index_key, RID(0, key));
+      } else {
+        tree.GetValue(index_key, rids);
+      }
+    });
+    LOG_INFO("%d threads: %.0f inserts/s, %.0f lookups/s, %.0f mixed operations/s", num_threads, inserts, lookups,
+             mixed);
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
 }  // namespace bustub
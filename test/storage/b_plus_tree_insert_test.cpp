@@ -12,6 +12,8 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <random>
+#include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "gtest/gtest.h"
@@ -20,7 +22,7 @@
 
 namespace bustub {
 
-TEST(BPlusTreeTests, DISABLED_InsertTest1) {
+TEST(BPlusTreeTests, InsertTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -78,7 +80,7 @@ TEST(BPlusTreeTests, DISABLED_InsertTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeTests, DISABLED_InsertTest2) {
+TEST(BPlusTreeTests, InsertTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -145,4 +147,112 @@ TEST(BPlusTreeTests, DISABLED_InsertTest2) {
   remove("test.db");
   remove("test.log");
 }
+
+// Bulk loading sorts shuffled keys with duplicates and packs them into pages that later inserts and removes split
+// and merge as usual
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, BulkLoadTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  // More keys than an external sort holds in memory.
+  const int64_t num_keys = 20000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < num_keys; key++) {
+    keys.push_back(key);
+  }
+  for (int64_t key = 0; key < num_keys; key += 3) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+
+  using KeyType = GenericKey<8>;
+  using ValueType = RID;
+  struct Config {
+    int leaf_max_size_;
+    int internal_max_size_;
+    double fill_factor_;
+  };
+  const Config default_pages{static_cast<int>(LEAF_PAGE_SIZE), static_cast<int>(INTERNAL_PAGE_SIZE), 0.9};
+  for (auto config : {Config{4, 5, 0.5}, Config{4, 5, 1.0}, default_pages}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, config.leaf_max_size_,
+                                                             config.internal_max_size_);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+
+    size_t next = 0;
+    tree.BulkLoad(
+        [&](std::pair<GenericKey<8>, RID> *entry) {
+          if (next == keys.size()) {
+            return false;
+          }
+          entry->first.SetFromInteger(keys[next]);
+          entry->second = RID(0, keys[next]);
+          next++;
+          return true;
+        },
+        config.fill_factor_);
+
+    // Every leaf is at least half full, and full ones hold one key less than their max size.
+    Page *page = tree.FindLeafPage(GenericKey<8>(), true);
+    page_id = page->GetPageId();
+    page->RUnlatch();
+    bpm->UnpinPage(page_id, false);
+    int leaves = 0;
+    while (page_id != INVALID_PAGE_ID) {
+      auto *leaf = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, GenericComparator<8>> *>(
+          bpm->FetchPage(page_id)->GetData());
+      EXPECT_GE(leaf->GetSize(), leaf->GetMinSize());
+      EXPECT_LT(leaf->GetSize(), leaf->GetMaxSize());
+      bpm->UnpinPage(page_id, false);
+      page_id = leaf->GetNextPageId();
+      leaves++;
+    }
+    if (config.fill_factor_ == 1.0) {
+      EXPECT_LE(leaves, num_keys / (config.leaf_max_size_ - 1) + 2);
+    }
+
+    std::vector<RID> rids;
+    GenericKey<8> index_key;
+    for (int64_t key = 0; key < num_keys; key++) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      EXPECT_TRUE(tree.GetValue(index_key, &rids));
+    }
+    int64_t current_key = 0;
+    for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+      EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+      current_key++;
+    }
+    EXPECT_EQ(current_key, num_keys);
+
+    for (int64_t key = 0; key < num_keys; key += 2) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key);
+      index_key.SetFromInteger(key + num_keys);
+      EXPECT_TRUE(tree.Insert(index_key, RID(0, key + num_keys)));
+    }
+    int64_t count = 0;
+    int64_t previous_key = -1;
+    for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+      EXPECT_GT((*iterator).second.GetSlotNum(), previous_key);
+      EXPECT_TRUE((*iterator).second.GetSlotNum() % 2 == 1 || (*iterator).second.GetSlotNum() >= num_keys);
+      previous_key = (*iterator).second.GetSlotNum();
+      count++;
+    }
+    EXPECT_EQ(count, num_keys);
+    for (int64_t key = 0; key < 2 * num_keys; key++) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key);
+    }
+    EXPECT_TRUE(tree.IsEmpty());
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+  }
+}
 }  // namespace bustub
@@ -10,7 +10,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <cstdint>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
@@ -23,14 +27,23 @@ class DiskManagerTest : public ::testing::Test {
   // This function is called before every test.
   void SetUp() override {
     remove("test.db");
-    remove("test.log");
+    RemoveLog();
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
-    remove("test.log");
+    RemoveLog();
   };
+
+  // The log is split into segment files named after test.log.
+  static void RemoveLog() {
+    for (const auto &entry : std::filesystem::directory_iterator(".")) {
+      if (entry.path().filename().string().rfind("test.log", 0) == 0) {
+        std::filesystem::remove(entry.path());
+      }
+    }
+  }
 };
 
 // NOLINTNEXTLINE
@@ -72,6 +85,33 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   dm.ShutDown();
 }
 
+// Log offsets keep counting up with the segment numbers, past the range of an int
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LargeLogOffsetTest) {
+  // A preallocated spare with a high number is where the log starts.
+  const int segment = 5000;
+  std::string segment_name = "test.log." + std::to_string(segment);
+  std::ofstream(segment_name, std::ios::binary | std::ios::trunc | std::ios::out).close();
+  std::filesystem::resize_file(segment_name, LOG_SEGMENT_SIZE);
+
+  char buf[16] = {0};
+  char data[16] = {0};
+  auto dm = DiskManager("test.db");
+  std::strncpy(data, "A test string.", sizeof(data));
+  dm.StartLogSegment(0);
+  dm.WriteLog(data, sizeof(data));
+
+  log_offset_t offset = static_cast<log_offset_t>(segment) * DiskManager::LOG_SEGMENT_DATA_SIZE;
+  EXPECT_GT(offset, INT32_MAX);
+  EXPECT_EQ(offset, dm.GetLogStartOffset());
+  EXPECT_EQ(offset, dm.FindLogSegment(0));
+  EXPECT_TRUE(dm.ReadLog(buf, sizeof(buf), offset));
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  EXPECT_FALSE(dm.ReadLog(buf, sizeof(buf), offset - DiskManager::LOG_SEGMENT_DATA_SIZE));
+
+  dm.ShutDown();
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
@@ -0,0 +1,60 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// external_sorter_test.cpp
+//
+// Identification: test/storage/external_sorter_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/external_sorter.h"
+
+namespace bustub {
+
+// Records sorted in memory and in runs spilled through a small buffer pool, merged in one pass or in several
+// NOLINTNEXTLINE
+TEST(ExternalSorterTest, SortTest) {
+  auto *disk_manager = new DiskManager("external_sorter_test.db");
+  auto *bpm = new BufferPoolManagerInstance(10, disk_manager);
+  std::mt19937_64 gen(0);
+  const size_t records_per_page = ExternalSorter<int64_t>::RECORDS_PER_PAGE;
+
+  for (size_t memory_pages : {3, 8, 64}) {
+    for (size_t count : {static_cast<size_t>(0), records_per_page, 50 * records_per_page + 7}) {
+      std::vector<int64_t> records(count);
+      for (auto &record : records) {
+        record = static_cast<int64_t>(gen() % 1000);
+      }
+      ExternalSorter<int64_t> sorter(
+          bpm, [](const int64_t &a, const int64_t &b) { return a < b; }, memory_pages);
+      for (auto record : records) {
+        sorter.Add(record);
+      }
+      sorter.Sort();
+      std::vector<int64_t> sorted;
+      int64_t record;
+      while (sorter.Next(&record)) {
+        sorted.push_back(record);
+      }
+      std::sort(records.begin(), records.end());
+      EXPECT_EQ(sorted, records) << "Wrong order of " << count << " records sorted in " << memory_pages << " pages";
+    }
+  }
+
+  disk_manager->ShutDown();
+  remove("external_sorter_test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+}  // namespace bustub
@@ -0,0 +1,176 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// generic_key_test.cpp
+//
+// Identification: test/storage/generic_key_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <climits>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "gtest/gtest.h"
+#include "storage/index/generic_key.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+/** @return -1, 0 or 1 as the values of lhs compare to those of rhs, column by column */
+static int CompareValues(const std::vector<Value> &lhs, const std::vector<Value> &rhs) {
+  for (size_t i = 0; i < lhs.size(); i++) {
+    if (lhs[i].CompareLessThan(rhs[i]) == CmpBool::CmpTrue) {
+      return -1;
+    }
+    if (lhs[i].CompareGreaterThan(rhs[i]) == CmpBool::CmpTrue) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/** Picks one of few values, so that the later columns of keys often decide their order. */
+template <typename T>
+static T Pick(std::mt19937 *gen, const std::vector<T> &choices) {
+  return choices[(*gen)() % choices.size()];
+}
+
+// Encoded keys of every type compare as their values do, and decode to them
+// NOLINTNEXTLINE
+TEST(GenericKeyTest, OrderTest) {
+  Schema schema({Column("a", TypeId::BOOLEAN), Column("b", TypeId::TINYINT), Column("c", TypeId::SMALLINT),
+                 Column("d", TypeId::INTEGER), Column("e", TypeId::VARCHAR, 8), Column("f", TypeId::BIGINT),
+                 Column("g", TypeId::DECIMAL)});
+  GenericComparator<64> comparator(&schema);
+  std::mt19937 gen(0);
+  const int num_keys = 300;
+  std::vector<std::vector<Value>> values;
+  std::vector<GenericKey<64>> keys(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    values.push_back({ValueFactory::GetBooleanValue(Pick<bool>(&gen, {false, true})),
+                      ValueFactory::GetTinyIntValue(Pick<int8_t>(&gen, {-128 + 1, -1, 0, 127})),
+                      ValueFactory::GetSmallIntValue(Pick<int16_t>(&gen, {-300, 0, 300})),
+                      ValueFactory::GetIntegerValue(Pick<int32_t>(&gen, {INT_MIN + 1, -256, -1, 0, 1, 255, INT_MAX})),
+                      ValueFactory::GetVarcharValue(Pick<std::string>(
+                          &gen, {"", "a", std::string("a\0", 2), std::string("a\0b", 3), "ab", "b"})),
+                      ValueFactory::GetBigIntValue(Pick<int64_t>(&gen, {LLONG_MIN + 1, -(1LL << 40), 0, 1LL << 40})),
+                      ValueFactory::GetDecimalValue(Pick<double>(&gen, {-1e10, -2.5, -0.0, 0.0, 1e-10, 2.5, 1e10}))});
+    keys[i].SetFromKey(Tuple(values[i], &schema), schema);
+  }
+
+  for (int i = 0; i < num_keys; i++) {
+    for (uint32_t column = 0; column < schema.GetColumnCount(); column++) {
+      EXPECT_EQ(keys[i].ToValue(&schema, column).CompareEquals(values[i][column]), CmpBool::CmpTrue)
+          << "Wrong value of column " << column << " of key " << i;
+    }
+    for (int j = 0; j < num_keys; j++) {
+      EXPECT_EQ(comparator(keys[i], keys[j]), CompareValues(values[i], values[j]))
+          << "Wrong order of keys " << i << " and " << j;
+    }
+  }
+
+  // A key too large for its size is refused rather than truncated.
+  GenericKey<8> small_key;
+  Schema varchar_schema({Column("a", TypeId::VARCHAR, 16)});
+  Tuple long_key({ValueFactory::GetVarcharValue("too long")}, &varchar_schema);
+  EXPECT_THROW(small_key.SetFromKey(long_key, varchar_schema), Exception);
+}
+
+// Keys of a single integer compare as a word, as the integers do
+// NOLINTNEXTLINE
+TEST(GenericKeyTest, SingleIntegerTest) {
+  Schema integer_schema({Column("a", TypeId::INTEGER)});
+  Schema bigint_schema({Column("a", TypeId::BIGINT)});
+  GenericComparator<4> integer_comparator(&integer_schema);
+  GenericComparator<8> bigint_comparator(&bigint_schema);
+  std::vector<int64_t> integers{INT_MIN + 1, -65536, -256, -1, 0, 1, 255, 256, 65536, INT_MAX};
+  for (int64_t lhs : integers) {
+    for (int64_t rhs : integers) {
+      GenericKey<4> lhs_key;
+      GenericKey<4> rhs_key;
+      lhs_key.SetFromKey(Tuple({ValueFactory::GetIntegerValue(lhs)}, &integer_schema), integer_schema);
+      rhs_key.SetFromKey(Tuple({ValueFactory::GetIntegerValue(rhs)}, &integer_schema), integer_schema);
+      EXPECT_EQ(integer_comparator(lhs_key, rhs_key), (lhs > rhs) - (lhs < rhs));
+
+      // A short key set from an integer is encoded like an INTEGER column.
+      GenericKey<4> lhs_integer;
+      GenericKey<4> rhs_integer;
+      lhs_integer.SetFromInteger(lhs);
+      rhs_integer.SetFromInteger(rhs);
+      EXPECT_EQ(lhs_integer.ToString(), lhs);
+      EXPECT_EQ(0, memcmp(lhs_integer.data_, lhs_key.data_, 4));
+      EXPECT_EQ(integer_comparator(lhs_integer, rhs_integer), (lhs > rhs) - (lhs < rhs));
+
+      GenericKey<8> lhs_bigint;
+      GenericKey<8> rhs_bigint;
+      lhs_bigint.SetFromInteger(lhs * (1LL << 31));
+      rhs_bigint.SetFromInteger(rhs * (1LL << 31));
+      EXPECT_EQ(lhs_bigint.ToString(), lhs * (1LL << 31));
+      EXPECT_EQ(bigint_comparator(lhs_bigint, rhs_bigint), (lhs > rhs) - (lhs < rhs));
+    }
+  }
+}
+
+// Compares the comparators with deserializing and comparing the values of the keys, which they used to do
+// NOLINTNEXTLINE
+TEST(GenericKeyTest, Benchmark) {
+  Schema bigint_schema({Column("a", TypeId::BIGINT)});
+  Schema composite_schema({Column("a", TypeId::INTEGER), Column("b", TypeId::BIGINT), Column("c", TypeId::INTEGER)});
+  const int num_keys = 1000;
+  const int rounds = 100;
+  std::mt19937 gen(0);
+  auto rate = [&](auto compare) {
+    auto start = std::chrono::steady_clock::now();
+    int less = 0;
+    for (int round = 0; round < rounds; round++) {
+      for (int i = 1; i < num_keys; i++) {
+        less += compare(i - 1, i) < 0 ? 1 : 0;
+      }
+    }
+    EXPECT_GT(less, 0);
+    return rounds * (num_keys - 1) / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+  auto measure = [&](const char *name, auto *key_type, Schema *schema) {
+    using KeyType = std::remove_pointer_t<decltype(key_type)>;
+    std::vector<Tuple> tuples;
+    std::vector<KeyType> keys(num_keys);
+    for (int i = 0; i < num_keys; i++) {
+      std::vector<Value> values;
+      for (const auto &column : schema->GetColumns()) {
+        values.push_back(column.GetType() == TypeId::INTEGER ? ValueFactory::GetIntegerValue(gen() % 4)
+                                                             : ValueFactory::GetBigIntValue(gen()));
+      }
+      tuples.emplace_back(values, schema);
+      keys[i].SetFromKey(tuples.back(), *schema);
+    }
+    double values = rate([&](int lhs, int rhs) {
+      for (uint32_t column = 0; column < schema->GetColumnCount(); column++) {
+        Value lhs_value = tuples[lhs].GetValue(schema, column);
+        Value rhs_value = tuples[rhs].GetValue(schema, column);
+        if (lhs_value.CompareLessThan(rhs_value) == CmpBool::CmpTrue) {
+          return -1;
+        }
+        if (lhs_value.CompareGreaterThan(rhs_value) == CmpBool::CmpTrue) {
+          return 1;
+        }
+      }
+      return 0;
+    });
+    GenericComparator<sizeof(KeyType)> comparator(schema);
+    double encoded = rate([&](int lhs, int rhs) { return comparator(keys[lhs], keys[rhs]); });
+    LOG_INFO("%s: values %.0f comparisons/s, encoded keys %.0f comparisons/s", name, values, encoded);
+  };
+  measure("bigint in GenericKey<8>", static_cast<GenericKey<8> *>(nullptr), &bigint_schema);
+  measure("integer, bigint, integer in GenericKey<32>", static_cast<GenericKey<32> *>(nullptr), &composite_schema);
+}
+
+}  // namespace bustub